@@ -1,6 +1,6 @@
 /***************************************************************************//**
  * @file app.c
- * @brief Core application logic for the vendor relay node.
+ * @brief Boot, buttons and the stack callbacks of the vendor relay node.
  *******************************************************************************
  * # License
  * <b>Copyright 2022 Silicon Laboratories Inc. www.silabs.com</b>
@@ -33,13 +33,11 @@
  * maintained and there may be no bug maintenance planned for these resources.
  * Silicon Labs may update projects from time to time.
  ******************************************************************************/
-#include <stdio.h>
 #include "em_common.h"
 #include "app_assert.h"
 #include "app_log.h"
 #include "sl_status.h"
 #include "app.h"
-#include "gatt_db.h"
 
 #include "sl_btmesh_api.h"
 #include "sl_bt_api.h"
@@ -48,7 +46,9 @@
 #include "em_cmu.h"
 #include "em_gpio.h"
 
-#include "my_model_def.h"
+#include "relay_node.h"
+#include "app_profile.h"
+#include "app_time.h"
 
 #include "app_button_press.h"
 #include "sl_simple_button.h"
@@ -62,36 +62,13 @@
 /// GATT Provisioning Bearer
 #define PB_GATT                                     0x2
 
-/// Length of the display name buffer
-#define NAME_BUF_LEN                   20
-
 /// Length of device's uuid
 #define BLE_MESH_UUID_LEN_BYTE (16)
 
-#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
-#include "sl_btmesh_wstk_lcd.h"
-#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
-
-#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
-#define lcd_print(...) sl_btmesh_LCD_write(__VA_ARGS__)
-#else
-#define lcd_print(...)
-#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
-
-static my_model_t my_model = {
-  .elem_index = PRIMARY_ELEMENT,
-  .vendor_id = VENDOR_ID,
-  .model_id = MY_VENDOR_RELAY_ID,
-  .publish = 1,
-  .opcodes_len = 1,
-  .opcodes_data[0] = sensor_status
-};
-static uint8_t cache_data[16] = {0, 0, 0, 0, 0, 0, 0, 0};
-static uint16_t my_address = 0;
+static relay_node_t this_node;
 
 static void factory_reset(void);
 static void delay_reset_ms(uint32_t ms);
-static void initialize_relay_settings(void);
 
 
 /**************************************************************************//**
@@ -101,6 +78,9 @@ SL_WEAK void app_init(void)
 {
   app_log("=================\r\n");
   app_log("Relay Device\r\n");
+  app_time_init();
+  app_profile_init();
+  relay_node_init(&this_node);
   app_button_press_enable();
 }
 
@@ -116,36 +96,6 @@ SL_WEAK void app_process_action(void)
   /////////////////////////////////////////////////////////////////////////////
 }
 
-/***************************************************************************//**
- * Set device name in the GATT database. A unique name is generated using
- * the two last bytes from the Bluetooth address of this device. Name is also
- * displayed on the LCD.
- *
- * @param[in] addr  Pointer to Bluetooth address.
- ******************************************************************************/
-static void set_device_name(bd_addr *addr)
-{
-  char name[NAME_BUF_LEN];
-  sl_status_t result;
-
-  // Create unique device name using the last two bytes of the Bluetooth address
-  snprintf(name, NAME_BUF_LEN, "Relay %02x:%02x",
-           addr->addr[1], addr->addr[0]);
-
-  app_log("Device name: '%s'\r\n", name);
-
-  result = sl_bt_gatt_server_write_attribute_value(gattdb_device_name,
-                                                   0,
-                                                   strlen(name),
-                                                   (uint8_t *)name);
-  if(result) {
-    app_log("sl_bt_gatt_server_write_attribute_value() failed, code %lx\r\n", result);
-  }
-
-  // Show device name on the LCD
-  lcd_print(name, SL_BTMESH_WSTK_LCD_ROW_NAME_CFG_VAL);
-}
-
 /**************************************************************************//**
  * Bluetooth stack event handler.
  * This overrides the dummy weak implementation.
@@ -164,16 +114,23 @@ void sl_bt_on_event(struct sl_bt_msg *evt)
       }
       // Initialize Mesh stack in Node operation mode,
       // wait for initialized event
-      app_log("Node init\r\n");
+      APP_STACK_LOG("Node init\r\n");
       sc = sl_btmesh_node_init();
 
       switch (sc) {
         case 0x00: break;
-        case 0x02: app_log("Node already initialized\r\n"); break;
+        case 0x02: APP_STACK_LOG("Node already initialized\r\n"); break;
         default: app_assert_status_f(sc, "Failed to init node\r\n");
       }
       break;
 
+    // -------------------------------
+    // Handle Button Presses
+    case sl_bt_evt_system_external_signal_id:
+      app_tasks_post_cmd(&this_node.tasks,
+                         evt->data.evt_system_external_signal.extsignals);
+      break;
+
     // -------------------------------
     // Default event handler.
     default:
@@ -189,195 +146,26 @@ void sl_bt_on_event(struct sl_bt_msg *evt)
  *****************************************************************************/
 void sl_btmesh_on_event(sl_btmesh_msg_t *evt)
 {
-  sl_status_t sc;
-  switch (SL_BT_MSG_ID(evt->header)) {
-    case sl_btmesh_evt_node_initialized_id:
-      app_log("Node initialized ...\r\n");
-      sc = sl_btmesh_vendor_model_init(my_model.elem_index,
-                                       my_model.vendor_id,
-                                       my_model.model_id,
-                                       my_model.publish,
-                                       my_model.opcodes_len,
-                                       my_model.opcodes_data);
-      app_assert_status_f(sc, "Failed to initialize vendor model\r\n");
-      bd_addr address;
-      uint8_t address_type;
-      sc = sl_bt_system_get_identity_address(&address, &address_type);
-      app_assert_status_f(sc, "Failed to get Bluetooth address\r\n");
-      set_device_name(&address);
-
-      if(evt->data.evt_node_initialized.provisioned) {
-        app_log("Node already provisioned.\r\n");
-        initialize_relay_settings();
-        lcd_print("Node ready", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
-      } else {
-        app_log("Node unprovisioned\r\n");
-
-        // Start unprovisioned Beaconing using PB-ADV and PB-GATT Bearers (done automatically now)
-        app_log("Send unprovisioned beacons.\r\n");
-        lcd_print("Node unprovisioned", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
-      }
-      break;
-
-    // -------------------------------
-    // Provisioning Events
-    case sl_btmesh_evt_node_provisioned_id:
-      app_log("Provisioning done. Address: 0x%04x, IV Index: 0x%lx\r\n",
-              evt->data.evt_node_provisioned.address,
-              evt->data.evt_node_provisioned.iv_index);
-      initialize_relay_settings();
-      lcd_print("Provisioning done", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
-      break;
-
-    case sl_btmesh_evt_node_provisioning_failed_id:
-      app_log("Provisioning failed. Result = 0x%04x\r\n",
-              evt->data.evt_node_provisioning_failed.result);
-      lcd_print("Provisioning failed", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
-      break;
-
-    case sl_btmesh_evt_node_provisioning_started_id:
-      app_log("Provisioning started.\r\n");
-      lcd_print("Provisioning...", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
-      break;
-
-    case sl_btmesh_evt_node_key_added_id:
-      app_log("Got new %s key with index %x\r\n",
-              evt->data.evt_node_key_added.type == 0 ? "network " : "application ",
-              evt->data.evt_node_key_added.index);
-      break;
-
-    case sl_btmesh_evt_node_config_set_id:
-      app_log("evt_node_config_set_id\r\n\t");
-      break;
-
-    case sl_btmesh_evt_node_model_config_changed_id:
-      app_log("Model config changed, type: %d, elem_addr: %x, model_id: %x, vendor_id: %x\r\n",
-              evt->data.evt_node_model_config_changed.node_config_state,
-              evt->data.evt_node_model_config_changed.element_address,
-              evt->data.evt_node_model_config_changed.model_id,
-              evt->data.evt_node_model_config_changed.vendor_id);
-      break;
-
-      // -------------------------------
-      // Handle vendor model messages
-      case sl_btmesh_evt_vendor_model_receive_id: {
-        sl_btmesh_evt_vendor_model_receive_t *rx_evt = (sl_btmesh_evt_vendor_model_receive_t *)&evt->data;
-        if (rx_evt->source_address != my_address) {
-            // Check if payload is duplicate
-            bool is_duplicate = true;
-            for (int i = 0; i < rx_evt->payload.len; i++) {
-                if (rx_evt->payload.data[i] != cache_data[i]) {
-                    is_duplicate = false;
-                    break;
-                }
-            }
-            app_log("\r\n");
-
-            if (is_duplicate) {
-                app_log("Duplicate payload detected, skipping relay.\r\n");
-                break;
-            }
-
-            // Update cache with new payload
-            for (int i = 0; i < rx_evt->payload.len; i++) {
-                cache_data[i] = rx_evt->payload.data[i];
-            }
-
-            app_log("Vendor model data received.\r\n\t"
-                    "Element index = %d\r\n\t"
-                    "Vendor id = 0x%04X\r\n\t"
-                    "Model id = 0x%04X\r\n\t"
-                    "Source address = 0x%04X\r\n\t"
-                    "Destination address = 0x%04X\r\n\t"
-                    "Destination label UUID index = 0x%02X\r\n\t"
-                    "App key index = 0x%04X\r\n\t"
-                    "Non-relayed = 0x%02X\r\n\t"
-                    "Opcode = 0x%02X\r\n\t"
-                    "Final = 0x%04X\r\n\t"
-                    "Payload: ",
-                    rx_evt->elem_index,
-                    rx_evt->vendor_id,
-                    rx_evt->model_id,
-                    rx_evt->source_address,
-                    rx_evt->destination_address,
-                    rx_evt->va_index,
-                    rx_evt->appkey_index,
-                    rx_evt->nonrelayed,
-                    rx_evt->opcode,
-                    rx_evt->final);
-            for(int i = 0; i < rx_evt->payload.len; i++) {
-                app_log("%x ", rx_evt->payload.data[i]);
-            }
-            app_log("\r\n");
-
-            switch (rx_evt->opcode) {
-              case sensor_status:
-                int32_t temperature = 0;
-                uint32_t humidity = 0;
-                app_log("Data to be relayed:\r\n");
-                for (int8_t i = 7; i >= 4; i--) {
-                    uint8_t temp = rx_evt->payload.data[i];
-                    temperature = (temperature << 8) | temp;
-                }
-                for (int8_t i = 3; i >= 0; i--) {
-                    uint8_t temp = rx_evt->payload.data[i];
-                    humidity = (humidity << 8) | temp;
-                }
-                app_log("Temperature = %ld.%1ld Celsius\r\n",
-                        temperature / 1000,
-                        temperature % 1000);
-
-                float temp = (float) (temperature / 1000);
-                temp = temp * 1.8 + 32;
-                temperature = (int32_t) (temp * 1000);
-                app_log("Temperature = %ld.%1ld Fahrenheit\r\n",
-                        temperature / 1000,
-                        temperature % 1000);
-
-                app_log("Humidity = %ld %%\r\n",
-                        humidity / 1000);
-                break;
-
-              default:
-                break;
-            }
-            // set the vendor model publication message
-            sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
-                                                        my_model.vendor_id,
-                                                        my_model.model_id,
-                                                        rx_evt->opcode,
-                                                        rx_evt->final,
-                                                        rx_evt->payload.len,
-                                                        rx_evt->payload.data);
-            if(sc != SL_STATUS_OK) {
-                app_log("Set publication error: 0x%04lX\r\n", sc);
-            } else {
-                app_log("Set publication done. Publishing...\r\n");
-                // publish the vendor model publication message
-                sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
-                                                    my_model.vendor_id,
-                                                    my_model.model_id);
-                if(sc != SL_STATUS_OK) {
-                    app_log("Publish error: 0x%04lX\r\n", sc);
-                } else {
-                    app_log("Publish done. Relay successful.\r\n");
-                }
-            }
-        }
-        break;
-      }
+  APP_PROFILE_BEGIN(BTMESH_EVENT);
+  relay_node_on_mesh_event(&this_node, evt);
+  APP_PROFILE_END(BTMESH_EVENT);
+}
 
-    // -------------------------------
-    // Default event handler.
-    default:
-      break;
+/**************************************************************************//**
+ * Button press handler. A long press of button 0 dumps the profiling report
+ * and the traffic capture.
+ *****************************************************************************/
+void app_button_press_cb(uint8_t button, uint8_t duration)
+{
+  if (button == 0 && duration == APP_BUTTON_PRESS_DURATION_LONG) {
+    sl_bt_external_signal(EX_B0_LONG_PRESS);
   }
 }
 
 /// Reset
 static void factory_reset(void)
 {
-  app_log("Factory reset\r\n");
+  APP_STACK_LOG("Factory reset\r\n");
   sl_btmesh_node_reset();
   delay_reset_ms(100);
 }
@@ -402,38 +190,3 @@ static void delay_reset_ms(uint32_t ms)
                   false);
 
 }
-
-/**************************************************************************//**
- * Initialize relay settings for the node.
- * This function is called both for newly provisioned nodes and already provisioned nodes.
- *****************************************************************************/
-static void initialize_relay_settings(void)
-{
-  sl_status_t sc;
-  
-  app_log("Setting up relay functionality...\r\n");
-  
-  // Enable relay functionality
-  sc = sl_btmesh_test_set_relay(1, 0, 0);
-  app_assert_status_f(sc, "Failed to set relay\r\n");
-  app_log("Relay enabled\r\n");
-  
-  // Set network transmission state
-  sc = sl_btmesh_test_set_nettx(0, 0);
-  app_assert_status_f(sc, "Failed to set network tx state\r\n");
-  app_log("Network tx state set\r\n");
-  
-  // If my_address is not set yet (for already provisioned nodes), get it
-  if (my_address == 0) {
-    uint16_t node_address;
-    sc = sl_btmesh_node_get_element_address(my_model.elem_index, &node_address);
-    if (sc == SL_STATUS_OK) {
-      my_address = node_address;
-      app_log("Got node address: 0x%04x\r\n", my_address);
-    } else {
-      app_log("Failed to get node address, error: 0x%lx\r\n", sc);
-    }
-  }
-  
-  app_log("Relay initialization complete\r\n");
-}
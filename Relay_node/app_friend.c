@@ -0,0 +1,37 @@
+/***************************************************************************//**
+ * @file app_friend.c
+ * @brief Friend role of the relay.
+ ******************************************************************************/
+#include "app_assert.h"
+#include "app_log.h"
+
+#include "app_friend.h"
+#include "app_tasks.h"
+
+void app_friend_init(void)
+{
+  sl_status_t sc;
+
+  sc = sl_btmesh_friend_init();
+  app_assert_status_f(sc, "Failed to init Friend\r\n");
+  APP_STACK_LOG("Friend feature enabled\r\n");
+}
+
+void app_friend_on_event(sl_btmesh_msg_t *evt)
+{
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_btmesh_evt_friend_friendship_established_id:
+      APP_STACK_LOG("Friendship established with LPN 0x%04X\r\n",
+                    evt->data.evt_friend_friendship_established.lpn_address);
+      break;
+
+    case sl_btmesh_evt_friend_friendship_terminated_id:
+      APP_STACK_LOG("Friendship with LPN 0x%04X terminated, reason 0x%04X\r\n",
+                    evt->data.evt_friend_friendship_terminated.lpn_address,
+                    evt->data.evt_friend_friendship_terminated.reason);
+      break;
+
+    default:
+      break;
+  }
+}
@@ -0,0 +1,90 @@
+/***************************************************************************//**
+ * @file app_hops.h
+ * @brief Heartbeat-derived hop distance and publication TTL selection.
+ *
+ * Servers and relays publish Mesh heartbeats to APP_HOPS_GROUP. A node that
+ * subscribes to the heartbeats of the next node which consumes or
+ * re-originates its data learns the hop count to it from the stack. It then
+ * lowers the TTL of its own vendor model publication to that distance plus a
+ * small margin, instead of using the default TTL which floods far beyond
+ * the destination. The smallest hop count of the last two windows is used,
+ * so one detour does not raise the TTL. When heartbeats stop, the TTL that
+ * was configured originally is restored.
+ *
+ * The measurement lives in an app_hops_t owned by the caller, so a host
+ * simulation can run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_HOPS_H
+#define APP_HOPS_H
+
+#include <stdint.h>
+#include "app_timer.h"
+
+// Destination group of the hop heartbeats
+#define APP_HOPS_GROUP                  0xC003
+
+// Heartbeat period, 2^(n-1) seconds
+#define APP_HOPS_PERIOD_LOG             7
+
+// Initial TTL of the heartbeats; bounds the distance that can be measured
+#define APP_HOPS_HEARTBEAT_TTL          16
+
+// Heartbeat subscription period, 2^(n-1) seconds (0x11 is the maximum)
+#define APP_HOPS_SUB_PERIOD_LOG         0x11
+
+// Hops added to the measured distance for route changes
+#define APP_HOPS_TTL_MARGIN             1
+
+// Measurement window; a distance not confirmed for two windows expires
+#define APP_HOPS_WINDOW_MS              (4 * (1000u << (APP_HOPS_PERIOD_LOG - 1)))
+
+// Unicast address of the heartbeat source to subscribe to at start-up.
+// 0 keeps the subscription set by the provisioner.
+#ifndef APP_HOPS_SINK_ADDRESS
+#define APP_HOPS_SINK_ADDRESS           0x0000
+#endif
+
+typedef struct {
+  uint16_t pub_elem_index;
+  uint16_t pub_vendor_id;
+  uint16_t pub_model_id;
+  uint16_t sub_source;
+  uint8_t hops_cur;
+  uint8_t hops_prev;
+  uint8_t default_ttl;                  // TTL before we changed it, 0 = none
+  app_timer_t window_timer;
+} app_hops_t;
+
+/***************************************************************************//**
+ * Start publishing hop heartbeats from this node.
+ ******************************************************************************/
+void app_hops_publish(void);
+
+/***************************************************************************//**
+ * Start measuring. The TTL of the publication of the given model follows
+ * the measured distance.
+ ******************************************************************************/
+void app_hops_init(app_hops_t *hops,
+                   uint16_t elem_index,
+                   uint16_t vendor_id,
+                   uint16_t model_id);
+
+/***************************************************************************//**
+ * Subscribe to the heartbeats of @p source unless a distance to another
+ * source is currently known.
+ ******************************************************************************/
+void app_hops_subscribe(app_hops_t *hops, uint16_t source);
+
+/***************************************************************************//**
+ * Handle a sl_btmesh_evt_node_heartbeat event from @p source, @p count hops
+ * away.
+ ******************************************************************************/
+void app_hops_on_heartbeat(app_hops_t *hops, uint16_t source, uint8_t count);
+
+/***************************************************************************//**
+ * Measured hop distance, 0 if unknown.
+ ******************************************************************************/
+uint8_t app_hops_distance(const app_hops_t *hops);
+
+#endif // APP_HOPS_H
@@ -0,0 +1,98 @@
+/***************************************************************************//**
+ * @file app_profile.c
+ * @brief Lightweight scoped profiling of application hot paths.
+ ******************************************************************************/
+#include "app_profile.h"
+
+#if APP_PROFILE_ENABLE
+
+#include <string.h>
+#include "app_log.h"
+
+#if defined(__arm__)
+#include "em_device.h"
+#define APP_PROFILE_UNIT                "cycles"
+#else
+#include <time.h>
+#define APP_PROFILE_UNIT                "ns"
+#endif
+
+typedef struct {
+  uint32_t count;
+  uint32_t min;
+  uint32_t max;
+  uint64_t total;
+} app_profile_stat_t;
+
+static const char *const zone_names[APP_PROFILE_ZONE_COUNT] = {
+#define APP_PROFILE_ZONE_NAME(id, name) name,
+  APP_PROFILE_ZONES(APP_PROFILE_ZONE_NAME)
+#undef APP_PROFILE_ZONE_NAME
+};
+
+static app_profile_stat_t zone_stats[APP_PROFILE_ZONE_COUNT];
+
+void app_profile_init(void)
+{
+#if defined(__arm__)
+  // Enable the trace block and start the free-running cycle counter
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+#endif
+  app_profile_reset();
+}
+
+void app_profile_reset(void)
+{
+  memset(zone_stats, 0, sizeof(zone_stats));
+  for (int i = 0; i < APP_PROFILE_ZONE_COUNT; i++) {
+    zone_stats[i].min = UINT32_MAX;
+  }
+}
+
+uint32_t app_profile_now(void)
+{
+#if defined(__arm__)
+  return DWT->CYCCNT;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+#endif
+}
+
+void app_profile_record(app_profile_zone_t zone, uint32_t start)
+{
+  // Unsigned subtraction keeps the delta correct across one counter wrap
+  uint32_t delta = app_profile_now() - start;
+  app_profile_stat_t *stat = &zone_stats[zone];
+
+  stat->count++;
+  stat->total += delta;
+  if (delta < stat->min) {
+    stat->min = delta;
+  }
+  if (delta > stat->max) {
+    stat->max = delta;
+  }
+}
+
+void app_profile_report(void)
+{
+  app_log("Profile report (" APP_PROFILE_UNIT "):\r\n");
+  for (int i = 0; i < APP_PROFILE_ZONE_COUNT; i++) {
+    const app_profile_stat_t *stat = &zone_stats[i];
+    if (stat->count == 0) {
+      continue;
+    }
+    app_log("  %-20s count=%lu min=%lu avg=%lu max=%lu\r\n",
+            zone_names[i],
+            (unsigned long)stat->count,
+            (unsigned long)stat->min,
+            (unsigned long)(stat->total / stat->count),
+            (unsigned long)stat->max);
+  }
+}
+
+#endif // APP_PROFILE_ENABLE
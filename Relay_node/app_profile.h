@@ -0,0 +1,76 @@
+/***************************************************************************//**
+ * @file app_profile.h
+ * @brief Lightweight scoped profiling of application hot paths.
+ *
+ * Each zone keeps count/min/max/total of the time spent between
+ * APP_PROFILE_BEGIN() and APP_PROFILE_END(). On EFR32 the time base is the
+ * DWT cycle counter, on a host build it is CLOCK_MONOTONIC in nanoseconds.
+ * Define APP_PROFILE_ENABLE to 0 to compile every call out.
+ ******************************************************************************/
+
+#ifndef APP_PROFILE_H
+#define APP_PROFILE_H
+
+#include <stdint.h>
+
+#ifndef APP_PROFILE_ENABLE
+#define APP_PROFILE_ENABLE              1
+#endif
+
+// Profiling zones: X(identifier, printable name)
+#define APP_PROFILE_ZONES(X)                          \
+  X(BTMESH_EVENT,    "sl_btmesh_on_event")            \
+  X(READ_SENSOR,     "read_sensor_data")              \
+  X(RELAY_REPUBLISH, "relay republish")               \
+  X(DCD_DECODE,      "DCD_decode")
+
+typedef enum {
+#define APP_PROFILE_ZONE_ENUM(id, name) APP_PROFILE_ZONE_##id,
+  APP_PROFILE_ZONES(APP_PROFILE_ZONE_ENUM)
+#undef APP_PROFILE_ZONE_ENUM
+  APP_PROFILE_ZONE_COUNT
+} app_profile_zone_t;
+
+#if APP_PROFILE_ENABLE
+
+/***************************************************************************//**
+ * Start the time base and clear all zones.
+ ******************************************************************************/
+void app_profile_init(void);
+
+/***************************************************************************//**
+ * Clear the statistics of all zones.
+ ******************************************************************************/
+void app_profile_reset(void);
+
+/***************************************************************************//**
+ * Current value of the time base (cycles on target, ns on host).
+ ******************************************************************************/
+uint32_t app_profile_now(void);
+
+/***************************************************************************//**
+ * Account the time elapsed since @p start to @p zone.
+ ******************************************************************************/
+void app_profile_record(app_profile_zone_t zone, uint32_t start);
+
+/***************************************************************************//**
+ * Print count/min/avg/max of every zone that has been hit.
+ ******************************************************************************/
+void app_profile_report(void);
+
+#define APP_PROFILE_BEGIN(zone) \
+  uint32_t app_profile_start_##zone = app_profile_now()
+#define APP_PROFILE_END(zone) \
+  app_profile_record(APP_PROFILE_ZONE_##zone, app_profile_start_##zone)
+
+#else // APP_PROFILE_ENABLE
+
+#define app_profile_init()              ((void)0)
+#define app_profile_reset()             ((void)0)
+#define app_profile_report()            ((void)0)
+#define APP_PROFILE_BEGIN(zone)         ((void)0)
+#define APP_PROFILE_END(zone)           ((void)0)
+
+#endif // APP_PROFILE_ENABLE
+
+#endif // APP_PROFILE_H
@@ -0,0 +1,103 @@
+/***************************************************************************//**
+ * @file app_queue.h
+ * @brief Lock-free single-producer/single-consumer queue of fixed-size slots.
+ *
+ * Exactly one context may push and exactly one context may pop. The slot
+ * count must be a power of two. Items can be copied in/out with push/pop,
+ * or built and consumed in place with claim/commit and peek/release.
+ ******************************************************************************/
+
+#ifndef APP_QUEUE_H
+#define APP_QUEUE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdatomic.h>
+
+typedef struct {
+  uint8_t *slots;
+  uint16_t slot_size;
+  uint16_t mask;                        // slot count - 1
+  atomic_uint_fast16_t head;            // written by the producer only
+  atomic_uint_fast16_t tail;            // written by the consumer only
+} app_queue_t;
+
+// Define a static queue of @p count items of @p type
+#define APP_QUEUE_DEFINE(name, type, count)                             \
+  _Static_assert(((count) & ((count) - 1)) == 0,                        \
+                 #name " slot count must be a power of two");           \
+  static type name##_slots[count];                                      \
+  static app_queue_t name = {                                           \
+    .slots = (uint8_t *)name##_slots,                                   \
+    .slot_size = sizeof(type),                                          \
+    .mask = (count) - 1,                                                \
+  }
+
+static inline uint16_t app_queue_level(app_queue_t *q)
+{
+  return (uint16_t)(atomic_load_explicit(&q->head, memory_order_acquire)
+                    - atomic_load_explicit(&q->tail, memory_order_acquire));
+}
+
+// Producer: return the next free slot, or NULL if the queue is full
+static inline void *app_queue_claim(app_queue_t *q)
+{
+  uint16_t head = (uint16_t)atomic_load_explicit(&q->head, memory_order_relaxed);
+  uint16_t tail = (uint16_t)atomic_load_explicit(&q->tail, memory_order_acquire);
+
+  if ((uint16_t)(head - tail) > q->mask) {
+    return NULL;
+  }
+  return &q->slots[(head & q->mask) * q->slot_size];
+}
+
+// Producer: make the slot returned by app_queue_claim() visible
+static inline void app_queue_commit(app_queue_t *q)
+{
+  uint16_t head = (uint16_t)atomic_load_explicit(&q->head, memory_order_relaxed);
+  atomic_store_explicit(&q->head, (uint16_t)(head + 1), memory_order_release);
+}
+
+// Consumer: return the oldest item, or NULL if the queue is empty
+static inline void *app_queue_peek(app_queue_t *q)
+{
+  uint16_t tail = (uint16_t)atomic_load_explicit(&q->tail, memory_order_relaxed);
+  uint16_t head = (uint16_t)atomic_load_explicit(&q->head, memory_order_acquire);
+
+  if (head == tail) {
+    return NULL;
+  }
+  return &q->slots[(tail & q->mask) * q->slot_size];
+}
+
+// Consumer: free the slot returned by app_queue_peek()
+static inline void app_queue_release(app_queue_t *q)
+{
+  uint16_t tail = (uint16_t)atomic_load_explicit(&q->tail, memory_order_relaxed);
+  atomic_store_explicit(&q->tail, (uint16_t)(tail + 1), memory_order_release);
+}
+
+static inline bool app_queue_push(app_queue_t *q, const void *item)
+{
+  void *slot = app_queue_claim(q);
+  if (slot == NULL) {
+    return false;
+  }
+  memcpy(slot, item, q->slot_size);
+  app_queue_commit(q);
+  return true;
+}
+
+static inline bool app_queue_pop(app_queue_t *q, void *item)
+{
+  void *slot = app_queue_peek(q);
+  if (slot == NULL) {
+    return false;
+  }
+  memcpy(item, slot, q->slot_size);
+  app_queue_release(q);
+  return true;
+}
+
+#endif // APP_QUEUE_H
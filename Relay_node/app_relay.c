@@ -0,0 +1,313 @@
+/***************************************************************************//**
+ * @file app_relay.c
+ * @brief Relay decision layer: destination filter and counter-based
+ *        suppression of the application-level republish.
+ ******************************************************************************/
+#include <string.h>
+#include "app_log.h"
+#include "sl_bt_api.h"
+
+#include "app_relay.h"
+#include "app_time.h"
+
+static bool is_group(uint16_t address)
+{
+  // Fixed group addresses (0xFF00..0xFFFF) always reach everyone
+  return address >= 0xC000 && address < 0xFF00;
+}
+
+static uint32_t hash(uint16_t address)
+{
+  // Multiplicative hash; each filter hash takes its own byte of the result
+  return (uint32_t)address * 2654435761u;
+}
+
+static void filter_add(app_relay_filter_t *f, uint16_t address)
+{
+  uint32_t h = hash(address);
+  for (int i = 0; i < APP_RELAY_FILTER_HASHES; i++) {
+    uint32_t bit = (h >> (i * 8)) & (APP_RELAY_FILTER_BITS - 1);
+    f->bits[bit / 32] |= 1u << (bit % 32);
+  }
+  f->groups++;
+}
+
+static bool filter_test(const app_relay_filter_t *f, uint16_t address)
+{
+  uint32_t h = hash(address);
+  for (int i = 0; i < APP_RELAY_FILTER_HASHES; i++) {
+    uint32_t bit = (h >> (i * 8)) & (APP_RELAY_FILTER_BITS - 1);
+    if (!(f->bits[bit / 32] & (1u << (bit % 32)))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void filter_reset(app_relay_t *relay, app_relay_filter_t *f)
+{
+  memset(f, 0, sizeof(*f));
+  if (is_group(relay->own_group)) {
+    filter_add(f, relay->own_group);
+  }
+}
+
+static uint32_t random_ms(app_relay_t *relay, uint32_t min, uint32_t max)
+{
+  // xorshift32
+  relay->rng_state ^= relay->rng_state << 13;
+  relay->rng_state ^= relay->rng_state >> 17;
+  relay->rng_state ^= relay->rng_state << 5;
+  return min + relay->rng_state % (max - min + 1);
+}
+
+static void age_timer_cb(app_timer_t *handle, void *data)
+{
+  app_relay_t *relay = data;
+  (void)handle;
+  // The filter belongs to the worker; let it age there
+  sl_bt_external_signal(relay->age_signal_mask);
+}
+
+static void rad_timer_cb(app_timer_t *handle, void *data)
+{
+  app_relay_t *relay = data;
+  (void)handle;
+  // The pending messages belong to the worker; let it decide there
+  sl_bt_external_signal(relay->due_signal_mask);
+}
+
+static app_relay_pending_t *earliest(app_relay_t *relay)
+{
+  app_relay_pending_t *first = NULL;
+
+  for (int i = 0; i < APP_RELAY_PENDING_MAX; i++) {
+    app_relay_pending_t *p = &relay->pending[i];
+    if (p->valid && (first == NULL || p->due_ms < first->due_ms)) {
+      first = p;
+    }
+  }
+  return first;
+}
+
+static void arm_rad_timer(app_relay_t *relay)
+{
+  app_relay_pending_t *first = earliest(relay);
+  uint64_t now = app_time_ms();
+
+  app_timer_stop(&relay->rad_timer);
+  if (first == NULL) {
+    return;
+  }
+  app_timer_start(&relay->rad_timer,
+                  first->due_ms > now ? (uint32_t)(first->due_ms - now) : 1,
+                  rad_timer_cb,
+                  relay,
+                  false);
+}
+
+static void decide(app_relay_t *relay, app_relay_pending_t *p)
+{
+  p->valid = false;
+  if (p->heard >= APP_RELAY_SUPPRESS_COUNT && !(p->options & APP_RELAY_NO_SUPPRESS)) {
+    relay->suppressed_count++;
+    APP_TASK_LOG("Heard %u neighbour copies, relay suppressed\r\n", p->heard);
+    return;
+  }
+  relay->relayed_count++;
+  relay->publish_fn(relay, &p->msg);
+}
+
+void app_relay_init(app_relay_t *relay,
+                    uint16_t own_pub_address,
+                    app_relay_publish_fn publish,
+                    uint32_t due_signal,
+                    uint32_t age_signal)
+{
+  size_t len = 0;
+
+  app_timer_stop(&relay->age_timer);
+  app_timer_stop(&relay->rad_timer);
+  memset(relay, 0, sizeof(*relay));
+  relay->own_group = own_pub_address;
+  relay->publish_fn = publish;
+  relay->due_signal_mask = due_signal;
+  relay->age_signal_mask = age_signal;
+  relay->dup_len = APP_RELAY_DUP_CACHE_LEN;
+  filter_reset(relay, &relay->filter_cur);
+
+  if (sl_bt_system_get_random_data(sizeof(relay->rng_state), sizeof(relay->rng_state), &len,
+                                   (uint8_t *)&relay->rng_state) != SL_STATUS_OK
+      || relay->rng_state == 0) {
+    relay->rng_state = 0x9E3779B9u ^ own_pub_address;
+  }
+
+  app_timer_start(&relay->age_timer,
+                  APP_RELAY_FILTER_AGE_MS,
+                  age_timer_cb,
+                  relay,
+                  true);
+  APP_STACK_LOG("Relay filter seeded with 0x%04X\r\n", own_pub_address);
+}
+
+static bool is_known_relay(const app_relay_t *relay, uint16_t source)
+{
+  for (int i = 0; i < APP_RELAY_KNOWN_MAX; i++) {
+    if (relay->known[i] == source) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void app_relay_age(app_relay_t *relay)
+{
+  // Groups not advertised again within one generation are forgotten
+  relay->filter_prev = relay->filter_cur;
+  filter_reset(relay, &relay->filter_cur);
+}
+
+void app_relay_on_advert(app_relay_t *relay,
+                         uint16_t source,
+                         const uint8_t *data,
+                         uint8_t len)
+{
+  if (source != 0 && !is_known_relay(relay, source)) {
+    relay->known[relay->known_next] = source;
+    relay->known_next = (relay->known_next + 1) % APP_RELAY_KNOWN_MAX;
+    APP_TASK_LOG("Relay filter: 0x%04X passes adverts on\r\n", source);
+  }
+  for (uint8_t i = 0; i + 1 < len && i / 2 < APP_RELAY_ADVERT_MAX_GROUPS; i += 2) {
+    uint16_t group = (uint16_t)(data[i] | (data[i + 1] << 8));
+    if (is_group(group) && !filter_test(&relay->filter_cur, group)) {
+      filter_add(&relay->filter_cur, group);
+      APP_TASK_LOG("Relay filter: learned group 0x%04X\r\n", group);
+    }
+  }
+}
+
+bool app_relay_filter_match(const app_relay_t *relay, uint16_t destination)
+{
+  if (!is_group(destination)) {
+    // Unicast, virtual and fixed group destinations cannot be judged here
+    return true;
+  }
+  if (relay->filter_cur.groups == 0 && relay->filter_prev.groups == 0) {
+    // Nothing learned yet: behave like a plain flooding relay
+    return true;
+  }
+  return filter_test(&relay->filter_cur, destination)
+         || filter_test(&relay->filter_prev, destination);
+}
+
+void app_relay_schedule(app_relay_t *relay, const app_rx_msg_t *msg, uint8_t options)
+{
+  app_relay_pending_t *slot = NULL;
+  // A relay's reports come from all the clients behind it
+  bool mergeable = (options & APP_RELAY_LATEST_ONLY)
+                   && !is_known_relay(relay, msg->source_address);
+
+  for (int i = 0; mergeable && i < APP_RELAY_PENDING_MAX; i++) {
+    app_relay_pending_t *p = &relay->pending[i];
+    if (p->valid
+        && p->msg.opcode == msg->opcode
+        && p->msg.source_address == msg->source_address) {
+      // Superseded before it went out: send only the newer one, on the
+      // deadline already running
+      p->msg = *msg;
+      p->heard = 0;
+      relay->merged_count++;
+      return;
+    }
+  }
+
+  for (int i = 0; i < APP_RELAY_PENDING_MAX && slot == NULL; i++) {
+    if (!relay->pending[i].valid) {
+      slot = &relay->pending[i];
+    }
+  }
+  if (slot == NULL) {
+    // All held: the one due first goes out early
+    slot = earliest(relay);
+    decide(relay, slot);
+  }
+  slot->msg = *msg;
+  slot->heard = 0;
+  slot->options = options;
+  slot->due_ms = app_time_ms()
+                 + random_ms(relay, APP_RELAY_RAD_MIN_MS, APP_RELAY_RAD_MAX_MS);
+  slot->valid = true;
+  arm_rad_timer(relay);
+}
+
+bool app_relay_check_duplicate(app_relay_t *relay, const uint8_t *data, uint8_t len)
+{
+  // FNV-1a over the length and the payload; 0 marks a free entry
+  uint32_t h = 2166136261u;
+
+  h = (h ^ len) * 16777619u;
+  for (uint8_t i = 0; i < len; i++) {
+    h = (h ^ data[i]) * 16777619u;
+  }
+  if (h == 0) {
+    h = 1;
+  }
+  for (int i = 0; i < relay->dup_len; i++) {
+    if (relay->dup_hash[i] == h) {
+      return true;
+    }
+  }
+  relay->dup_hash[relay->dup_next] = h;
+  relay->dup_next = (relay->dup_next + 1) % relay->dup_len;
+  return false;
+}
+
+void app_relay_set_dup_cache_len(app_relay_t *relay, uint8_t len)
+{
+  if (len < 1) {
+    len = 1;
+  }
+  if (len > APP_RELAY_DUP_CACHE_LEN) {
+    len = APP_RELAY_DUP_CACHE_LEN;
+  }
+  memset(relay->dup_hash, 0, sizeof(relay->dup_hash));
+  relay->dup_next = 0;
+  relay->dup_len = len;
+}
+
+void app_relay_on_duplicate(app_relay_t *relay, const uint8_t *data, uint8_t len)
+{
+  for (int i = 0; i < APP_RELAY_PENDING_MAX; i++) {
+    app_relay_pending_t *p = &relay->pending[i];
+    if (p->valid && len == p->msg.len && memcmp(data, p->msg.data, len) == 0) {
+      p->heard++;
+    }
+  }
+}
+
+void app_relay_flush(app_relay_t *relay)
+{
+  uint64_t now = app_time_ms();
+
+  for (int i = 0; i < APP_RELAY_PENDING_MAX; i++) {
+    app_relay_pending_t *p = &relay->pending[i];
+    if (p->valid && p->due_ms <= now) {
+      decide(relay, p);
+    }
+  }
+  arm_rad_timer(relay);
+}
+
+void app_relay_count_filtered(app_relay_t *relay)
+{
+  relay->filtered_count++;
+}
+
+void app_relay_report(const app_relay_t *relay)
+{
+  APP_TASK_LOG("Relay: %lu relayed, %lu filtered, %lu suppressed, %lu merged\r\n",
+               (unsigned long)relay->relayed_count,
+               (unsigned long)relay->filtered_count,
+               (unsigned long)relay->suppressed_count,
+               (unsigned long)relay->merged_count);
+}
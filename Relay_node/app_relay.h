@@ -0,0 +1,199 @@
+/***************************************************************************//**
+ * @file app_relay.h
+ * @brief Relay decision layer: destination filter and counter-based
+ *        suppression of the application-level republish.
+ *
+ * Group destinations are only republished when some node downstream has
+ * subscribers on them. Those groups are kept in a two-generation Bloom
+ * filter that is filled from this node's own publication address and from
+ * relay_advert messages; the older generation is dropped periodically so
+ * stale groups age out. The aging timer only raises a signal, and the
+ * generations are swapped by app_relay_age() in the worker, which is where
+ * the filter is read and filled. Unicast and fixed group destinations are always
+ * relayed, and so is everything while nothing has been learned yet.
+ *
+ * A message that passes the filter is held for a random assessment delay,
+ * up to APP_RELAY_PENDING_MAX messages at a time, each with a deadline of
+ * its own. If enough neighbours republish the same payload meanwhile, our
+ * copy adds nothing and is suppressed. For state reports, where only the
+ * latest value matters, a newer message with the same opcode from the same
+ * source supersedes the held one and takes over its deadline.
+ *
+ * That merge is only sound for copies straight from the node that made the
+ * report. A relay republishes as a new origin, so everything it passes on
+ * carries its own address, whichever client it came from. Relays are told
+ * apart by the adverts: every relay passes each advert on, never
+ * suppressed, so each copy of an advert names a relay (or the server that
+ * made it). Copies from those addresses are held but never merged.
+ *
+ * Payloads already taken are recognised by the duplicate check, which
+ * remembers a hash of the last APP_RELAY_DUP_CACHE_LEN of them, whatever
+ * their length; app_relay_set_dup_cache_len() keeps fewer. A relay's own
+ * copy comes back from every neighbour that passes it on, under a new
+ * source address, so one entry is not enough once reports from several
+ * clients are in the air at the same time.
+ *
+ * The filter is asked about the destination of the received message, and
+ * the republished copy goes to that same destination (see republish_data()
+ * in relay_node.c), so the answer is about the address the copy is actually sent
+ * to.
+ *
+ * The state lives in an app_relay_t owned by the caller, so a host
+ * simulation can run many relays in one process.
+ ******************************************************************************/
+
+#ifndef APP_RELAY_H
+#define APP_RELAY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+#include "app_tasks.h"
+
+// Bloom filter size in bits (power of two) and number of hash functions
+#define APP_RELAY_FILTER_BITS           256
+#define APP_RELAY_FILTER_HASHES         2
+
+// Age of a filter generation before it is dropped
+#define APP_RELAY_FILTER_AGE_MS         (15 * 60 * 1000)
+
+// Random assessment delay range before republishing
+#define APP_RELAY_RAD_MIN_MS            20
+#define APP_RELAY_RAD_MAX_MS            120
+
+// Republish is suppressed after hearing this many neighbour copies
+#define APP_RELAY_SUPPRESS_COUNT        2
+
+// Messages held in their assessment delay at the same time
+#define APP_RELAY_PENDING_MAX           8
+
+// Largest number of groups carried by one relay_advert message
+#define APP_RELAY_ADVERT_MAX_GROUPS     8
+
+// Payloads remembered by the duplicate check
+#define APP_RELAY_DUP_CACHE_LEN         16
+
+// Relays remembered from their adverts; the oldest gives way
+#define APP_RELAY_KNOWN_MAX             16
+
+// Options of app_relay_schedule()
+#define APP_RELAY_LATEST_ONLY           0x01    // a newer report replaces it
+#define APP_RELAY_NO_SUPPRESS           0x02    // sent however many copies
+                                                // were heard
+
+#define APP_RELAY_FILTER_WORDS          (APP_RELAY_FILTER_BITS / 32)
+
+typedef struct app_relay app_relay_t;
+
+typedef void (*app_relay_publish_fn)(app_relay_t *relay, const app_rx_msg_t *msg);
+
+typedef struct {
+  uint32_t bits[APP_RELAY_FILTER_WORDS];
+  uint16_t groups;                      // insertions, 0 = empty
+} app_relay_filter_t;
+
+typedef struct {
+  app_rx_msg_t msg;
+  uint64_t due_ms;
+  uint8_t heard;                        // neighbour copies heard meanwhile
+  uint8_t options;                      // APP_RELAY_LATEST_ONLY, ...
+  bool valid;
+} app_relay_pending_t;
+
+struct app_relay {
+  app_relay_filter_t filter_cur;
+  app_relay_filter_t filter_prev;
+  uint16_t own_group;
+  app_relay_publish_fn publish_fn;
+  uint32_t due_signal_mask;
+  uint32_t age_signal_mask;
+  uint32_t rng_state;
+  app_timer_t age_timer;
+  app_timer_t rad_timer;                // runs to the earliest deadline
+  app_relay_pending_t pending[APP_RELAY_PENDING_MAX];
+  uint16_t known[APP_RELAY_KNOWN_MAX];  // relays, 0 = free
+  uint8_t known_next;
+  uint32_t dup_hash[APP_RELAY_DUP_CACHE_LEN]; // 0 = free
+  uint8_t dup_next;
+  uint8_t dup_len;                      // entries in use
+
+  uint32_t relayed_count;
+  uint32_t filtered_count;
+  uint32_t suppressed_count;
+  uint32_t merged_count;
+};
+
+/***************************************************************************//**
+ * Seed the filter of @p relay with @p own_pub_address and start the aging
+ * timer. @p publish is called from app_relay_flush() to actually republish,
+ * @p due_signal is raised with sl_bt_external_signal() when the assessment
+ * delay of a pending message expires, and @p age_signal every
+ * APP_RELAY_FILTER_AGE_MS for app_relay_age().
+ ******************************************************************************/
+void app_relay_init(app_relay_t *relay,
+                    uint16_t own_pub_address,
+                    app_relay_publish_fn publish,
+                    uint32_t due_signal,
+                    uint32_t age_signal);
+
+/***************************************************************************//**
+ * Start a new filter generation, forgetting the groups not advertised again
+ * since the last one. Called when @p age_signal was raised.
+ ******************************************************************************/
+void app_relay_age(app_relay_t *relay);
+
+/***************************************************************************//**
+ * Add the groups listed in a relay_advert payload to the filter and note
+ * @p source as a relay. Called for every copy heard, duplicates included.
+ ******************************************************************************/
+void app_relay_on_advert(app_relay_t *relay,
+                         uint16_t source,
+                         const uint8_t *data,
+                         uint8_t len);
+
+/***************************************************************************//**
+ * Returns true if messages to @p destination should be relayed.
+ ******************************************************************************/
+bool app_relay_filter_match(const app_relay_t *relay, uint16_t destination);
+
+/***************************************************************************//**
+ * Hold @p msg for the assessment delay. With APP_RELAY_LATEST_ONLY in
+ * @p options, a pending message with the same opcode and source is replaced,
+ * unless the source is a relay. When all slots are taken the message due
+ * first is decided early to make room.
+ ******************************************************************************/
+void app_relay_schedule(app_relay_t *relay, const app_rx_msg_t *msg, uint8_t options);
+
+/***************************************************************************//**
+ * Returns true if a payload equal to @p data was taken recently, and takes
+ * it otherwise. Payloads are compared by a 32-bit hash.
+ ******************************************************************************/
+bool app_relay_check_duplicate(app_relay_t *relay, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Remember only the last @p len payloads, 1 to APP_RELAY_DUP_CACHE_LEN, and
+ * forget those taken so far. app_relay_init() sets APP_RELAY_DUP_CACHE_LEN.
+ ******************************************************************************/
+void app_relay_set_dup_cache_len(app_relay_t *relay, uint8_t len);
+
+/***************************************************************************//**
+ * Count a neighbour copy of the payload in @p data.
+ ******************************************************************************/
+void app_relay_on_duplicate(app_relay_t *relay, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Republish or drop the pending messages whose delay expired.
+ ******************************************************************************/
+void app_relay_flush(app_relay_t *relay);
+
+/***************************************************************************//**
+ * Count a message that did not pass the filter.
+ ******************************************************************************/
+void app_relay_count_filtered(app_relay_t *relay);
+
+/***************************************************************************//**
+ * Print relayed/filtered/suppressed/merged counters.
+ ******************************************************************************/
+void app_relay_report(const app_relay_t *relay);
+
+#endif // APP_RELAY_H
@@ -0,0 +1,247 @@
+/***************************************************************************//**
+ * @file app_telemetry.c
+ * @brief Node health counters and the telemetry status vendor message.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "app_timer.h"
+#include "sl_bt_api.h"
+#include "sl_btmesh_api.h"
+
+#include "my_model_def.h"
+#include "app_telemetry.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+void app_telemetry_init(app_telemetry_t *telemetry)
+{
+  app_timer_stop(&telemetry->telemetry_timer);
+  memset(telemetry, 0, sizeof(*telemetry));
+}
+
+void app_telemetry_table_init(app_telemetry_table_t *table)
+{
+  memset(table, 0, sizeof(*table));
+}
+
+void app_telemetry_count_rx(app_telemetry_t *telemetry)
+{
+  telemetry->counters.rx++;
+}
+
+void app_telemetry_count_drop(app_telemetry_t *telemetry)
+{
+  telemetry->counters.drop++;
+}
+
+void app_telemetry_count_dup_lookup(app_telemetry_t *telemetry, bool hit)
+{
+  telemetry->counters.dup_lookups++;
+  if (hit) {
+    telemetry->counters.dup_hits++;
+  }
+}
+
+void app_telemetry_count_publish(app_telemetry_t *telemetry, sl_status_t sc)
+{
+  if (sc == SL_STATUS_OK) {
+    telemetry->counters.tx++;
+    return;
+  }
+
+  uint16_t code = (uint16_t)sc;
+  int last = APP_TELEMETRY_ERR_SLOTS - 1;
+  for (int i = 0; i < last; i++) {
+    if (telemetry->counters.pub_err[i].count == 0) {
+      telemetry->counters.pub_err[i].status = code;
+    }
+    if (telemetry->counters.pub_err[i].status == code) {
+      telemetry->counters.pub_err[i].count++;
+      return;
+    }
+  }
+  // Overflow slot: keeps the most recent code, counts all of them
+  telemetry->counters.pub_err[last].status = code;
+  telemetry->counters.pub_err[last].count++;
+}
+
+void app_telemetry_count_send(app_telemetry_t *telemetry, uint16_t destination, sl_status_t sc)
+{
+  // Unicast addresses are 0x0001..0x7FFF; 0 stands for a publication
+  if (sc == SL_STATUS_OK && destination != 0 && destination < 0x8000) {
+    return;
+  }
+  app_telemetry_count_publish(telemetry, sc);
+}
+
+void app_telemetry_queue_level(app_telemetry_t *telemetry, uint8_t level)
+{
+  if (level > telemetry->counters.queue_hwm) {
+    telemetry->counters.queue_hwm = level;
+  }
+}
+
+void app_telemetry_set_publish_period(app_telemetry_t *telemetry, uint32_t period_ms)
+{
+  telemetry->counters.publish_period_ms = period_ms;
+}
+
+void app_telemetry_snapshot(const app_telemetry_t *telemetry, app_telemetry_status_t *status)
+{
+  status->version = APP_TELEMETRY_VERSION;
+  status->queue_hwm = telemetry->counters.queue_hwm;
+  status->dup_permille = telemetry->counters.dup_lookups == 0 ? 0
+                         : (uint16_t)((uint64_t)telemetry->counters.dup_hits * 1000
+                                      / telemetry->counters.dup_lookups);
+  status->uptime_s = app_time_s();
+  status->rx_count = telemetry->counters.rx;
+  status->tx_count = telemetry->counters.tx;
+  status->drop_count = telemetry->counters.drop;
+  status->publish_period_ms = telemetry->counters.publish_period_ms;
+  memcpy(status->pub_err, telemetry->counters.pub_err, sizeof(status->pub_err));
+}
+
+sl_status_t app_telemetry_publish(app_telemetry_t *telemetry, app_telemetry_status_t *sent)
+{
+  app_telemetry_status_t status;
+  sl_status_t sc;
+
+  app_telemetry_snapshot(telemetry, &status);
+  sc = sl_btmesh_vendor_model_set_publication(telemetry->pub_elem_index,
+                                              telemetry->pub_vendor_id,
+                                              telemetry->pub_model_id,
+                                              telemetry_status,
+                                              1,
+                                              sizeof(status),
+                                              (const uint8_t *)&status);
+  if (sc == SL_STATUS_OK) {
+    sc = sl_btmesh_vendor_model_publish(telemetry->pub_elem_index,
+                                        telemetry->pub_vendor_id,
+                                        telemetry->pub_model_id);
+  }
+  app_telemetry_count_publish(telemetry, sc);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Telemetry publish error: 0x%04lX\r\n", sc);
+  }
+  if (sent != NULL) {
+    *sent = status;
+  }
+  return sc;
+}
+
+static void telemetry_timer_cb(app_timer_t *handle, void *data)
+{
+  app_telemetry_t *telemetry = data;
+
+  (void)handle;
+  // Publishing touches the stack and the counters; leave it to the worker
+  sl_bt_external_signal(telemetry->due_signal_mask);
+}
+
+void app_telemetry_bind(app_telemetry_t *telemetry,
+                        uint16_t elem_index,
+                        uint16_t vendor_id,
+                        uint16_t model_id)
+{
+  telemetry->pub_elem_index = elem_index;
+  telemetry->pub_vendor_id = vendor_id;
+  telemetry->pub_model_id = model_id;
+}
+
+void app_telemetry_start(app_telemetry_t *telemetry,
+                         uint16_t elem_index,
+                         uint16_t vendor_id,
+                         uint16_t model_id,
+                         uint32_t due_signal)
+{
+  app_telemetry_bind(telemetry, elem_index, vendor_id, model_id);
+  telemetry->due_signal_mask = due_signal;
+  app_timer_stop(&telemetry->telemetry_timer);
+  app_timer_start(&telemetry->telemetry_timer,
+                  APP_TELEMETRY_PERIOD_MS,
+                  telemetry_timer_cb,
+                  telemetry,
+                  true);
+}
+
+static app_telemetry_entry_t *table_slot(app_telemetry_table_t *table, uint16_t source)
+{
+  app_telemetry_entry_t *oldest = &table->entries[0];
+
+  for (int i = 0; i < APP_TELEMETRY_TABLE_SIZE; i++) {
+    app_telemetry_entry_t *entry = &table->entries[i];
+    if (entry->address == source || entry->address == 0) {
+      return entry;
+    }
+    if (entry->last_seen_s < oldest->last_seen_s) {
+      oldest = entry;
+    }
+  }
+  // Table full: evict the node that reported least recently
+  return oldest;
+}
+
+static void print_row(const char *prefix, uint16_t address, const app_telemetry_status_t *s)
+{
+  // One log line per row, so a row takes a single slot of the log queue
+  char row[APP_LOG_LINE_LEN];
+  int n;
+
+  if (address == 0) {
+    n = snprintf(row, sizeof(row), "%slocal ", prefix);
+  } else {
+    n = snprintf(row, sizeof(row), "%s0x%04X", prefix, address);
+  }
+  n += snprintf(&row[n], sizeof(row) - n, " %8lu %8lu %8lu %6lu %4u.%u%% %3u %8lu",
+                (unsigned long)s->uptime_s,
+                (unsigned long)s->rx_count,
+                (unsigned long)s->tx_count,
+                (unsigned long)s->drop_count,
+                s->dup_permille / 10,
+                s->dup_permille % 10,
+                s->queue_hwm,
+                (unsigned long)s->publish_period_ms);
+  for (int i = 0; i < APP_TELEMETRY_ERR_SLOTS && n < (int)sizeof(row); i++) {
+    if (s->pub_err[i].count) {
+      n += snprintf(&row[n], sizeof(row) - n, " 0x%04X:%u",
+                    s->pub_err[i].status, s->pub_err[i].count);
+    }
+  }
+  APP_TASK_LOG("%s\r\n", row);
+}
+
+void app_telemetry_on_status(app_telemetry_table_t *table,
+                             uint16_t source,
+                             const uint8_t *data,
+                             uint8_t len)
+{
+  if (len < sizeof(app_telemetry_status_t)) {
+    APP_TASK_LOG("Telemetry from 0x%04X too short (%u bytes)\r\n", source, len);
+    return;
+  }
+
+  app_telemetry_entry_t *entry = table_slot(table, source);
+  entry->address = source;
+  entry->last_seen_s = app_time_s();
+  memcpy(&entry->status, data, sizeof(entry->status));
+  if (entry->status.version != APP_TELEMETRY_VERSION) {
+    APP_TASK_LOG("Telemetry from 0x%04X has version %u\r\n",
+                 source, entry->status.version);
+  }
+  print_row("Telemetry: ", source, &entry->status);
+}
+
+void app_telemetry_print_table(const app_telemetry_t *telemetry,
+                               const app_telemetry_table_t *table)
+{
+  app_telemetry_status_t local;
+
+  app_telemetry_snapshot(telemetry, &local);
+  APP_TASK_LOG("Node     uptime       rx       tx   drop    dup hwm   period errors\r\n");
+  print_row("", 0, &local);
+  for (int i = 0; i < APP_TELEMETRY_TABLE_SIZE; i++) {
+    if (table->entries[i].address != 0) {
+      print_row("", table->entries[i].address, &table->entries[i].status);
+    }
+  }
+}
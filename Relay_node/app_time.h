@@ -0,0 +1,83 @@
+/***************************************************************************//**
+ * @file app_time.h
+ * @brief Monotonic time service on the 64-bit sleeptimer tick count.
+ *
+ * The tick frequency is read once at init. Conversions then use a shift when
+ * the frequency is a power of two, which is the usual 32768 Hz case, and a
+ * multiply-high by a rounded-up 0.64 fixed-point reciprocal otherwise, which
+ * is exact for any tick count below 2^64 / frequency. No 64-bit division runs
+ * on the hot path. The 64-bit tick base does not wrap during the life of a device; the
+ * 32-bit second counter and the uptime delta encoding use modular arithmetic
+ * and stay correct across a wrap.
+ *
+ * Uptime is published as a varint of (value << 3 | epoch << 1 | absolute).
+ * An absolute value is sent first, then every APP_TIME_ABS_EVERY messages
+ * and whenever the delta would not be shorter. In between only the seconds
+ * since the last absolute value are sent, two bytes for up to half an hour.
+ * Deltas refer to the absolute value, not the previous message, so a lost
+ * delta costs nothing; the 2-bit epoch counts absolute values, so a receiver
+ * that missed one rejects deltas until the next one arrives.
+ ******************************************************************************/
+
+#ifndef APP_TIME_H
+#define APP_TIME_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// An absolute uptime is sent at least every N messages
+#define APP_TIME_ABS_EVERY              8
+
+// Longest encoded uptime: 35 bits of varint
+#define APP_TIME_UPTIME_MAX_LEN         5
+
+typedef struct {
+  uint32_t base_s;                      // last absolute value
+  uint8_t epoch;                        // absolute values sent, modulo 4
+  uint8_t since_abs;                    // messages since the last absolute
+  bool valid;
+} app_time_uptime_enc_t;
+
+typedef struct {
+  uint32_t base_s;                      // last absolute value received
+  uint8_t epoch;
+  bool valid;
+} app_time_uptime_dec_t;
+
+/***************************************************************************//**
+ * Cache the tick frequency and precompute the conversion factors.
+ ******************************************************************************/
+void app_time_init(void);
+
+/***************************************************************************//**
+ * Current 64-bit tick count.
+ ******************************************************************************/
+uint64_t app_time_ticks(void);
+
+/***************************************************************************//**
+ * Monotonic milliseconds and seconds since boot.
+ ******************************************************************************/
+uint64_t app_time_ms(void);
+uint32_t app_time_s(void);
+
+/***************************************************************************//**
+ * Conversions between ticks and milliseconds.
+ ******************************************************************************/
+uint64_t app_time_ticks_to_ms(uint64_t ticks);
+uint64_t app_time_ms_to_ticks(uint32_t ms);
+
+/***************************************************************************//**
+ * Encode @p uptime_s into @p out (APP_TIME_UPTIME_MAX_LEN bytes) as an
+ * absolute value or a delta to the last absolute. Returns the length.
+ ******************************************************************************/
+uint8_t app_time_encode_uptime(app_time_uptime_enc_t *enc, uint32_t uptime_s, uint8_t *out);
+
+/***************************************************************************//**
+ * Decode an uptime message with the per-sender state @p dec. Returns false
+ * if the payload is malformed or is a delta without a matching base.
+ ******************************************************************************/
+bool app_time_decode_uptime(app_time_uptime_dec_t *dec,
+                            const uint8_t *data, uint8_t len,
+                            uint32_t *uptime_s);
+
+#endif // APP_TIME_H
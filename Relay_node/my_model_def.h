@@ -42,9 +42,13 @@
 
 #define MY_VENDOR_RELAY_ID              0x3333
 
-#define NUMBER_OF_OPCODES               1
+#define NUMBER_OF_OPCODES               5
 
 #define sensor_status                   0x1
+#define telemetry_status                0x5
+#define relay_advert                    0x6
+#define ctrl_command                    0xB
+#define ctrl_ack                        0xC
 
 typedef struct {
   uint16_t elem_index;
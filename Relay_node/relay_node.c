@@ -0,0 +1,540 @@
+/***************************************************************************//**
+ * @file relay_node.c
+ * @brief Mesh side of the vendor relay node: event dispatch, relaying and
+ *        control commands.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "app_assert.h"
+#include "app_log.h"
+#include "sl_status.h"
+#include "gatt_db.h"
+
+#include "sl_btmesh_api.h"
+#include "sl_bt_api.h"
+
+#include "my_model_def.h"
+#include "relay_node.h"
+#include "app_profile.h"
+#include "app_ctrl.h"
+#include "app_friend.h"
+#include "app_sensor_codec.h"
+
+/// Length of the display name buffer
+#define NAME_BUF_LEN                   20
+
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#include "sl_btmesh_wstk_lcd.h"
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#define lcd_print(...) sl_btmesh_LCD_write(__VA_ARGS__)
+#else
+#define lcd_print(...)
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+static my_model_t my_model = {
+  .elem_index = PRIMARY_ELEMENT,
+  .vendor_id = VENDOR_ID,
+  .model_id = MY_VENDOR_RELAY_ID,
+  .publish = 1,
+  .opcodes_len = NUMBER_OF_OPCODES,
+  .opcodes_data[0] = sensor_status,
+  .opcodes_data[1] = telemetry_status,
+  .opcodes_data[2] = relay_advert,
+  .opcodes_data[3] = ctrl_command,
+  .opcodes_data[4] = ctrl_ack
+};
+
+// Node that owns the module instance @p ptr, a member @p member of it
+#define NODE_OF(ptr, member) \
+  ((relay_node_t *)((uint8_t *)(ptr) - offsetof(relay_node_t, member)))
+
+static void initialize_relay_settings(relay_node_t *node);
+static void relay_republish(app_relay_t *relay, const app_rx_msg_t *msg);
+static void relay_on_rx(relay_node_t *node, const app_rx_msg_t *msg);
+static void handle_ctrl(relay_node_t *node, const app_rx_msg_t *msg);
+static void republish_data(relay_node_t *node, const app_rx_msg_t *msg,
+                           const uint8_t *data, uint8_t len);
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg);
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd);
+
+void relay_node_init(relay_node_t *node)
+{
+  app_capture_init(&node->capture);
+  app_telemetry_init(&node->telemetry);
+  app_reasm_init(&node->reasm);
+  app_tasks_init(&node->tasks, &node->telemetry, worker_on_rx, worker_on_cmd);
+}
+
+/***************************************************************************//**
+ * Set device name in the GATT database. A unique name is generated using
+ * the two last bytes from the Bluetooth address of this device. Name is also
+ * displayed on the LCD.
+ *
+ * @param[in] addr  Pointer to Bluetooth address.
+ ******************************************************************************/
+static void set_device_name(bd_addr *addr)
+{
+  char name[NAME_BUF_LEN];
+  sl_status_t result;
+
+  // Create unique device name using the last two bytes of the Bluetooth address
+  snprintf(name, NAME_BUF_LEN, "Relay %02x:%02x",
+           addr->addr[1], addr->addr[0]);
+
+  APP_STACK_LOG("Device name: '%s'\r\n", name);
+
+  result = sl_bt_gatt_server_write_attribute_value(gattdb_device_name,
+                                                   0,
+                                                   strlen(name),
+                                                   (uint8_t *)name);
+  if(result) {
+    APP_STACK_LOG("sl_bt_gatt_server_write_attribute_value() failed, code %lx\r\n", result);
+  }
+
+  // Show device name on the LCD
+  APP_STACK_LCD(name, SL_BTMESH_WSTK_LCD_ROW_NAME_CFG_VAL);
+}
+
+void relay_node_on_mesh_event(relay_node_t *node, sl_btmesh_msg_t *evt)
+{
+  sl_status_t sc;
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_btmesh_evt_node_initialized_id:
+      APP_STACK_LOG("Node initialized ...\r\n");
+      sc = sl_btmesh_vendor_model_init(my_model.elem_index,
+                                       my_model.vendor_id,
+                                       my_model.model_id,
+                                       my_model.publish,
+                                       my_model.opcodes_len,
+                                       my_model.opcodes_data);
+      app_assert_status_f(sc, "Failed to initialize vendor model\r\n");
+      bd_addr address;
+      uint8_t address_type;
+      sc = sl_bt_system_get_identity_address(&address, &address_type);
+      app_assert_status_f(sc, "Failed to get Bluetooth address\r\n");
+      set_device_name(&address);
+
+      if(evt->data.evt_node_initialized.provisioned) {
+        APP_STACK_LOG("Node already provisioned.\r\n");
+        initialize_relay_settings(node);
+        APP_STACK_LCD("Node ready", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      } else {
+        APP_STACK_LOG("Node unprovisioned\r\n");
+
+        // Start unprovisioned Beaconing using PB-ADV and PB-GATT Bearers (done automatically now)
+        APP_STACK_LOG("Send unprovisioned beacons.\r\n");
+        APP_STACK_LCD("Node unprovisioned", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      }
+      break;
+
+    // -------------------------------
+    // Provisioning Events
+    case sl_btmesh_evt_node_provisioned_id:
+      APP_STACK_LOG("Provisioning done. Address: 0x%04x, IV Index: 0x%lx\r\n",
+                    evt->data.evt_node_provisioned.address,
+                    evt->data.evt_node_provisioned.iv_index);
+      initialize_relay_settings(node);
+      APP_STACK_LCD("Provisioning done", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_provisioning_failed_id:
+      APP_STACK_LOG("Provisioning failed. Result = 0x%04x\r\n",
+                    evt->data.evt_node_provisioning_failed.result);
+      APP_STACK_LCD("Provisioning failed", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_provisioning_started_id:
+      APP_STACK_LOG("Provisioning started.\r\n");
+      APP_STACK_LCD("Provisioning...", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_key_added_id:
+      APP_STACK_LOG("Got new %s key with index %x\r\n",
+                    evt->data.evt_node_key_added.type == 0 ? "network " : "application ",
+                    evt->data.evt_node_key_added.index);
+      break;
+
+    case sl_btmesh_evt_node_config_set_id:
+      APP_STACK_LOG("evt_node_config_set_id\r\n\t");
+      break;
+
+    case sl_btmesh_evt_node_model_config_changed_id:
+      APP_STACK_LOG("Model config changed, type: %d, elem_addr: %x, model_id: %x, vendor_id: %x\r\n",
+                    evt->data.evt_node_model_config_changed.node_config_state,
+                    evt->data.evt_node_model_config_changed.element_address,
+                    evt->data.evt_node_model_config_changed.model_id,
+                    evt->data.evt_node_model_config_changed.vendor_id);
+      break;
+
+    // -------------------------------
+    // Heartbeats give the hop distance to the next hop of our data
+    case sl_btmesh_evt_node_heartbeat_id:
+      app_hops_on_heartbeat(&node->hops,
+                            evt->data.evt_node_heartbeat.src_addr,
+                            evt->data.evt_node_heartbeat.hops);
+      break;
+
+    // -------------------------------
+    // Friend events
+    case sl_btmesh_evt_friend_friendship_established_id:
+    case sl_btmesh_evt_friend_friendship_terminated_id:
+#if APP_FRIEND_ENABLE
+      app_friend_on_event(evt);
+#endif
+      break;
+
+    // -------------------------------
+    // Handle vendor model messages
+    case sl_btmesh_evt_vendor_model_receive_id: {
+      sl_btmesh_evt_vendor_model_receive_t *rx_evt = (sl_btmesh_evt_vendor_model_receive_t *)&evt->data;
+      app_telemetry_count_rx(&node->telemetry);
+      app_capture_rx(&node->capture, rx_evt);
+      // Never relay our own publications
+      if (rx_evt->source_address != node->address) {
+        app_tasks_post_rx(&node->tasks, rx_evt);
+      }
+      break;
+    }
+
+    // -------------------------------
+    // Default event handler.
+    default:
+      break;
+  }
+}
+
+/**************************************************************************//**
+ * Process and republish a received vendor message. Runs in the worker task
+ * with a kernel, inline from relay_node_on_mesh_event() otherwise.
+ *****************************************************************************/
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg)
+{
+  relay_node_t *node = NODE_OF(tasks, tasks);
+  const uint8_t *data;
+  uint8_t len;
+
+  // Commands are for us; the network layer relays them already
+  if (msg->opcode == ctrl_command) {
+    handle_ctrl(node, msg);
+    return;
+  }
+  // Parts of a longer message are collected first and passed on whole
+  if (!app_reasm_feed(&node->reasm, msg, &data, &len)) {
+    return;
+  }
+  if (data == msg->data) {
+    relay_on_rx(node, msg);
+    return;
+  }
+  // Too long for the held copy of the assessment delay; relay it right away
+  APP_TASK_LOG("Reassembled %u bytes from 0x%04X\r\n", len, msg->source_address);
+  if (app_relay_filter_match(&node->relay, msg->destination_address)) {
+    republish_data(node, msg, data, len);
+  } else {
+    app_relay_count_filtered(&node->relay);
+  }
+  app_reasm_release(&node->reasm, data);
+}
+
+/**************************************************************************//**
+ * Process and republish a message that arrived in a single part.
+ *****************************************************************************/
+static void relay_on_rx(relay_node_t *node, const app_rx_msg_t *msg)
+{
+  // Every copy of an advert, duplicates too, names a node that passes
+  // adverts on: a relay, whose reports are never merged
+  if (msg->opcode == relay_advert) {
+    app_relay_on_advert(&node->relay, msg->source_address, msg->data, msg->len);
+  }
+
+  // A payload taken recently is a copy from a neighbour
+  bool is_duplicate = app_relay_check_duplicate(&node->relay, msg->data, msg->len);
+  app_telemetry_count_dup_lookup(&node->telemetry, is_duplicate);
+  APP_TASK_LOG("\r\n");
+
+  if (is_duplicate) {
+    APP_TASK_LOG("Duplicate payload detected, skipping relay.\r\n");
+    app_telemetry_count_drop(&node->telemetry);
+    app_relay_on_duplicate(&node->relay, msg->data, msg->len);
+    return;
+  }
+
+  app_tasks_log_rx(msg);
+
+  // Adverts are always passed on so relays further upstream learn too
+  if (msg->opcode == relay_advert) {
+    // The advertiser consumes or re-originates what we republish
+    app_hops_subscribe(&node->hops, msg->source_address);
+  } else if (!app_relay_filter_match(&node->relay, msg->destination_address)) {
+    APP_TASK_LOG("No subscribers behind us for 0x%04X, not relayed\r\n",
+                 msg->destination_address);
+    app_relay_count_filtered(&node->relay);
+    return;
+  }
+
+  switch (msg->opcode) {
+    case sensor_status:
+      APP_TASK_LOG("Data to be relayed:\r\n");
+      app_sensor_sample_t sample;
+      if (!app_sensor_unpack(msg->data, msg->len, &sample)) {
+        APP_TASK_LOG("Malformed sensor payload, length %u\r\n", msg->len);
+        break;
+      }
+      int32_t temperature = sample.temperature;
+      int32_t humidity = sample.humidity;
+      APP_TASK_LOG("Temperature = %ld.%1ld Celsius\r\n",
+                   temperature / 1000,
+                   temperature % 1000);
+
+      float temp = (float) (temperature / 1000);
+      temp = temp * 1.8 + 32;
+      temperature = (int32_t) (temp * 1000);
+      APP_TASK_LOG("Temperature = %ld.%1ld Fahrenheit\r\n",
+                   temperature / 1000,
+                   temperature % 1000);
+
+      APP_TASK_LOG("Humidity = %ld %%\r\n",
+                   humidity / 1000);
+      break;
+
+    default:
+      break;
+  }
+
+  // Wait for the assessment delay; neighbours may make our copy redundant,
+  // and a newer report straight from the same client replaces this one.
+  // Our advert copy names us to the relays around, so it always goes out.
+  app_relay_schedule(&node->relay,
+                     msg,
+                     msg->opcode == relay_advert ? APP_RELAY_NO_SUPPRESS
+                     : msg->opcode == sensor_status || msg->opcode == telemetry_status
+                     ? APP_RELAY_LATEST_ONLY : 0);
+}
+
+/**************************************************************************//**
+ * Apply a control command of the server. We republish reports as their
+ * origin, so the server counts us among its sources and waits for our ack.
+ * Relays are few next to the clients, so the ack goes out at once.
+ *****************************************************************************/
+static void handle_ctrl(relay_node_t *node, const app_rx_msg_t *msg)
+{
+  app_ctrl_cmd_t cmd;
+  uint8_t ack[APP_CTRL_ACK_LEN];
+  sl_status_t sc;
+
+  if (!app_ctrl_decode(msg->data, msg->len, &cmd)) {
+    return;
+  }
+  ack[0] = cmd.seq;
+  ack[1] = APP_CTRL_STATUS_OK;
+  if (cmd.command == APP_CTRL_SET_NETTX) {
+    app_nettx_set_level(&node->nettx, (uint8_t)cmd.argument);
+  } else {
+    ack[1] = APP_CTRL_STATUS_UNSUPPORTED;
+  }
+
+  sc = sl_btmesh_vendor_model_send(msg->source_address,
+                                   -1,
+                                   msg->appkey_index,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   ctrl_ack,
+                                   1,
+                                   sizeof(ack),
+                                   ack);
+  app_capture_tx(&node->capture, ctrl_ack, msg->source_address, msg->appkey_index, ack, sizeof(ack), sc);
+  app_telemetry_count_send(&node->telemetry, msg->source_address, sc);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Control ack error: 0x%04lX\r\n", sc);
+  }
+}
+
+/**************************************************************************//**
+ * Republish a message once app_relay_flush() decided it is still needed.
+ *****************************************************************************/
+static void relay_republish(app_relay_t *relay, const app_rx_msg_t *msg)
+{
+  relay_node_t *node = NODE_OF(relay, relay);
+
+  republish_data(node, msg, msg->data, msg->len);
+}
+
+/**************************************************************************//**
+ * Pass a complete payload on, handing it to the stack in parts of at most
+ * APP_RX_PAYLOAD_MAX bytes with final set on the last one. The copy goes to
+ * the group @p msg was sent to, which is the address the relay filter
+ * approved; through our publication when that is our publication address
+ * or not a group, so the hop-limited TTL applies.
+ *****************************************************************************/
+static void republish_data(relay_node_t *node, const app_rx_msg_t *msg,
+                           const uint8_t *data, uint8_t len)
+{
+  sl_status_t sc = SL_STATUS_OK;
+  uint16_t offset = 0;
+  uint8_t opcode = msg->opcode;
+  uint16_t destination = msg->destination_address;
+
+  APP_PROFILE_BEGIN(RELAY_REPUBLISH);
+  if (destination >= 0xC000 && destination != node->pub_address) {
+    do {
+      uint8_t part = len - offset > APP_RX_PAYLOAD_MAX ? APP_RX_PAYLOAD_MAX : len - offset;
+      sc = sl_btmesh_vendor_model_send(destination,
+                                       -1,
+                                       msg->appkey_index,
+                                       my_model.elem_index,
+                                       my_model.vendor_id,
+                                       my_model.model_id,
+                                       0,
+                                       opcode,
+                                       offset + part == len,
+                                       part,
+                                       &data[offset]);
+      offset += part;
+    } while (sc == SL_STATUS_OK && offset < len);
+    app_capture_tx(&node->capture, opcode, destination, msg->appkey_index, data, len, sc);
+    app_telemetry_count_send(&node->telemetry, destination, sc);
+    if(sc != SL_STATUS_OK) {
+      APP_TASK_LOG("Relay to 0x%04X error: 0x%04lX\r\n", destination, sc);
+    } else {
+      APP_TASK_LOG("Relayed to 0x%04X.\r\n", destination);
+    }
+    APP_PROFILE_END(RELAY_REPUBLISH);
+    return;
+  }
+
+  // set the vendor model publication message
+  do {
+    uint8_t part = len - offset > APP_RX_PAYLOAD_MAX ? APP_RX_PAYLOAD_MAX : len - offset;
+    sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
+                                                my_model.vendor_id,
+                                                my_model.model_id,
+                                                opcode,
+                                                offset + part == len,
+                                                part,
+                                                &data[offset]);
+    offset += part;
+  } while (sc == SL_STATUS_OK && offset < len);
+  if(sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Set publication error: 0x%04lX\r\n", sc);
+    app_capture_tx(&node->capture, opcode, 0, 0, data, len, sc);
+    app_telemetry_count_publish(&node->telemetry, sc);
+  } else {
+    APP_TASK_LOG("Set publication done. Publishing...\r\n");
+    // publish the vendor model publication message
+    sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
+                                        my_model.vendor_id,
+                                        my_model.model_id);
+    app_capture_tx(&node->capture, opcode, 0, 0, data, len, sc);
+    app_telemetry_count_publish(&node->telemetry, sc);
+    if(sc != SL_STATUS_OK) {
+      APP_TASK_LOG("Publish error: 0x%04lX\r\n", sc);
+    } else {
+      APP_TASK_LOG("Publish done. Relay successful.\r\n");
+    }
+  }
+  APP_PROFILE_END(RELAY_REPUBLISH);
+}
+
+/**************************************************************************//**
+ * Process the external signals forwarded by sl_bt_on_event().
+ *****************************************************************************/
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd)
+{
+  relay_node_t *node = NODE_OF(tasks, tasks);
+
+  if (cmd & EX_B0_LONG_PRESS) {
+    app_profile_report();
+    app_relay_report(&node->relay);
+    app_reasm_report(&node->reasm);
+    app_capture_dump(&node->capture, node->address, EX_CAPTURE_DUMP);
+  }
+  if (cmd & EX_RELAY_DUE) {
+    app_relay_flush(&node->relay);
+  }
+  if (cmd & EX_RELAY_AGE) {
+    app_relay_age(&node->relay);
+  }
+  if (cmd & EX_TELEMETRY_DUE) {
+    app_telemetry_status_t status;
+    sl_status_t sc = app_telemetry_publish(&node->telemetry, &status);
+    app_capture_tx(&node->capture, telemetry_status, 0, 0, (const uint8_t *)&status, sizeof(status), sc);
+  }
+  if (cmd & EX_CAPTURE_DUMP) {
+    app_capture_dump_process(&node->capture);
+  }
+}
+
+/**************************************************************************//**
+ * Initialize relay settings for the node.
+ * This function is called both for newly provisioned nodes and already provisioned nodes.
+ *****************************************************************************/
+static void initialize_relay_settings(relay_node_t *node)
+{
+  sl_status_t sc;
+  
+  APP_STACK_LOG("Setting up relay functionality...\r\n");
+  
+  // Enable relay functionality and set the network transmission state;
+  // both follow the level the server sends as APP_CTRL_SET_NETTX
+  app_nettx_init(&node->nettx, true, 0);
+
+  // Take commands sent to the control group. This fails harmlessly when the
+  // provisioner has already added the subscription.
+  (void)sl_btmesh_test_add_local_model_sub(my_model.elem_index,
+                                           my_model.vendor_id,
+                                           my_model.model_id,
+                                           APP_CTRL_GROUP_ADDR);
+  
+  // If our address is not set yet (for already provisioned nodes), get it
+  if (node->address == 0) {
+    uint16_t node_address;
+    sc = sl_btmesh_node_get_element_address(my_model.elem_index, &node_address);
+    if (sc == SL_STATUS_OK) {
+      node->address = node_address;
+      APP_STACK_LOG("Got node address: 0x%04x\r\n", node->address);
+    } else {
+      APP_STACK_LOG("Failed to get node address, error: 0x%lx\r\n", sc);
+    }
+  }
+  
+  // The provisioner pointed our publication at a group with subscribers
+  // downstream; that group is always worth relaying to
+  uint16_t appkey_index;
+  uint16_t pub_address = 0;
+  uint8_t ttl, period, retrans, credentials;
+  sc = sl_btmesh_test_get_local_model_pub(my_model.elem_index,
+                                          my_model.vendor_id,
+                                          my_model.model_id,
+                                          &appkey_index,
+                                          &pub_address,
+                                          &ttl,
+                                          &period,
+                                          &retrans,
+                                          &credentials);
+  if (sc != SL_STATUS_OK) {
+    APP_STACK_LOG("No publication configured yet, error: 0x%lx\r\n", sc);
+  }
+  node->pub_address = pub_address;
+  app_relay_init(&node->relay, pub_address, relay_republish, EX_RELAY_DUE,
+                 EX_RELAY_AGE);
+
+  // Our republish is a new origin: limit its TTL to the distance to the next
+  // consumer, and let upstream senders measure their distance to us
+  app_hops_publish();
+  app_hops_init(&node->hops, my_model.elem_index, my_model.vendor_id, my_model.model_id);
+
+  app_telemetry_start(&node->telemetry,
+                      my_model.elem_index,
+                      my_model.vendor_id,
+                      my_model.model_id,
+                      EX_TELEMETRY_DUE);
+#if APP_FRIEND_ENABLE
+  app_friend_init();
+#endif
+  APP_STACK_LOG("Relay initialization complete\r\n");
+}
@@ -0,0 +1,63 @@
+/***************************************************************************//**
+ * @file relay_node.h
+ * @brief Mesh side of the vendor relay node: event dispatch, relaying and
+ *        control commands.
+ *
+ * Everything the relay does with the mesh runs on a relay_node_t, which
+ * holds the instances of the shared modules. app.c keeps what belongs to the
+ * chip: the boot, the buttons and the one node it runs, and hands the
+ * node the mesh events and the external signals.
+ *
+ * The node lives in a relay_node_t owned by the caller, so a host simulation
+ * can run many relays in one process, each with its own host node entered.
+ ******************************************************************************/
+
+#ifndef RELAY_NODE_H
+#define RELAY_NODE_H
+
+#include <stdint.h>
+#include "sl_btmesh_api.h"
+#include "app_relay.h"
+#include "app_telemetry.h"
+#include "app_nettx.h"
+#include "app_reasm.h"
+#include "app_hops.h"
+#include "app_tasks.h"
+#include "app_capture.h"
+
+// External signals of the node, handed to app_tasks_post_cmd()
+#define EX_B0_LONG_PRESS                            ((1) << 7)
+#define EX_RELAY_DUE                                ((1) << 8)
+#define EX_TELEMETRY_DUE                            ((1) << 9)
+#define EX_CAPTURE_DUMP                             ((1) << 10)
+#define EX_RELAY_AGE                                ((1) << 11)
+
+// State of one relay, with the instances of the shared modules. Everything
+// below the stack callbacks takes it as a context instead of reaching for
+// file statics.
+typedef struct {
+  uint16_t address;
+  uint16_t pub_address;                 // where our own publications go
+  app_relay_t relay;
+  app_telemetry_t telemetry;
+  app_nettx_t nettx;
+  app_reasm_t reasm;
+  app_hops_t hops;
+  app_tasks_t tasks;
+#if APP_CAPTURE_ENABLE
+  app_capture_t capture;
+#endif
+} relay_node_t;
+
+/***************************************************************************//**
+ * Set up the modules of @p node and its worker. Call from app_init(), after
+ * app_time_init().
+ ******************************************************************************/
+void relay_node_init(relay_node_t *node);
+
+/***************************************************************************//**
+ * Handle an event of the Bluetooth Mesh stack.
+ ******************************************************************************/
+void relay_node_on_mesh_event(relay_node_t *node, sl_btmesh_msg_t *evt);
+
+#endif // RELAY_NODE_H
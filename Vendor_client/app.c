@@ -34,6 +34,8 @@
  * Silicon Labs may update projects from time to time.
  ******************************************************************************/
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "em_common.h"
 #include "app_assert.h"
 #include "app_log.h"
@@ -44,21 +46,40 @@
 #include "sl_btmesh_api.h"
 #include "sl_bt_api.h"
 #include "app_timer.h"
-#include "sl_sensor_rht.h"
 
 #include "em_cmu.h"
 #include "em_gpio.h"
 
 #include "my_model_def.h"
+#include "app_profile.h"
+#include "app_telemetry.h"
+#include "app_time.h"
+#include "app_tasks.h"
+#include "app_power.h"
+#include "app_lpn.h"
+#include "app_nettx.h"
+#include "app_hops.h"
+#include "app_sensor_codec.h"
+#include "app_action.h"
+#include "app_ctrl.h"
+#include "app_rht.h"
+#include "app_filter.h"
+#include "app_bulk_tx.h"
+#include "app_blob_rx.h"
+#include "app_sync.h"
 
 #include "app_button_press.h"
 #include "sl_simple_button.h"
 #include "sl_simple_button_instances.h"
 
-#define EX_B0_PRESS                                 ((1) << 5)
-#define EX_B0_LONG_PRESS                            ((1) << 6)
-#define EX_B1_PRESS                                 ((1) << 7)
-#define EX_B1_LONG_PRESS                            ((1) << 8)
+#define EX_ACTION_READY                             ((1) << 5)
+#define EX_CTRL_ACK                                 ((1) << 6)
+#define EX_SENSOR_READY                             ((1) << 7)
+#define EX_BULK_TICK                                ((1) << 8)
+#define EX_PERIODIC_UPDATE                          ((1) << 9)
+#define EX_BLOB_REPLY                               ((1) << 10)
+#define EX_TELEMETRY_DUE                            ((1) << 11)
+#define EX_CONFIG_PERIOD                            ((1) << 12)
 
 // Timing
 // Check section 4.2.2.2 of Mesh Profile Specification 1.0 for format
@@ -100,16 +121,21 @@
 #define lcd_print(...)
 #endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
 
-static uint8_t temperature[4] = {0, 0, 0, 0};
-static uint8_t humidity[4] = {0, 0, 0, 0};
-static uint8_t sensor_data[8];
-static uint16_t my_address = 0;
+// What to do with a sample. Requests that arrive while a conversion runs
+// are collected and served together by the next one.
+#define SAMPLE_PUBLISH                              (1 << 0)
+#define SAMPLE_PERIODIC                             (1 << 1)
 
-static uint32_t periodic_timer_ms = 0;
-bool select_update_mode = false;
+// Readings are filtered before they are packed, so noise alone does not
+// trigger send-on-delta reports. Low-power nodes skip the oversampling, see
+// app_filter.h.
+#if APP_LOW_POWER_ENABLE
+static const app_filter_config_t filter_config = APP_FILTER_CONFIG_LOW_POWER;
+#else
+static const app_filter_config_t filter_config = APP_FILTER_CONFIG_DEFAULT;
+#endif
 
-static uint8_t period_idx = 0;
-static uint8_t periods[] = {
+static const uint8_t periods[] = {
   SET_100_MILLI(10),        /* 1s */
   SET_1_SEC(10),           /* 10s   */
   SET_10_SEC(6),          /* 1min  */
@@ -122,18 +148,155 @@ static my_model_t my_model = {
   .vendor_id = VENDOR_ID,
   .model_id = MY_VENDOR_CLIENT_ID,
   .publish = 1,
-  .opcodes_len = 1,
-  .opcodes_data[0] = sensor_status
+  .opcodes_len = NUMBER_OF_OPCODES,
+  .opcodes_data[0] = sensor_status,
+  .opcodes_data[1] = ctrl_command,
+  .opcodes_data[2] = bulk_ack,
+  .opcodes_data[3] = blob_transfer,
+  .opcodes_data[4] = time_beacon
 };
 
+// Send-on-delta: a periodic report that moved less than this from the last
+// one sent is skipped, but never more than DELTA_KEEPALIVE_PERIODS in a row
+#define DELTA_KEEPALIVE_PERIODS                     10
+
+// State of this node, with the instances of the shared modules. Everything
+// below the stack callbacks, the button handler and the actions takes it as
+// a context instead of reaching for file statics.
+typedef struct {
+  uint16_t address;
+  app_sensor_sample_t sample;
+  uint8_t sensor_data[APP_SENSOR_PACKED_LEN];
+
+  // What to do with a sample. Requests that arrive while a conversion runs
+  // are collected and served together by the next one.
+  uint8_t sample_wanted;                // for the next conversion
+  uint8_t sample_running;               // for the conversion in flight
+  app_filter_t humidity_filter;
+  app_filter_t temperature_filter;
+
+  // Periodic reports
+  uint32_t periodic_timer_ms;
+  app_timer_t periodic_update_timer;
+  // Publication period last seen in the model's publication settings; a
+  // change made there by the provisioner overrides the period picked with
+  // the buttons. A period picked locally clears it, so the next
+  // configuration wins again even if it sets the same period as before.
+  uint8_t config_period;
+  // Period selection with the buttons
+  bool select_update_mode;
+  uint8_t period_idx;
+
+  // Send-on-delta
+  int32_t delta_threshold;              // milli-units, 0 = report every period
+  app_sensor_sample_t reported;
+  bool have_reported;
+  uint8_t skipped_reports;
+
+  // Control plane: the last command applied and the ack waiting for its delay
+  bool ctrl_seen;
+  uint8_t ctrl_last_seq;
+  uint8_t ctrl_last_status;
+  uint8_t ctrl_ack_data[APP_CTRL_ACK_LEN];
+  uint16_t ctrl_ack_dest;
+  uint16_t ctrl_ack_appkey;
+  uint32_t ctrl_rng;
+  app_timer_t ctrl_ack_timer;
+  // An upload of the sample log was asked for and starts with the ack
+  bool upload_pending;
+  // Application key of the blob distribution, for the status answers
+  uint16_t blob_appkey;
+
+  app_telemetry_t telemetry;
+  app_nettx_t nettx;
+  app_bulk_tx_t bulk;
+  app_blob_rx_t blob;
+  app_sync_t sync;
+  app_hops_t hops;
+  app_lpn_t lpn;
+  app_action_t action;
+  app_tasks_t tasks;
+} client_node_t;
+
+// Node that owns the module instance @p ptr, a member @p member of it
+#define NODE_OF(ptr, member) \
+  ((client_node_t *)((uint8_t *)(ptr) - offsetof(client_node_t, member)))
+
+static client_node_t this_node;
+
 static void factory_reset(void);
-static void read_sensor_data(void);
-static void setup_periodcal_update(uint8_t interval);
+static void read_sensor_data(client_node_t *node, uint8_t reason);
+static void start_conversion(client_node_t *node);
+static sl_status_t convert(void);
+static void sensor_ready(client_node_t *node);
+static void sample_done(client_node_t *node, sl_status_t sc, uint32_t humidity, int32_t temperature);
+static void setup_periodcal_update(client_node_t *node, uint8_t interval);
+static void follow_config_period(client_node_t *node);
+static void align_periodic_update(client_node_t *node);
 static void delay_reset_ms(uint32_t ms);
 static void choose_period(uint8_t update_interval);
-static void initialize_client_settings(void);
+void print_update_time(uint8_t choose);
+static void initialize_client_settings(client_node_t *node);
+static void publish_sensor_data(client_node_t *node);
+static bool report_due(client_node_t *node);
+static void handle_ctrl(client_node_t *node, const app_rx_msg_t *msg);
+static uint8_t apply_ctrl(client_node_t *node, uint8_t command, uint16_t argument);
+static void send_ctrl_ack(client_node_t *node);
+static sl_status_t send_bulk(app_bulk_tx_t *bulk,
+                             uint16_t destination,
+                             const uint8_t *data,
+                             uint8_t len);
+static sl_status_t send_blob_status(app_blob_rx_t *blob,
+                                    uint16_t destination,
+                                    const uint8_t *data,
+                                    uint8_t len);
+static void apply_config_blob(app_blob_rx_t *blob, const uint8_t *data, uint16_t len);
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg);
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd);
 void app_button_press_select_period_update_cb(uint8_t button, uint8_t duration);
 
+// Button gestures are mapped to these actions and run from the action queue
+enum {
+  ACTION_PUBLISH_ONCE,
+  ACTION_SELECT_PERIOD,
+  ACTION_PROFILE_REPORT,
+  ACTION_ENERGY_REPORT,
+  ACTION_PERIOD_NEXT,
+  ACTION_PERIOD_PREV,
+  ACTION_PERIOD_CONFIRM,
+  ACTION_COUNT
+};
+
+static void action_publish_once(app_action_t *action);
+static void action_select_period(app_action_t *action);
+static void action_profile_report(app_action_t *action);
+static void action_energy_report(app_action_t *action);
+static void action_period_next(app_action_t *action);
+static void action_period_prev(app_action_t *action);
+static void action_period_confirm(app_action_t *action);
+
+static const app_action_def_t action_table[ACTION_COUNT] = {
+  [ACTION_PUBLISH_ONCE]   = { action_publish_once, 1000 },
+  [ACTION_SELECT_PERIOD]  = { action_select_period, 500 },
+  [ACTION_PROFILE_REPORT] = { action_profile_report, 1000 },
+  [ACTION_ENERGY_REPORT]  = { action_energy_report, 1000 },
+  [ACTION_PERIOD_NEXT]    = { action_period_next, 0 },
+  [ACTION_PERIOD_PREV]    = { action_period_prev, 0 },
+  [ACTION_PERIOD_CONFIRM] = { action_period_confirm, 0 },
+};
+
+#if defined(SL_CATALOG_KERNEL_PRESENT)
+// With a kernel the actions run in the worker task
+static void action_wake(app_action_t *action)
+{
+  (void)action;
+  sl_bt_external_signal(EX_ACTION_READY);
+}
+#define ACTION_WAKE                                 action_wake
+#else
+#define ACTION_WAKE                                 NULL
+#endif
+
 /**************************************************************************//**
  * Application Init.
  *****************************************************************************/
@@ -141,6 +304,15 @@ SL_WEAK void app_init(void)
 {
   app_log("=================\r\n");
   app_log("Client Device\r\n");
+  app_time_init();
+  app_profile_init();
+  app_telemetry_init(&this_node.telemetry);
+  app_tasks_init(&this_node.tasks, &this_node.telemetry, worker_on_rx, worker_on_cmd);
+  app_power_init();
+  app_rht_init(EX_SENSOR_READY);
+  app_filter_init(&this_node.humidity_filter, &filter_config);
+  app_filter_init(&this_node.temperature_filter, &filter_config);
+  app_action_init(&this_node.action, action_table, ACTION_COUNT, ACTION_WAKE);
   app_button_press_enable();
 }
 
@@ -154,6 +326,9 @@ SL_WEAK void app_process_action(void)
   // This is called infinitely.                                              //
   // Do not call blocking functions from here!                               //
   /////////////////////////////////////////////////////////////////////////////
+#if !defined(SL_CATALOG_KERNEL_PRESENT)
+  app_action_process(&this_node.action);
+#endif
 }
 
 /***************************************************************************//**
@@ -172,18 +347,18 @@ static void set_device_name(bd_addr *addr)
   snprintf(name, NAME_BUF_LEN, "Client %02x:%02x",
            addr->addr[1], addr->addr[0]);
 
-  app_log("Device name: '%s'\r\n", name);
+  APP_STACK_LOG("Device name: '%s'\r\n", name);
 
   result = sl_bt_gatt_server_write_attribute_value(gattdb_device_name,
                                                    0,
                                                    strlen(name),
                                                    (uint8_t *)name);
   if(result) {
-    app_log("sl_bt_gatt_server_write_attribute_value() failed, code %lx\r\n", result);
+    APP_STACK_LOG("sl_bt_gatt_server_write_attribute_value() failed, code %lx\r\n", result);
   }
 
   // Show device name on the LCD
-  lcd_print(name, SL_BTMESH_WSTK_LCD_ROW_NAME_CFG_VAL);
+  APP_STACK_LCD(name, SL_BTMESH_WSTK_LCD_ROW_NAME_CFG_VAL);
 }
 
 /**************************************************************************//**
@@ -204,56 +379,21 @@ void sl_bt_on_event(struct sl_bt_msg *evt)
       }
       // Initialize Mesh stack in Node operation mode,
       // wait for initialized event
-      app_log("Node init\r\n");
+      APP_STACK_LOG("Node init\r\n");
       sc = sl_btmesh_node_init();
       switch (sc) {
         case 0x00: break;
-        case 0x02: app_log("Node already initialized\r\n"); break;
+        case 0x02: APP_STACK_LOG("Node already initialized\r\n"); break;
         default: app_assert_status_f(sc, "Failed to init node\r\n");
       }
       break;
 
     // -------------------------------
     // Handle Button Presses
-    case sl_bt_evt_system_external_signal_id: {
-      uint8_t *data = NULL;
-      // check if external signal triggered by button 0 press
-      if(evt->data.evt_system_external_signal.extsignals & EX_B0_PRESS) {
-          read_sensor_data();
-          data = sensor_data;
-          app_log("B0 Pressed. Data is sent once.\r\n");
-          // set the vendor model publication message
-          sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
-                                                      my_model.vendor_id,
-                                                      my_model.model_id,
-                                                      my_model.opcodes_data[0],
-                                                      1,
-                                                      DATA_LENGTH,
-                                                      data);
-          if(sc != SL_STATUS_OK) {
-              app_log("Set publication error: 0x%04lX\r\n", sc);
-          } else {
-              app_log("Set publication done. Publishing...\r\n");
-              // publish the vendor model publication message
-              sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
-                                                  my_model.vendor_id,
-                                                  my_model.model_id);
-              if(sc != SL_STATUS_OK) {
-                  app_log("Publish error: 0x%04lX\r\n", sc);
-              } else {
-                  app_log("Publish done.\r\n");
-              }
-          }
-      }
-      // check if external signal triggered by button 1 press
-      if(evt->data.evt_system_external_signal.extsignals & EX_B1_PRESS) {
-          read_sensor_data();
-          select_update_mode = true;
-          period_idx = 0;
-          choose_period(period_idx);
-      }
+    case sl_bt_evt_system_external_signal_id:
+      app_tasks_post_cmd(&this_node.tasks,
+                         evt->data.evt_system_external_signal.extsignals);
       break;
-    }
 
     // -------------------------------
     // Default event handler.
@@ -271,9 +411,10 @@ void sl_bt_on_event(struct sl_bt_msg *evt)
 void sl_btmesh_on_event(sl_btmesh_msg_t *evt)
 {
   sl_status_t sc;
+  APP_PROFILE_BEGIN(BTMESH_EVENT);
   switch (SL_BT_MSG_ID(evt->header)) {
     case sl_btmesh_evt_node_initialized_id:
-      app_log("Node initialized ...\r\n");
+      APP_STACK_LOG("Node initialized ...\r\n");
       sc = sl_btmesh_vendor_model_init(my_model.elem_index,
                                        my_model.vendor_id,
                                        my_model.model_id,
@@ -288,54 +429,82 @@ void sl_btmesh_on_event(sl_btmesh_msg_t *evt)
       set_device_name(&address);
 
       if(evt->data.evt_node_initialized.provisioned) {
-        app_log("Node already provisioned.\r\n");
-        initialize_client_settings();
-        lcd_print("Node ready", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+        APP_STACK_LOG("Node already provisioned.\r\n");
+        initialize_client_settings(&this_node);
+        APP_STACK_LCD("Node ready", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
       } else {
-        app_log("Node unprovisioned\r\n");
+        APP_STACK_LOG("Node unprovisioned\r\n");
         // Start unprovisioned Beaconing using PB-ADV and PB-GATT Bearers (done automatically now)
-        app_log("Send unprovisioned beacons.\r\n");
-        lcd_print("Node unprovisioned", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+        APP_STACK_LOG("Send unprovisioned beacons.\r\n");
+        APP_STACK_LCD("Node unprovisioned", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
       }
       break;
 
     // -------------------------------
     // Provisioning Events
     case sl_btmesh_evt_node_provisioned_id:
-      app_log("Provisioning done. Address: 0x%04x, IV Index: 0x%lx\r\n",
-              evt->data.evt_node_provisioned.address,
-              evt->data.evt_node_provisioned.iv_index);
-      initialize_client_settings();
-      lcd_print("Provisioning done.", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      APP_STACK_LOG("Provisioning done. Address: 0x%04x, IV Index: 0x%lx\r\n",
+                    evt->data.evt_node_provisioned.address,
+                    evt->data.evt_node_provisioned.iv_index);
+      initialize_client_settings(&this_node);
+      APP_STACK_LCD("Provisioning done.", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
       break;
 
     case sl_btmesh_evt_node_provisioning_failed_id:
-      app_log("Provisioning failed. Result = 0x%04x\r\n",
-              evt->data.evt_node_provisioning_failed.result);
-      lcd_print("Provisioning failed", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      APP_STACK_LOG("Provisioning failed. Result = 0x%04x\r\n",
+                    evt->data.evt_node_provisioning_failed.result);
+      APP_STACK_LCD("Provisioning failed", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
       break;
 
     case sl_btmesh_evt_node_provisioning_started_id:
-      app_log("Provisioning started.\r\n");
-      lcd_print("Provisioning...", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      APP_STACK_LOG("Provisioning started.\r\n");
+      APP_STACK_LCD("Provisioning...", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
       break;
 
     case sl_btmesh_evt_node_key_added_id:
-      app_log("Got new %s key with index %x\r\n",
-              evt->data.evt_node_key_added.type == 0 ? "Network" : "Application",
-              evt->data.evt_node_key_added.index);
+      APP_STACK_LOG("Got new %s key with index %x\r\n",
+                    evt->data.evt_node_key_added.type == 0 ? "Network" : "Application",
+                    evt->data.evt_node_key_added.index);
       break;
 
     case sl_btmesh_evt_node_config_set_id:
-      app_log("Evt_node_config_set_id\r\n\t");
+      APP_STACK_LOG("Evt_node_config_set_id\r\n\t");
       break;
 
     case sl_btmesh_evt_node_model_config_changed_id:
-      app_log("Model config changed, type: %d, elem_addr: %x, model_id: %x, vendor_id: %x\r\n",
-              evt->data.evt_node_model_config_changed.node_config_state,
-              evt->data.evt_node_model_config_changed.element_address,
-              evt->data.evt_node_model_config_changed.model_id,
-              evt->data.evt_node_model_config_changed.vendor_id);
+      APP_STACK_LOG("Model config changed, type: %d, elem_addr: %x, model_id: %x, vendor_id: %x\r\n",
+                    evt->data.evt_node_model_config_changed.node_config_state,
+                    evt->data.evt_node_model_config_changed.element_address,
+                    evt->data.evt_node_model_config_changed.model_id,
+                    evt->data.evt_node_model_config_changed.vendor_id);
+      // The provisioner may have retuned our publication period
+      if (evt->data.evt_node_model_config_changed.model_id == my_model.model_id
+          && evt->data.evt_node_model_config_changed.vendor_id == my_model.vendor_id) {
+        sl_bt_external_signal(EX_CONFIG_PERIOD);
+      }
+      break;
+
+    // -------------------------------
+    // Control commands from the server
+    case sl_btmesh_evt_vendor_model_receive_id:
+      app_telemetry_count_rx(&this_node.telemetry);
+      app_tasks_post_rx(&this_node.tasks, (sl_btmesh_evt_vendor_model_receive_t *)&evt->data);
+      break;
+
+    // -------------------------------
+    // Heartbeats give the hop distance to the next hop of our data
+    case sl_btmesh_evt_node_heartbeat_id:
+      app_hops_on_heartbeat(&this_node.hops,
+                            evt->data.evt_node_heartbeat.src_addr,
+                            evt->data.evt_node_heartbeat.hops);
+      break;
+
+    // -------------------------------
+    // Low Power Node events
+    case sl_btmesh_evt_lpn_friendship_established_id:
+    case sl_btmesh_evt_lpn_friendship_failed_id:
+    case sl_btmesh_evt_lpn_friendship_terminated_id:
+      app_lpn_on_event(&this_node.lpn, evt);
       break;
 
     // -------------------------------
@@ -343,11 +512,319 @@ void sl_btmesh_on_event(sl_btmesh_msg_t *evt)
     default:
       break;
   }
+  APP_PROFILE_END(BTMESH_EVENT);
+}
+
+/**************************************************************************//**
+ * Process commands forwarded by sl_bt_on_event(). Runs in the worker task
+ * with a kernel, inline from the event handler otherwise.
+ *****************************************************************************/
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd)
+{
+  client_node_t *node = NODE_OF(tasks, tasks);
+
+  // button actions are pending in the action queue
+  if(cmd & EX_ACTION_READY) {
+    app_action_process(&node->action);
+  }
+  // the random delay of a control ack is over
+  if(cmd & EX_CTRL_ACK) {
+    send_ctrl_ack(node);
+  }
+  // check if external signal triggered by the periodic update timer
+  if(cmd & EX_PERIODIC_UPDATE) {
+    APP_PATH_LOG("New data update\r\n");
+    align_periodic_update(node);
+    read_sensor_data(node, SAMPLE_PERIODIC);
+  }
+  // the sensor conversion is over
+  if(cmd & EX_SENSOR_READY) {
+    sensor_ready(node);
+  }
+  // the bulk upload can send or timed out
+  if(cmd & EX_BULK_TICK) {
+    app_bulk_tx_process(&node->bulk);
+  }
+  // the delay of a blob status answer is over
+  if(cmd & EX_BLOB_REPLY) {
+    app_blob_rx_process(&node->blob);
+  }
+  // the model configuration changed or the node was set up
+  if(cmd & EX_CONFIG_PERIOD) {
+    follow_config_period(node);
+  }
+  // the telemetry period is over
+  if(cmd & EX_TELEMETRY_DUE) {
+    if(app_telemetry_publish(&node->telemetry, NULL) == SL_STATUS_OK) {
+      app_energy_charge_publish(sizeof(app_telemetry_status_t),
+                                app_nettx_transmissions(&node->nettx));
+    }
+  }
+}
+
+/**************************************************************************//**
+ * Process a received vendor message. The client only takes control commands,
+ * the acks of its bulk upload, blob distribution and time beacons.
+ *****************************************************************************/
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg)
+{
+  client_node_t *node = NODE_OF(tasks, tasks);
+
+  if(msg->opcode == ctrl_command) {
+    handle_ctrl(node, msg);
+  } else if(msg->opcode == bulk_ack) {
+    app_bulk_tx_on_ack(&node->bulk, msg->source_address, msg->data, msg->len);
+  } else if(msg->opcode == blob_transfer) {
+    node->blob_appkey = msg->appkey_index;
+    app_blob_rx_on_message(&node->blob, msg->source_address, msg->data, msg->len);
+  } else if(msg->opcode == time_beacon) {
+    // Stamped in the stack event, so the wait in the worker queue is no delay
+    app_sync_on_beacon(&node->sync, msg->data, msg->len, msg->rx_ms,
+                       app_hops_distance(&node->hops));
+  }
+}
+
+static void ctrl_ack_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  sl_bt_external_signal(EX_CTRL_ACK);
+}
+
+/**************************************************************************//**
+ * Apply a control command and ack it after a random delay within the spread
+ * the sender asked for. A copy of the command already applied is only acked.
+ *****************************************************************************/
+static void handle_ctrl(client_node_t *node, const app_rx_msg_t *msg)
+{
+  app_ctrl_cmd_t cmd;
+  uint32_t window_ms;
+
+  if(!app_ctrl_decode(msg->data, msg->len, &cmd)) {
+    return;
+  }
+  if(!node->ctrl_seen || cmd.seq != node->ctrl_last_seq) {
+    node->ctrl_seen = true;
+    node->ctrl_last_seq = cmd.seq;
+    if(cmd.command == APP_CTRL_UPLOAD_LOG) {
+      node->upload_pending = true;
+      node->ctrl_last_status = APP_CTRL_STATUS_OK;
+    } else {
+      node->ctrl_last_status = apply_ctrl(node, cmd.command, cmd.argument);
+    }
+  }
+
+  node->ctrl_ack_data[0] = cmd.seq;
+  node->ctrl_ack_data[1] = node->ctrl_last_status;
+  node->ctrl_ack_dest = msg->source_address;
+  node->ctrl_ack_appkey = msg->appkey_index;
+  app_timer_stop(&node->ctrl_ack_timer);
+  if(cmd.spread == 0) {
+    send_ctrl_ack(node);
+    return;
+  }
+  // xorshift32
+  node->ctrl_rng ^= node->ctrl_rng << 13;
+  node->ctrl_rng ^= node->ctrl_rng >> 17;
+  node->ctrl_rng ^= node->ctrl_rng << 5;
+  window_ms = (uint32_t)cmd.spread * APP_CTRL_SPREAD_UNIT_MS;
+  app_timer_start(&node->ctrl_ack_timer,
+                  1 + node->ctrl_rng % window_ms,
+                  ctrl_ack_timer_cb,
+                  NULL,
+                  false);
+}
+
+/**************************************************************************//**
+ * Apply a setting of a control command or configuration blob entry.
+ *****************************************************************************/
+static uint8_t apply_ctrl(client_node_t *node, uint8_t command, uint16_t argument)
+{
+  switch (command) {
+    case APP_CTRL_SET_PERIOD:
+      APP_TASK_LOG("Control: set period 0x%02X\r\n", argument & 0xFF);
+      node->config_period = 0;
+      setup_periodcal_update(node, (uint8_t)argument);
+      break;
+    case APP_CTRL_SET_DELTA:
+      node->delta_threshold = (int32_t)argument * 100;
+      APP_TASK_LOG("Control: send-on-delta threshold %u.%u\r\n",
+                   argument / 10, argument % 10);
+      break;
+    case APP_CTRL_SAMPLE_NOW:
+      read_sensor_data(node, SAMPLE_PUBLISH);
+      break;
+    case APP_CTRL_SET_NETTX:
+      app_nettx_set_level(&node->nettx, (uint8_t)argument);
+      break;
+    default:
+      return APP_CTRL_STATUS_UNSUPPORTED;
+  }
+  return APP_CTRL_STATUS_OK;
+}
+
+static void send_ctrl_ack(client_node_t *node)
+{
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(node->ctrl_ack_dest,
+                                   -1,
+                                   node->ctrl_ack_appkey,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   ctrl_ack,
+                                   1,
+                                   sizeof(node->ctrl_ack_data),
+                                   node->ctrl_ack_data);
+  app_telemetry_count_send(&node->telemetry, node->ctrl_ack_dest, sc);
+  if(sc != SL_STATUS_OK) {
+    APP_PATH_LOG("Control ack error: 0x%04lX\r\n", sc);
+  }
+  // The upload follows the ack, so the spread also spreads the uploads
+  if(node->upload_pending) {
+    node->upload_pending = false;
+    if(!app_bulk_tx_start(&node->bulk, node->ctrl_ack_dest)) {
+      APP_TASK_LOG("Log upload not started\r\n");
+    }
+  }
+}
+
+static sl_status_t send_bulk(app_bulk_tx_t *bulk,
+                             uint16_t destination,
+                             const uint8_t *data,
+                             uint8_t len)
+{
+  client_node_t *node = NODE_OF(bulk, bulk);
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination,
+                                   -1,
+                                   node->ctrl_ack_appkey,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   bulk_chunk,
+                                   1,
+                                   len,
+                                   data);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  return sc;
+}
+
+static sl_status_t send_blob_status(app_blob_rx_t *blob,
+                                    uint16_t destination,
+                                    const uint8_t *data,
+                                    uint8_t len)
+{
+  client_node_t *node = NODE_OF(blob, blob);
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination,
+                                   -1,
+                                   node->blob_appkey,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   blob_status,
+                                   1,
+                                   len,
+                                   data);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  return sc;
+}
+
+/**************************************************************************//**
+ * A configuration blob is in: apply its entries in order. Uploads need a
+ * sender to go to and are not taken from a blob.
+ *****************************************************************************/
+static void apply_config_blob(app_blob_rx_t *blob, const uint8_t *data, uint16_t len)
+{
+  client_node_t *node = NODE_OF(blob, blob);
+  uint16_t applied = 0;
+
+  for(uint16_t i = 0; i + APP_BLOB_ENTRY_LEN <= len; i += APP_BLOB_ENTRY_LEN) {
+    uint16_t argument = (uint16_t)data[i + 1] | ((uint16_t)data[i + 2] << 8);
+    if(data[i] != APP_CTRL_UPLOAD_LOG
+       && apply_ctrl(node, data[i], argument) == APP_CTRL_STATUS_OK) {
+      applied++;
+    }
+  }
+  APP_TASK_LOG("Configuration blob: %u bytes, %u entries applied\r\n", len, applied);
+}
+
+/**************************************************************************//**
+ * Button actions, run from the action queue.
+ *****************************************************************************/
+static void action_publish_once(app_action_t *action)
+{
+  APP_TASK_LOG("B0 Pressed. Data is sent once.\r\n");
+  read_sensor_data(NODE_OF(action, action), SAMPLE_PUBLISH);
+}
+
+static void action_select_period(app_action_t *action)
+{
+  client_node_t *node = NODE_OF(action, action);
+
+  node->select_update_mode = true;
+  node->period_idx = 0;
+  choose_period(node->period_idx);
+}
+
+static void action_profile_report(app_action_t *action)
+{
+  app_profile_report();
+  app_action_report(action);
+}
+
+static void action_energy_report(app_action_t *action)
+{
+  (void)action;
+  app_energy_report();
+}
+
+static void action_period_next(app_action_t *action)
+{
+  client_node_t *node = NODE_OF(action, action);
+
+  if(node->period_idx < sizeof(periods) - 1)
+    node->period_idx++;
+  else
+    node->period_idx = 0;
+  choose_period(node->period_idx);
+}
+
+static void action_period_prev(app_action_t *action)
+{
+  client_node_t *node = NODE_OF(action, action);
+
+  if(node->period_idx > 0)
+    node->period_idx--;
+  else
+    node->period_idx = sizeof(periods) - 1;
+  choose_period(node->period_idx);
+}
+
+static void action_period_confirm(app_action_t *action)
+{
+  client_node_t *node = NODE_OF(action, action);
+
+  node->select_update_mode = false;
+  APP_TASK_LOG("Mode %1d selected.\r\n", node->period_idx);
+  print_update_time(node->period_idx);
+  node->config_period = 0;
+  setup_periodcal_update(node, periods[node->period_idx]);
+  APP_TASK_LCD("PB0: Public data", 3);
+  APP_TASK_LCD("PB1: Set period", 4);
+  APP_TASK_LOG("B1 Pressed. Set periodic update done.\r\n");
 }
 
 void app_button_press_cb(uint8_t button, uint8_t duration)
 {
-  if(select_update_mode) {
+  if(this_node.select_update_mode) {
       app_button_press_select_period_update_cb(button, duration);
       return;
   }
@@ -358,17 +835,17 @@ void app_button_press_cb(uint8_t button, uint8_t duration)
     case APP_BUTTON_PRESS_DURATION_MEDIUM:
       // Handling of button press greater than 0.25s and less than 1s
       if (button == BUTTON_PRESS_BUTTON_0) {
-        sl_bt_external_signal(EX_B0_PRESS);
+        app_action_post(&this_node.action, ACTION_PUBLISH_ONCE);
       } else {
-        sl_bt_external_signal(EX_B1_PRESS);
+        app_action_post(&this_node.action, ACTION_SELECT_PERIOD);
       }
       break;
     case APP_BUTTON_PRESS_DURATION_LONG:
       // Handling of button press greater than 1s and less than 5s
       if (button == BUTTON_PRESS_BUTTON_0) {
-        sl_bt_external_signal(EX_B0_LONG_PRESS);
+        app_action_post(&this_node.action, ACTION_PROFILE_REPORT);
       } else {
-        sl_bt_external_signal(EX_B1_LONG_PRESS);
+        app_action_post(&this_node.action, ACTION_ENERGY_REPORT);
       }
       break;
     case APP_BUTTON_PRESS_DURATION_VERYLONG:
@@ -378,21 +855,114 @@ void app_button_press_cb(uint8_t button, uint8_t duration)
   }
 }
 
-/// Temperature and Humidity
-static void read_sensor_data(void)
+/// Temperature and Humidity: ask for a sample, acted on per @p reason once
+/// the conversion is over
+static void read_sensor_data(client_node_t *node, uint8_t reason)
+{
+  node->sample_wanted |= reason;
+  if(!app_rht_busy()) {
+    start_conversion(node);
+  }
+}
+
+static void start_conversion(client_node_t *node)
+{
+  sl_status_t sc = convert();
+
+  node->sample_running = node->sample_wanted;
+  node->sample_wanted = 0;
+  if(sc != SL_STATUS_OK) {
+    sample_done(node, sc, 0, 0);
+  }
+}
+
+static sl_status_t convert(void)
+{
+  sl_status_t sc;
+
+  APP_PROFILE_BEGIN(READ_SENSOR);
+  app_energy_charge_sensor();
+  sc = app_rht_start();
+  APP_PROFILE_END(READ_SENSOR);
+  return sc;
+}
+
+static void sensor_ready(client_node_t *node)
+{
+  uint32_t humidity = 0;
+  int32_t temperature = 0;
+  sl_status_t sc;
+
+  APP_PROFILE_BEGIN(READ_SENSOR);
+  sc = app_rht_read(&humidity, &temperature);
+  APP_PROFILE_END(READ_SENSOR);
+  if(sc == SL_STATUS_NOT_READY) {
+    return;
+  }
+  if(sc == SL_STATUS_OK) {
+    int32_t filtered_humidity, filtered_temperature;
+    // Both channels complete their oversampling groups together
+    app_filter_feed(&node->humidity_filter, (int32_t)humidity, &filtered_humidity);
+    if(app_filter_feed(&node->temperature_filter, temperature, &filtered_temperature)) {
+      sample_done(node, SL_STATUS_OK, (uint32_t)filtered_humidity, filtered_temperature);
+      return;
+    }
+    // More readings for this sample
+    sc = convert();
+    if(sc == SL_STATUS_OK) {
+      return;
+    }
+  }
+  app_filter_abort(&node->humidity_filter);
+  app_filter_abort(&node->temperature_filter);
+  sample_done(node, sc, 0, 0);
+}
+
+static void sample_done(client_node_t *node, sl_status_t sc, uint32_t humidity, int32_t temperature)
 {
-//  float temp;
-  if(sl_sensor_rht_get((uint32_t *)humidity, (int32_t *)temperature) != SL_STATUS_OK) {
-    app_log("Error while reading temperature and humidity sensor. Clear the buffer.\r\n");
-    memset(temperature, 0, sizeof(temperature));
-    memset(humidity, 0, sizeof(humidity));
+  uint8_t reasons = node->sample_running;
+
+  node->sample_running = 0;
+  if(sc != SL_STATUS_OK) {
+    APP_PATH_LOG("Error while reading temperature and humidity sensor. Clear the buffer.\r\n");
+    humidity = 0;
+    temperature = 0;
+  }
+  node->sample.humidity = (int32_t)humidity;
+  node->sample.temperature = temperature;
+  app_sensor_pack(&node->sample, node->sensor_data);
+  if(sc == SL_STATUS_OK) {
+    app_bulk_tx_log(&node->bulk, node->sensor_data, (uint32_t)(app_sync_now_ms(&node->sync) / 1000));
+  }
+
+  // Requests that came in meanwhile get the next conversion, which runs
+  // while this sample is being published
+  if(node->sample_wanted != 0) {
+    start_conversion(node);
   }
-//  app_log("Temp: %ld.%ld Celsius\r\n", (*(int32_t *)temperature) / 1000,(*(int32_t *)temperature) % 1000);
-//  app_log("Hum: %ld %%\r\n", (*(uint32_t *)humidity) / 1000);
 
-  for (int i = 0; i < 4; i ++) {
-      sensor_data[i] = humidity[i];
-      sensor_data[i + 4] = temperature[i];
+  if(reasons & SAMPLE_PUBLISH) {
+    publish_sensor_data(node);
+  } else if(reasons & SAMPLE_PERIODIC) {
+    if(report_due(node)) {
+      publish_sensor_data(node);
+    } else {
+      APP_PATH_LOG("Change below threshold, report skipped\r\n");
+    }
+  }
+  if(reasons & SAMPLE_PERIODIC) {
+#if APP_LOW_POWER_ENABLE
+    // Telemetry rides in the same wake window instead of its own timer
+    if(app_power_telemetry_due()
+       && app_telemetry_publish(&node->telemetry, NULL) == SL_STATUS_OK) {
+      app_energy_charge_publish(sizeof(app_telemetry_status_t),
+                                app_nettx_transmissions(&node->nettx));
+    }
+#endif
+#if APP_LPN_ENABLE
+    // Collect anything the Friend holds while the radio is up anyway
+    app_lpn_poll(&node->lpn);
+#endif
   }
 }
 
@@ -400,7 +970,7 @@ static void read_sensor_data(void)
 /// Reset
 static void factory_reset(void)
 {
-  app_log("Factory reset\r\n");
+  APP_STACK_LOG("Factory reset\r\n");
   sl_btmesh_node_reset();
   delay_reset_ms(100);
 }
@@ -426,97 +996,175 @@ static void delay_reset_ms(uint32_t ms)
 
 }
 
-/// Update Interval
-static void periodic_update_timer_cb(app_timer_t *handle, void *data)
+/// Publish the last sensor reading
+static void publish_sensor_data(client_node_t *node)
 {
-  (void)handle;
-  (void)data;
   sl_status_t sc;
-  app_log("New data update\r\n");
-  read_sensor_data();
+  // set the vendor model publication message
   sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
                                               my_model.vendor_id,
                                               my_model.model_id,
                                               my_model.opcodes_data[0],
                                               1,
-                                              DATA_LENGTH,
-                                              sensor_data);
+                                              sizeof(node->sensor_data),
+                                              node->sensor_data);
   if(sc != SL_STATUS_OK) {
-    app_log("Set publication error: 0x%04lX\r\n", sc);
+    APP_PATH_LOG("Set publication error: 0x%04lX\r\n", sc);
+    app_telemetry_count_publish(&node->telemetry, sc);
   } else {
-    app_log("Set publication done. Publishing...\r\n");
+    APP_PATH_LOG("Set publication done. Publishing...\r\n");
+    // publish the vendor model publication message
     sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
                                         my_model.vendor_id,
                                         my_model.model_id);
+    app_telemetry_count_publish(&node->telemetry, sc);
     if (sc != SL_STATUS_OK) {
-      app_log("Publish error: 0x%04lX\r\n", sc);
+      APP_PATH_LOG("Publish error: 0x%04lX\r\n", sc);
     } else {
-      app_log("Publish done.\r\n");
+      APP_PATH_LOG("Publish done.\r\n");
+      app_energy_charge_publish(sizeof(node->sensor_data), app_nettx_transmissions(&node->nettx));
+      app_energy_count_sample();
+      node->reported = node->sample;
+      node->have_reported = true;
+      node->skipped_reports = 0;
     }
   }
 }
 
-static void parse_period(uint8_t interval)
+/// Send-on-delta decision for a periodic report
+static bool report_due(client_node_t *node)
+{
+  if(node->delta_threshold == 0
+     || !node->have_reported
+     || node->skipped_reports + 1 >= DELTA_KEEPALIVE_PERIODS
+     || labs(node->sample.temperature - node->reported.temperature) >= node->delta_threshold
+     || labs(node->sample.humidity - node->reported.humidity) >= node->delta_threshold) {
+    return true;
+  }
+  node->skipped_reports++;
+  return false;
+}
+
+/// Update Interval
+static void periodic_update_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  // The sensor read and publication run from the event loop / worker task
+  sl_bt_external_signal(EX_PERIODIC_UPDATE);
+}
+
+static void parse_period(client_node_t *node, uint8_t interval)
 {
   switch (interval & STEP_RES_BIT_MASK) {
     case STEP_RES_100_MILLI:
-      periodic_timer_ms = 100 * (interval & (~STEP_RES_BIT_MASK));
+      node->periodic_timer_ms = 100 * (interval & (~STEP_RES_BIT_MASK));
       break;
     case STEP_RES_1_SEC:
-      periodic_timer_ms = 1000 * (interval & (~STEP_RES_BIT_MASK));
+      node->periodic_timer_ms = 1000 * (interval & (~STEP_RES_BIT_MASK));
       break;
     case STEP_RES_10_SEC:
-      periodic_timer_ms = 10000 * (interval & (~STEP_RES_BIT_MASK));
+      node->periodic_timer_ms = 10000 * (interval & (~STEP_RES_BIT_MASK));
       break;
     case STEP_RES_10_MIN:
       // 10 min = 600000ms
-      periodic_timer_ms = 600000 * (interval & (~STEP_RES_BIT_MASK));
+      node->periodic_timer_ms = 600000 * (interval & (~STEP_RES_BIT_MASK));
       break;
     default:
       // Set to 0 for "No update" case or invalid interval
-      periodic_timer_ms = 0;
+      node->periodic_timer_ms = 0;
       break;
   }
 }
 
-static app_timer_t periodic_update_timer;
-static void setup_periodcal_update(uint8_t interval)
+static void setup_periodcal_update(client_node_t *node, uint8_t interval)
 {
   // Stop existing timer first
-  app_timer_stop(&periodic_update_timer);
+  app_timer_stop(&node->periodic_update_timer);
   
-  parse_period(interval);
+  parse_period(node, interval);
+  app_telemetry_set_publish_period(&node->telemetry, node->periodic_timer_ms);
   
   // Only start timer if periodic_timer_ms is not 0
-  if (periodic_timer_ms > 0) {
-    app_timer_start(&periodic_update_timer,
-                    periodic_timer_ms,
+  if (node->periodic_timer_ms > 0) {
+    app_timer_start(&node->periodic_update_timer,
+                    node->periodic_timer_ms,
                     periodic_update_timer_cb,
                     NULL,
                     true);
+    align_periodic_update(node);
   } else {
-    app_log("Periodic update stopped.\r\n");
+    APP_TASK_LOG("Periodic update stopped.\r\n");
+  }
+}
+
+/// In sync, sample on multiples of the period in network time, so the
+/// readings of all nodes line up. The timer is re-armed for every sample
+/// and follows the drift.
+static void align_periodic_update(client_node_t *node)
+{
+  uint32_t period_ms = node->periodic_timer_ms;
+  uint64_t now, next;
+
+  if (period_ms == 0 || !app_sync_is_synced(&node->sync)) {
+    return;
+  }
+  now = app_sync_now_ms(&node->sync);
+  // Half a period of slack: waking up a bit early does not sample twice
+  next = ((now + period_ms / 2) / period_ms + 1) * period_ms;
+  app_timer_stop(&node->periodic_update_timer);
+  app_timer_start(&node->periodic_update_timer,
+                  (uint32_t)(app_sync_to_local_ms(&node->sync, next) - app_time_ms()),
+                  periodic_update_timer_cb,
+                  NULL,
+                  false);
+}
+
+/// Apply the publication period set by the provisioner, if it changed
+static void follow_config_period(client_node_t *node)
+{
+  sl_status_t sc;
+  uint16_t appkey_index, pub_address;
+  uint8_t ttl, period, retrans, credentials;
+
+  sc = sl_btmesh_test_get_local_model_pub(my_model.elem_index,
+                                          my_model.vendor_id,
+                                          my_model.model_id,
+                                          &appkey_index,
+                                          &pub_address,
+                                          &ttl,
+                                          &period,
+                                          &retrans,
+                                          &credentials);
+  if (sc != SL_STATUS_OK || period == node->config_period) {
+    // No publication configured, or only other settings changed
+    return;
   }
+  node->config_period = period;
+  setup_periodcal_update(node, period);
+  APP_TASK_LOG("Publication period set by configuration: %lu ms\r\n",
+               (unsigned long)node->periodic_timer_ms);
+  APP_TASK_LCD("Period: by config", 5);
 }
 void choose_period(uint8_t choose)
 {
-  lcd_print("Hold PB0 to choose", 3);
-  lcd_print("Choose your period update: ", 4);
+  APP_TASK_LCD("Hold PB0 to choose", 3);
+  APP_TASK_LCD("Choose your period update: ", 4);
   switch (choose) {
     case 0:
-      lcd_print("1 second", 5);
+      APP_TASK_LCD("1 second", 5);
       break;
     case 1:
-      lcd_print("10 seconds", 5);
+      APP_TASK_LCD("10 seconds", 5);
       break;
     case 2:
-      lcd_print("1 minute", 5);
+      APP_TASK_LCD("1 minute", 5);
       break;
     case 3:
-      lcd_print("10 minutes", 5);
+      APP_TASK_LCD("10 minutes", 5);
       break;
     default:
-      lcd_print("No update", 5);
+      APP_TASK_LCD("No update", 5);
       break;
   }
 }
@@ -525,54 +1173,39 @@ void print_update_time(uint8_t choose)
 {
   switch (choose) {
     case 0:
-      app_log("1s\r\n");
+      APP_TASK_LOG("Period update time: 1s\r\n");
       break;
     case 1:
-      app_log("10s\r\n");
+      APP_TASK_LOG("Period update time: 10s\r\n");
       break;
     case 2:
-      app_log("1m\r\n");
+      APP_TASK_LOG("Period update time: 1m\r\n");
       break;
     case 3:
-      app_log("10m\r\n");
+      APP_TASK_LOG("Period update time: 10m\r\n");
       break;
     default:
-      app_log("No update\r\n");
+      APP_TASK_LOG("Period update time: No update\r\n");
       break;
   }
 }
 
 void app_button_press_select_period_update_cb(uint8_t button, uint8_t duration)
 {
-  // Selecting action by duration
+  // Selecting action by duration; the period is changed by the actions
   switch (duration) {
     case APP_BUTTON_PRESS_DURATION_SHORT:
       // Handling of button press less than 0.25s
       if(button == BUTTON_PRESS_BUTTON_0) {
-        if(period_idx < sizeof(periods) - 1)
-          period_idx++;
-        else
-          period_idx = 0;
+        app_action_post(&this_node.action, ACTION_PERIOD_NEXT);
       } else {
-        if(period_idx > 0)
-          period_idx--;
-        else
-          period_idx = sizeof(periods) - 1;
+        app_action_post(&this_node.action, ACTION_PERIOD_PREV);
       }
-      choose_period(period_idx);
-
       break;
     case APP_BUTTON_PRESS_DURATION_LONG:
       // Handling of button press greater than 1s and less than 5s
       if (button == BUTTON_PRESS_BUTTON_0) {
-        select_update_mode = false;
-        app_log("Mode %1d selected.\r\n", period_idx);
-        app_log("Period update time: ");
-        print_update_time(period_idx);
-        setup_periodcal_update(periods[period_idx]);
-        lcd_print("PB0: Public data", 3);
-        lcd_print("PB1: Set period", 4);
-        app_log("B1 Pressed. Set periodic update done.\r\n");
+        app_action_post(&this_node.action, ACTION_PERIOD_CONFIRM);
       }
       break;
     default:
@@ -584,36 +1217,64 @@ void app_button_press_select_period_update_cb(uint8_t button, uint8_t duration)
  * Initialize client settings for the node.
  * This function is called both for newly provisioned nodes and already provisioned nodes.
  *****************************************************************************/
-static void initialize_client_settings(void)
+static void initialize_client_settings(client_node_t *node)
 {
   sl_status_t sc;
   
-  app_log("Setting up client functionality...\r\n");
-  
-  // Enable relay functionality
-  sc = sl_btmesh_test_set_relay(1, 0, 0);
-  app_assert_status_f(sc, "Failed to set relay\r\n");
-  app_log("Relay enabled\r\n");
+  APP_STACK_LOG("Setting up client functionality...\r\n");
   
-  // Set network transmission state
-  sc = sl_btmesh_test_set_nettx(0, 0);
-  app_assert_status_f(sc, "Failed to set network tx state\r\n");
-  app_log("Network tx state set\r\n");
+  // Set relay and network transmission state. A Low Power Node never
+  // relays. The level follows the server's APP_CTRL_SET_NETTX.
+  app_nettx_init(&node->nettx, !APP_LPN_ENABLE, 0);
+
+  // Take commands sent to the control group. This fails harmlessly when the
+  // provisioner has already added the subscription.
+  (void)sl_btmesh_test_add_local_model_sub(my_model.elem_index,
+                                           my_model.vendor_id,
+                                           my_model.model_id,
+                                           APP_CTRL_GROUP_ADDR);
   
-  // If my_address is not set yet (for already provisioned nodes), get it
-    if (my_address == 0) {
+  // If our address is not set yet (for already provisioned nodes), get it
+    if (node->address == 0) {
       uint16_t node_address;
       sc = sl_btmesh_node_get_element_address(my_model.elem_index, &node_address);
       if (sc == SL_STATUS_OK) {
-        my_address = node_address;
-        app_log("Got node address: 0x%04x\r\n", my_address);
+        node->address = node_address;
+        APP_STACK_LOG("Got node address: 0x%04x\r\n", node->address);
       } else {
-        app_log("Failed to get node address, error: 0x%lx\r\n", sc);
+        APP_STACK_LOG("Failed to get node address, error: 0x%lx\r\n", sc);
       }
     }
 
+  // Seed for the ack delay; the address keeps nodes apart without an RNG
+  size_t rng_len = 0;
+  if (sl_bt_system_get_random_data(sizeof(node->ctrl_rng), sizeof(node->ctrl_rng), &rng_len,
+                                   (uint8_t *)&node->ctrl_rng) != SL_STATUS_OK
+      || node->ctrl_rng == 0) {
+    node->ctrl_rng = 0x9E3779B9u ^ node->address;
+  }
+  app_bulk_tx_init(&node->bulk, send_bulk, EX_BULK_TICK);
+  app_blob_rx_init(&node->blob, send_blob_status, apply_config_blob, EX_BLOB_REPLY);
+  app_sync_init(&node->sync, false);
+
 
-  app_log("Client initialization complete\r\n");
-  lcd_print("PB0: Public data", 3);
-  lcd_print("PB1: Set period", 4);
+#if APP_LOW_POWER_ENABLE
+  app_telemetry_bind(&node->telemetry, my_model.elem_index, my_model.vendor_id, my_model.model_id);
+#else
+  app_telemetry_start(&node->telemetry,
+                      my_model.elem_index,
+                      my_model.vendor_id,
+                      my_model.model_id,
+                      EX_TELEMETRY_DUE);
+#endif
+  // Publish only as far as the server or the nearest relay
+  app_hops_init(&node->hops, my_model.elem_index, my_model.vendor_id, my_model.model_id);
+  // Resume the period configured for the model before the last reset
+  sl_bt_external_signal(EX_CONFIG_PERIOD);
+#if APP_LPN_ENABLE
+  app_lpn_start(&node->lpn);
+#endif
+  APP_STACK_LOG("Client initialization complete\r\n");
+  APP_STACK_LCD("PB0: Public data", 3);
+  APP_STACK_LCD("PB1: Set period", 4);
 }
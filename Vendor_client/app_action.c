@@ -0,0 +1,117 @@
+/***************************************************************************//**
+ * @file app_action.c
+ * @brief Debounced, rate-limited queue of application actions.
+ ******************************************************************************/
+#include <stdatomic.h>
+#include <stdbool.h>
+#include "app_log.h"
+#include "app_timer.h"
+
+#include "app_action.h"
+#include "app_time.h"
+
+static void defer_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  app_action_t *action = data;
+
+  atomic_store(&action->defer_running, false);
+  // The expiry itself wakes the super loop; a kernel needs to be told
+  if (action->wake_fn != NULL) {
+    action->wake_fn(action);
+  }
+}
+
+void app_action_init(app_action_t *action,
+                     const app_action_def_t *table,
+                     uint8_t count,
+                     void (*wake)(app_action_t *action))
+{
+  action->table = table;
+  action->count = count < APP_ACTION_MAX ? count : APP_ACTION_MAX;
+  action->wake_fn = wake;
+  atomic_store(&action->pending, 0);
+  app_timer_stop(&action->defer_timer);
+  atomic_store(&action->defer_running, false);
+  for (int i = 0; i < APP_ACTION_MAX; i++) {
+    action->has_run[i] = false;
+    action->last_post[i] = 0;
+  }
+}
+
+void app_action_post(app_action_t *action, uint8_t number)
+{
+  uint64_t now = app_time_ticks();
+  uint32_t bit = 1u << number;
+
+  if (number >= action->count) {
+    return;
+  }
+  action->posted++;
+  if (action->last_post[number] != 0
+      && now - action->last_post[number] < app_time_ms_to_ticks(APP_ACTION_DEBOUNCE_MS)) {
+    action->debounced++;
+    return;
+  }
+  action->last_post[number] = now;
+  if (atomic_fetch_or(&action->pending, bit) & bit) {
+    action->collapsed++;
+    return;
+  }
+  if (action->wake_fn != NULL) {
+    action->wake_fn(action);
+  }
+}
+
+void app_action_process(app_action_t *action)
+{
+  uint32_t todo = atomic_load(&action->pending);
+  uint64_t now;
+  uint64_t next_wait = UINT64_MAX;
+
+  if (todo == 0) {
+    return;
+  }
+  now = app_time_ticks();
+  for (uint8_t i = 0; i < action->count; i++) {
+    uint32_t bit = 1u << i;
+    if (!(todo & bit)) {
+      continue;
+    }
+    if (action->has_run[i] && action->table[i].min_interval_ms != 0) {
+      uint64_t interval = app_time_ms_to_ticks(action->table[i].min_interval_ms);
+      if (now - action->last_run[i] < interval) {
+        // Keep it pending; further posts collapse into this run
+        if (interval - (now - action->last_run[i]) < next_wait) {
+          next_wait = interval - (now - action->last_run[i]);
+        }
+        continue;
+      }
+    }
+    atomic_fetch_and(&action->pending, ~bit);
+    action->has_run[i] = true;
+    action->last_run[i] = now;
+    action->run_count++;
+    action->table[i].run(action);
+  }
+
+  // Without a kernel this runs on every pass of the super loop; leave a
+  // running timer alone unless an action is due before it expires
+  if (next_wait != UINT64_MAX
+      && (!atomic_load(&action->defer_running) || now + next_wait < action->defer_due)) {
+    uint32_t ms = (uint32_t)app_time_ticks_to_ms(next_wait) + 1;
+    app_timer_stop(&action->defer_timer);
+    action->defer_due = now + next_wait;
+    atomic_store(&action->defer_running, true);
+    app_timer_start(&action->defer_timer, ms, defer_timer_cb, action, false);
+  }
+}
+
+void app_action_report(const app_action_t *action)
+{
+  app_log("Actions: %lu posted, %lu debounced, %lu collapsed, %lu run\r\n",
+          (unsigned long)action->posted,
+          (unsigned long)action->debounced,
+          (unsigned long)action->collapsed,
+          (unsigned long)action->run_count);
+}
@@ -0,0 +1,148 @@
+/***************************************************************************//**
+ * @file app_blob_rx.c
+ * @brief Receiver side of the blob distribution.
+ ******************************************************************************/
+#include <string.h>
+#include "app_timer.h"
+#include "sl_bt_api.h"
+
+#include "app_blob_rx.h"
+#include "app_tasks.h"
+
+static uint32_t all_chunks(const app_blob_rx_t *blob)
+{
+  return blob->total >= 32 ? UINT32_MAX : (1u << blob->total) - 1;
+}
+
+static void reply_timer_cb(app_timer_t *handle, void *data)
+{
+  app_blob_rx_t *blob = data;
+
+  (void)handle;
+  sl_bt_external_signal(blob->reply_signal_mask);
+}
+
+// A chunk or query of another blob than ours starts it over
+static bool follow(app_blob_rx_t *blob, uint8_t id, uint8_t blob_total)
+{
+  if (blob_total == 0 || blob_total > APP_BLOB_MAX_CHUNKS) {
+    return false;
+  }
+  if (blob->have_blob && id == blob->blob_id) {
+    return blob_total == blob->total;
+  }
+  app_timer_stop(&blob->reply_timer);
+  blob->have_blob = true;
+  blob->blob_id = id;
+  blob->total = blob_total;
+  blob->received = 0;
+  blob->blob_len = 0;
+  blob->complete = false;
+  blob->reported = false;
+  return true;
+}
+
+static void on_chunk(app_blob_rx_t *blob, const uint8_t *data, uint8_t len)
+{
+  uint8_t seq = data[2];
+  uint8_t chunk_len = len - APP_BLOB_CHUNK_HEADER_LEN;
+
+  // Every chunk but the last is full
+  if (!follow(blob, data[1], data[3]) || seq >= blob->total
+      || chunk_len > APP_BLOB_CHUNK_DATA
+      || (seq + 1 < blob->total && chunk_len != APP_BLOB_CHUNK_DATA)) {
+    return;
+  }
+  if (blob->received & (1u << seq)) {
+    return;
+  }
+  memcpy(&blob->storage[seq * APP_BLOB_CHUNK_DATA], &data[APP_BLOB_CHUNK_HEADER_LEN], chunk_len);
+  blob->received |= 1u << seq;
+  if (seq + 1 == blob->total) {
+    blob->blob_len = seq * APP_BLOB_CHUNK_DATA + chunk_len;
+  }
+  if (blob->received == all_chunks(blob) && !blob->complete) {
+    blob->complete = true;
+    blob->done_fn(blob, blob->storage, blob->blob_len);
+  }
+}
+
+static void on_query(app_blob_rx_t *blob, uint16_t source, const uint8_t *data)
+{
+  uint32_t window_ms;
+
+  if (!follow(blob, data[1], data[2])) {
+    return;
+  }
+  if (blob->complete && blob->reported && !(data[4] & APP_BLOB_QUERY_ALWAYS)) {
+    return;
+  }
+  blob->reply_dest = source;
+  app_timer_stop(&blob->reply_timer);
+  if (data[3] == 0) {
+    app_blob_rx_process(blob);
+    return;
+  }
+  // xorshift32
+  blob->rng_state ^= blob->rng_state << 13;
+  blob->rng_state ^= blob->rng_state >> 17;
+  blob->rng_state ^= blob->rng_state << 5;
+  window_ms = (uint32_t)data[3] * APP_BLOB_SPREAD_UNIT_MS;
+  app_timer_start(&blob->reply_timer, 1 + blob->rng_state % window_ms, reply_timer_cb, blob, false);
+}
+
+void app_blob_rx_init(app_blob_rx_t *blob,
+                      app_blob_rx_send_fn send_status,
+                      app_blob_rx_done_fn done,
+                      uint32_t reply_signal)
+{
+  size_t len = 0;
+
+  app_timer_stop(&blob->reply_timer);
+  memset(blob, 0, sizeof(*blob));
+  blob->send_fn = send_status;
+  blob->done_fn = done;
+  blob->reply_signal_mask = reply_signal;
+  if (sl_bt_system_get_random_data(sizeof(blob->rng_state), sizeof(blob->rng_state), &len,
+                                   (uint8_t *)&blob->rng_state) != SL_STATUS_OK
+      || blob->rng_state == 0) {
+    blob->rng_state = 0x9E3779B9u;
+  }
+}
+
+void app_blob_rx_on_message(app_blob_rx_t *blob, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  if (blob->send_fn == NULL || len == 0) {
+    return;
+  }
+  if (data[0] == APP_BLOB_TYPE_CHUNK && len >= APP_BLOB_CHUNK_HEADER_LEN) {
+    on_chunk(blob, data, len);
+  } else if (data[0] == APP_BLOB_TYPE_QUERY && len >= APP_BLOB_QUERY_LEN) {
+    on_query(blob, source, data);
+  }
+}
+
+void app_blob_rx_process(app_blob_rx_t *blob)
+{
+  uint8_t status[APP_BLOB_STATUS_LEN];
+  // Chunks that came in during the delay are not asked for again
+  uint32_t missing = all_chunks(blob) & ~blob->received;
+  sl_status_t sc;
+
+  if (!blob->have_blob) {
+    return;
+  }
+  status[0] = blob->blob_id;
+  status[1] = missing & 0xFF;
+  status[2] = (missing >> 8) & 0xFF;
+  status[3] = (missing >> 16) & 0xFF;
+  status[4] = missing >> 24;
+  sc = blob->send_fn(blob, blob->reply_dest, status, sizeof(status));
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Blob status error: 0x%04lX\r\n", sc);
+    return;
+  }
+  if (missing == 0) {
+    blob->reported = true;
+  }
+}
@@ -0,0 +1,72 @@
+/***************************************************************************//**
+ * @file app_blob_rx.h
+ * @brief Receiver side of the blob distribution.
+ *
+ * Chunks of the current blob are stored in place and marked in a bitmap. A
+ * chunk or query with a new id starts a new blob. A query is answered with
+ * the missing bitmap after a random delay within its spread; a complete
+ * blob answers a group query only once. The blob is handed to @p done in
+ * place once when it is complete.
+ *
+ * The state lives in an app_blob_rx_t owned by the caller, so a host
+ * simulation can run many clients in one process.
+ ******************************************************************************/
+
+#ifndef APP_BLOB_RX_H
+#define APP_BLOB_RX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+#include "app_blob.h"
+
+typedef struct app_blob_rx app_blob_rx_t;
+
+// Send @p len bytes of a blob_status to @p destination
+typedef sl_status_t (*app_blob_rx_send_fn)(app_blob_rx_t *blob,
+                                           uint16_t destination,
+                                           const uint8_t *data,
+                                           uint8_t len);
+
+// Complete blob of @p len bytes
+typedef void (*app_blob_rx_done_fn)(app_blob_rx_t *blob, const uint8_t *data, uint16_t len);
+
+struct app_blob_rx {
+  app_blob_rx_send_fn send_fn;
+  app_blob_rx_done_fn done_fn;
+  uint32_t reply_signal_mask;
+  app_timer_t reply_timer;
+  uint32_t rng_state;
+
+  bool have_blob;
+  uint8_t blob_id;
+  uint8_t total;
+  uint32_t received;                    // bit n: chunk n stored
+  uint16_t blob_len;                    // known once the last chunk is in
+  bool complete;
+  bool reported;                        // completion sent to a group query
+  uint16_t reply_dest;
+  uint8_t storage[APP_BLOB_MAX_LEN];
+};
+
+/***************************************************************************//**
+ * @p send_status sends a blob_status, @p done gets the complete blob.
+ * @p reply_signal is raised with sl_bt_external_signal() when the delay of
+ * a status answer is over and app_blob_rx_process() should send it.
+ ******************************************************************************/
+void app_blob_rx_init(app_blob_rx_t *blob,
+                      app_blob_rx_send_fn send_status,
+                      app_blob_rx_done_fn done,
+                      uint32_t reply_signal);
+
+/***************************************************************************//**
+ * Handle a blob_transfer from @p source.
+ ******************************************************************************/
+void app_blob_rx_on_message(app_blob_rx_t *blob, uint16_t source, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Send the status answer when @p reply_signal was raised.
+ ******************************************************************************/
+void app_blob_rx_process(app_blob_rx_t *blob);
+
+#endif // APP_BLOB_RX_H
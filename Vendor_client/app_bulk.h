@@ -0,0 +1,51 @@
+/***************************************************************************//**
+ * @file app_bulk.h
+ * @brief Bulk transfer message format, shared by the client and server.
+ *
+ * A client uploads its sample log as a session of up to
+ * APP_BULK_MAX_CHUNKS bulk_chunk messages to the server. Every chunk names
+ * the session, its own sequence number and the chunk count, so the server
+ * can place it in storage whichever chunk arrives first:
+ *
+ *   session (1) | seq (1) | total (1) | up to APP_BULK_CHUNK_DATA bytes
+ *
+ * The server answers with a selective ack of the whole session, bit n set
+ * when chunk n is stored, little-endian:
+ *
+ *   session (1) | status (1) | received bitmap (4)
+ *
+ * The data is a sequence of APP_BULK_RECORD_LEN byte records, oldest first:
+ * the app_sensor_codec payload followed by the time in seconds at which the
+ * sample was taken. That is network time from app_sync, the uptime of the
+ * server, once the client is in sync and the client's own uptime before.
+ ******************************************************************************/
+
+#ifndef APP_BULK_H
+#define APP_BULK_H
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "app_sensor_codec.h"
+
+#define APP_BULK_CHUNK_HEADER_LEN       3
+#define APP_BULK_RECORD_LEN             (APP_SENSOR_PACKED_LEN + 4)
+#define APP_BULK_RECORDS_PER_CHUNK      4
+#define APP_BULK_CHUNK_DATA             (APP_BULK_RECORDS_PER_CHUNK * APP_BULK_RECORD_LEN)
+#define APP_BULK_CHUNK_MAX_LEN          (APP_BULK_CHUNK_HEADER_LEN + APP_BULK_CHUNK_DATA)
+
+// One ack bitmap covers a whole session
+#define APP_BULK_MAX_CHUNKS             32
+#define APP_BULK_MAX_DATA               (APP_BULK_MAX_CHUNKS * APP_BULK_CHUNK_DATA)
+
+#define APP_BULK_ACK_LEN                6
+
+// Ack status
+#define APP_BULK_STATUS_OK              0
+#define APP_BULK_STATUS_BUSY            1   // no free session, try again later
+
+// Chunks in flight before the sender waits for an ack; each chunk is a
+// few segments, so this keeps the segments in flight within what the
+// relays can buffer
+#define APP_BULK_WINDOW                 4
+
+#endif // APP_BULK_H
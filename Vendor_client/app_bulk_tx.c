@@ -0,0 +1,284 @@
+/***************************************************************************//**
+ * @file app_bulk_tx.c
+ * @brief Sender side of the bulk transfer: the sample log and its upload.
+ ******************************************************************************/
+#include <string.h>
+#include "app_timer.h"
+#include "sl_bt_api.h"
+
+#include "app_bulk_tx.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+// Retry of a chunk the stack had no buffer for
+#define RETRY_MS                        50
+
+
+
+
+static uint8_t popcount32(uint32_t x)
+{
+  uint8_t n = 0;
+  for (; x != 0; x &= x - 1) {
+    n++;
+  }
+  return n;
+}
+
+static uint32_t all_chunks(const app_bulk_tx_t *bulk)
+{
+  return bulk->total >= 32 ? UINT32_MAX : (1u << bulk->total) - 1;
+}
+
+static void set_ack_timeout(app_bulk_tx_t *bulk, uint64_t ticks)
+{
+  uint64_t min = app_time_ms_to_ticks(APP_BULK_TX_ACK_TIMEOUT_MS);
+  uint64_t max = app_time_ms_to_ticks(APP_BULK_TX_ACK_TIMEOUT_MAX_MS);
+
+  bulk->ack_timeout = ticks < min ? min : ticks > max ? max : ticks;
+}
+
+static void tick_timer_cb(app_timer_t *handle, void *data)
+{
+  app_bulk_tx_t *bulk = data;
+
+  (void)handle;
+  // Sending belongs to the worker
+  sl_bt_external_signal(bulk->tick_signal_mask);
+}
+
+static void arm_until(app_bulk_tx_t *bulk, uint64_t when)
+{
+  uint64_t now = app_time_ticks();
+  uint32_t ms = when > now ? (uint32_t)app_time_ticks_to_ms(when - now) + 1 : 1;
+
+  app_timer_stop(&bulk->tick_timer);
+  app_timer_start(&bulk->tick_timer, ms, tick_timer_cb, bulk, false);
+}
+
+static uint8_t build_chunk(const app_bulk_tx_t *bulk, uint8_t seq, uint8_t *out)
+{
+  uint16_t first = seq * APP_BULK_RECORDS_PER_CHUNK;
+  uint16_t count = bulk->records - first;
+  uint8_t len = APP_BULK_CHUNK_HEADER_LEN;
+
+  if (count > APP_BULK_RECORDS_PER_CHUNK) {
+    count = APP_BULK_RECORDS_PER_CHUNK;
+  }
+  out[0] = bulk->session;
+  out[1] = seq;
+  out[2] = bulk->total;
+  for (uint16_t i = 0; i < count; i++) {
+    memcpy(&out[len],
+           bulk->log_records[(bulk->log_first + first + i) % APP_BULK_TX_LOG_RECORDS],
+           APP_BULK_RECORD_LEN);
+    len += APP_BULK_RECORD_LEN;
+  }
+  return len;
+}
+
+static void send_window(app_bulk_tx_t *bulk)
+{
+  uint8_t chunk[APP_BULK_CHUNK_MAX_LEN];
+  uint32_t need = all_chunks(bulk) & ~bulk->acked & ~bulk->in_flight;
+  bool stalled = false;
+  sl_status_t sc;
+
+  while (need != 0 && popcount32(bulk->in_flight) < APP_BULK_WINDOW) {
+    uint8_t seq = 0;
+    while (!(need & (1u << seq))) {
+      seq++;
+    }
+    sc = bulk->send_fn(bulk, bulk->destination, chunk, build_chunk(bulk, seq, chunk));
+    if (sc == SL_STATUS_NO_MORE_RESOURCE) {
+      stalled = true;
+      break;
+    }
+    if (sc != SL_STATUS_OK) {
+      // Counted as sent; the ack timeout sends it again
+      APP_TASK_LOG("Bulk chunk %u error: 0x%04lX\r\n", seq, sc);
+    }
+    if (bulk->sent & (1u << seq)) {
+      bulk->resent |= 1u << seq;
+    }
+    bulk->sent |= 1u << seq;
+    bulk->sent_at[seq] = app_time_ticks();
+    bulk->in_flight |= 1u << seq;
+    need &= ~(1u << seq);
+    bulk->chunks_sent++;
+    bulk->deadline = bulk->sent_at[seq] + bulk->ack_timeout;
+  }
+  if (stalled) {
+    app_timer_stop(&bulk->tick_timer);
+    app_timer_start(&bulk->tick_timer, RETRY_MS, tick_timer_cb, bulk, false);
+  } else {
+    arm_until(bulk, bulk->deadline);
+  }
+}
+
+static void finish(app_bulk_tx_t *bulk, bool ok)
+{
+  uint32_t elapsed_ms = (uint32_t)app_time_ticks_to_ms(app_time_ticks() - bulk->started);
+  uint16_t bytes = bulk->records * APP_BULK_RECORD_LEN;
+
+  app_timer_stop(&bulk->tick_timer);
+  bulk->active = false;
+  if (!ok) {
+    APP_TASK_LOG("Bulk upload to 0x%04X failed, %u of %u chunks acked\r\n",
+                 bulk->destination, popcount32(bulk->acked), bulk->total);
+    return;
+  }
+  bulk->log_first = (bulk->log_first + bulk->records) % APP_BULK_TX_LOG_RECORDS;
+  bulk->log_count -= bulk->records;
+  APP_TASK_LOG("Bulk upload: %u records, %u bytes in %lu ms, %lu B/s, %lu chunks sent for %u\r\n",
+               bulk->records,
+               bytes,
+               (unsigned long)elapsed_ms,
+               (unsigned long)(elapsed_ms != 0 ? bytes * 1000u / elapsed_ms : 0),
+               (unsigned long)bulk->chunks_sent,
+               bulk->total);
+  if (bulk->log_dropped != 0) {
+    APP_TASK_LOG("Bulk log: %lu samples dropped while full\r\n", (unsigned long)bulk->log_dropped);
+  }
+}
+
+void app_bulk_tx_init(app_bulk_tx_t *bulk, app_bulk_tx_send_fn send, uint32_t tick_signal)
+{
+  size_t len = 0;
+
+  app_timer_stop(&bulk->tick_timer);
+  memset(bulk, 0, sizeof(*bulk));
+  bulk->send_fn = send;
+  bulk->tick_signal_mask = tick_signal;
+  // A random first session, so the receiver does not take the first
+  // upload after a reboot for a copy of an earlier one
+  if (sl_bt_system_get_random_data(sizeof(bulk->rng_state), sizeof(bulk->rng_state), &len,
+                                   (uint8_t *)&bulk->rng_state) != SL_STATUS_OK
+      || bulk->rng_state == 0) {
+    bulk->rng_state = 0x9E3779B9u ^ (uint32_t)app_time_ticks();
+  }
+  bulk->session = (uint8_t)bulk->rng_state;
+}
+
+void app_bulk_tx_log(app_bulk_tx_t *bulk, const uint8_t *packed, uint32_t uptime_s)
+{
+  uint8_t *record;
+
+  if (bulk->log_count == APP_BULK_TX_LOG_RECORDS) {
+    if (bulk->active) {
+      // The records of the running upload must stay where they are
+      bulk->log_dropped++;
+      return;
+    }
+    bulk->log_first = (bulk->log_first + 1) % APP_BULK_TX_LOG_RECORDS;
+    bulk->log_count--;
+  }
+  record = bulk->log_records[(bulk->log_first + bulk->log_count) % APP_BULK_TX_LOG_RECORDS];
+  memcpy(record, packed, APP_SENSOR_PACKED_LEN);
+  record[APP_SENSOR_PACKED_LEN] = uptime_s & 0xFF;
+  record[APP_SENSOR_PACKED_LEN + 1] = (uptime_s >> 8) & 0xFF;
+  record[APP_SENSOR_PACKED_LEN + 2] = (uptime_s >> 16) & 0xFF;
+  record[APP_SENSOR_PACKED_LEN + 3] = uptime_s >> 24;
+  bulk->log_count++;
+}
+
+bool app_bulk_tx_start(app_bulk_tx_t *bulk, uint16_t dest)
+{
+  if (bulk->active || bulk->log_count == 0 || bulk->send_fn == NULL) {
+    return false;
+  }
+  bulk->destination = dest;
+  bulk->session++;
+  bulk->records = bulk->log_count;
+  bulk->total = (bulk->records + APP_BULK_RECORDS_PER_CHUNK - 1) / APP_BULK_RECORDS_PER_CHUNK;
+  bulk->acked = 0;
+  bulk->in_flight = 0;
+  bulk->sent = 0;
+  bulk->resent = 0;
+  bulk->ack_time = 0;
+  set_ack_timeout(bulk, 0);
+  bulk->timeouts = 0;
+  bulk->chunks_sent = 0;
+  bulk->log_dropped = 0;
+  bulk->backing_off = false;
+  bulk->active = true;
+  bulk->started = app_time_ticks();
+  bulk->deadline = bulk->started + bulk->ack_timeout;
+  send_window(bulk);
+  return true;
+}
+
+void app_bulk_tx_on_ack(app_bulk_tx_t *bulk, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint64_t now = app_time_ticks();
+  uint32_t received, timed;
+  uint8_t highest;
+
+  if (!bulk->active || source != bulk->destination || len < APP_BULK_ACK_LEN || data[0] != bulk->session) {
+    return;
+  }
+  if (data[1] == APP_BULK_STATUS_BUSY) {
+    // xorshift32
+    bulk->rng_state ^= bulk->rng_state << 13;
+    bulk->rng_state ^= bulk->rng_state >> 17;
+    bulk->rng_state ^= bulk->rng_state << 5;
+    bulk->in_flight = 0;
+    bulk->backing_off = true;
+    bulk->deadline = app_time_ticks()
+               + app_time_ms_to_ticks(APP_BULK_TX_BUSY_MIN_MS
+                                      + bulk->rng_state % (APP_BULK_TX_BUSY_MAX_MS - APP_BULK_TX_BUSY_MIN_MS));
+    arm_until(bulk, bulk->deadline);
+    return;
+  }
+
+  received = (uint32_t)data[2] | ((uint32_t)data[3] << 8)
+             | ((uint32_t)data[4] << 16) | ((uint32_t)data[5] << 24);
+  received &= all_chunks(bulk);
+  // Ack time of the newly acked chunks that went out once
+  timed = received & bulk->sent & ~bulk->acked & ~bulk->resent;
+  for (uint8_t seq = 0; timed != 0; seq++, timed >>= 1) {
+    if (timed & 1u) {
+      uint64_t sample = now - bulk->sent_at[seq];
+      bulk->ack_time = bulk->ack_time == 0 ? sample : (3 * bulk->ack_time + sample) / 4;
+    }
+  }
+  if (bulk->ack_time != 0) {
+    set_ack_timeout(bulk, 2 * bulk->ack_time);
+  }
+  bulk->acked |= received;
+  bulk->in_flight &= ~bulk->acked;
+  bulk->timeouts = 0;
+  if (bulk->acked == all_chunks(bulk)) {
+    finish(bulk, true);
+    return;
+  }
+  if (received != 0) {
+    // Chunks below the highest one received that are still missing were lost
+    for (highest = 31; !(received & (1u << highest)); highest--) {
+    }
+    bulk->in_flight &= ~((1u << highest) - 1);
+  }
+  send_window(bulk);
+}
+
+void app_bulk_tx_process(app_bulk_tx_t *bulk)
+{
+  if (!bulk->active) {
+    return;
+  }
+  if (app_time_ticks() >= bulk->deadline) {
+    if (bulk->backing_off) {
+      bulk->backing_off = false;
+    } else if (++bulk->timeouts > APP_BULK_TX_MAX_TIMEOUTS) {
+      finish(bulk, false);
+      return;
+    } else {
+      // No ack at all: everything unacked goes again, with more time
+      bulk->in_flight = 0;
+      set_ack_timeout(bulk, 2 * bulk->ack_timeout);
+    }
+  } else if (bulk->backing_off) {
+    return;
+  }
+  send_window(bulk);
+}
@@ -0,0 +1,108 @@
+/***************************************************************************//**
+ * @file app_bulk_tx.h
+ * @brief Sender side of the bulk transfer: the sample log and its upload.
+ *
+ * Every sample is appended to a log of APP_BULK_TX_LOG_RECORDS records,
+ * whether it was published or not. An upload sends the records logged so
+ * far as one session of chunks. At most APP_BULK_WINDOW chunks are
+ * unacknowledged at a time. A selective ack frees the acked chunks, and
+ * chunks below the highest acked one that are still missing count as lost
+ * and are sent again first. Without an ack before the ack timeout all
+ * unacked chunks are sent again, up to APP_BULK_TX_MAX_TIMEOUTS times in a
+ * row. The timeout starts at APP_BULK_TX_ACK_TIMEOUT_MS and follows twice
+ * the smoothed time from sending a chunk to its ack, counting only chunks
+ * sent once; a timeout doubles it. A full window over several hops takes
+ * longer than the initial timeout. A busy receiver is retried after a random back-off. Uploaded
+ * records are removed from the log; while an upload runs the log does not
+ * overwrite records, so new samples are dropped once it is full.
+ *
+ * The log and the upload live in an app_bulk_tx_t owned by the caller, so a
+ * host simulation can run many clients in one process.
+ ******************************************************************************/
+
+#ifndef APP_BULK_TX_H
+#define APP_BULK_TX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+#include "app_bulk.h"
+
+// One session holds the whole log
+#define APP_BULK_TX_LOG_RECORDS         (APP_BULK_MAX_CHUNKS * APP_BULK_RECORDS_PER_CHUNK)
+
+#define APP_BULK_TX_ACK_TIMEOUT_MS      4000
+#define APP_BULK_TX_ACK_TIMEOUT_MAX_MS  12000
+#define APP_BULK_TX_MAX_TIMEOUTS        4
+
+// Back-off range after a busy answer
+#define APP_BULK_TX_BUSY_MIN_MS         1000
+#define APP_BULK_TX_BUSY_MAX_MS         5000
+
+typedef struct app_bulk_tx app_bulk_tx_t;
+
+// Send @p len bytes of a bulk_chunk to @p destination
+typedef sl_status_t (*app_bulk_tx_send_fn)(app_bulk_tx_t *bulk,
+                                           uint16_t destination,
+                                           const uint8_t *data,
+                                           uint8_t len);
+
+struct app_bulk_tx {
+  uint8_t log_records[APP_BULK_TX_LOG_RECORDS][APP_BULK_RECORD_LEN];
+  uint16_t log_first;                   // index of the oldest record
+  uint16_t log_count;
+  uint32_t log_dropped;
+
+  app_bulk_tx_send_fn send_fn;
+  uint32_t tick_signal_mask;
+  app_timer_t tick_timer;
+  uint32_t rng_state;
+
+  bool active;
+  bool backing_off;
+  uint16_t destination;
+  uint8_t session;
+  uint8_t total;                        // chunks of the session
+  uint16_t records;                     // records of the session
+  uint32_t acked;
+  uint32_t in_flight;                   // sent, not acked yet
+  uint32_t sent;                        // sent at least once
+  uint32_t resent;                      // sent more than once, no ack time
+  uint64_t sent_at[APP_BULK_MAX_CHUNKS];
+  uint64_t ack_time;                    // smoothed, 0 until measured
+  uint64_t ack_timeout;
+  uint8_t timeouts;
+  uint64_t deadline;                    // ack timeout or end of back-off
+  uint64_t started;
+  uint32_t chunks_sent;
+};
+
+/***************************************************************************//**
+ * Clear the log. @p send sends a bulk_chunk. @p tick_signal is raised with
+ * sl_bt_external_signal() when app_bulk_tx_process() has work to do.
+ ******************************************************************************/
+void app_bulk_tx_init(app_bulk_tx_t *bulk, app_bulk_tx_send_fn send, uint32_t tick_signal);
+
+/***************************************************************************//**
+ * Append a sample, packed by app_sensor_pack(), taken at @p uptime_s.
+ ******************************************************************************/
+void app_bulk_tx_log(app_bulk_tx_t *bulk, const uint8_t *packed, uint32_t uptime_s);
+
+/***************************************************************************//**
+ * Upload the log to @p destination. Returns false if an upload is running
+ * or the log is empty.
+ ******************************************************************************/
+bool app_bulk_tx_start(app_bulk_tx_t *bulk, uint16_t destination);
+
+/***************************************************************************//**
+ * Handle a bulk_ack from @p source.
+ ******************************************************************************/
+void app_bulk_tx_on_ack(app_bulk_tx_t *bulk, uint16_t source, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Send what the window allows and handle timeouts, when @p tick_signal was
+ * raised.
+ ******************************************************************************/
+void app_bulk_tx_process(app_bulk_tx_t *bulk);
+
+#endif // APP_BULK_TX_H
@@ -0,0 +1,26 @@
+/***************************************************************************//**
+ * @file app_ctrl.c
+ * @brief Control plane message format, shared by the server and clients.
+ ******************************************************************************/
+#include "app_ctrl.h"
+
+void app_ctrl_encode(const app_ctrl_cmd_t *cmd, uint8_t *out)
+{
+  out[0] = cmd->seq;
+  out[1] = cmd->command;
+  out[2] = cmd->argument & 0xFF;
+  out[3] = cmd->argument >> 8;
+  out[4] = cmd->spread;
+}
+
+bool app_ctrl_decode(const uint8_t *data, uint8_t len, app_ctrl_cmd_t *cmd)
+{
+  if (len < APP_CTRL_CMD_LEN) {
+    return false;
+  }
+  cmd->seq = data[0];
+  cmd->command = data[1];
+  cmd->argument = (uint16_t)(data[2] | (data[3] << 8));
+  cmd->spread = data[4];
+  return true;
+}
@@ -0,0 +1,81 @@
+/***************************************************************************//**
+ * @file app_filter.c
+ * @brief Fixed-point filter pipeline for sensor readings.
+ ******************************************************************************/
+#include <string.h>
+#include "app_filter.h"
+
+void app_filter_init(app_filter_t *f, const app_filter_config_t *config)
+{
+  memset(f, 0, sizeof(*f));
+  f->config = config;
+}
+
+void app_filter_abort(app_filter_t *f)
+{
+  f->acc = 0;
+  f->acc_count = 0;
+}
+
+static int32_t median(const app_filter_t *f)
+{
+  int32_t sorted[APP_FILTER_MEDIAN_MAX];
+
+  // Insertion sort of at most APP_FILTER_MEDIAN_MAX values
+  for (uint8_t i = 0; i < f->window_fill; i++) {
+    int32_t x = f->window[i];
+    uint8_t j = i;
+    while (j > 0 && sorted[j - 1] > x) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = x;
+  }
+  // Lower median while the window is still filling
+  return sorted[(f->window_fill - 1) / 2];
+}
+
+bool app_filter_feed(app_filter_t *f, int32_t raw, int32_t *out)
+{
+  const app_filter_config_t *config = f->config;
+  uint8_t len = config->median_len;
+  int32_t value;
+
+  f->acc += raw;
+  if (++f->acc_count < (1u << config->oversample_log2)) {
+    return false;
+  }
+  // Rounded average of the group
+  value = (f->acc + ((1 << config->oversample_log2) >> 1)) >> config->oversample_log2;
+  f->acc = 0;
+  f->acc_count = 0;
+
+  if (len > APP_FILTER_MEDIAN_MAX) {
+    len = APP_FILTER_MEDIAN_MAX;
+  }
+  if (len > 1) {
+    f->window[f->window_pos] = value;
+    if (++f->window_pos >= len) {
+      f->window_pos = 0;
+    }
+    if (f->window_fill < len) {
+      f->window_fill++;
+    }
+    value = median(f);
+  }
+
+  if (config->ema_shift != 0) {
+    int32_t x = value * (1 << APP_FILTER_EMA_FRAC);
+    if (!f->ema_valid) {
+      // Start from the first value instead of creeping up from zero
+      f->ema = x;
+      f->ema_valid = true;
+    } else {
+      f->ema += (x - f->ema) >> config->ema_shift;
+    }
+    value = (f->ema + (1 << (APP_FILTER_EMA_FRAC - 1))) >> APP_FILTER_EMA_FRAC;
+  }
+
+  *out = value;
+  return true;
+}
@@ -0,0 +1,76 @@
+/***************************************************************************//**
+ * @file app_filter.h
+ * @brief Fixed-point filter pipeline for sensor readings.
+ *
+ * A channel runs each raw reading through three stages, any of which can
+ * be switched off in the configuration:
+ *
+ *   oversampling  2^oversample_log2 readings are averaged into one value
+ *   median        median of the last median_len values, removes spikes
+ *   EMA           y += (x - y) / 2^ema_shift, smooths the rest of the noise
+ *
+ * Everything is integer arithmetic on the milli-unit readings; the EMA
+ * keeps 8 fraction bits. The cost per reading is constant: an add, and
+ * per value a shift, a sort of at most APP_FILTER_MEDIAN_MAX values and a
+ * shift-and-add update.
+ *
+ * Oversampling is the only stage that costs energy: every reading is a
+ * conversion, and each conversion wakes the node twice. Four conversions
+ * per value add about 48 uJ to a sample, 22 % of the sample energy at a
+ * 10 s period on a low-power node (host/sim/energy_model). The low-power
+ * configuration takes one conversion and a slower EMA instead; on the
+ * traces of host/sim/filter_bench its error is 1.1 to 1.5 times that of
+ * the default and it lets fewer reports through.
+ ******************************************************************************/
+
+#ifndef APP_FILTER_H
+#define APP_FILTER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Longest median window
+#define APP_FILTER_MEDIAN_MAX           5
+
+// Fraction bits of the EMA state
+#define APP_FILTER_EMA_FRAC             8
+
+typedef struct {
+  uint8_t oversample_log2;              // 0 = one reading per value
+  uint8_t median_len;                   // odd, 1 = off
+  uint8_t ema_shift;                    // 0 = off
+} app_filter_config_t;
+
+// Four readings per value, median of three, EMA with alpha 1/2
+#define APP_FILTER_CONFIG_DEFAULT       { 2, 3, 1 }
+// One reading per value, median of three, EMA with alpha 1/4
+#define APP_FILTER_CONFIG_LOW_POWER     { 0, 3, 2 }
+
+typedef struct {
+  const app_filter_config_t *config;
+  int32_t acc;                          // oversampling sum
+  uint8_t acc_count;
+  int32_t window[APP_FILTER_MEDIAN_MAX];
+  uint8_t window_pos;
+  uint8_t window_fill;
+  int32_t ema;                          // APP_FILTER_EMA_FRAC fraction bits
+  bool ema_valid;
+} app_filter_t;
+
+/***************************************************************************//**
+ * Reset @p f and use @p config, which must stay valid.
+ ******************************************************************************/
+void app_filter_init(app_filter_t *f, const app_filter_config_t *config);
+
+/***************************************************************************//**
+ * Drop a partial oversampling sum, e.g. after a failed reading.
+ ******************************************************************************/
+void app_filter_abort(app_filter_t *f);
+
+/***************************************************************************//**
+ * Feed one raw reading. Returns true and the filtered value in @p out when
+ * it completed an oversampling group, false if more readings are needed.
+ ******************************************************************************/
+bool app_filter_feed(app_filter_t *f, int32_t raw, int32_t *out);
+
+#endif // APP_FILTER_H
@@ -0,0 +1,183 @@
+/***************************************************************************//**
+ * @file app_hops.c
+ * @brief Heartbeat-derived hop distance and publication TTL selection.
+ ******************************************************************************/
+#include "app_assert.h"
+#include "app_log.h"
+#include "app_timer.h"
+#include "sl_btmesh_api.h"
+
+#include "app_hops.h"
+
+#define HOPS_UNKNOWN   0xFF
+#define TTL_MAX        0x7F
+
+static uint8_t distance(const app_hops_t *hops)
+{
+  return hops->hops_cur < hops->hops_prev ? hops->hops_cur : hops->hops_prev;
+}
+
+static void apply_ttl(app_hops_t *hops)
+{
+  sl_status_t sc;
+  uint16_t appkey_index;
+  uint16_t pub_address;
+  uint8_t ttl, period, retrans, credentials;
+  uint8_t wanted;
+
+  sc = sl_btmesh_test_get_local_model_pub(hops->pub_elem_index,
+                                          hops->pub_vendor_id,
+                                          hops->pub_model_id,
+                                          &appkey_index,
+                                          &pub_address,
+                                          &ttl,
+                                          &period,
+                                          &retrans,
+                                          &credentials);
+  if (sc != SL_STATUS_OK) {
+    // No publication configured yet; try again with the next heartbeat
+    return;
+  }
+
+  if (distance(hops) == HOPS_UNKNOWN) {
+    if (hops->default_ttl == 0) {
+      return;
+    }
+    wanted = hops->default_ttl;
+  } else {
+    if (hops->default_ttl == 0) {
+      hops->default_ttl = ttl;
+    }
+    // TTL 1 is prohibited and a TTL of n reaches n hops
+    wanted = distance(hops) + APP_HOPS_TTL_MARGIN;
+    if (wanted < 2) {
+      wanted = 2;
+    }
+    if (wanted > TTL_MAX) {
+      wanted = TTL_MAX;
+    }
+    // Never flood further than the provisioner intended
+    if (wanted > hops->default_ttl) {
+      wanted = hops->default_ttl;
+    }
+  }
+  if (wanted == ttl) {
+    return;
+  }
+
+  sc = sl_btmesh_test_set_local_model_pub(hops->pub_elem_index,
+                                          hops->pub_vendor_id,
+                                          hops->pub_model_id,
+                                          appkey_index,
+                                          pub_address,
+                                          wanted,
+                                          period,
+                                          retrans,
+                                          credentials);
+  if (sc != SL_STATUS_OK) {
+    app_log("Failed to set publication TTL, error: 0x%lx\r\n", sc);
+    return;
+  }
+  app_log("Publication TTL %u -> %u (%u hops)\r\n", ttl, wanted, distance(hops));
+  if (distance(hops) == HOPS_UNKNOWN) {
+    hops->default_ttl = 0;
+  }
+}
+
+static void window_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  app_hops_t *hops = data;
+  sl_status_t sc;
+
+  hops->hops_prev = hops->hops_cur;
+  hops->hops_cur = HOPS_UNKNOWN;
+  if (distance(hops) == HOPS_UNKNOWN) {
+    // The source went silent or the subscription period ran out
+    apply_ttl(hops);
+    if (hops->sub_source != 0) {
+      sc = sl_btmesh_test_set_local_heartbeat_subscription(hops->sub_source,
+                                                           APP_HOPS_GROUP,
+                                                           APP_HOPS_SUB_PERIOD_LOG);
+      if (sc != SL_STATUS_OK) {
+        // The distance stays unknown, so this is tried again next window
+        app_log("Heartbeat subscription to 0x%04X not renewed, error: 0x%lx\r\n",
+                hops->sub_source, sc);
+      }
+    }
+  }
+}
+
+void app_hops_publish(void)
+{
+  sl_status_t sc;
+
+  sc = sl_btmesh_test_set_local_heartbeat_publication(APP_HOPS_GROUP,
+                                                      0,
+                                                      0xFF,
+                                                      APP_HOPS_PERIOD_LOG,
+                                                      APP_HOPS_HEARTBEAT_TTL,
+                                                      0);
+  app_assert_status_f(sc, "Failed to set heartbeat publication\r\n");
+}
+
+void app_hops_init(app_hops_t *hops,
+                   uint16_t elem_index,
+                   uint16_t vendor_id,
+                   uint16_t model_id)
+{
+  hops->pub_elem_index = elem_index;
+  hops->pub_vendor_id = vendor_id;
+  hops->pub_model_id = model_id;
+  hops->sub_source = 0;
+  hops->hops_cur = HOPS_UNKNOWN;
+  hops->hops_prev = HOPS_UNKNOWN;
+  hops->default_ttl = 0;
+
+  if (APP_HOPS_SINK_ADDRESS != 0) {
+    app_hops_subscribe(hops, APP_HOPS_SINK_ADDRESS);
+  }
+
+  app_timer_stop(&hops->window_timer);
+  app_timer_start(&hops->window_timer,
+                  APP_HOPS_WINDOW_MS,
+                  window_timer_cb,
+                  hops,
+                  true);
+}
+
+void app_hops_subscribe(app_hops_t *hops, uint16_t source)
+{
+  sl_status_t sc;
+
+  if (source == hops->sub_source || distance(hops) != HOPS_UNKNOWN) {
+    return;
+  }
+  sc = sl_btmesh_test_set_local_heartbeat_subscription(source,
+                                                       APP_HOPS_GROUP,
+                                                       APP_HOPS_SUB_PERIOD_LOG);
+  if (sc != SL_STATUS_OK) {
+    app_log("Heartbeat subscription to 0x%04X failed, error: 0x%lx\r\n", source, sc);
+    return;
+  }
+  hops->sub_source = source;
+  app_log("Measuring hops to 0x%04X\r\n", source);
+}
+
+void app_hops_on_heartbeat(app_hops_t *hops, uint16_t source, uint8_t count)
+{
+  (void)source;
+
+  if (count == 0 || count >= HOPS_UNKNOWN) {
+    return;
+  }
+  if (count < hops->hops_cur) {
+    hops->hops_cur = count;
+  }
+  apply_ttl(hops);
+}
+
+uint8_t app_hops_distance(const app_hops_t *hops)
+{
+  return distance(hops) == HOPS_UNKNOWN ? 0 : distance(hops);
+}
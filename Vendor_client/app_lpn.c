@@ -0,0 +1,106 @@
+/***************************************************************************//**
+ * @file app_lpn.c
+ * @brief Low Power Node role for battery powered clients.
+ ******************************************************************************/
+#include "app_assert.h"
+#include "app_log.h"
+#include "app_tasks.h"
+#include "app_timer.h"
+
+#include "app_lpn.h"
+
+static void establish_friendship(void)
+{
+  sl_status_t sc;
+
+  app_log("LPN: looking for a Friend\r\n");
+  sc = sl_btmesh_lpn_establish_friendship(APP_LPN_NETKEY_INDEX);
+  if (sc != SL_STATUS_OK) {
+    app_log("LPN: establish friendship failed, code 0x%04lX\r\n", sc);
+  }
+}
+
+static void lpn_retry_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  establish_friendship();
+}
+
+static void schedule_retry(app_lpn_t *lpn)
+{
+  app_timer_start(&lpn->retry_timer,
+                  APP_LPN_REESTABLISH_MS,
+                  lpn_retry_timer_cb,
+                  lpn,
+                  false);
+}
+
+void app_lpn_start(app_lpn_t *lpn)
+{
+  sl_status_t sc;
+
+  if (lpn->active) {
+    return;
+  }
+  sc = sl_btmesh_lpn_init();
+  app_assert_status_f(sc, "Failed to init LPN\r\n");
+
+  sc = sl_btmesh_lpn_config(sl_btmesh_lpn_queue_length, APP_LPN_MIN_QUEUE_LEN);
+  app_assert_status_f(sc, "Failed to set LPN queue length\r\n");
+  sc = sl_btmesh_lpn_config(sl_btmesh_lpn_poll_timeout, APP_LPN_POLL_TIMEOUT_MS);
+  app_assert_status_f(sc, "Failed to set LPN poll timeout\r\n");
+  sc = sl_btmesh_lpn_config(sl_btmesh_lpn_receive_delay, APP_LPN_RECEIVE_DELAY_MS);
+  app_assert_status_f(sc, "Failed to set LPN receive delay\r\n");
+  sc = sl_btmesh_lpn_config(sl_btmesh_lpn_request_retries, APP_LPN_REQUEST_RETRIES);
+  app_assert_status_f(sc, "Failed to set LPN request retries\r\n");
+  sc = sl_btmesh_lpn_config(sl_btmesh_lpn_retry_interval, APP_LPN_RETRY_INTERVAL_MS);
+  app_assert_status_f(sc, "Failed to set LPN retry interval\r\n");
+
+  lpn->active = true;
+  APP_STACK_LOG("LPN initialized, poll timeout %u ms\r\n", APP_LPN_POLL_TIMEOUT_MS);
+  establish_friendship();
+}
+
+void app_lpn_on_event(app_lpn_t *lpn, sl_btmesh_msg_t *evt)
+{
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_btmesh_evt_lpn_friendship_established_id:
+      lpn->friend_address = evt->data.evt_lpn_friendship_established.friend_address;
+      APP_STACK_LOG("LPN: friendship established with 0x%04X\r\n", lpn->friend_address);
+      break;
+
+    case sl_btmesh_evt_lpn_friendship_failed_id:
+      APP_STACK_LOG("LPN: friendship failed, retry in %u s\r\n",
+                    APP_LPN_REESTABLISH_MS / 1000);
+      schedule_retry(lpn);
+      break;
+
+    case sl_btmesh_evt_lpn_friendship_terminated_id:
+      APP_STACK_LOG("LPN: friendship with 0x%04X terminated, reason 0x%04X\r\n",
+                    lpn->friend_address,
+                    evt->data.evt_lpn_friendship_terminated.reason);
+      lpn->friend_address = 0;
+      schedule_retry(lpn);
+      break;
+
+    default:
+      break;
+  }
+}
+
+void app_lpn_poll(const app_lpn_t *lpn)
+{
+  if (lpn->friend_address == 0) {
+    return;
+  }
+  sl_status_t sc = sl_btmesh_lpn_poll(APP_LPN_NETKEY_INDEX);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("LPN: poll failed, code 0x%04lX\r\n", sc);
+  }
+}
+
+bool app_lpn_has_friend(const app_lpn_t *lpn)
+{
+  return lpn->friend_address != 0;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************//**
+ * @file app_lpn.h
+ * @brief Low Power Node role for battery powered clients.
+ *
+ * An LPN client does not relay. It establishes a friendship with a Friend
+ * node (the relay) and polls it for queued messages, preferably in the same
+ * wake window as its own publications.
+ *
+ * The friendship state lives in an app_lpn_t owned by the caller, so a host
+ * simulation can run many clients in one process.
+ ******************************************************************************/
+
+#ifndef APP_LPN_H
+#define APP_LPN_H
+
+#include <stdbool.h>
+#include "sl_btmesh_api.h"
+#include "app_power.h"
+#include "app_timer.h"
+
+#ifndef APP_LPN_ENABLE
+#define APP_LPN_ENABLE                  APP_LOW_POWER_ENABLE
+#endif
+
+// Primary network key
+#define APP_LPN_NETKEY_INDEX            0
+
+// Friendship parameters requested from the Friend
+#define APP_LPN_POLL_TIMEOUT_MS         10000
+#define APP_LPN_MIN_QUEUE_LEN           2
+#define APP_LPN_RECEIVE_DELAY_MS        50
+#define APP_LPN_REQUEST_RETRIES         4
+#define APP_LPN_RETRY_INTERVAL_MS       1000
+
+// Delay before a new friendship attempt after a failure or termination
+#define APP_LPN_REESTABLISH_MS          30000
+
+typedef struct {
+  bool active;
+  uint16_t friend_address;              // 0 = no friendship
+  app_timer_t retry_timer;
+} app_lpn_t;
+
+/***************************************************************************//**
+ * Initialize the LPN feature and look for a Friend. Call once the node is
+ * provisioned.
+ ******************************************************************************/
+void app_lpn_start(app_lpn_t *lpn);
+
+/***************************************************************************//**
+ * Handle the sl_btmesh_evt_lpn_* events.
+ ******************************************************************************/
+void app_lpn_on_event(app_lpn_t *lpn, sl_btmesh_msg_t *evt);
+
+/***************************************************************************//**
+ * Poll the Friend now instead of waiting for the poll timeout.
+ ******************************************************************************/
+void app_lpn_poll(const app_lpn_t *lpn);
+
+/***************************************************************************//**
+ * Returns true while a friendship is established.
+ ******************************************************************************/
+bool app_lpn_has_friend(const app_lpn_t *lpn);
+
+#endif // APP_LPN_H
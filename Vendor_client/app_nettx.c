@@ -0,0 +1,202 @@
+/***************************************************************************//**
+ * @file app_nettx.c
+ * @brief Adaptive network transmit and relay retransmit tuning.
+ ******************************************************************************/
+#include <string.h>
+#include "app_assert.h"
+#include "app_timer.h"
+#include "sl_bt_api.h"
+#include "sl_btmesh_api.h"
+
+#include "app_nettx.h"
+#include "app_tasks.h"
+
+typedef struct {
+  uint8_t count;                        // retransmissions after the first TX
+  uint8_t interval_ms;                  // multiple of 10 ms
+} app_nettx_level_t;
+
+static const app_nettx_level_t levels[APP_NETTX_LEVELS] = {
+  { 0, 0 },                             // single transmission
+  { 1, 20 },
+  { 2, 20 },
+  { 3, 30 },
+  { 4, 40 },
+};
+static void apply_level(app_nettx_t *nettx)
+{
+  sl_status_t sc;
+  const app_nettx_level_t *l = &levels[nettx->level];
+
+  sc = sl_btmesh_test_set_nettx(l->count, l->interval_ms);
+  app_assert_status_f(sc, "Failed to set network tx state\r\n");
+  if (nettx->relay_enabled) {
+    sc = sl_btmesh_test_set_relay(1, l->count, l->interval_ms);
+  } else {
+    sc = sl_btmesh_test_set_relay(0, 0, 0);
+  }
+  app_assert_status_f(sc, "Failed to set relay\r\n");
+}
+
+static app_nettx_source_t *find_source(app_nettx_t *nettx, uint16_t address)
+{
+  app_nettx_source_t *free_slot = NULL;
+
+  for (int i = 0; i < APP_NETTX_SOURCES; i++) {
+    if (nettx->sources[i].address == address) {
+      return &nettx->sources[i];
+    }
+    if (free_slot == NULL && nettx->sources[i].address == 0) {
+      free_slot = &nettx->sources[i];
+    }
+  }
+  if (free_slot != NULL) {
+    free_slot->address = address;
+    free_slot->has_baseline = false;
+    free_slot->rx_since = 0;
+  }
+  // NULL when the table is full: the source is simply not measured
+  return free_slot;
+}
+
+static void log_level(const app_nettx_t *nettx)
+{
+  const app_nettx_level_t *l = &levels[nettx->level];
+
+  APP_TASK_LOG("Network tx level %u: %u retransmissions every %u ms%s\r\n",
+               nettx->level, l->count, l->interval_ms,
+               nettx->relay_enabled ? " (relay too)" : "");
+}
+
+static void eval_timer_cb(app_timer_t *handle, void *data)
+{
+  app_nettx_t *nettx = data;
+  (void)handle;
+
+  sl_bt_external_signal(nettx->eval_signal);
+}
+
+bool app_nettx_evaluate(app_nettx_t *nettx)
+{
+  uint32_t loss;
+  uint32_t dup;
+
+  if (nettx->window_expected < APP_NETTX_MIN_SAMPLES) {
+    // Not enough traffic to judge; keep counting into the next window
+    return false;
+  }
+  loss = (nettx->window_expected - nettx->window_received) * 1000 / nettx->window_expected;
+  dup = nettx->window_duplicates * 1000
+        / (nettx->window_received + nettx->window_duplicates + 1);
+  nettx->window_expected = 0;
+  nettx->window_received = 0;
+  nettx->window_duplicates = 0;
+
+  if (loss > APP_NETTX_LOSS_HIGH) {
+    nettx->lower_streak = 0;
+    if (++nettx->raise_streak >= APP_NETTX_RAISE_WINDOWS && nettx->level < APP_NETTX_LEVELS - 1) {
+      nettx->level++;
+      nettx->raise_streak = 0;
+      APP_TASK_LOG("Loss %lu permille, raising network tx\r\n", (unsigned long)loss);
+      apply_level(nettx);
+      log_level(nettx);
+      return true;
+    }
+  } else if (loss < APP_NETTX_LOSS_LOW && dup > APP_NETTX_DUP_HIGH) {
+    nettx->raise_streak = 0;
+    if (++nettx->lower_streak >= APP_NETTX_LOWER_WINDOWS && nettx->level > 0) {
+      nettx->level--;
+      nettx->lower_streak = 0;
+      APP_TASK_LOG("Duplicates %lu permille, lowering network tx\r\n", (unsigned long)dup);
+      apply_level(nettx);
+      log_level(nettx);
+      return true;
+    }
+  } else {
+    // Inside the hysteresis band
+    nettx->raise_streak = 0;
+    nettx->lower_streak = 0;
+  }
+  return false;
+}
+
+void app_nettx_init(app_nettx_t *nettx, bool relay, uint32_t eval_signal)
+{
+  app_timer_stop(&nettx->eval_timer);
+  memset(nettx, 0, sizeof(*nettx));
+  nettx->relay_enabled = relay;
+  nettx->eval_signal = eval_signal;
+  apply_level(nettx);
+
+  if (eval_signal != 0) {
+    app_timer_start(&nettx->eval_timer,
+                    APP_NETTX_EVAL_MS,
+                    eval_timer_cb,
+                    nettx,
+                    true);
+  }
+}
+
+void app_nettx_set_level(app_nettx_t *nettx, uint8_t level)
+{
+  if (level >= APP_NETTX_LEVELS) {
+    level = APP_NETTX_LEVELS - 1;
+  }
+  if (level == nettx->level) {
+    return;
+  }
+  nettx->level = level;
+  apply_level(nettx);
+  log_level(nettx);
+}
+
+uint8_t app_nettx_level(const app_nettx_t *nettx)
+{
+  return nettx->level;
+}
+
+void app_nettx_on_rx(app_nettx_t *nettx, uint16_t source, uint16_t destination)
+{
+  app_nettx_source_t *s;
+
+  if (destination < 0x8000) {
+    return;
+  }
+  s = find_source(nettx, source);
+  if (s != NULL) {
+    s->rx_since++;
+  }
+}
+
+void app_nettx_on_duplicate(app_nettx_t *nettx)
+{
+  nettx->window_duplicates++;
+}
+
+void app_nettx_on_telemetry(app_nettx_t *nettx, uint16_t source, uint32_t tx_count)
+{
+  app_nettx_source_t *s = find_source(nettx, source);
+  if (s == NULL) {
+    return;
+  }
+  if (s->has_baseline && tx_count >= s->last_tx_count) {
+    uint32_t expected = tx_count - s->last_tx_count;
+    uint32_t received = s->rx_since;
+    // Relayed copies can make us see more than was sent
+    if (received > expected) {
+      received = expected;
+    }
+    nettx->window_expected += expected;
+    nettx->window_received += received;
+  }
+  s->has_baseline = true;
+  s->last_tx_count = tx_count;
+  // The report itself was published after its snapshot, so it belongs to
+  // the next interval
+  s->rx_since = 1;
+}
+
+uint8_t app_nettx_transmissions(const app_nettx_t *nettx)
+{
+  return levels[nettx->level].count + 1;
+}
@@ -0,0 +1,162 @@
+/***************************************************************************//**
+ * @file app_power.c
+ * @brief Low-power client mode and energy-per-sample model.
+ ******************************************************************************/
+#include <string.h>
+#include "sl_component_catalog.h"
+#include "sl_sleeptimer.h"
+#include "app_log.h"
+
+#include "app_power.h"
+
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+#include "sl_power_manager.h"
+#endif // SL_CATALOG_POWER_MANAGER_PRESENT
+
+// Vendor opcode size and TransMIC size of an access message
+#define ACCESS_OPCODE_LEN               3
+#define TRANS_MIC_LEN                   4
+// Largest unsegmented access PDU and segment payload size
+#define UNSEGMENTED_MAX                 11
+#define SEGMENT_LEN                     12
+
+static uint8_t window_count;
+
+#if APP_ENERGY_MODEL_ENABLE
+
+typedef struct {
+  app_energy_totals_t totals;
+  uint64_t start_tick;
+  uint64_t awake_ticks;                 // time spent above EM2
+  uint64_t wake_tick;
+} app_energy_t;
+
+static app_energy_t energy;
+
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+static sl_power_manager_em_transition_event_handle_t em_handle;
+
+static void on_em_transition(sl_power_manager_em_t from, sl_power_manager_em_t to)
+{
+  uint64_t now = sl_sleeptimer_get_tick_count64();
+
+  if (to == SL_POWER_MANAGER_EM2) {
+    energy.awake_ticks += now - energy.wake_tick;
+  } else if (from == SL_POWER_MANAGER_EM2) {
+    energy.wake_tick = now;
+    app_energy_charge_wake();
+  }
+}
+
+static const sl_power_manager_em_transition_event_info_t em_info = {
+  .event_mask = SL_POWER_MANAGER_EVENT_TRANSITION_ENTERING_EM2
+                | SL_POWER_MANAGER_EVENT_TRANSITION_LEAVING_EM2,
+  .on_event = on_em_transition,
+};
+#endif // SL_CATALOG_POWER_MANAGER_PRESENT
+
+#endif // APP_ENERGY_MODEL_ENABLE
+
+void app_power_init(void)
+{
+  window_count = 0;
+#if APP_ENERGY_MODEL_ENABLE
+  memset(&energy, 0, sizeof(energy));
+  energy.start_tick = sl_sleeptimer_get_tick_count64();
+  energy.wake_tick = energy.start_tick;
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+  sl_power_manager_subscribe_em_transition_event(&em_handle, &em_info);
+#endif // SL_CATALOG_POWER_MANAGER_PRESENT
+#endif // APP_ENERGY_MODEL_ENABLE
+}
+
+bool app_power_telemetry_due(void)
+{
+  if (++window_count < APP_POWER_TELEMETRY_EVERY) {
+    return false;
+  }
+  window_count = 0;
+  return true;
+}
+
+#if APP_ENERGY_MODEL_ENABLE
+
+void app_energy_charge_wake(void)
+{
+  energy.totals.wakes++;
+  energy.totals.wake_nj += APP_ENERGY_WAKE_NJ;
+}
+
+void app_energy_charge_publish(uint16_t payload_len, uint8_t transmissions)
+{
+  uint16_t access_len = ACCESS_OPCODE_LEN + payload_len;
+  uint32_t pdus = 1;
+
+  if (access_len > UNSEGMENTED_MAX) {
+    pdus = (access_len + TRANS_MIC_LEN + SEGMENT_LEN - 1) / SEGMENT_LEN;
+  }
+  pdus *= transmissions;
+  energy.totals.tx_pdus += pdus;
+  energy.totals.tx_nj += (uint64_t)pdus * APP_ENERGY_TX_PDU_NJ;
+}
+
+void app_energy_charge_sensor(void)
+{
+  energy.totals.sensor_reads++;
+  energy.totals.sensor_nj += APP_ENERGY_SENSOR_NJ;
+}
+
+void app_energy_charge_log(uint16_t bytes)
+{
+  energy.totals.log_bytes += bytes;
+  energy.totals.log_nj += (uint64_t)bytes * APP_ENERGY_LOG_BYTE_NJ;
+}
+
+void app_energy_count_sample(void)
+{
+  energy.totals.samples++;
+}
+
+void app_energy_get(app_energy_totals_t *totals)
+{
+  uint64_t elapsed = sl_sleeptimer_get_tick_count64() - energy.start_tick;
+  uint64_t elapsed_ms = elapsed * 1000 / sl_sleeptimer_get_timer_frequency();
+
+  *totals = energy.totals;
+  totals->elapsed_ms = (uint32_t)elapsed_ms;
+  // nW * ms / 1000 = nJ
+  totals->sleep_nj = (uint64_t)APP_ENERGY_SLEEP_NW * elapsed_ms / 1000;
+}
+
+void app_energy_report(void)
+{
+  app_energy_totals_t t;
+  uint64_t total_nj;
+
+  app_energy_get(&t);
+  total_nj = t.wake_nj + t.tx_nj + t.sensor_nj + t.log_nj + t.sleep_nj;
+  app_log("Energy model (%s mode), %lu s:\r\n",
+          APP_LOW_POWER_ENABLE ? "low-power" : "normal",
+          (unsigned long)(t.elapsed_ms / 1000));
+  app_log("  Wake   %6lu wakes  %8lu uJ\r\n",
+          (unsigned long)t.wakes, (unsigned long)(t.wake_nj / 1000));
+  app_log("  TX     %6lu PDUs   %8lu uJ\r\n",
+          (unsigned long)t.tx_pdus, (unsigned long)(t.tx_nj / 1000));
+  app_log("  Sensor %6lu reads  %8lu uJ\r\n",
+          (unsigned long)t.sensor_reads, (unsigned long)(t.sensor_nj / 1000));
+  app_log("  Log    %6lu bytes  %8lu uJ\r\n",
+          (unsigned long)t.log_bytes, (unsigned long)(t.log_nj / 1000));
+  app_log("  Sleep                %8lu uJ\r\n", (unsigned long)(t.sleep_nj / 1000));
+  if (t.samples) {
+    app_log("  %lu samples, %lu uJ per sample\r\n",
+            (unsigned long)t.samples,
+            (unsigned long)(total_nj / t.samples / 1000));
+  }
+#if defined(SL_CATALOG_POWER_MANAGER_PRESENT)
+  app_log("  Awake (above EM2): %lu ms\r\n",
+          (unsigned long)(energy.awake_ticks * 1000
+                          / sl_sleeptimer_get_timer_frequency()));
+#endif // SL_CATALOG_POWER_MANAGER_PRESENT
+}
+
+#endif // APP_ENERGY_MODEL_ENABLE
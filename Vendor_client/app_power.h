@@ -0,0 +1,121 @@
+/***************************************************************************//**
+ * @file app_power.h
+ * @brief Low-power client mode and energy-per-sample model.
+ *
+ * In low-power mode (APP_LOW_POWER_ENABLE) the periodic sensor read, the
+ * sensor publication and the telemetry publication share one wake window,
+ * and the hot-path log lines are only compiled in a debug build
+ * (APP_DEBUG_LOG). The energy model charges every wake from EM2, TX PDU,
+ * sensor conversion and log byte with a fixed cost plus the sleep floor, and
+ * reports the modelled energy per published sample. The costs default to an
+ * EFR32xG21 at 3 V and can be set for another board from the build.
+ *
+ * host/sim/energy_model.c runs the same model over the client's sampling
+ * schedule in both modes.
+ ******************************************************************************/
+
+#ifndef APP_POWER_H
+#define APP_POWER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_tasks.h"
+
+#ifndef APP_LOW_POWER_ENABLE
+#define APP_LOW_POWER_ENABLE            0
+#endif
+
+#ifndef APP_DEBUG_LOG
+#define APP_DEBUG_LOG                   0
+#endif
+
+#ifndef APP_ENERGY_MODEL_ENABLE
+#define APP_ENERGY_MODEL_ENABLE         1
+#endif
+
+// Telemetry is published in every Nth wake window in low-power mode
+#define APP_POWER_TELEMETRY_EVERY       10
+
+// Modelled costs in nJ, sleep floor in nW
+#ifndef APP_ENERGY_WAKE_NJ
+#define APP_ENERGY_WAKE_NJ              4000    // EM2 -> EM0 -> EM2, HFXO start
+#endif
+#ifndef APP_ENERGY_TX_PDU_NJ
+#define APP_ENERGY_TX_PDU_NJ            35000   // one network PDU, 3 adv channels, 0 dBm
+#endif
+#ifndef APP_ENERGY_SENSOR_NJ
+#define APP_ENERGY_SENSOR_NJ            12000   // Si70xx RH + T conversion, no-hold
+#endif
+#ifndef APP_ENERGY_LOG_BYTE_NJ
+#define APP_ENERGY_LOG_BYTE_NJ          800     // one UART byte at 115200 baud
+#endif
+#ifndef APP_ENERGY_SLEEP_NW
+#define APP_ENERGY_SLEEP_NW             15000   // EM2 with RTC running, ~5 uA
+#endif
+
+/***************************************************************************//**
+ * Reset the model and subscribe to power manager EM transitions.
+ ******************************************************************************/
+void app_power_init(void);
+
+/***************************************************************************//**
+ * Returns true when the telemetry publication is due in this wake window.
+ ******************************************************************************/
+bool app_power_telemetry_due(void);
+
+#if APP_ENERGY_MODEL_ENABLE
+
+typedef struct {
+  uint64_t wake_nj;
+  uint64_t tx_nj;
+  uint64_t sensor_nj;
+  uint64_t log_nj;
+  uint64_t sleep_nj;
+  uint32_t wakes;
+  uint32_t tx_pdus;
+  uint32_t sensor_reads;
+  uint32_t log_bytes;
+  uint32_t samples;
+  uint32_t elapsed_ms;
+} app_energy_totals_t;
+
+void app_energy_charge_wake(void);
+void app_energy_charge_publish(uint16_t payload_len, uint8_t transmissions);
+void app_energy_charge_sensor(void);
+void app_energy_charge_log(uint16_t bytes);
+void app_energy_count_sample(void);
+
+/***************************************************************************//**
+ * Totals since app_power_init(), the sleep floor up to now included.
+ ******************************************************************************/
+void app_energy_get(app_energy_totals_t *totals);
+
+/***************************************************************************//**
+ * Log the modelled energy per sample and the measured awake time.
+ ******************************************************************************/
+void app_energy_report(void);
+
+#else // APP_ENERGY_MODEL_ENABLE
+
+#define app_energy_charge_wake()        ((void)0)
+#define app_energy_charge_publish(len, tx) ((void)0)
+#define app_energy_charge_sensor()      ((void)0)
+#define app_energy_charge_log(bytes)    ((void)0)
+#define app_energy_count_sample()       ((void)0)
+#define app_energy_report()             ((void)0)
+
+#endif // APP_ENERGY_MODEL_ENABLE
+
+// Log line on the periodic sampling path. The line is charged by the length
+// of its format string, a compile time constant close enough to the output.
+#if APP_LOW_POWER_ENABLE && !APP_DEBUG_LOG
+#define APP_PATH_LOG(fmt, ...)          ((void)0)
+#else
+#define APP_PATH_LOG(fmt, ...)                  \
+  do {                                          \
+    app_energy_charge_log(sizeof(fmt) - 1);     \
+    APP_TASK_LOG(fmt, ##__VA_ARGS__);           \
+  } while (0)
+#endif
+
+#endif // APP_POWER_H
@@ -0,0 +1,76 @@
+/***************************************************************************//**
+ * @file app_rht.c
+ * @brief Split-phase humidity and temperature acquisition on the Si70xx.
+ ******************************************************************************/
+#include "app_timer.h"
+#include "sl_bt_api.h"
+#include "sl_i2cspm_instances.h"
+#include "sl_si70xx.h"
+
+#include "app_rht.h"
+
+static uint32_t ready_signal_mask;
+static app_timer_t conversion_timer;
+static bool busy;
+static uint8_t retries;
+
+static void conversion_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  // The I2C read belongs to the worker
+  sl_bt_external_signal(ready_signal_mask);
+}
+
+void app_rht_init(uint32_t ready_signal)
+{
+  ready_signal_mask = ready_signal;
+  busy = false;
+}
+
+sl_status_t app_rht_start(void)
+{
+  sl_status_t sc;
+
+  if (busy) {
+    return SL_STATUS_IN_PROGRESS;
+  }
+  sc = sl_si70xx_start_no_hold_measure_rh(sl_i2cspm_sensor, SI7021_ADDR);
+  if (sc != SL_STATUS_OK) {
+    return sc;
+  }
+  busy = true;
+  retries = 0;
+  app_timer_start(&conversion_timer,
+                  APP_RHT_CONVERSION_MS,
+                  conversion_timer_cb,
+                  NULL,
+                  false);
+  return SL_STATUS_OK;
+}
+
+bool app_rht_busy(void)
+{
+  return busy;
+}
+
+sl_status_t app_rht_read(uint32_t *humidity, int32_t *temperature)
+{
+  sl_status_t sc;
+
+  if (!busy) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  sc = sl_si70xx_read_rh_and_temp(sl_i2cspm_sensor, SI7021_ADDR, humidity, temperature);
+  if (sc != SL_STATUS_OK && retries < APP_RHT_MAX_RETRIES) {
+    retries++;
+    app_timer_start(&conversion_timer,
+                    APP_RHT_RETRY_MS,
+                    conversion_timer_cb,
+                    NULL,
+                    false);
+    return SL_STATUS_NOT_READY;
+  }
+  busy = false;
+  return sc;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************//**
+ * @file app_rht.h
+ * @brief Split-phase humidity and temperature acquisition on the Si70xx.
+ *
+ * sl_sensor_rht_get() holds the I2C bus and the caller for the whole
+ * conversion, about 23 ms at 12-bit resolution. Here the conversion is
+ * started in no-hold mode and the caller returns at once; a timer raises
+ * @p ready_signal when the conversion should be over, and app_rht_read()
+ * then only fetches the result. A sensor that is still converting NACKs the
+ * read, which is retried a little later.
+ ******************************************************************************/
+
+#ifndef APP_RHT_H
+#define APP_RHT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+
+// Longest RH conversion with the embedded temperature conversion
+#define APP_RHT_CONVERSION_MS           25
+
+// Retry of a read the sensor NACKed because it was not done yet
+#define APP_RHT_RETRY_MS                5
+#define APP_RHT_MAX_RETRIES             3
+
+/***************************************************************************//**
+ * @p ready_signal is raised with sl_bt_external_signal() when the result of
+ * a conversion can be read.
+ ******************************************************************************/
+void app_rht_init(uint32_t ready_signal);
+
+/***************************************************************************//**
+ * Start a conversion. Returns SL_STATUS_IN_PROGRESS if one is running.
+ ******************************************************************************/
+sl_status_t app_rht_start(void);
+
+/***************************************************************************//**
+ * Returns true while a conversion is running.
+ ******************************************************************************/
+bool app_rht_busy(void);
+
+/***************************************************************************//**
+ * Fetch the result once @p ready_signal was raised. Returns
+ * SL_STATUS_NOT_READY if the read is retried later and @p ready_signal will
+ * be raised again, otherwise the conversion is over, successful or not.
+ ******************************************************************************/
+sl_status_t app_rht_read(uint32_t *humidity, int32_t *temperature);
+
+#endif // APP_RHT_H
@@ -0,0 +1,60 @@
+/***************************************************************************//**
+ * @file app_sensor_codec.c
+ * @brief Schema of the sensor_status payload and its bit-packed codec.
+ ******************************************************************************/
+#include "app_sensor_codec.h"
+
+_Static_assert(APP_SENSOR_PACKED_BITS <= 64, "sensor schema exceeds 64 bits");
+
+static inline uint32_t encode(int32_t value, unsigned bits, int32_t scale, int32_t offset)
+{
+  int32_t raw = value - offset;
+  uint32_t max = (1u << bits) - 1;
+
+  if (raw <= 0) {
+    return 0;
+  }
+  raw = (raw + scale / 2) / scale;
+  return (uint32_t)raw > max ? max : (uint32_t)raw;
+}
+
+void app_sensor_pack(const app_sensor_sample_t *sample, uint8_t *out)
+{
+  uint64_t stream = 0;
+  unsigned pos = 0;
+
+  // Expands to straight-line code; every shift is a constant
+#define APP_SENSOR_FIELD_PACK(name, bits, scale, offset)                  \
+  stream |= (uint64_t)encode(sample->name, bits, scale, offset) << pos;   \
+  pos += bits;
+  APP_SENSOR_SCHEMA(APP_SENSOR_FIELD_PACK)
+#undef APP_SENSOR_FIELD_PACK
+  (void)pos;
+
+  for (int i = 0; i < APP_SENSOR_PACKED_LEN; i++) {
+    out[i] = (uint8_t)(stream >> (8 * i));
+  }
+}
+
+bool app_sensor_unpack(const uint8_t *data, uint8_t len, app_sensor_sample_t *sample)
+{
+  uint64_t stream = 0;
+  unsigned pos = 0;
+
+  if (len != APP_SENSOR_PACKED_LEN) {
+    return false;
+  }
+  for (int i = 0; i < APP_SENSOR_PACKED_LEN; i++) {
+    stream |= (uint64_t)data[i] << (8 * i);
+  }
+
+#define APP_SENSOR_FIELD_UNPACK(name, bits, scale, offset)                        \
+  sample->name = (int32_t)((stream >> pos) & ((1u << (bits)) - 1)) * (scale)      \
+                 + (offset);                                                      \
+  pos += bits;
+  APP_SENSOR_SCHEMA(APP_SENSOR_FIELD_UNPACK)
+#undef APP_SENSOR_FIELD_UNPACK
+  (void)pos;
+
+  return true;
+}
@@ -0,0 +1,46 @@
+/***************************************************************************//**
+ * @file app_sensor_codec.h
+ * @brief Schema of the sensor_status payload and its bit-packed codec.
+ *
+ * APP_SENSOR_SCHEMA is the only description of the payload. The sample
+ * struct, the packed length and the pack/unpack code are all expanded from
+ * it, so the client packer and the server/relay unpacker cannot drift
+ * apart. Each field is a value in milli-units that is sent as
+ * (value - offset) / scale in the given number of bits, clamped to the
+ * field range. Fields are packed LSB first in schema order and the
+ * resulting bit stream is sent little-endian.
+ ******************************************************************************/
+
+#ifndef APP_SENSOR_CODEC_H
+#define APP_SENSOR_CODEC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// X(name, bits, scale, offset)
+#define APP_SENSOR_SCHEMA(X)                                            \
+  X(humidity,    11, 50, 0)        /* 0 .. 102.35 %RH, 0.05 % steps */  \
+  X(temperature, 14, 10, -40000)   /* -40 .. 123.83 C, 0.01 C steps */
+
+#define APP_SENSOR_FIELD_BITS(name, bits, scale, offset) + (bits)
+#define APP_SENSOR_PACKED_BITS          (0 APP_SENSOR_SCHEMA(APP_SENSOR_FIELD_BITS))
+#define APP_SENSOR_PACKED_LEN           ((APP_SENSOR_PACKED_BITS + 7) / 8)
+
+typedef struct {
+#define APP_SENSOR_FIELD_MEMBER(name, bits, scale, offset) int32_t name;
+  APP_SENSOR_SCHEMA(APP_SENSOR_FIELD_MEMBER)
+#undef APP_SENSOR_FIELD_MEMBER
+} app_sensor_sample_t;
+
+/***************************************************************************//**
+ * Pack @p sample into APP_SENSOR_PACKED_LEN bytes at @p out.
+ ******************************************************************************/
+void app_sensor_pack(const app_sensor_sample_t *sample, uint8_t *out);
+
+/***************************************************************************//**
+ * Unpack a sensor_status payload. Returns false if @p len does not match
+ * the schema.
+ ******************************************************************************/
+bool app_sensor_unpack(const uint8_t *data, uint8_t len, app_sensor_sample_t *sample);
+
+#endif // APP_SENSOR_CODEC_H
@@ -0,0 +1,153 @@
+/***************************************************************************//**
+ * @file app_telemetry.h
+ * @brief Node health counters and the telemetry status vendor message.
+ *
+ * Every node keeps a small set of counters. Client and relay nodes publish
+ * them periodically with the telemetry_status opcode; the server keeps the
+ * last report of each source address in a table.
+ *
+ * The counters live in an app_telemetry_t and the server's table in an
+ * app_telemetry_table_t, both owned by the caller, so a host simulation can
+ * run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_TELEMETRY_H
+#define APP_TELEMETRY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+#include "app_timer.h"
+
+#define APP_TELEMETRY_VERSION           2
+
+// Publication interval of the local telemetry status
+#define APP_TELEMETRY_PERIOD_MS         60000
+
+// Number of distinct publish error codes tracked; the last slot counts
+// every code that did not fit into the others
+#define APP_TELEMETRY_ERR_SLOTS         3
+
+// Number of nodes the server keeps telemetry for
+#define APP_TELEMETRY_TABLE_SIZE        16
+
+typedef struct __attribute__((packed)) {
+  uint16_t status;                      // low 16 bits of the sl_status_t
+  uint16_t count;
+} app_telemetry_err_t;
+
+// Wire layout of the telemetry_status message (little-endian, 36 bytes)
+typedef struct __attribute__((packed)) {
+  uint8_t version;
+  uint8_t queue_hwm;                    // highest worker queue fill level
+                                        // seen; 0 without a kernel, where
+                                        // messages are handled inline
+  uint16_t dup_permille;                // duplicate cache hits per 1000 lookups
+  uint32_t uptime_s;
+  uint32_t rx_count;                    // vendor messages received
+  uint32_t tx_count;                    // group-addressed messages sent,
+                                        // published or not
+  uint32_t drop_count;                  // received messages not processed
+  uint32_t publish_period_ms;           // 0 if not publishing periodically
+  app_telemetry_err_t pub_err[APP_TELEMETRY_ERR_SLOTS];
+} app_telemetry_status_t;
+
+typedef struct {
+  uint32_t rx;
+  uint32_t tx;
+  uint32_t drop;
+  uint32_t dup_lookups;
+  uint32_t dup_hits;
+  uint32_t publish_period_ms;
+  uint8_t queue_hwm;
+  app_telemetry_err_t pub_err[APP_TELEMETRY_ERR_SLOTS];
+} app_telemetry_counters_t;
+
+typedef struct {
+  app_telemetry_counters_t counters;
+  uint16_t pub_elem_index;
+  uint16_t pub_vendor_id;
+  uint16_t pub_model_id;
+  uint32_t due_signal_mask;
+  app_timer_t telemetry_timer;
+} app_telemetry_t;
+
+typedef struct {
+  uint16_t address;                     // 0 = free slot
+  uint32_t last_seen_s;
+  app_telemetry_status_t status;
+} app_telemetry_entry_t;
+
+typedef struct {
+  app_telemetry_entry_t entries[APP_TELEMETRY_TABLE_SIZE];
+} app_telemetry_table_t;
+
+/***************************************************************************//**
+ * Clear the local counters.
+ ******************************************************************************/
+void app_telemetry_init(app_telemetry_t *telemetry);
+
+/***************************************************************************//**
+ * Clear the per-node table of the server.
+ ******************************************************************************/
+void app_telemetry_table_init(app_telemetry_table_t *table);
+
+/***************************************************************************//**
+ * Local counter updates. A send to a unicast @p destination fails like a
+ * publication but is not counted in tx_count: only its addressee sees it,
+ * while every subscriber of a group sees all the traffic counted there.
+ ******************************************************************************/
+void app_telemetry_count_rx(app_telemetry_t *telemetry);
+void app_telemetry_count_drop(app_telemetry_t *telemetry);
+void app_telemetry_count_dup_lookup(app_telemetry_t *telemetry, bool hit);
+void app_telemetry_count_publish(app_telemetry_t *telemetry, sl_status_t sc);
+void app_telemetry_count_send(app_telemetry_t *telemetry, uint16_t destination, sl_status_t sc);
+void app_telemetry_queue_level(app_telemetry_t *telemetry, uint8_t level);
+void app_telemetry_set_publish_period(app_telemetry_t *telemetry, uint32_t period_ms);
+
+/***************************************************************************//**
+ * Fill @p status with a snapshot of the local counters.
+ ******************************************************************************/
+void app_telemetry_snapshot(const app_telemetry_t *telemetry, app_telemetry_status_t *status);
+
+/***************************************************************************//**
+ * Select the vendor model app_telemetry_publish() publishes through.
+ ******************************************************************************/
+void app_telemetry_bind(app_telemetry_t *telemetry,
+                        uint16_t elem_index,
+                        uint16_t vendor_id,
+                        uint16_t model_id);
+
+/***************************************************************************//**
+ * Publish the local telemetry every APP_TELEMETRY_PERIOD_MS through the given
+ * vendor model. The timer only raises @p due_signal with
+ * sl_bt_external_signal(); the worker calls app_telemetry_publish() then.
+ ******************************************************************************/
+void app_telemetry_start(app_telemetry_t *telemetry,
+                         uint16_t elem_index,
+                         uint16_t vendor_id,
+                         uint16_t model_id,
+                         uint32_t due_signal);
+
+/***************************************************************************//**
+ * Publish the local telemetry once. The report is copied to @p sent unless
+ * it is NULL, so the caller can capture it. Worker only.
+ ******************************************************************************/
+sl_status_t app_telemetry_publish(app_telemetry_t *telemetry, app_telemetry_status_t *sent);
+
+/***************************************************************************//**
+ * Store a received telemetry_status message from @p source in the table.
+ * Worker only.
+ ******************************************************************************/
+void app_telemetry_on_status(app_telemetry_table_t *table,
+                             uint16_t source,
+                             const uint8_t *data,
+                             uint8_t len);
+
+/***************************************************************************//**
+ * Print the local counters and the per-node table. Worker only.
+ ******************************************************************************/
+void app_telemetry_print_table(const app_telemetry_t *telemetry,
+                               const app_telemetry_table_t *table);
+
+#endif // APP_TELEMETRY_H
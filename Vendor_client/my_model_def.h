@@ -42,11 +42,17 @@
 
 #define MY_VENDOR_CLIENT_ID             0x2222
 
-#define DATA_LENGTH                     8
-
-#define NUMBER_OF_OPCODES               1
+#define NUMBER_OF_OPCODES               5
 
 #define sensor_status                   0x1
+#define telemetry_status                0x5
+#define ctrl_command                    0xB
+#define ctrl_ack                        0xC
+#define bulk_chunk                      0xD
+#define bulk_ack                        0xE
+#define blob_transfer                   0xF
+#define blob_status                     0x10
+#define time_beacon                     0x11
 
 typedef struct {
   uint16_t elem_index;
@@ -0,0 +1,55 @@
+/***************************************************************************//**
+ * @file app_blob.h
+ * @brief Blob distribution message format, shared by the client and server.
+ *
+ * The server pushes a blob of up to APP_BLOB_MAX_LEN bytes to the control
+ * group. Every chunk is multicast once. Each client tracks the chunks it
+ * holds in a bitmap. A status query then collects the missing chunks, and
+ * only the chunks someone misses are multicast again.
+ *
+ * blob_transfer, server to clients, starts with a type byte:
+ *
+ *   chunk: type (1) | id (1) | seq (1) | total (1) | up to APP_BLOB_CHUNK_DATA bytes
+ *   query: type (1) | id (1) | total (1) | spread (1) | flags (1)
+ *
+ * A client answers a query after a random delay within spread units of
+ * APP_BLOB_SPREAD_UNIT_MS with a blob_status, bit n set when chunk n is
+ * missing, little-endian:
+ *
+ *   id (1) | missing bitmap (4)
+ *
+ * A complete client answers a group query once; later ones it only answers
+ * with APP_BLOB_QUERY_ALWAYS set.
+ *
+ * A configuration blob is a sequence of APP_BLOB_ENTRY_LEN byte entries,
+ * command (1) | argument (2, little-endian), each applied like the control
+ * command of app_ctrl.h.
+ ******************************************************************************/
+
+#ifndef APP_BLOB_H
+#define APP_BLOB_H
+
+#include <stdint.h>
+#include "sl_status.h"
+
+// Message types of blob_transfer
+#define APP_BLOB_TYPE_CHUNK             0
+#define APP_BLOB_TYPE_QUERY             1
+
+#define APP_BLOB_CHUNK_HEADER_LEN       4
+#define APP_BLOB_CHUNK_DATA             32
+#define APP_BLOB_CHUNK_MAX_LEN          (APP_BLOB_CHUNK_HEADER_LEN + APP_BLOB_CHUNK_DATA)
+
+// One status bitmap covers a whole blob
+#define APP_BLOB_MAX_CHUNKS             32
+#define APP_BLOB_MAX_LEN                (APP_BLOB_MAX_CHUNKS * APP_BLOB_CHUNK_DATA)
+
+#define APP_BLOB_QUERY_LEN              5
+#define APP_BLOB_QUERY_ALWAYS           0x01   // answer even if complete
+#define APP_BLOB_SPREAD_UNIT_MS         100
+
+#define APP_BLOB_STATUS_LEN             5
+
+#define APP_BLOB_ENTRY_LEN              3
+
+#endif // APP_BLOB_H
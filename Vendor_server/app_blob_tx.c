@@ -0,0 +1,303 @@
+/***************************************************************************//**
+ * @file app_blob_tx.c
+ * @brief Sender side of the blob distribution: one blob to every known
+ *        client over the control group.
+ ******************************************************************************/
+#include <string.h>
+#include "app_timer.h"
+#include "sl_bt_api.h"
+
+#include "app_blob_tx.h"
+#include "app_ctrl.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+static bool bit_get(const uint8_t *map, uint16_t index)
+{
+  return map[index / 8] & (1u << (index % 8));
+}
+
+static uint32_t all_chunks(const app_blob_tx_t *blob)
+{
+  return blob->total >= 32 ? UINT32_MAX : (1u << blob->total) - 1;
+}
+
+static void tick_timer_cb(app_timer_t *handle, void *data)
+{
+  app_blob_tx_t *blob = data;
+
+  (void)handle;
+  // Sending belongs to the worker
+  sl_bt_external_signal(blob->tick_signal_mask);
+}
+
+static void arm(app_blob_tx_t *blob, uint32_t ms, bool periodic)
+{
+  app_timer_stop(&blob->tick_timer);
+  app_timer_start(&blob->tick_timer, ms, tick_timer_cb, blob, periodic);
+}
+
+static void wait_for_status(app_blob_tx_t *blob, uint32_t ms)
+{
+  blob->phase = APP_BLOB_TX_WAIT;
+  blob->wait_until = app_time_ticks() + app_time_ms_to_ticks(ms);
+  arm(blob, ms, false);
+}
+
+static void finish(app_blob_tx_t *blob)
+{
+  app_timer_stop(&blob->tick_timer);
+  blob->phase = APP_BLOB_TX_IDLE;
+  APP_TASK_LOG("Blob %u: %u/%u nodes complete in %lu ms, %u rounds\r\n",
+               blob->blob_id,
+               blob->targets - blob->pending_count,
+               blob->targets,
+               (unsigned long)app_time_ticks_to_ms(app_time_ticks() - blob->started),
+               blob->round_count);
+  APP_TASK_LOG("Blob %u: %lu chunk sends for %u chunks, %lu queries, %lu status answers\r\n",
+               blob->blob_id,
+               (unsigned long)blob->chunk_sends,
+               blob->total,
+               (unsigned long)blob->query_sends,
+               (unsigned long)blob->status_count);
+}
+
+static sl_status_t send_query(app_blob_tx_t *blob,
+                              uint16_t destination,
+                              uint8_t spread,
+                              uint8_t flags)
+{
+  uint8_t buf[APP_BLOB_QUERY_LEN];
+
+  buf[0] = APP_BLOB_TYPE_QUERY;
+  buf[1] = blob->blob_id;
+  buf[2] = blob->total;
+  buf[3] = spread;
+  buf[4] = flags;
+  return blob->send_fn(blob, destination, buf, sizeof(buf));
+}
+
+static void query(app_blob_tx_t *blob)
+{
+  uint32_t spread;
+  sl_status_t sc;
+
+  blob->round_count++;
+  if (blob->round_count > 1 && blob->pending_count <= APP_BLOB_TX_UNICAST_LIMIT) {
+    blob->cursor = 0;
+    blob->phase = APP_BLOB_TX_QUERY;
+    arm(blob, APP_BLOB_TX_TICK_MS, true);
+    return;
+  }
+  // Room for every node not complete to answer once
+  spread = (uint32_t)blob->pending_count * 1000 / APP_BLOB_TX_STATUS_RATE / APP_BLOB_SPREAD_UNIT_MS + 1;
+  if (spread > UINT8_MAX) {
+    spread = UINT8_MAX;
+  }
+  sc = send_query(blob, APP_CTRL_GROUP_ADDR, (uint8_t)spread, 0);
+  blob->query_sends++;
+  if (sc != SL_STATUS_OK) {
+    // The next round queries again
+    APP_TASK_LOG("Blob query error: 0x%04lX\r\n", sc);
+  }
+  wait_for_status(blob, spread * APP_BLOB_SPREAD_UNIT_MS + APP_BLOB_TX_GRACE_MS);
+}
+
+static void end_of_round(app_blob_tx_t *blob)
+{
+  if (blob->pending_count == 0) {
+    finish(blob);
+    return;
+  }
+  if (blob->round_count >= APP_BLOB_TX_MAX_ROUNDS) {
+    APP_TASK_LOG("Blob %u: %u nodes not complete\r\n", blob->blob_id, blob->pending_count);
+    finish(blob);
+    return;
+  }
+  if (blob->resend != 0) {
+    blob->phase = APP_BLOB_TX_SEND;
+    arm(blob, APP_BLOB_TX_TICK_MS, true);
+    return;
+  }
+  query(blob);
+}
+
+static void send_burst(app_blob_tx_t *blob)
+{
+  uint8_t buf[APP_BLOB_CHUNK_MAX_LEN];
+  uint8_t sent = 0;
+  uint8_t seq = 0;
+  uint16_t offset;
+  uint8_t len;
+  sl_status_t sc;
+
+  while (blob->resend != 0 && sent < APP_BLOB_TX_BURST) {
+    while (!(blob->resend & (1u << seq))) {
+      seq++;
+    }
+    offset = seq * APP_BLOB_CHUNK_DATA;
+    len = blob->blob_len - offset > APP_BLOB_CHUNK_DATA ? APP_BLOB_CHUNK_DATA : blob->blob_len - offset;
+    buf[0] = APP_BLOB_TYPE_CHUNK;
+    buf[1] = blob->blob_id;
+    buf[2] = seq;
+    buf[3] = blob->total;
+    memcpy(&buf[APP_BLOB_CHUNK_HEADER_LEN], &blob->storage[offset], len);
+    sc = blob->send_fn(blob, APP_CTRL_GROUP_ADDR, buf, APP_BLOB_CHUNK_HEADER_LEN + len);
+    if (sc == SL_STATUS_NO_MORE_RESOURCE) {
+      // Out of buffers; try the same chunk on the next tick
+      return;
+    }
+    if (sc != SL_STATUS_OK) {
+      // Whoever misses it reports it in the next query
+      APP_TASK_LOG("Blob chunk %u error: 0x%04lX\r\n", seq, sc);
+    }
+    blob->resend &= ~(1u << seq);
+    blob->chunk_sends++;
+    sent++;
+  }
+  if (blob->resend == 0) {
+    query(blob);
+  }
+}
+
+static void query_burst(app_blob_tx_t *blob)
+{
+  uint8_t sent = 0;
+  sl_status_t sc;
+
+  while (blob->cursor < blob->highest && sent < APP_BLOB_TX_BURST) {
+    if (!bit_get(blob->pending, blob->cursor)) {
+      blob->cursor++;
+      continue;
+    }
+    // A single node can answer right away
+    sc = send_query(blob, blob->cursor + 1, 1, APP_BLOB_QUERY_ALWAYS);
+    if (sc == SL_STATUS_NO_MORE_RESOURCE) {
+      return;
+    }
+    blob->query_sends++;
+    if (sc != SL_STATUS_OK) {
+      APP_TASK_LOG("Blob query to 0x%04X error: 0x%04lX\r\n", blob->cursor + 1, sc);
+    }
+    sent++;
+    blob->cursor++;
+  }
+  if (blob->cursor >= blob->highest) {
+    wait_for_status(blob, APP_BLOB_SPREAD_UNIT_MS + APP_BLOB_TX_GRACE_MS);
+  }
+}
+
+void app_blob_tx_init(app_blob_tx_t *blob, app_blob_tx_send_fn send, uint32_t tick_signal)
+{
+  size_t len = 0;
+
+  app_timer_stop(&blob->tick_timer);
+  memset(blob, 0, sizeof(*blob));
+  blob->send_fn = send;
+  blob->tick_signal_mask = tick_signal;
+  blob->phase = APP_BLOB_TX_IDLE;
+  // A random first id, so clients do not take the first blob after a
+  // reboot for the last one before it
+  if (sl_bt_system_get_random_data(1, 1, &len, &blob->blob_id) != SL_STATUS_OK) {
+    blob->blob_id = 0;
+  }
+}
+
+void app_blob_tx_note_node(app_blob_tx_t *blob, uint16_t address)
+{
+  if (address == 0 || address > APP_BLOB_TX_MAX_NODES) {
+    return;
+  }
+  blob->known[(address - 1) / 8] |= 1u << ((address - 1) % 8);
+  if (address > blob->highest) {
+    blob->highest = address;
+  }
+}
+
+bool app_blob_tx_start(app_blob_tx_t *blob, const uint8_t *data, uint16_t len)
+{
+  if (blob->phase != APP_BLOB_TX_IDLE || blob->send_fn == NULL || len == 0 || len > APP_BLOB_MAX_LEN) {
+    return false;
+  }
+  memcpy(blob->pending, blob->known, sizeof(blob->pending));
+  blob->targets = 0;
+  for (uint16_t i = 0; i < blob->highest; i++) {
+    blob->targets += bit_get(blob->known, i);
+  }
+  if (blob->targets == 0) {
+    return false;
+  }
+
+  memcpy(blob->storage, data, len);
+  blob->blob_len = len;
+  blob->blob_id++;
+  blob->total = (len + APP_BLOB_CHUNK_DATA - 1) / APP_BLOB_CHUNK_DATA;
+  blob->pending_count = blob->targets;
+  blob->resend = all_chunks(blob);
+  blob->round_count = 0;
+  blob->chunk_sends = 0;
+  blob->query_sends = 0;
+  blob->status_count = 0;
+  blob->started = app_time_ticks();
+  APP_TASK_LOG("Blob %u: %u bytes in %u chunks to %u nodes\r\n",
+               blob->blob_id, len, blob->total, blob->targets);
+  blob->phase = APP_BLOB_TX_SEND;
+  arm(blob, APP_BLOB_TX_TICK_MS, true);
+  send_burst(blob);
+  return true;
+}
+
+void app_blob_tx_on_status(app_blob_tx_t *blob, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint32_t missing;
+  uint16_t index;
+
+  if (blob->phase == APP_BLOB_TX_IDLE || len < APP_BLOB_STATUS_LEN || data[0] != blob->blob_id) {
+    return;
+  }
+  blob->status_count++;
+  missing = (uint32_t)data[1] | ((uint32_t)data[2] << 8)
+            | ((uint32_t)data[3] << 16) | ((uint32_t)data[4] << 24);
+  missing &= all_chunks(blob);
+  if (missing != 0) {
+    // Nodes we do not know still get what they miss
+    blob->resend |= missing;
+    return;
+  }
+  if (source == 0 || source > blob->highest) {
+    return;
+  }
+  index = source - 1;
+  if (!bit_get(blob->pending, index)) {
+    return;
+  }
+  blob->pending[index / 8] &= ~(1u << (index % 8));
+  blob->pending_count--;
+  if (blob->pending_count == 0 && blob->phase == APP_BLOB_TX_WAIT) {
+    finish(blob);
+  }
+}
+
+void app_blob_tx_process(app_blob_tx_t *blob)
+{
+  switch (blob->phase) {
+    case APP_BLOB_TX_SEND:
+      send_burst(blob);
+      break;
+
+    case APP_BLOB_TX_QUERY:
+      query_burst(blob);
+      break;
+
+    case APP_BLOB_TX_WAIT:
+      if (app_time_ticks() < blob->wait_until) {
+        // Tick of a burst that has finished meanwhile
+        return;
+      }
+      end_of_round(blob);
+      break;
+
+    default:
+      break;
+  }
+}
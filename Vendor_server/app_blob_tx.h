@@ -0,0 +1,117 @@
+/***************************************************************************//**
+ * @file app_blob_tx.h
+ * @brief Sender side of the blob distribution: one blob to every known
+ *        client over the control group.
+ *
+ * Clients become known when they report sensor data, like for app_fanout.
+ * The chunks go to the control group APP_BLOB_TX_BURST per tick. Then a
+ * group query, with a spread sized for APP_BLOB_TX_STATUS_RATE answers per
+ * second from the clients not yet complete, collects the missing bitmaps.
+ * Their union is multicast again, followed by the next query. Once only
+ * APP_BLOB_TX_UNICAST_LIMIT clients or fewer have not reported complete,
+ * they are queried one by one instead, which they always answer. The
+ * transfer ends when every client is complete or after
+ * APP_BLOB_TX_MAX_ROUNDS queries, and logs the chunks and queries sent.
+ *
+ * The state lives in an app_blob_tx_t owned by the caller, so a host
+ * simulation can run many servers in one process.
+ ******************************************************************************/
+
+#ifndef APP_BLOB_TX_H
+#define APP_BLOB_TX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+#include "app_blob.h"
+
+// Highest unicast address tracked
+#define APP_BLOB_TX_MAX_NODES           1024
+
+#define APP_BLOB_TX_MAX_ROUNDS          6
+
+// Status answers per second the query spread is sized for
+#define APP_BLOB_TX_STATUS_RATE         50
+
+// Wait for late answers after the spread
+#define APP_BLOB_TX_GRACE_MS            1000
+
+// Messages sent per tick
+#define APP_BLOB_TX_BURST               4
+#define APP_BLOB_TX_TICK_MS             50
+
+// Stragglers queried by unicast rather than by the group
+#define APP_BLOB_TX_UNICAST_LIMIT       8
+
+typedef enum {
+  APP_BLOB_TX_IDLE,
+  APP_BLOB_TX_SEND,                     // multicasting the chunks to resend
+  APP_BLOB_TX_QUERY,                    // querying the stragglers by unicast
+  APP_BLOB_TX_WAIT                      // waiting for status answers
+} app_blob_tx_phase_t;
+
+typedef struct app_blob_tx app_blob_tx_t;
+
+// Send @p len bytes of a blob_transfer to @p destination
+typedef sl_status_t (*app_blob_tx_send_fn)(app_blob_tx_t *blob,
+                                           uint16_t destination,
+                                           const uint8_t *data,
+                                           uint8_t len);
+
+struct app_blob_tx {
+  uint8_t known[APP_BLOB_TX_MAX_NODES / 8];
+  uint8_t pending[APP_BLOB_TX_MAX_NODES / 8];   // not reported complete
+  uint16_t highest;                     // highest address known
+
+  app_blob_tx_send_fn send_fn;
+  uint32_t tick_signal_mask;
+  app_timer_t tick_timer;
+
+  uint8_t storage[APP_BLOB_MAX_LEN];
+  uint16_t blob_len;
+  uint8_t blob_id;
+  uint8_t total;
+
+  app_blob_tx_phase_t phase;
+  uint32_t resend;                      // chunks to multicast
+  uint16_t pending_count;
+  uint16_t targets;
+  uint16_t cursor;                      // index of the next node to query
+  uint8_t round_count;
+  uint64_t started;
+  uint64_t wait_until;
+
+  // Transmissions of the transfer
+  uint32_t chunk_sends;
+  uint32_t query_sends;
+  uint32_t status_count;
+};
+
+/***************************************************************************//**
+ * @p send sends a blob_transfer. @p tick_signal is raised with
+ * sl_bt_external_signal() when app_blob_tx_process() has work to do.
+ ******************************************************************************/
+void app_blob_tx_init(app_blob_tx_t *blob, app_blob_tx_send_fn send, uint32_t tick_signal);
+
+/***************************************************************************//**
+ * Include @p address in the transfers from now on.
+ ******************************************************************************/
+void app_blob_tx_note_node(app_blob_tx_t *blob, uint16_t address);
+
+/***************************************************************************//**
+ * Distribute @p len bytes at @p data, which are copied. Returns false if a
+ * transfer is running, no node is known or the blob is too long.
+ ******************************************************************************/
+bool app_blob_tx_start(app_blob_tx_t *blob, const uint8_t *data, uint16_t len);
+
+/***************************************************************************//**
+ * Handle a blob_status from @p source.
+ ******************************************************************************/
+void app_blob_tx_on_status(app_blob_tx_t *blob, uint16_t source, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Send and advance the rounds when @p tick_signal was raised.
+ ******************************************************************************/
+void app_blob_tx_process(app_blob_tx_t *blob);
+
+#endif // APP_BLOB_TX_H
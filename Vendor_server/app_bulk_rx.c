@@ -0,0 +1,140 @@
+/***************************************************************************//**
+ * @file app_bulk_rx.c
+ * @brief Receiver side of the bulk transfer: chunks go straight into the
+ *        storage of their session.
+ ******************************************************************************/
+#include <stddef.h>
+#include <string.h>
+
+#include "app_bulk_rx.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+static void send_ack(app_bulk_rx_t *bulk,
+                     uint16_t source,
+                     uint8_t session,
+                     uint8_t status,
+                     uint32_t received)
+{
+  uint8_t ack[APP_BULK_ACK_LEN];
+  sl_status_t sc;
+
+  ack[0] = session;
+  ack[1] = status;
+  ack[2] = received & 0xFF;
+  ack[3] = (received >> 8) & 0xFF;
+  ack[4] = (received >> 16) & 0xFF;
+  ack[5] = received >> 24;
+  sc = bulk->send_fn(bulk, source, ack, sizeof(ack));
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Bulk ack error: 0x%04lX\r\n", sc);
+  }
+}
+
+static app_bulk_rx_session_t *find(app_bulk_rx_t *bulk, uint16_t source, uint8_t session)
+{
+  for (uint8_t i = 0; i < APP_BULK_RX_SESSIONS; i++) {
+    app_bulk_rx_session_t *s = &bulk->sessions[i];
+    if (s->active && s->source == source && s->session == session) {
+      return s;
+    }
+  }
+  return NULL;
+}
+
+// A slot for a new session: the sender's previous one, a free one or an
+// idle one, in this order
+static app_bulk_rx_session_t *take(app_bulk_rx_t *bulk, uint16_t source, uint64_t now)
+{
+  uint64_t idle = app_time_ms_to_ticks(APP_BULK_RX_IDLE_MS);
+  app_bulk_rx_session_t *free_slot = NULL;
+  app_bulk_rx_session_t *idle_slot = NULL;
+
+  for (uint8_t i = 0; i < APP_BULK_RX_SESSIONS; i++) {
+    app_bulk_rx_session_t *s = &bulk->sessions[i];
+    if (s->active && s->source == source) {
+      return s;
+    }
+    if (!s->active && free_slot == NULL) {
+      free_slot = s;
+    } else if (s->active && now - s->last_chunk > idle && idle_slot == NULL) {
+      idle_slot = s;
+    }
+  }
+  return free_slot != NULL ? free_slot : idle_slot;
+}
+
+void app_bulk_rx_init(app_bulk_rx_t *bulk, app_bulk_rx_send_fn send_ack, app_bulk_rx_done_fn done)
+{
+  bulk->send_fn = send_ack;
+  bulk->done_fn = done;
+  for (uint8_t i = 0; i < APP_BULK_RX_SESSIONS; i++) {
+    bulk->sessions[i].active = false;
+  }
+}
+
+void app_bulk_rx_on_chunk(app_bulk_rx_t *bulk, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint64_t now = app_time_ticks();
+  app_bulk_rx_session_t *s;
+  uint8_t seq, total, chunk_len;
+  uint32_t all;
+
+  if (len < APP_BULK_CHUNK_HEADER_LEN) {
+    return;
+  }
+  seq = data[1];
+  total = data[2];
+  chunk_len = len - APP_BULK_CHUNK_HEADER_LEN;
+  // Every chunk but the last is full
+  if (total == 0 || total > APP_BULK_MAX_CHUNKS || seq >= total
+      || chunk_len > APP_BULK_CHUNK_DATA
+      || (seq + 1 < total && chunk_len != APP_BULK_CHUNK_DATA)) {
+    APP_TASK_LOG("Malformed bulk chunk from 0x%04X\r\n", source);
+    return;
+  }
+
+  s = find(bulk, source, data[0]);
+  if (s == NULL) {
+    s = take(bulk, source, now);
+    if (s == NULL) {
+      send_ack(bulk, source, data[0], APP_BULK_STATUS_BUSY, 0);
+      return;
+    }
+    memset(s, 0, offsetof(app_bulk_rx_session_t, storage));
+    s->active = true;
+    s->source = source;
+    s->session = data[0];
+    s->total = total;
+    s->started = now;
+  } else if (total != s->total) {
+    APP_TASK_LOG("Bulk chunk from 0x%04X does not match its session\r\n", source);
+    return;
+  }
+  s->last_chunk = now;
+
+  if (s->received & (1u << seq)) {
+    // The sender repeats a chunk we have: our ack was lost
+    send_ack(bulk, source, s->session, APP_BULK_STATUS_OK, s->received);
+    return;
+  }
+  memcpy(&s->storage[seq * APP_BULK_CHUNK_DATA], &data[APP_BULK_CHUNK_HEADER_LEN], chunk_len);
+  s->received |= 1u << seq;
+  s->since_ack++;
+  if (seq + 1 == s->total) {
+    s->len = seq * APP_BULK_CHUNK_DATA + chunk_len;
+  }
+
+  all = s->total >= 32 ? UINT32_MAX : (1u << s->total) - 1;
+  if (s->received == all) {
+    send_ack(bulk, source, s->session, APP_BULK_STATUS_OK, s->received);
+    if (!s->complete) {
+      s->complete = true;
+      bulk->done_fn(bulk, source, s->storage, s->len,
+                    (uint32_t)app_time_ticks_to_ms(now - s->started));
+    }
+  } else if (s->since_ack >= APP_BULK_WINDOW || seq + 1 == s->total) {
+    send_ack(bulk, source, s->session, APP_BULK_STATUS_OK, s->received);
+    s->since_ack = 0;
+  }
+}
@@ -0,0 +1,77 @@
+/***************************************************************************//**
+ * @file app_bulk_rx.h
+ * @brief Receiver side of the bulk transfer: chunks go straight into the
+ *        storage of their session.
+ *
+ * Each of APP_BULK_RX_SESSIONS sessions owns APP_BULK_MAX_DATA bytes of
+ * storage. A chunk is copied from the received message to its offset there
+ * and marked in the received bitmap; nothing is staged in between. An ack
+ * goes back after every APP_BULK_WINDOW new chunks, on the last chunk of
+ * the session, and on a chunk that was already stored, which means the
+ * sender lost an ack. When the bitmap is complete the storage is handed to
+ * @p done in place. A session idle for APP_BULK_RX_IDLE_MS is given to the
+ * next sender.
+ *
+ * The sessions live in an app_bulk_rx_t owned by the caller, so a host
+ * simulation can run many servers in one process.
+ ******************************************************************************/
+
+#ifndef APP_BULK_RX_H
+#define APP_BULK_RX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_bulk.h"
+
+// Uploads received at the same time
+#define APP_BULK_RX_SESSIONS            2
+
+// A session without chunks for this long can be taken over
+#define APP_BULK_RX_IDLE_MS             10000
+
+typedef struct app_bulk_rx app_bulk_rx_t;
+
+// Send @p len bytes of a bulk_ack to @p destination
+typedef sl_status_t (*app_bulk_rx_send_fn)(app_bulk_rx_t *bulk,
+                                           uint16_t destination,
+                                           const uint8_t *data,
+                                           uint8_t len);
+
+// Complete upload of @p len bytes of records from @p source
+typedef void (*app_bulk_rx_done_fn)(app_bulk_rx_t *bulk,
+                                    uint16_t source,
+                                    const uint8_t *records,
+                                    uint16_t len,
+                                    uint32_t elapsed_ms);
+
+typedef struct {
+  bool active;
+  bool complete;
+  uint16_t source;
+  uint8_t session;
+  uint8_t total;
+  uint32_t received;                    // bit n: chunk n stored
+  uint8_t since_ack;                    // new chunks since the last ack
+  uint16_t len;                         // known once the last chunk is in
+  uint64_t started;
+  uint64_t last_chunk;
+  uint8_t storage[APP_BULK_MAX_DATA];
+} app_bulk_rx_session_t;
+
+struct app_bulk_rx {
+  app_bulk_rx_session_t sessions[APP_BULK_RX_SESSIONS];
+  app_bulk_rx_send_fn send_fn;
+  app_bulk_rx_done_fn done_fn;
+};
+
+/***************************************************************************//**
+ * @p send_ack sends a bulk_ack, @p done gets every complete upload.
+ ******************************************************************************/
+void app_bulk_rx_init(app_bulk_rx_t *bulk, app_bulk_rx_send_fn send_ack, app_bulk_rx_done_fn done);
+
+/***************************************************************************//**
+ * Store a bulk_chunk from @p source.
+ ******************************************************************************/
+void app_bulk_rx_on_chunk(app_bulk_rx_t *bulk, uint16_t source, const uint8_t *data, uint8_t len);
+
+#endif // APP_BULK_RX_H
@@ -0,0 +1,241 @@
+/***************************************************************************//**
+ * @file app_capture.c
+ * @brief Capture of vendor model traffic in a RAM ring, dumped over the UART.
+ ******************************************************************************/
+#include "app_capture.h"
+
+#if APP_CAPTURE_ENABLE
+
+#include <string.h>
+#include "app_timer.h"
+#include "sl_bt_api.h"
+#include "sl_sleeptimer.h"
+
+#include "app_profile.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+// The mesh event handler and the worker both capture. On the host a replay
+// runs in a single thread.
+#if defined(__arm__)
+#include "em_core.h"
+#define CAPTURE_LOCK_DECLARE()          CORE_DECLARE_IRQ_STATE
+#define CAPTURE_LOCK()                  CORE_ENTER_ATOMIC()
+#define CAPTURE_UNLOCK()                CORE_EXIT_ATOMIC()
+#else
+#define CAPTURE_LOCK_DECLARE()
+#define CAPTURE_LOCK()
+#define CAPTURE_UNLOCK()
+#endif
+
+#define RING_MASK                       (APP_CAPTURE_RING_LEN - 1)
+// Offset of the stored payload length in a record
+#define STORED_AT                       12
+
+_Static_assert((APP_CAPTURE_RING_LEN & RING_MASK) == 0,
+               "APP_CAPTURE_RING_LEN must be a power of two");
+_Static_assert(APP_CAPTURE_RING_LEN <= 32768,
+               "record positions are 16 bits");
+
+static void put(app_capture_t *capture, const uint8_t *src, uint16_t len)
+{
+  uint16_t at = capture->head & RING_MASK;
+  uint16_t first = APP_CAPTURE_RING_LEN - at;
+
+  if (first >= len) {
+    memcpy(&capture->ring[at], src, len);
+  } else {
+    memcpy(&capture->ring[at], src, first);
+    memcpy(capture->ring, &src[first], len - first);
+  }
+  capture->head += len;
+}
+
+static void record(app_capture_t *capture,
+                   uint8_t kind,
+                   uint8_t opcode,
+                   uint16_t source,
+                   uint16_t destination,
+                   uint16_t appkey_index,
+                   const uint8_t *data,
+                   uint16_t len)
+{
+#if APP_PROFILE_ENABLE
+  uint32_t start = app_profile_now();
+  uint32_t cost;
+#endif
+  uint8_t header[APP_CAPTURE_HEADER_LEN];
+  uint8_t stored = len > APP_CAPTURE_PAYLOAD_MAX ? APP_CAPTURE_PAYLOAD_MAX : len;
+  uint16_t need = APP_CAPTURE_HEADER_LEN + stored;
+  uint32_t ticks;
+  CAPTURE_LOCK_DECLARE();
+
+  if (stored < len) {
+    kind |= APP_CAPTURE_FLAG_TRUNCATED;
+  }
+  header[4] = kind;
+  header[5] = opcode;
+  header[6] = source & 0xFF;
+  header[7] = source >> 8;
+  header[8] = destination & 0xFF;
+  header[9] = destination >> 8;
+  header[10] = appkey_index & 0xFF;
+  header[11] = appkey_index >> 8;
+  header[STORED_AT] = stored;
+  header[13] = len & 0xFF;
+  header[14] = len >> 8;
+
+  CAPTURE_LOCK();
+  if (capture->frozen) {
+    capture->missed++;
+    CAPTURE_UNLOCK();
+    return;
+  }
+  // Stamped under the lock, so the records are in time order
+  ticks = (uint32_t)app_time_ticks();
+  header[0] = ticks & 0xFF;
+  header[1] = (ticks >> 8) & 0xFF;
+  header[2] = (ticks >> 16) & 0xFF;
+  header[3] = ticks >> 24;
+  while ((uint16_t)(APP_CAPTURE_RING_LEN - (uint16_t)(capture->head - capture->tail)) < need) {
+    capture->tail += APP_CAPTURE_HEADER_LEN
+                     + capture->ring[(capture->tail + STORED_AT) & RING_MASK];
+    capture->overwritten++;
+  }
+  put(capture, header, APP_CAPTURE_HEADER_LEN);
+  put(capture, data, stored);
+  capture->events++;
+#if APP_PROFILE_ENABLE
+  cost = app_profile_now() - start;
+  if (cost > capture->max_cost) {
+    capture->max_cost = cost;
+  }
+  if (cost > APP_CAPTURE_BUDGET) {
+    capture->over_budget++;
+  }
+#endif
+  CAPTURE_UNLOCK();
+}
+
+void app_capture_init(app_capture_t *capture)
+{
+  app_timer_stop(&capture->dump_timer);
+  capture->dumping = false;
+  capture->head = 0;
+  capture->tail = 0;
+  capture->frozen = false;
+  capture->events = 0;
+  capture->overwritten = 0;
+  capture->missed = 0;
+  capture->max_cost = 0;
+  capture->over_budget = 0;
+}
+
+void app_capture_rx(app_capture_t *capture, const sl_btmesh_evt_vendor_model_receive_t *rx_evt)
+{
+  record(capture,
+         APP_CAPTURE_RX | (rx_evt->nonrelayed ? APP_CAPTURE_FLAG_NONRELAYED : 0),
+         rx_evt->opcode,
+         rx_evt->source_address,
+         rx_evt->destination_address,
+         rx_evt->appkey_index,
+         rx_evt->payload.data,
+         rx_evt->payload.len);
+}
+
+void app_capture_tx(app_capture_t *capture,
+                    uint8_t opcode,
+                    uint16_t destination,
+                    uint16_t appkey_index,
+                    const uint8_t *data,
+                    uint16_t len,
+                    sl_status_t sc)
+{
+  record(capture,
+         (destination != 0 ? APP_CAPTURE_SEND : APP_CAPTURE_PUBLISH)
+         | (sc != SL_STATUS_OK ? APP_CAPTURE_FLAG_FAILED : 0),
+         opcode,
+         0,
+         destination,
+         destination != 0 ? appkey_index : 0,
+         data,
+         len);
+}
+
+static void dump_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  app_capture_t *capture = data;
+
+  sl_bt_external_signal(capture->dump_signal);
+}
+
+void app_capture_dump(app_capture_t *capture, uint16_t node_address, uint32_t step_signal)
+{
+  CAPTURE_LOCK_DECLARE();
+
+  if (capture->dumping) {
+    return;
+  }
+  // Producers leave the ring alone until the dump is done, so it can be
+  // printed without holding the lock
+  CAPTURE_LOCK();
+  capture->frozen = true;
+  CAPTURE_UNLOCK();
+
+  capture->dumping = true;
+  capture->dump_begun = false;
+  capture->dump_pos = capture->tail;
+  capture->dump_node = node_address;
+  capture->dump_signal = step_signal;
+  app_capture_dump_process(capture);
+}
+
+void app_capture_dump_process(app_capture_t *capture)
+{
+  static const char hex[] = "0123456789ABCDEF";
+  char line[2 * (APP_CAPTURE_HEADER_LEN + APP_CAPTURE_PAYLOAD_MAX) + 1];
+  // One line is left for the rest of the worker
+  uint8_t room = app_tasks_log_room();
+  uint16_t len;
+  CAPTURE_LOCK_DECLARE();
+
+  if (!capture->dumping) {
+    return;
+  }
+  if (!capture->dump_begun && room > 1) {
+    APP_TASK_LOG("CAPTURE BEGIN %u node 0x%04X hz %lu events %lu overwritten %lu\r\n",
+                 APP_CAPTURE_FORMAT,
+                 capture->dump_node,
+                 (unsigned long)sl_sleeptimer_get_timer_frequency(),
+                 (unsigned long)capture->events,
+                 (unsigned long)capture->overwritten);
+    capture->dump_begun = true;
+    room--;
+  }
+  for (; capture->dump_begun && capture->dump_pos != capture->head && room > 1;
+       capture->dump_pos += len, room--) {
+    len = APP_CAPTURE_HEADER_LEN + capture->ring[(capture->dump_pos + STORED_AT) & RING_MASK];
+    for (uint16_t i = 0; i < len; i++) {
+      uint8_t b = capture->ring[(capture->dump_pos + i) & RING_MASK];
+      line[2 * i] = hex[b >> 4];
+      line[2 * i + 1] = hex[b & 0x0F];
+    }
+    line[2 * len] = '\0';
+    APP_TASK_LOG("CAP %s\r\n", line);
+  }
+  if (!capture->dump_begun || capture->dump_pos != capture->head || room <= 1) {
+    app_timer_start(&capture->dump_timer, APP_CAPTURE_DUMP_MS, dump_timer_cb, capture, false);
+    return;
+  }
+
+  APP_TASK_LOG("CAPTURE END missed %lu cost max %lu over budget %lu\r\n",
+               (unsigned long)capture->missed,
+               (unsigned long)capture->max_cost,
+               (unsigned long)capture->over_budget);
+  CAPTURE_LOCK();
+  app_capture_init(capture);
+  CAPTURE_UNLOCK();
+}
+
+#endif // APP_CAPTURE_ENABLE
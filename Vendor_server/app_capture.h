@@ -0,0 +1,140 @@
+/***************************************************************************//**
+ * @file app_capture.h
+ * @brief Capture of vendor model traffic in a RAM ring, dumped over the UART.
+ *
+ * Every vendor message received and every one sent or published is kept as a
+ * binary record, the oldest records giving way to new ones when the ring is
+ * full. A record is a fixed header followed by the first
+ * APP_CAPTURE_PAYLOAD_MAX bytes of the payload, all fields little endian:
+ *
+ *   0  ticks       low 32 bits of the sleeptimer tick count
+ *   4  kind        APP_CAPTURE_RX/SEND/PUBLISH | APP_CAPTURE_FLAG_*
+ *   5  opcode
+ *   6  source      our address is not known to the capture: 0 on tx
+ *   8  destination 0 on a publish, which uses the publication settings
+ *   10 appkey      application key index, 0 on a publish
+ *   12 stored      payload bytes kept in the record
+ *   13 len         payload length of the message, 16 bits
+ *
+ * The dump prints one record per line as "CAP <hex>", between a BEGIN line
+ * with the format version, our address and the tick frequency and an END
+ * line with the losses and the cost per event. It goes out through the log
+ * task a few lines per worker pass, as many as the log queue has room for,
+ * so the worker never waits for the UART. host/sim/replay.c feeds the
+ * received records to the mesh event handler of the real app.c and checks
+ * the tx records against what the replay produces.
+ *
+ * The cost of an event is measured with app_profile_now(), in cycles on
+ * EFR32, and compared with APP_CAPTURE_BUDGET. Define APP_CAPTURE_ENABLE to 0
+ * to compile every call out.
+ *
+ * The ring lives in an app_capture_t owned by the caller, so a host
+ * simulation can run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_CAPTURE_H
+#define APP_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+#include "sl_btmesh_api.h"
+#include "app_timer.h"
+
+#ifndef APP_CAPTURE_ENABLE
+#define APP_CAPTURE_ENABLE              1
+#endif
+
+// Ring size in bytes, must be a power of two
+#define APP_CAPTURE_RING_LEN            2048
+// Payload bytes kept per record
+#define APP_CAPTURE_PAYLOAD_MAX         40
+// Most the capture of one event may cost
+#define APP_CAPTURE_BUDGET              400
+// Wait for room in the log queue during a dump
+#define APP_CAPTURE_DUMP_MS             20
+
+#define APP_CAPTURE_FORMAT              1
+#define APP_CAPTURE_HEADER_LEN          15
+
+// Record kinds
+#define APP_CAPTURE_RX                  0x00
+#define APP_CAPTURE_SEND                0x01
+#define APP_CAPTURE_PUBLISH             0x02
+#define APP_CAPTURE_KIND_MASK           0x0F
+
+// Record flags
+#define APP_CAPTURE_FLAG_NONRELAYED     0x10    // rx: not relayed on the way
+#define APP_CAPTURE_FLAG_TRUNCATED      0x20    // payload longer than stored
+#define APP_CAPTURE_FLAG_FAILED         0x40    // tx: refused by the stack
+
+#if APP_CAPTURE_ENABLE
+
+typedef struct {
+  uint8_t ring[APP_CAPTURE_RING_LEN];
+  uint16_t head;                        // free running, masked on access
+  uint16_t tail;                        // start of the oldest record
+  bool frozen;                          // a dump is reading the ring
+
+  uint32_t events;
+  uint32_t overwritten;                 // records given way to new ones
+  uint32_t missed;                      // events during a dump
+  uint32_t max_cost;
+  uint32_t over_budget;
+
+  // Dump in progress
+  bool dumping;
+  bool dump_begun;                      // BEGIN line queued
+  uint16_t dump_pos;                    // next record to print
+  uint16_t dump_node;
+  uint32_t dump_signal;
+  app_timer_t dump_timer;
+} app_capture_t;
+
+/***************************************************************************//**
+ * Clear the ring and start capturing.
+ ******************************************************************************/
+void app_capture_init(app_capture_t *capture);
+
+/***************************************************************************//**
+ * Capture a received vendor message. Called from the mesh event handler.
+ ******************************************************************************/
+void app_capture_rx(app_capture_t *capture, const sl_btmesh_evt_vendor_model_receive_t *rx_evt);
+
+/***************************************************************************//**
+ * Capture a vendor message sent to @p destination, or published if it is 0,
+ * with the status the stack returned. @p appkey_index is ignored on a publish.
+ ******************************************************************************/
+void app_capture_tx(app_capture_t *capture,
+                    uint8_t opcode,
+                    uint16_t destination,
+                    uint16_t appkey_index,
+                    const uint8_t *data,
+                    uint16_t len,
+                    sl_status_t sc);
+
+/***************************************************************************//**
+ * Start printing the capture of @p node_address, then start over. The lines
+ * go out from app_capture_dump_process(); @p step_signal is raised with
+ * sl_bt_external_signal() when the log queue may have room for more. Events
+ * are counted as missed until the dump is done. Worker only.
+ ******************************************************************************/
+void app_capture_dump(app_capture_t *capture, uint16_t node_address, uint32_t step_signal);
+
+/***************************************************************************//**
+ * Queue the next lines of a dump. Worker only.
+ ******************************************************************************/
+void app_capture_dump_process(app_capture_t *capture);
+
+#else // APP_CAPTURE_ENABLE
+
+// Callers keep no app_capture_t; the argument is never evaluated
+#define app_capture_init(capture)       ((void)0)
+#define app_capture_rx(capture, rx_evt) ((void)0)
+#define app_capture_tx(capture, opcode, destination, appkey_index, data, len, sc) ((void)0)
+#define app_capture_dump(capture, node_address, step_signal) ((void)0)
+#define app_capture_dump_process(capture) ((void)0)
+
+#endif // APP_CAPTURE_ENABLE
+
+#endif // APP_CAPTURE_H
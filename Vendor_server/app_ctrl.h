@@ -0,0 +1,62 @@
+/***************************************************************************//**
+ * @file app_ctrl.h
+ * @brief Control plane message format, shared by the server and clients.
+ *
+ * The server multicasts a ctrl_command once to the control group. Every
+ * client that applies it answers with a ctrl_ack to the sender after a
+ * random delay within the spread carried in the command, so the acks of a
+ * large group do not collide. Nodes that did not ack get the same command
+ * again by unicast. A client recognises a repeated command by its sequence
+ * number; it applies it once and acks every copy.
+ *
+ * ctrl_command, little-endian:
+ *
+ *   seq (1) | command (1) | argument (2) | ack spread in 100 ms units (1)
+ *
+ * ctrl_ack:
+ *
+ *   seq (1) | status (1)
+ ******************************************************************************/
+
+#ifndef APP_CTRL_H
+#define APP_CTRL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Group the clients subscribe to for commands (CUSTOM_CTRL_GRP_ADDR)
+#define APP_CTRL_GROUP_ADDR             0xC002
+
+// Commands
+#define APP_CTRL_SET_PERIOD             0x1   // argument: period, mesh step-resolution format
+#define APP_CTRL_SET_DELTA              0x2   // argument: send-on-delta threshold in 0.1 units, 0 = off
+#define APP_CTRL_SAMPLE_NOW             0x3   // no argument
+#define APP_CTRL_UPLOAD_LOG             0x4   // no argument; the log goes to the sender
+#define APP_CTRL_SET_NETTX              0x5   // argument: network transmit level of app_nettx.h
+
+// Ack status
+#define APP_CTRL_STATUS_OK              0
+#define APP_CTRL_STATUS_UNSUPPORTED     1
+
+#define APP_CTRL_CMD_LEN                5
+#define APP_CTRL_ACK_LEN                2
+#define APP_CTRL_SPREAD_UNIT_MS         100
+
+typedef struct {
+  uint8_t seq;
+  uint8_t command;
+  uint16_t argument;
+  uint8_t spread;                       // in APP_CTRL_SPREAD_UNIT_MS
+} app_ctrl_cmd_t;
+
+/***************************************************************************//**
+ * Write @p cmd into @p out, APP_CTRL_CMD_LEN bytes.
+ ******************************************************************************/
+void app_ctrl_encode(const app_ctrl_cmd_t *cmd, uint8_t *out);
+
+/***************************************************************************//**
+ * Read a ctrl_command. Returns false if it is too short.
+ ******************************************************************************/
+bool app_ctrl_decode(const uint8_t *data, uint8_t len, app_ctrl_cmd_t *cmd);
+
+#endif // APP_CTRL_H
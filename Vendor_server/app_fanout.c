@@ -0,0 +1,211 @@
+/***************************************************************************//**
+ * @file app_fanout.c
+ * @brief Sender side of the control plane: one command to every known
+ *        client, with acks collected in a bitmap.
+ ******************************************************************************/
+#include <string.h>
+#include "app_log.h"
+#include "app_timer.h"
+#include "sl_bt_api.h"
+
+#include "app_fanout.h"
+#include "app_ctrl.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+static bool bit_get(const uint8_t *map, uint16_t index)
+{
+  return map[index / 8] & (1u << (index % 8));
+}
+
+static void tick_timer_cb(app_timer_t *handle, void *data)
+{
+  app_fanout_t *fanout = data;
+
+  (void)handle;
+  // Sending belongs to the worker
+  sl_bt_external_signal(fanout->tick_signal_mask);
+}
+
+static void arm(app_fanout_t *fanout, uint32_t ms, bool periodic)
+{
+  app_timer_stop(&fanout->tick_timer);
+  app_timer_start(&fanout->tick_timer, ms, tick_timer_cb, fanout, periodic);
+}
+
+static void wait_for_acks(app_fanout_t *fanout, uint32_t ms)
+{
+  fanout->phase = APP_FANOUT_WAIT;
+  fanout->wait_until = app_time_ticks() + app_time_ms_to_ticks(ms);
+  arm(fanout, ms, false);
+}
+
+static void finish(app_fanout_t *fanout)
+{
+  app_timer_stop(&fanout->tick_timer);
+  fanout->phase = APP_FANOUT_IDLE;
+  APP_TASK_LOG("Control 0x%X seq %u: %u/%u nodes acked in %lu ms, %u rounds\r\n",
+               fanout->current.command,
+               fanout->current.seq,
+               fanout->acked,
+               fanout->targets,
+               (unsigned long)app_time_ticks_to_ms(app_time_ticks() - fanout->started),
+               fanout->round_count);
+}
+
+static sl_status_t send_to(app_fanout_t *fanout, uint16_t destination, uint8_t spread)
+{
+  uint8_t buf[APP_CTRL_CMD_LEN];
+
+  fanout->current.spread = spread;
+  app_ctrl_encode(&fanout->current, buf);
+  return fanout->send_fn(fanout, destination, buf, sizeof(buf));
+}
+
+static void resend_burst(app_fanout_t *fanout)
+{
+  uint8_t sent = 0;
+  sl_status_t sc;
+
+  while (fanout->cursor < fanout->highest && sent < APP_FANOUT_BURST) {
+    if (!bit_get(fanout->pending, fanout->cursor)) {
+      fanout->cursor++;
+      continue;
+    }
+    // A single node can answer right away
+    sc = send_to(fanout, fanout->cursor + 1, 1);
+    if (sc == SL_STATUS_NO_MORE_RESOURCE) {
+      // Out of buffers; try the same node on the next tick
+      return;
+    }
+    if (sc != SL_STATUS_OK) {
+      APP_TASK_LOG("Control resend to 0x%04X error: 0x%04lX\r\n", fanout->cursor + 1, sc);
+    }
+    sent++;
+    fanout->cursor++;
+  }
+  if (fanout->cursor >= fanout->highest) {
+    wait_for_acks(fanout, APP_CTRL_SPREAD_UNIT_MS + APP_FANOUT_GRACE_MS);
+  }
+}
+
+void app_fanout_init(app_fanout_t *fanout, app_fanout_send_fn send, uint32_t tick_signal)
+{
+  size_t len = 0;
+
+  app_timer_stop(&fanout->tick_timer);
+  memset(fanout, 0, sizeof(*fanout));
+  fanout->send_fn = send;
+  fanout->tick_signal_mask = tick_signal;
+  fanout->phase = APP_FANOUT_IDLE;
+  // A random first sequence number, so clients do not take the first
+  // command after a reboot for a copy of the last one before it
+  if (sl_bt_system_get_random_data(1, 1, &len, &fanout->current.seq) != SL_STATUS_OK) {
+    fanout->current.seq = 0;
+  }
+}
+
+void app_fanout_note_node(app_fanout_t *fanout, uint16_t address)
+{
+  if (address == 0 || address > APP_FANOUT_MAX_NODES) {
+    return;
+  }
+  fanout->known[(address - 1) / 8] |= 1u << ((address - 1) % 8);
+  if (address > fanout->highest) {
+    fanout->highest = address;
+  }
+}
+
+bool app_fanout_start(app_fanout_t *fanout, uint8_t command, uint16_t argument)
+{
+  uint32_t spread;
+  sl_status_t sc;
+
+  if (fanout->phase != APP_FANOUT_IDLE || fanout->send_fn == NULL) {
+    return false;
+  }
+  memcpy(fanout->pending, fanout->known, sizeof(fanout->pending));
+  fanout->targets = 0;
+  for (uint16_t i = 0; i < fanout->highest; i++) {
+    fanout->targets += bit_get(fanout->known, i);
+  }
+  if (fanout->targets == 0) {
+    return false;
+  }
+
+  fanout->current.seq++;
+  fanout->current.command = command;
+  fanout->current.argument = argument;
+  fanout->acked = 0;
+  fanout->round_count = 1;
+  fanout->started = app_time_ticks();
+
+  // Room for every node to ack once at APP_FANOUT_ACK_RATE
+  spread = (uint32_t)fanout->targets * 1000 / APP_FANOUT_ACK_RATE / APP_CTRL_SPREAD_UNIT_MS + 1;
+  if (spread > UINT8_MAX) {
+    spread = UINT8_MAX;
+  }
+  sc = send_to(fanout, APP_CTRL_GROUP_ADDR, (uint8_t)spread);
+  if (sc != SL_STATUS_OK) {
+    // Nobody got it; the unicast rounds still will
+    APP_TASK_LOG("Control multicast error: 0x%04lX\r\n", sc);
+  }
+  APP_TASK_LOG("Control 0x%X seq %u sent to %u nodes\r\n",
+               command, fanout->current.seq, fanout->targets);
+  wait_for_acks(fanout, spread * APP_CTRL_SPREAD_UNIT_MS + APP_FANOUT_GRACE_MS);
+  return true;
+}
+
+void app_fanout_on_ack(app_fanout_t *fanout, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint16_t index;
+
+  if (fanout->phase == APP_FANOUT_IDLE || len < APP_CTRL_ACK_LEN
+      || data[0] != fanout->current.seq || source == 0 || source > fanout->highest) {
+    return;
+  }
+  index = source - 1;
+  if (!bit_get(fanout->pending, index)) {
+    // Ack of a retransmit that crossed the first ack, or not a target
+    return;
+  }
+  fanout->pending[index / 8] &= ~(1u << (index % 8));
+  fanout->acked++;
+  if (data[1] != APP_CTRL_STATUS_OK) {
+    APP_TASK_LOG("Node 0x%04X rejected control 0x%X, status %u\r\n",
+                 source, fanout->current.command, data[1]);
+  }
+  if (fanout->acked == fanout->targets) {
+    finish(fanout);
+  }
+}
+
+void app_fanout_process(app_fanout_t *fanout)
+{
+  switch (fanout->phase) {
+    case APP_FANOUT_WAIT:
+      if (app_time_ticks() < fanout->wait_until) {
+        // Tick of a command that has finished meanwhile
+        return;
+      }
+      if (fanout->round_count >= APP_FANOUT_MAX_ROUNDS) {
+        APP_TASK_LOG("Control seq %u: %u nodes did not ack\r\n",
+                     fanout->current.seq, fanout->targets - fanout->acked);
+        finish(fanout);
+        return;
+      }
+      fanout->round_count++;
+      fanout->cursor = 0;
+      fanout->phase = APP_FANOUT_RESEND;
+      arm(fanout, APP_FANOUT_TICK_MS, true);
+      resend_burst(fanout);
+      break;
+
+    case APP_FANOUT_RESEND:
+      resend_burst(fanout);
+      break;
+
+    default:
+      break;
+  }
+}
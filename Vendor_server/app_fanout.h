@@ -0,0 +1,104 @@
+/***************************************************************************//**
+ * @file app_fanout.h
+ * @brief Sender side of the control plane: one command to every known
+ *        client, with acks collected in a bitmap.
+ *
+ * Clients become known when they report sensor data. A command goes to the
+ * control group once, with an ack spread sized for APP_FANOUT_ACK_RATE acks
+ * per second. The clients that acked are cleared from a pending bitmap
+ * indexed by (unicast address - 1). When the spread and a grace period are
+ * over, only the nodes still pending get the command again, by unicast and
+ * APP_FANOUT_BURST at a time, for up to APP_FANOUT_MAX_ROUNDS rounds in all.
+ * The time until the last ack is logged.
+ *
+ * The state lives in an app_fanout_t owned by the caller, so a host
+ * simulation can run many servers in one process.
+ ******************************************************************************/
+
+#ifndef APP_FANOUT_H
+#define APP_FANOUT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+#include "app_timer.h"
+#include "app_ctrl.h"
+
+// Highest unicast address tracked
+#define APP_FANOUT_MAX_NODES            1024
+
+// Rounds of one command: the multicast and the unicast retransmits
+#define APP_FANOUT_MAX_ROUNDS           4
+
+// Acks per second the group spread is sized for
+#define APP_FANOUT_ACK_RATE             50
+
+// Wait for late acks after the spread
+#define APP_FANOUT_GRACE_MS             1000
+
+// Unicast retransmits sent per tick
+#define APP_FANOUT_BURST                4
+#define APP_FANOUT_TICK_MS              50
+
+typedef enum {
+  APP_FANOUT_IDLE,
+  APP_FANOUT_WAIT,                      // waiting for acks
+  APP_FANOUT_RESEND                     // unicasting to the pending nodes
+} app_fanout_phase_t;
+
+typedef struct app_fanout app_fanout_t;
+
+// Send @p len bytes of a ctrl_command to @p destination
+typedef sl_status_t (*app_fanout_send_fn)(app_fanout_t *fanout,
+                                          uint16_t destination,
+                                          const uint8_t *data,
+                                          uint8_t len);
+
+struct app_fanout {
+  uint8_t known[APP_FANOUT_MAX_NODES / 8];
+  uint8_t pending[APP_FANOUT_MAX_NODES / 8];
+  uint16_t highest;                     // highest address known
+
+  app_fanout_send_fn send_fn;
+  uint32_t tick_signal_mask;
+  app_timer_t tick_timer;
+
+  app_fanout_phase_t phase;
+  app_ctrl_cmd_t current;
+  uint8_t round_count;
+  uint16_t cursor;                      // index of the next node to resend to
+  uint16_t targets;
+  uint16_t acked;
+  uint64_t started;
+  uint64_t wait_until;
+};
+
+/***************************************************************************//**
+ * @p send is called from app_fanout_process() and app_fanout_start(), and
+ * @p tick_signal is raised with sl_bt_external_signal() when
+ * app_fanout_process() has work to do.
+ ******************************************************************************/
+void app_fanout_init(app_fanout_t *fanout, app_fanout_send_fn send, uint32_t tick_signal);
+
+/***************************************************************************//**
+ * Include @p address in the commands from now on.
+ ******************************************************************************/
+void app_fanout_note_node(app_fanout_t *fanout, uint16_t address);
+
+/***************************************************************************//**
+ * Send @p command with @p argument to all known nodes. Returns false if a
+ * command is still in progress or no node is known.
+ ******************************************************************************/
+bool app_fanout_start(app_fanout_t *fanout, uint8_t command, uint16_t argument);
+
+/***************************************************************************//**
+ * Count a ctrl_ack from @p source.
+ ******************************************************************************/
+void app_fanout_on_ack(app_fanout_t *fanout, uint16_t source, const uint8_t *data, uint8_t len);
+
+/***************************************************************************//**
+ * Advance retransmission when @p tick_signal was raised.
+ ******************************************************************************/
+void app_fanout_process(app_fanout_t *fanout);
+
+#endif // APP_FANOUT_H
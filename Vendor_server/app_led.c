@@ -0,0 +1,86 @@
+/***************************************************************************//**
+ * @file app_led.c
+ * @brief LED state of every client node, kept as a packed 2-bit bitmap.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+
+#include "app_led.h"
+
+_Static_assert(APP_LED_LCD_ROWS <= 8, "dirty_rows holds 8 rows");
+
+void app_led_init(app_led_t *led)
+{
+  memset(led->bitmap, 0, sizeof(led->bitmap));
+  led->highest = 0;
+  led->dirty_rows = (1u << APP_LED_LCD_ROWS) - 1;
+}
+
+bool app_led_update(app_led_t *led, uint16_t address, uint8_t state)
+{
+  uint16_t index;
+  uint8_t shift;
+  uint8_t old;
+
+  if (address == 0 || address > APP_LED_MAX_NODES) {
+    return false;
+  }
+  index = address - 1;
+  shift = 2 * (index % 4);
+  state &= 0x3;
+  old = (led->bitmap[index / 4] >> shift) & 0x3;
+  if (address > led->highest) {
+    led->highest = address;
+  }
+  if (old == state) {
+    return false;
+  }
+
+  led->bitmap[index / 4] = (led->bitmap[index / 4] & ~(0x3 << shift)) | (state << shift);
+  if (index / APP_LED_NODES_PER_ROW < APP_LED_LCD_ROWS) {
+    led->dirty_rows |= 1u << (index / APP_LED_NODES_PER_ROW);
+  }
+  return true;
+}
+
+bool app_led_next_dirty_row(app_led_t *led, uint8_t *row, char *text, size_t size)
+{
+  uint8_t r;
+  int pos;
+
+  if (led->dirty_rows == 0) {
+    return false;
+  }
+  for (r = 0; !(led->dirty_rows & (1u << r)); r++) {
+  }
+  led->dirty_rows &= ~(1u << r);
+
+  // "0009 30210031": first address, then one digit per node
+  pos = snprintf(text, size, "%04u ", r * APP_LED_NODES_PER_ROW + 1);
+  for (int i = 0; i < APP_LED_NODES_PER_ROW && pos > 0 && (size_t)pos + 1 < size; i++) {
+    uint16_t index = r * APP_LED_NODES_PER_ROW + i;
+    text[pos++] = '0' + ((led->bitmap[index / 4] >> (2 * (index % 4))) & 0x3);
+  }
+  if (pos > 0 && (size_t)pos < size) {
+    text[pos] = '\0';
+  }
+  *row = APP_LED_LCD_FIRST_ROW + r;
+  return true;
+}
+
+uint16_t app_led_snapshot(const app_led_t *led, uint8_t *out, uint16_t out_size)
+{
+  // Whole bytes only; the last one may carry up to three unused nodes
+  uint16_t count = (led->highest + 3) & ~3u;
+  uint16_t len = APP_LED_SNAPSHOT_HEADER_LEN + count / 4;
+
+  if (len > out_size) {
+    return 0;
+  }
+  out[0] = 1;
+  out[1] = 0;
+  out[2] = (uint8_t)count;
+  out[3] = (uint8_t)(count >> 8);
+  memcpy(&out[APP_LED_SNAPSHOT_HEADER_LEN], led->bitmap, count / 4);
+  return len;
+}
@@ -0,0 +1,67 @@
+/***************************************************************************//**
+ * @file app_led.h
+ * @brief LED state of every client node, kept as a packed 2-bit bitmap.
+ *
+ * The LED message of a node carries two LED bits. They are stored at index
+ * (unicast address - 1) of a bitmap, four nodes per byte, so 1024 nodes need
+ * 256 bytes. An update only marks an LCD row dirty when the stored state
+ * actually changes. The LCD shows the first APP_LED_LCD_ROWS x
+ * APP_LED_NODES_PER_ROW nodes.
+ *
+ * The whole bitmap is returned by a snapshot. Layout, little-endian:
+ *
+ *   first address (2) | node count (2) | count / 4 bytes of 2-bit states
+ *
+ * Node n is held in bits 2 * (n % 4) of byte n / 4.
+ *
+ * The table lives in an app_led_t owned by the caller, so a host simulation
+ * can run many servers in one process.
+ ******************************************************************************/
+
+#ifndef APP_LED_H
+#define APP_LED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+// Highest unicast address tracked
+#define APP_LED_MAX_NODES               1024
+
+// LCD area used for the LED table
+#define APP_LED_LCD_FIRST_ROW           4
+#define APP_LED_LCD_ROWS                3
+#define APP_LED_NODES_PER_ROW           8
+
+#define APP_LED_SNAPSHOT_HEADER_LEN     4
+#define APP_LED_SNAPSHOT_MAX_LEN        (APP_LED_SNAPSHOT_HEADER_LEN + APP_LED_MAX_NODES / 4)
+
+typedef struct {
+  uint8_t bitmap[APP_LED_MAX_NODES / 4];
+  uint16_t highest;                     // highest address seen
+  uint8_t dirty_rows;                   // one bit per LCD row
+} app_led_t;
+
+/***************************************************************************//**
+ * Clear all states and mark every LCD row dirty.
+ ******************************************************************************/
+void app_led_init(app_led_t *led);
+
+/***************************************************************************//**
+ * Store the LED state of @p address. Returns true if it changed.
+ ******************************************************************************/
+bool app_led_update(app_led_t *led, uint16_t address, uint8_t state);
+
+/***************************************************************************//**
+ * Format the next dirty LCD row into @p text and clear its dirty flag.
+ * Returns false when no row is dirty.
+ ******************************************************************************/
+bool app_led_next_dirty_row(app_led_t *led, uint8_t *row, char *text, size_t size);
+
+/***************************************************************************//**
+ * Write a snapshot of all nodes up to the highest address seen into @p out.
+ * Returns its length, or 0 if @p out_size is too small.
+ ******************************************************************************/
+uint16_t app_led_snapshot(const app_led_t *led, uint8_t *out, uint16_t out_size);
+
+#endif // APP_LED_H
@@ -0,0 +1,128 @@
+/***************************************************************************//**
+ * @file app_nettx.h
+ * @brief Adaptive network transmit and relay retransmit tuning.
+ *
+ * The server runs the controller. Every received group-addressed message
+ * is counted per source. When a telemetry report arrives from that source,
+ * its tx_count tells how many group-addressed messages it really sent, which
+ * gives the loss rate of the path. Unicast traffic is left out on both ends, since only its addressee
+ * sees it; the measurement assumes the receiver subscribes to the groups
+ * the source sends to. Messages are counted before any duplicate check of
+ * the application, which only compares payloads. Together with the duplicate
+ * rate this drives a small ladder of (count, interval) settings that is
+ * applied with sl_btmesh_test_set_nettx() and sl_btmesh_test_set_relay().
+ * Moving up needs sustained loss, moving down needs sustained redundancy,
+ * so the setting does not oscillate.
+ *
+ * The loss is on the paths from the sources, so a new level is only useful
+ * at the sources. The server sends it to them as APP_CTRL_SET_NETTX. The
+ * clients and relays apply it with app_nettx_set_level(); they measure
+ * nothing themselves.
+ *
+ * The evaluation timer only raises a signal; app_nettx_evaluate() runs in
+ * the worker, where the counters are updated.
+ *
+ * The controller state lives in an app_nettx_t owned by the caller, so a
+ * host simulation can run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_NETTX_H
+#define APP_NETTX_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_timer.h"
+
+// Evaluation window of the controller
+#define APP_NETTX_EVAL_MS               60000
+
+// Minimum number of expected messages in a window to evaluate it
+#define APP_NETTX_MIN_SAMPLES           10
+
+// Loss above HIGH raises the level, loss below LOW with duplicates above
+// DUP_HIGH lowers it (per mille)
+#define APP_NETTX_LOSS_HIGH             100
+#define APP_NETTX_LOSS_LOW              20
+#define APP_NETTX_DUP_HIGH              300
+
+// Consecutive windows required before changing the level
+#define APP_NETTX_RAISE_WINDOWS         2
+#define APP_NETTX_LOWER_WINDOWS         3
+
+// Number of sources tracked for loss measurement
+#define APP_NETTX_SOURCES               16
+
+// Levels of the (count, interval) ladder; level 0 sends once
+#define APP_NETTX_LEVELS                5
+
+typedef struct {
+  uint16_t address;                     // 0 = free slot
+  bool has_baseline;
+  uint32_t last_tx_count;
+  uint32_t rx_since;
+} app_nettx_source_t;
+
+typedef struct {
+  app_nettx_source_t sources[APP_NETTX_SOURCES];
+  bool relay_enabled;
+  uint8_t level;
+  uint8_t raise_streak;
+  uint8_t lower_streak;
+  uint32_t window_expected;
+  uint32_t window_received;
+  uint32_t window_duplicates;
+  uint32_t eval_signal;
+  app_timer_t eval_timer;
+} app_nettx_t;
+
+/***************************************************************************//**
+ * Apply the lowest level, and on the controller start the evaluation timer.
+ *
+ * @param[in] relay        Whether this node relays; relay retransmissions are
+ *                         only configured when true, otherwise relaying is
+ *                         disabled.
+ * @param[in] eval_signal  Raised with sl_bt_external_signal() every
+ *                         APP_NETTX_EVAL_MS for app_nettx_evaluate(); 0 on
+ *                         the nodes that only follow the server's level.
+ ******************************************************************************/
+void app_nettx_init(app_nettx_t *nettx, bool relay, uint32_t eval_signal);
+
+/***************************************************************************//**
+ * Judge the window that ended when @p eval_signal was raised, and apply the
+ * new level if it changed. Returns true when it did, so the caller can send
+ * it to the sources.
+ ******************************************************************************/
+bool app_nettx_evaluate(app_nettx_t *nettx);
+
+/***************************************************************************//**
+ * Apply @p level as sent by the server; out of range levels are capped.
+ ******************************************************************************/
+void app_nettx_set_level(app_nettx_t *nettx, uint8_t level);
+
+/***************************************************************************//**
+ * Current level, 0 to APP_NETTX_LEVELS - 1.
+ ******************************************************************************/
+uint8_t app_nettx_level(const app_nettx_t *nettx);
+
+/***************************************************************************//**
+ * Count a message received from @p source. Only messages to a group or
+ * virtual @p destination are counted.
+ ******************************************************************************/
+void app_nettx_on_rx(app_nettx_t *nettx, uint16_t source, uint16_t destination);
+
+/***************************************************************************//**
+ * Count a message dropped as a duplicate.
+ ******************************************************************************/
+void app_nettx_on_duplicate(app_nettx_t *nettx);
+
+/***************************************************************************//**
+ * Report the publication counter carried by a telemetry message of @p source.
+ ******************************************************************************/
+void app_nettx_on_telemetry(app_nettx_t *nettx, uint16_t source, uint32_t tx_count);
+
+/***************************************************************************//**
+ * Number of times each network PDU is currently transmitted.
+ ******************************************************************************/
+uint8_t app_nettx_transmissions(const app_nettx_t *nettx);
+
+#endif // APP_NETTX_H
@@ -0,0 +1,167 @@
+/***************************************************************************//**
+ * @file app_reasm.c
+ * @brief Reassembly of vendor messages delivered in parts.
+ ******************************************************************************/
+#include <string.h>
+
+#include "app_reasm.h"
+#include "app_time.h"
+
+static void expire(app_reasm_t *reasm, uint64_t now)
+{
+  uint64_t timeout = app_time_ms_to_ticks(APP_REASM_TIMEOUT_MS);
+
+  for (uint8_t i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    app_reasm_buf_t *buf = &reasm->pool[i];
+    app_reasm_skip_t *skip = &reasm->skip[i];
+    if (buf->state == APP_REASM_FILLING && now - buf->last_part > timeout) {
+      buf->state = APP_REASM_FREE;
+      reasm->timed_out++;
+    }
+    if (skip->valid && now - skip->last_part > timeout) {
+      skip->valid = false;
+    }
+  }
+}
+
+static app_reasm_buf_t *find(app_reasm_t *reasm, const app_rx_msg_t *msg, app_reasm_state_t state)
+{
+  for (uint8_t i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    app_reasm_buf_t *buf = &reasm->pool[i];
+    if (buf->state == state
+        && (state == APP_REASM_FREE
+            || (buf->source == msg->source_address && buf->opcode == msg->opcode))) {
+      return buf;
+    }
+  }
+  return NULL;
+}
+
+// Returns true if @p msg belongs to a message being discarded
+static bool skipped(app_reasm_t *reasm, const app_rx_msg_t *msg, uint64_t now)
+{
+  for (uint8_t i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    app_reasm_skip_t *skip = &reasm->skip[i];
+    if (skip->valid
+        && skip->source == msg->source_address && skip->opcode == msg->opcode) {
+      if (msg->first) {
+        // The discarded message ended without its final part
+        skip->valid = false;
+        return false;
+      }
+      if (msg->final) {
+        skip->valid = false;
+      }
+      skip->last_part = now;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void discard_rest(app_reasm_t *reasm, const app_rx_msg_t *msg, uint64_t now)
+{
+  if (msg->final) {
+    return;
+  }
+  for (uint8_t i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    app_reasm_skip_t *skip = &reasm->skip[i];
+    if (!skip->valid) {
+      skip->valid = true;
+      skip->source = msg->source_address;
+      skip->opcode = msg->opcode;
+      skip->last_part = now;
+      return;
+    }
+  }
+}
+
+void app_reasm_init(app_reasm_t *reasm)
+{
+  memset(reasm, 0, sizeof(*reasm));
+}
+
+bool app_reasm_feed(app_reasm_t *reasm,
+                    const app_rx_msg_t *msg,
+                    const uint8_t **data,
+                    uint8_t *len)
+{
+  uint64_t now = app_time_ticks();
+  app_reasm_buf_t *buf;
+
+  expire(reasm, now);
+  if (skipped(reasm, msg, now)) {
+    return false;
+  }
+  buf = find(reasm, msg, APP_REASM_FILLING);
+  if (buf != NULL && msg->first) {
+    // The message in the buffer lost its rest; this part starts the next
+    buf->state = APP_REASM_FREE;
+    reasm->cut_short++;
+    buf = NULL;
+  }
+  if (buf == NULL) {
+    if (!msg->first) {
+      // The rest of a message whose start was dropped or timed out
+      reasm->orphaned++;
+      discard_rest(reasm, msg, now);
+      return false;
+    }
+    if (msg->final) {
+      *data = msg->data;
+      *len = msg->len;
+      return true;
+    }
+    buf = find(reasm, msg, APP_REASM_FREE);
+    if (buf == NULL) {
+      reasm->no_buffer++;
+      discard_rest(reasm, msg, now);
+      return false;
+    }
+    buf->state = APP_REASM_FILLING;
+    buf->source = msg->source_address;
+    buf->opcode = msg->opcode;
+    buf->len = 0;
+  }
+
+  if (buf->len + msg->len > APP_REASM_MAX_LEN) {
+    buf->state = APP_REASM_FREE;
+    reasm->too_long++;
+    discard_rest(reasm, msg, now);
+    return false;
+  }
+  memcpy(&buf->data[buf->len], msg->data, msg->len);
+  buf->len += msg->len;
+  buf->last_part = now;
+  if (!msg->final) {
+    return false;
+  }
+
+  buf->state = APP_REASM_HANDED_OUT;
+  reasm->completed++;
+  *data = buf->data;
+  *len = buf->len;
+  return true;
+}
+
+void app_reasm_release(app_reasm_t *reasm, const uint8_t *data)
+{
+  for (uint8_t i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    app_reasm_buf_t *buf = &reasm->pool[i];
+    if (buf->state == APP_REASM_HANDED_OUT && buf->data == data) {
+      buf->state = APP_REASM_FREE;
+      return;
+    }
+  }
+}
+
+void app_reasm_report(const app_reasm_t *reasm)
+{
+  APP_TASK_LOG("Reassembly: %lu completed, %lu timed out, %lu cut short, %lu without buffer, %lu too long, %lu orphaned\r\n",
+               (unsigned long)reasm->completed,
+               (unsigned long)reasm->timed_out,
+               (unsigned long)reasm->cut_short,
+               (unsigned long)reasm->no_buffer,
+               (unsigned long)reasm->too_long,
+               (unsigned long)reasm->orphaned);
+}
@@ -0,0 +1,104 @@
+/***************************************************************************//**
+ * @file app_reasm.h
+ * @brief Reassembly of vendor messages delivered in parts.
+ *
+ * A message longer than one stack event or one worker queue slot arrives as
+ * several app_rx_msg_t parts from the same source with the same opcode, all
+ * but the last with final cleared. The parts are appended to a buffer taken
+ * from a static pool of APP_REASM_POOL_SIZE; parts of different sources may
+ * interleave. When the final part arrives the complete payload is handed
+ * out in place, without another copy, and its buffer stays reserved until
+ * app_reasm_release(). A message that stops arriving for
+ * APP_REASM_TIMEOUT_MS is dropped when the pool is next used, and so is one
+ * whose source starts the next message (first set) before its final part.
+ * A part that is not first and finds no buffer, the rest of a message whose
+ * start was dropped, is discarded with that rest rather than handed out as
+ * a message of its own.
+ *
+ * A message in a single part, the common case, is handed out straight from
+ * the worker message and never touches the pool.
+ *
+ * The pool lives in an app_reasm_t owned by the caller, so a host
+ * simulation can run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_REASM_H
+#define APP_REASM_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "app_tasks.h"
+
+// Messages that can be reassembled at the same time
+#define APP_REASM_POOL_SIZE             4
+
+// Longest reassembled payload
+#define APP_REASM_MAX_LEN               255
+
+// Gap after which a partial message is dropped
+#define APP_REASM_TIMEOUT_MS            2000
+
+typedef enum {
+  APP_REASM_FREE,
+  APP_REASM_FILLING,
+  APP_REASM_HANDED_OUT
+} app_reasm_state_t;
+
+typedef struct {
+  app_reasm_state_t state;
+  uint16_t source;
+  uint8_t opcode;
+  uint8_t len;
+  uint64_t last_part;                   // tick of the latest part
+  uint8_t data[APP_REASM_MAX_LEN];
+} app_reasm_buf_t;
+
+// The rest of a dropped message is discarded up to its final part, the
+// first part of the next message or a gap of APP_REASM_TIMEOUT_MS
+typedef struct {
+  bool valid;
+  uint16_t source;
+  uint8_t opcode;
+  uint64_t last_part;                   // tick of the latest part
+} app_reasm_skip_t;
+
+typedef struct {
+  app_reasm_buf_t pool[APP_REASM_POOL_SIZE];
+  app_reasm_skip_t skip[APP_REASM_POOL_SIZE];
+
+  uint32_t completed;
+  uint32_t timed_out;
+  uint32_t cut_short;
+  uint32_t no_buffer;
+  uint32_t too_long;
+  uint32_t orphaned;
+} app_reasm_t;
+
+/***************************************************************************//**
+ * Empty the pool of @p reasm and clear its counters.
+ ******************************************************************************/
+void app_reasm_init(app_reasm_t *reasm);
+
+/***************************************************************************//**
+ * Add @p msg to the message it belongs to. Returns true and the complete
+ * payload in @p data and @p len once @p msg was the final part; @p msg
+ * carries the header fields. Returns false while parts are missing, or if
+ * the message was dropped.
+ ******************************************************************************/
+bool app_reasm_feed(app_reasm_t *reasm,
+                    const app_rx_msg_t *msg,
+                    const uint8_t **data,
+                    uint8_t *len);
+
+/***************************************************************************//**
+ * Return the buffer of a payload handed out by app_reasm_feed() to the pool.
+ * Does nothing for a payload that came in a single part.
+ ******************************************************************************/
+void app_reasm_release(app_reasm_t *reasm, const uint8_t *data);
+
+/***************************************************************************//**
+ * Print completed and dropped counters.
+ ******************************************************************************/
+void app_reasm_report(const app_reasm_t *reasm);
+
+#endif // APP_REASM_H
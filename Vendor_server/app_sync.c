@@ -0,0 +1,167 @@
+/***************************************************************************//**
+ * @file app_sync.c
+ * @brief Network time: beacons from the server and a synchronized clock on
+ *        the clients.
+ ******************************************************************************/
+#include <string.h>
+#include "sl_bt_api.h"
+
+#include "app_sync.h"
+#include "app_tasks.h"
+#include "app_time.h"
+
+// Drift is kept as offset milliseconds per local millisecond in 0.32 fixed
+// point, so reading the clock needs no division
+#define DRIFT_ONE                       ((int64_t)1 << 32)
+#define DRIFT_LIMIT                     (((int64_t)APP_SYNC_MAX_DRIFT_PPM << 32) / 1000000)
+
+static int64_t offset_at(const app_sync_t *sync, uint64_t local)
+{
+  return sync->ref_offset + (((int64_t)(local - sync->ref_local) * sync->drift) >> 32);
+}
+
+static void restart(app_sync_t *sync, uint8_t new_epoch, int64_t sample, uint64_t local)
+{
+  // The drift belongs to our own oscillator and is kept
+  sync->epoch = new_epoch;
+  sync->synced = true;
+  sync->ref_offset = sample;
+  sync->ref_local = local;
+  sync->win_count = 0;
+  sync->point_count = 0;
+  sync->point_next = 0;
+}
+
+static void add_point(app_sync_t *sync, int64_t offset, uint64_t local)
+{
+  const app_sync_point_t *oldest;
+  int64_t measured, predicted;
+
+  sync->points[sync->point_next].offset = offset;
+  sync->points[sync->point_next].local = local;
+  sync->point_next = (sync->point_next + 1) % APP_SYNC_POINTS;
+  if (sync->point_count < APP_SYNC_POINTS) {
+    sync->point_count++;
+  }
+  sync->ref_offset = offset;
+  sync->ref_local = local;
+  if (sync->point_count < 2) {
+    return;
+  }
+
+  oldest = &sync->points[(sync->point_next + APP_SYNC_POINTS - sync->point_count) % APP_SYNC_POINTS];
+  if (local == oldest->local) {
+    return;
+  }
+  measured = (offset - oldest->offset) * DRIFT_ONE / (int64_t)(local - oldest->local);
+  if (measured > DRIFT_LIMIT) {
+    measured = DRIFT_LIMIT;
+  } else if (measured < -DRIFT_LIMIT) {
+    measured = -DRIFT_LIMIT;
+  }
+  sync->drift += (measured - sync->drift) / (1 << APP_SYNC_DRIFT_SHIFT);
+
+  // The lowest of the minima, carried forward with the drift, is the one
+  // least delayed
+  for (uint8_t i = 0; i < sync->point_count; i++) {
+    const app_sync_point_t *p =
+      &sync->points[(sync->point_next + APP_SYNC_POINTS - 1 - i) % APP_SYNC_POINTS];
+    predicted = p->offset + (((int64_t)(local - p->local) * sync->drift) >> 32);
+    if (predicted < sync->ref_offset) {
+      sync->ref_offset = predicted;
+    }
+  }
+}
+
+void app_sync_init(app_sync_t *sync, bool source)
+{
+  size_t len = 0;
+
+  memset(sync, 0, sizeof(*sync));
+  sync->is_source = source;
+  sync->synced = source;
+  // A new epoch per boot of the source
+  if (sl_bt_system_get_random_data(1, 1, &len, &sync->epoch) != SL_STATUS_OK) {
+    sync->epoch = (uint8_t)app_time_ticks();
+  }
+}
+
+void app_sync_encode_beacon(const app_sync_t *sync, uint8_t *out)
+{
+  uint64_t now = app_time_ms();
+
+  out[0] = sync->epoch;
+  for (uint8_t i = 0; i < APP_SYNC_BEACON_LEN - 1; i++) {
+    out[1 + i] = (now >> (8 * i)) & 0xFF;
+  }
+}
+
+void app_sync_on_beacon(app_sync_t *sync,
+                        const uint8_t *data,
+                        uint8_t len,
+                        uint64_t rx_ms,
+                        uint8_t hops)
+{
+  uint64_t network = 0;
+  uint8_t relays = hops > 1 ? hops - 1 : 0;
+  int64_t sample, error;
+
+  if (sync->is_source || len < APP_SYNC_BEACON_LEN) {
+    return;
+  }
+  for (uint8_t i = 0; i < APP_SYNC_BEACON_LEN - 1; i++) {
+    network |= (uint64_t)data[1 + i] << (8 * i);
+  }
+  network += APP_SYNC_TX_DELAY_MS + (uint32_t)relays * APP_SYNC_HOP_DELAY_MS;
+  sample = (int64_t)rx_ms - (int64_t)network;
+
+  if (!sync->synced || data[0] != sync->epoch) {
+    APP_TASK_LOG("Time sync: source epoch %u\r\n", data[0]);
+    restart(sync, data[0], sample, rx_ms);
+  } else {
+    error = sample - offset_at(sync, rx_ms);
+    if (error > APP_SYNC_STEP_MS || error < -APP_SYNC_STEP_MS) {
+      APP_TASK_LOG("Time sync: step of %ld ms\r\n", (long)error);
+      restart(sync, data[0], sample, rx_ms);
+    }
+  }
+
+  // Jitter only delays a beacon: the smallest offset is the best one
+  if (sync->win_count == 0 || sample < sync->win_min) {
+    sync->win_min = sample;
+    sync->win_local = rx_ms;
+  }
+  if (++sync->win_count >= APP_SYNC_WINDOW) {
+    sync->win_count = 0;
+    add_point(sync, sync->win_min, sync->win_local);
+  }
+}
+
+bool app_sync_is_synced(const app_sync_t *sync)
+{
+  return sync->synced;
+}
+
+uint64_t app_sync_now_ms(const app_sync_t *sync)
+{
+  uint64_t local = app_time_ms();
+
+  if (!sync->synced) {
+    return local;
+  }
+  return local - offset_at(sync, local);
+}
+
+uint64_t app_sync_to_local_ms(const app_sync_t *sync, uint64_t network_ms)
+{
+  if (!sync->synced) {
+    return network_ms;
+  }
+  // The offset changes too slowly for a second iteration to matter
+  return network_ms + offset_at(sync, network_ms + sync->ref_offset);
+}
+
+int32_t app_sync_drift_ppm(const app_sync_t *sync)
+{
+  return (int32_t)((sync->drift * 1000000) >> 32);
+}
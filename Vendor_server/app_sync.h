@@ -0,0 +1,126 @@
+/***************************************************************************//**
+ * @file app_sync.h
+ * @brief Network time: beacons from the server and a synchronized clock on
+ *        the clients.
+ *
+ * The server is the time source. Every APP_SYNC_BEACON_PERIOD_MS it sends a
+ * time_beacon to the control group, stamped with its own milliseconds since
+ * boot just before the send:
+ *
+ *   epoch (1) | time_ms (6, little-endian)
+ *
+ * The epoch is random per boot of the source, so a client notices a restart
+ * instead of taking the clock jump for drift. The beacon fits an
+ * unsegmented message.
+ *
+ * A client subtracts the shortest path delay, APP_SYNC_TX_DELAY_MS plus
+ * APP_SYNC_HOP_DELAY_MS per relay on the hop distance from app_hops, from
+ * each beacon to get an offset sample. Relay and queueing jitter only ever
+ * delays a beacon, so the smallest sample of every APP_SYNC_WINDOW beacons
+ * is kept. Drift is the slope between the newest of those minima and the
+ * one APP_SYNC_POINTS - 1 windows older, smoothed by 2^-APP_SYNC_DRIFT_SHIFT.
+ * The offset is the lowest of the minima carried forward with the drift,
+ * extrapolated with the drift until the next window. A sample further than
+ * APP_SYNC_STEP_MS from the prediction starts over.
+ *
+ * The clock state lives in an app_sync_t owned by the caller, so a host
+ * simulation can run many nodes in one process.
+ ******************************************************************************/
+
+#ifndef APP_SYNC_H
+#define APP_SYNC_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define APP_SYNC_BEACON_PERIOD_MS       10000
+#define APP_SYNC_BEACON_LEN             7
+
+// Shortest path delay of a beacon: from the send call to reception one hop
+// away, and the extra delay of every relay on the way
+#define APP_SYNC_TX_DELAY_MS            8
+#define APP_SYNC_HOP_DELAY_MS           15
+
+// Beacons per minimum filter window
+#define APP_SYNC_WINDOW                 4
+
+// Window minima kept for the drift baseline
+#define APP_SYNC_POINTS                 16
+
+#define APP_SYNC_DRIFT_SHIFT            2
+
+// Largest drift believed, parts per million
+#define APP_SYNC_MAX_DRIFT_PPM          200
+
+// Deviation from the prediction taken for a clock step
+#define APP_SYNC_STEP_MS                500
+
+typedef struct {
+  int64_t offset;                       // local - network, ms
+  uint64_t local;                       // local ms it was taken at
+} app_sync_point_t;
+
+typedef struct {
+  bool is_source;
+  bool synced;
+  uint8_t epoch;
+
+  // Offset at ref_local, extrapolated with the drift; the drift is offset
+  // milliseconds per local millisecond in 0.32 fixed point
+  int64_t ref_offset;
+  uint64_t ref_local;
+  int64_t drift;
+
+  // Minimum of the current window
+  uint8_t win_count;
+  int64_t win_min;
+  uint64_t win_local;
+
+  // Recent window minima, oldest first from point_next - point_count
+  app_sync_point_t points[APP_SYNC_POINTS];
+  uint8_t point_count;
+  uint8_t point_next;
+} app_sync_t;
+
+/***************************************************************************//**
+ * Start the service. The @p source, the server, is in sync by definition.
+ ******************************************************************************/
+void app_sync_init(app_sync_t *sync, bool source);
+
+/***************************************************************************//**
+ * Stamp a beacon into @p out (APP_SYNC_BEACON_LEN bytes). Source only.
+ ******************************************************************************/
+void app_sync_encode_beacon(const app_sync_t *sync, uint8_t *out);
+
+/***************************************************************************//**
+ * Take a beacon received at local time @p rx_ms, app_time_ms(), over
+ * @p hops hops, 0 if unknown.
+ ******************************************************************************/
+void app_sync_on_beacon(app_sync_t *sync,
+                        const uint8_t *data,
+                        uint8_t len,
+                        uint64_t rx_ms,
+                        uint8_t hops);
+
+/***************************************************************************//**
+ * True once the network time can be read.
+ ******************************************************************************/
+bool app_sync_is_synced(const app_sync_t *sync);
+
+/***************************************************************************//**
+ * Network time in milliseconds; the local time while not in sync.
+ ******************************************************************************/
+uint64_t app_sync_now_ms(const app_sync_t *sync);
+
+/***************************************************************************//**
+ * Local time, as app_time_ms(), at which the network time is
+ * @p network_ms.
+ ******************************************************************************/
+uint64_t app_sync_to_local_ms(const app_sync_t *sync, uint64_t network_ms);
+
+/***************************************************************************//**
+ * Estimated drift of the local clock against the source, in ppm.
+ ******************************************************************************/
+int32_t app_sync_drift_ppm(const app_sync_t *sync);
+
+#endif // APP_SYNC_H
@@ -0,0 +1,353 @@
+/***************************************************************************//**
+ * @file app_tasks.c
+ * @brief Split of stack event handling and application processing.
+ ******************************************************************************/
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include "app_assert.h"
+
+#include "app_tasks.h"
+#include "app_time.h"
+
+// Number of worker messages the payload of @p rx_evt is split into
+static uint16_t rx_parts(const sl_btmesh_evt_vendor_model_receive_t *rx_evt)
+{
+  if (rx_evt->payload.len == 0) {
+    return 1;
+  }
+  return (rx_evt->payload.len + APP_RX_PAYLOAD_MAX - 1) / APP_RX_PAYLOAD_MAX;
+}
+
+// Returns true if @p rx_evt starts a message rather than continuing the one
+// of the previous event. The stack delivers the events of a message back to
+// back, so a message whose rest was dropped ends at the next one.
+static bool rx_starts(app_tasks_t *tasks,
+                      const sl_btmesh_evt_vendor_model_receive_t *rx_evt)
+{
+  bool starts = !tasks->rx_open
+                || tasks->rx_open_source != rx_evt->source_address
+                || tasks->rx_open_opcode != rx_evt->opcode;
+
+  tasks->rx_open = !rx_evt->final;
+  tasks->rx_open_source = rx_evt->source_address;
+  tasks->rx_open_opcode = rx_evt->opcode;
+  return starts;
+}
+
+// Copy the header and the part of the payload from @p offset. Only the last
+// part keeps the final flag of the event, only the first one @p first.
+static void copy_rx(app_rx_msg_t *msg,
+                    const sl_btmesh_evt_vendor_model_receive_t *rx_evt,
+                    uint16_t offset,
+                    bool first,
+                    uint64_t rx_ms)
+{
+  uint16_t len = rx_evt->payload.len - offset;
+
+  if (len > APP_RX_PAYLOAD_MAX) {
+    len = APP_RX_PAYLOAD_MAX;
+  }
+  msg->elem_index = rx_evt->elem_index;
+  msg->vendor_id = rx_evt->vendor_id;
+  msg->model_id = rx_evt->model_id;
+  msg->source_address = rx_evt->source_address;
+  msg->destination_address = rx_evt->destination_address;
+  msg->va_index = rx_evt->va_index;
+  msg->appkey_index = rx_evt->appkey_index;
+  msg->nonrelayed = rx_evt->nonrelayed;
+  msg->opcode = rx_evt->opcode;
+  msg->first = first && offset == 0;
+  msg->final = offset + len == rx_evt->payload.len ? rx_evt->final : 0;
+  msg->len = (uint8_t)len;
+  memcpy(msg->data, &rx_evt->payload.data[offset], len);
+  msg->rx_ms = rx_ms;
+}
+
+void app_tasks_log_rx(const app_rx_msg_t *msg)
+{
+  char hex[APP_RX_PAYLOAD_MAX * 3 + 1];
+
+  for (int i = 0; i < msg->len; i++) {
+    snprintf(&hex[i * 3], 4, "%x ", msg->data[i]);
+  }
+  hex[msg->len * 3] = '\0';
+
+  APP_TASK_LOG("Vendor model data received.\r\n\t"
+               "Element index = %d\r\n\t"
+               "Vendor id = 0x%04X\r\n\t"
+               "Model id = 0x%04X\r\n\t",
+               msg->elem_index,
+               msg->vendor_id,
+               msg->model_id);
+  APP_TASK_LOG("Source address = 0x%04X\r\n\t"
+               "Destination address = 0x%04X\r\n\t"
+               "Destination label UUID index = 0x%02X\r\n\t",
+               msg->source_address,
+               msg->destination_address,
+               msg->va_index);
+  APP_TASK_LOG("App key index = 0x%04X\r\n\t"
+               "Non-relayed = 0x%02X\r\n\t"
+               "Opcode = 0x%02X\r\n\t"
+               "Final = 0x%04X\r\n\t",
+               msg->appkey_index,
+               msg->nonrelayed,
+               msg->opcode,
+               msg->final);
+  APP_TASK_LOG("Payload: %s\r\n", hex);
+}
+
+#if defined(SL_CATALOG_KERNEL_PRESENT)
+
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#include "sl_btmesh_wstk_lcd.h"
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+#define WORKER_FLAG_RX                  0x1
+#define WORKER_FLAG_CMD                 0x2
+#define LOG_FLAG_LINE                   0x1
+
+// lcd_row value of a plain log line
+#define LOG_ROW_NONE                    0xFF
+
+#define WORKER_STACK_SIZE               2048
+#define LOG_STACK_SIZE                  1024
+
+typedef struct {
+  uint8_t lcd_row;
+  char text[APP_LOG_LINE_LEN];
+} app_log_line_t;
+
+_Static_assert((APP_RX_QUEUE_LEN & (APP_RX_QUEUE_LEN - 1)) == 0,
+               "rx_queue slot count must be a power of two");
+_Static_assert((APP_CMD_QUEUE_LEN & (APP_CMD_QUEUE_LEN - 1)) == 0,
+               "cmd_queue slot count must be a power of two");
+
+APP_QUEUE_DEFINE(log_queue, app_log_line_t, APP_LOG_QUEUE_LEN);
+APP_QUEUE_DEFINE(stack_log_queue, app_log_line_t, APP_STACK_LOG_QUEUE_LEN);
+
+static osThreadId_t log_task;
+
+static void worker_task_fn(void *arg)
+{
+  app_tasks_t *tasks = arg;
+  app_rx_msg_t *msg;
+  uint32_t cmd;
+
+  for (;;) {
+    osThreadFlagsWait(WORKER_FLAG_RX | WORKER_FLAG_CMD,
+                      osFlagsWaitAny,
+                      osWaitForever);
+    // Messages are processed in place and released afterwards
+    while ((msg = app_queue_peek(&tasks->rx_queue)) != NULL) {
+      tasks->on_rx(tasks, msg);
+      app_queue_release(&tasks->rx_queue);
+    }
+    while (app_queue_pop(&tasks->cmd_queue, &cmd)) {
+      tasks->on_cmd(tasks, cmd);
+    }
+  }
+}
+
+// Write out the lines of @p q; returns false if it was empty
+static bool drain_log(app_queue_t *q)
+{
+  app_log_line_t *line;
+  bool any = false;
+
+  while ((line = app_queue_peek(q)) != NULL) {
+    if (line->lcd_row == LOG_ROW_NONE) {
+      app_log("%s", line->text);
+    } else {
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+      sl_btmesh_LCD_write(line->text, line->lcd_row);
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+    }
+    app_queue_release(q);
+    any = true;
+  }
+  return any;
+}
+
+static void log_task_fn(void *arg)
+{
+  (void)arg;
+
+  for (;;) {
+    osThreadFlagsWait(LOG_FLAG_LINE, osFlagsWaitAny, osWaitForever);
+    // Lines of one producer stay in order; the two are interleaved by line
+    while (drain_log(&stack_log_queue) | drain_log(&log_queue)) {
+    }
+  }
+}
+
+void app_tasks_init(app_tasks_t *tasks,
+                    app_telemetry_t *telemetry,
+                    app_tasks_rx_fn on_rx,
+                    app_tasks_cmd_fn on_cmd)
+{
+  static const osThreadAttr_t worker_attr = {
+    .name = "app_worker",
+    .stack_size = WORKER_STACK_SIZE,
+    .priority = osPriorityNormal,
+  };
+  static const osThreadAttr_t log_attr = {
+    .name = "app_log",
+    .stack_size = LOG_STACK_SIZE,
+    .priority = osPriorityLow,
+  };
+
+  memset(tasks, 0, sizeof(*tasks));
+  tasks->telemetry = telemetry;
+  tasks->on_rx = on_rx;
+  tasks->on_cmd = on_cmd;
+  tasks->rx_queue.slots = (uint8_t *)tasks->rx_slots;
+  tasks->rx_queue.slot_size = sizeof(app_rx_msg_t);
+  tasks->rx_queue.mask = APP_RX_QUEUE_LEN - 1;
+  tasks->cmd_queue.slots = (uint8_t *)tasks->cmd_slots;
+  tasks->cmd_queue.slot_size = sizeof(uint32_t);
+  tasks->cmd_queue.mask = APP_CMD_QUEUE_LEN - 1;
+  tasks->worker_task = osThreadNew(worker_task_fn, tasks, &worker_attr);
+  app_assert(tasks->worker_task != NULL, "Failed to create worker task\r\n");
+  // Every node of the chip shares the one log task
+  if (log_task == NULL) {
+    log_task = osThreadNew(log_task_fn, NULL, &log_attr);
+    app_assert(log_task != NULL, "Failed to create log task\r\n");
+  }
+}
+
+bool app_tasks_post_rx(app_tasks_t *tasks,
+                       const sl_btmesh_evt_vendor_model_receive_t *rx_evt)
+{
+  uint16_t parts = rx_parts(rx_evt);
+  bool first = rx_starts(tasks, rx_evt);
+  uint64_t rx_ms = app_time_ms();
+
+  // All parts or none, and once an event of a message is dropped its later
+  // events too, so the worker never sees a message with a hole
+  if ((tasks->rx_dropping && !first)
+      || APP_RX_QUEUE_LEN - app_queue_level(&tasks->rx_queue) < parts) {
+    tasks->rx_dropping = !rx_evt->final;
+    app_telemetry_count_drop(tasks->telemetry);
+    return false;
+  }
+  tasks->rx_dropping = false;
+  for (uint16_t i = 0; i < parts; i++) {
+    copy_rx(app_queue_claim(&tasks->rx_queue), rx_evt, i * APP_RX_PAYLOAD_MAX, first, rx_ms);
+    app_queue_commit(&tasks->rx_queue);
+  }
+  app_telemetry_queue_level(tasks->telemetry, (uint8_t)app_queue_level(&tasks->rx_queue));
+  osThreadFlagsSet(tasks->worker_task, WORKER_FLAG_RX);
+  return true;
+}
+
+bool app_tasks_post_cmd(app_tasks_t *tasks, uint32_t cmd)
+{
+  if (!app_queue_push(&tasks->cmd_queue, &cmd)) {
+    return false;
+  }
+  osThreadFlagsSet(tasks->worker_task, WORKER_FLAG_CMD);
+  return true;
+}
+
+static void queue_log(app_queue_t *q, const char *fmt, va_list args)
+{
+  app_log_line_t *line = app_queue_claim(q);
+
+  // Log lines are dropped rather than blocking the producer
+  if (line == NULL) {
+    return;
+  }
+  line->lcd_row = LOG_ROW_NONE;
+  vsnprintf(line->text, sizeof(line->text), fmt, args);
+  app_queue_commit(q);
+  osThreadFlagsSet(log_task, LOG_FLAG_LINE);
+}
+
+static void queue_lcd(app_queue_t *q, const char *text, uint8_t row)
+{
+  app_log_line_t *line = app_queue_claim(q);
+
+  if (line == NULL) {
+    return;
+  }
+  line->lcd_row = row;
+  strncpy(line->text, text, sizeof(line->text) - 1);
+  line->text[sizeof(line->text) - 1] = '\0';
+  app_queue_commit(q);
+  osThreadFlagsSet(log_task, LOG_FLAG_LINE);
+}
+
+void app_tasks_log(const char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  queue_log(&log_queue, fmt, args);
+  va_end(args);
+}
+
+void app_tasks_lcd(const char *text, uint8_t row)
+{
+  queue_lcd(&log_queue, text, row);
+}
+
+void app_tasks_stack_log(const char *fmt, ...)
+{
+  va_list args;
+
+  va_start(args, fmt);
+  queue_log(&stack_log_queue, fmt, args);
+  va_end(args);
+}
+
+void app_tasks_stack_lcd(const char *text, uint8_t row)
+{
+  queue_lcd(&stack_log_queue, text, row);
+}
+
+uint8_t app_tasks_log_room(void)
+{
+  return (uint8_t)(APP_LOG_QUEUE_LEN - app_queue_level(&log_queue));
+}
+
+#else // SL_CATALOG_KERNEL_PRESENT
+
+void app_tasks_init(app_tasks_t *tasks,
+                    app_telemetry_t *telemetry,
+                    app_tasks_rx_fn on_rx,
+                    app_tasks_cmd_fn on_cmd)
+{
+  memset(tasks, 0, sizeof(*tasks));
+  tasks->telemetry = telemetry;
+  tasks->on_rx = on_rx;
+  tasks->on_cmd = on_cmd;
+}
+
+bool app_tasks_post_rx(app_tasks_t *tasks,
+                       const sl_btmesh_evt_vendor_model_receive_t *rx_evt)
+{
+  app_rx_msg_t msg;
+  uint16_t parts = rx_parts(rx_evt);
+  bool first = rx_starts(tasks, rx_evt);
+  uint64_t rx_ms = app_time_ms();
+
+  for (uint16_t i = 0; i < parts; i++) {
+    copy_rx(&msg, rx_evt, i * APP_RX_PAYLOAD_MAX, first, rx_ms);
+    tasks->on_rx(tasks, &msg);
+  }
+  return true;
+}
+
+bool app_tasks_post_cmd(app_tasks_t *tasks, uint32_t cmd)
+{
+  tasks->on_cmd(tasks, cmd);
+  return true;
+}
+
+uint8_t app_tasks_log_room(void)
+{
+  return APP_LOG_QUEUE_LEN;
+}
+
+#endif // SL_CATALOG_KERNEL_PRESENT
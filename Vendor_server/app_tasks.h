@@ -0,0 +1,162 @@
+/***************************************************************************//**
+ * @file app_tasks.h
+ * @brief Split of stack event handling and application processing.
+ *
+ * With a kernel (SL_CATALOG_KERNEL_PRESENT) the stack event callbacks only
+ * copy vendor messages and application commands into lock-free queues. A
+ * worker task decodes, stores and publishes, and a low-priority task writes
+ * the log and the LCD. Without a kernel the same worker callbacks are
+ * called inline from the stack callbacks.
+ *
+ * Every queue has exactly one producer and one consumer. The log task is
+ * the only writer of the UART and the LCD: the worker hands it lines with
+ * APP_TASK_LOG/APP_TASK_LCD, the stack event handlers with
+ * APP_STACK_LOG/APP_STACK_LCD, each through a queue of its own.
+ *
+ * The worker and its queues live in an app_tasks_t owned by the caller, so a
+ * host simulation can run many nodes in one process. The log task and its
+ * queues belong to the chip, which has one UART and one LCD.
+ ******************************************************************************/
+
+#ifndef APP_TASKS_H
+#define APP_TASKS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_component_catalog.h"
+#include "sl_btmesh_api.h"
+#include "app_log.h"
+#include "app_queue.h"
+#include "app_telemetry.h"
+
+#if defined(SL_CATALOG_KERNEL_PRESENT)
+#include "cmsis_os2.h"
+#endif // SL_CATALOG_KERNEL_PRESENT
+
+// Largest vendor payload copied into one worker queue slot. A longer
+// payload takes several slots, all but the last with final cleared.
+#define APP_RX_PAYLOAD_MAX              40
+
+// Queue depths, must be powers of two
+#define APP_RX_QUEUE_LEN                8
+#define APP_CMD_QUEUE_LEN               8
+#define APP_LOG_QUEUE_LEN               16
+#define APP_STACK_LOG_QUEUE_LEN         8
+
+// Length of one deferred log line or LCD text
+#define APP_LOG_LINE_LEN                128
+
+// Copy of a sl_btmesh_evt_vendor_model_receive_t owned by the worker, with
+// the time it came in, before any wait in the worker queue
+typedef struct {
+  uint16_t elem_index;
+  uint16_t vendor_id;
+  uint16_t model_id;
+  uint16_t source_address;
+  uint16_t destination_address;
+  int8_t va_index;
+  uint16_t appkey_index;
+  uint8_t nonrelayed;
+  uint8_t opcode;
+  uint8_t first;                        // first part of a message
+  uint8_t final;
+  uint8_t len;
+  uint8_t data[APP_RX_PAYLOAD_MAX];
+  uint64_t rx_ms;                       // app_time_ms() at the stack event
+} app_rx_msg_t;
+
+typedef struct app_tasks app_tasks_t;
+
+// Worker callbacks, implemented by the application
+typedef void (*app_tasks_rx_fn)(app_tasks_t *tasks, const app_rx_msg_t *msg);
+typedef void (*app_tasks_cmd_fn)(app_tasks_t *tasks, uint32_t cmd);
+
+struct app_tasks {
+  app_telemetry_t *telemetry;           // counters of the node
+  app_tasks_rx_fn on_rx;
+  app_tasks_cmd_fn on_cmd;
+  // Source and opcode of the previous event if its message goes on in the next
+  bool rx_open;
+  uint16_t rx_open_source;
+  uint8_t rx_open_opcode;
+#if defined(SL_CATALOG_KERNEL_PRESENT)
+  bool rx_dropping;                     // rest of a message that lost an event
+  app_queue_t rx_queue;
+  app_rx_msg_t rx_slots[APP_RX_QUEUE_LEN];
+  app_queue_t cmd_queue;
+  uint32_t cmd_slots[APP_CMD_QUEUE_LEN];
+  osThreadId_t worker_task;
+#endif // SL_CATALOG_KERNEL_PRESENT
+};
+
+/***************************************************************************//**
+ * Create the worker task of @p tasks, and the log task on the first call.
+ * Call from app_init(). Messages dropped for a full worker queue and the
+ * queue fill level are counted in @p telemetry.
+ ******************************************************************************/
+void app_tasks_init(app_tasks_t *tasks,
+                    app_telemetry_t *telemetry,
+                    app_tasks_rx_fn on_rx,
+                    app_tasks_cmd_fn on_cmd);
+
+/***************************************************************************//**
+ * Hand a received vendor message to the worker, in parts of at most
+ * APP_RX_PAYLOAD_MAX bytes. Called from the mesh event handler only.
+ * Returns false if the message was dropped.
+ ******************************************************************************/
+bool app_tasks_post_rx(app_tasks_t *tasks,
+                       const sl_btmesh_evt_vendor_model_receive_t *rx_evt);
+
+/***************************************************************************//**
+ * Hand an application command (external signal bits) to the worker. Called
+ * from the Bluetooth event handler only.
+ ******************************************************************************/
+bool app_tasks_post_cmd(app_tasks_t *tasks, uint32_t cmd);
+
+/***************************************************************************//**
+ * Log the header fields and payload of a received message. Worker only.
+ ******************************************************************************/
+void app_tasks_log_rx(const app_rx_msg_t *msg);
+
+/***************************************************************************//**
+ * Lines APP_TASK_LOG can queue without dropping any. Without a kernel the
+ * lines go out directly and this is APP_LOG_QUEUE_LEN. Worker only.
+ ******************************************************************************/
+uint8_t app_tasks_log_room(void);
+
+#if defined(SL_CATALOG_KERNEL_PRESENT)
+
+/***************************************************************************//**
+ * Queue a log line or LCD text for the log task. Worker task only.
+ ******************************************************************************/
+void app_tasks_log(const char *fmt, ...);
+void app_tasks_lcd(const char *text, uint8_t row);
+
+/***************************************************************************//**
+ * Queue a log line or LCD text for the log task. Bluetooth and mesh event
+ * handlers only.
+ ******************************************************************************/
+void app_tasks_stack_log(const char *fmt, ...);
+void app_tasks_stack_lcd(const char *text, uint8_t row);
+
+#define APP_TASK_LOG(...)               app_tasks_log(__VA_ARGS__)
+#define APP_STACK_LOG(...)              app_tasks_stack_log(__VA_ARGS__)
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#define APP_TASK_LCD(text, row)         app_tasks_lcd(text, row)
+#define APP_STACK_LCD(text, row)        app_tasks_stack_lcd(text, row)
+#else
+// Like lcd_print(), the row names only exist with the LCD component
+#define APP_TASK_LCD(text, row)         ((void)0)
+#define APP_STACK_LCD(text, row)        ((void)0)
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+#else // SL_CATALOG_KERNEL_PRESENT
+
+#define APP_TASK_LOG(...)               app_log(__VA_ARGS__)
+#define APP_TASK_LCD(text, row)         lcd_print(text, row)
+#define APP_STACK_LOG(...)              app_log(__VA_ARGS__)
+#define APP_STACK_LCD(text, row)        lcd_print(text, row)
+
+#endif // SL_CATALOG_KERNEL_PRESENT
+
+#endif // APP_TASKS_H
@@ -42,9 +42,24 @@
 
 #define MY_VENDOR_SERVER_ID             0x1111
 
-#define NUMBER_OF_OPCODES               1
+#define NUMBER_OF_OPCODES               11
 
 #define sensor_status                   0x1
+#define uptime_status                   0x3
+#define led_state                       0x4
+#define telemetry_status                0x5
+#define relay_advert                    0x6
+#define mssv_list                       0x7
+#define led_snapshot_get                0x8
+#define led_snapshot                    0x9
+#define multi_record                    0xA
+#define ctrl_command                    0xB
+#define ctrl_ack                        0xC
+#define bulk_chunk                      0xD
+#define bulk_ack                        0xE
+#define blob_transfer                   0xF
+#define blob_status                     0x10
+#define time_beacon                     0x11
 
 typedef struct {
   uint16_t elem_index;
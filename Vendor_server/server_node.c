@@ -0,0 +1,901 @@
+/***************************************************************************//**
+ * @file server_node.c
+ * @brief Mesh side of the vendor server node: event dispatch, the data
+ *        handlers and the control plane.
+ ******************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include <stddef.h>
+#include "app_assert.h"
+#include "app_log.h"
+#include "sl_status.h"
+#include "gatt_db.h"
+
+#include "sl_btmesh_api.h"
+#include "sl_bt_api.h"
+
+#include "my_model_def.h"
+#include "server_node.h"
+#include "app_profile.h"
+#include "app_mssv.h"
+#include "app_tlv.h"
+#include "app_ctrl.h"
+#include "app_hops.h"
+
+// Interval at which subscriptions are advertised to relays; shorter than the
+// relay filter aging so learned groups never expire while we are alive
+#define RELAY_ADVERT_PERIOD_MS                      (5 * 60 * 1000)
+// Groups carried by one advertisement
+#define RELAY_ADVERT_MAX_GROUPS                     8
+
+/// Length of the display name buffer
+#define NAME_BUF_LEN                   20
+
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#include "sl_btmesh_wstk_lcd.h"
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+#ifdef SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+#define lcd_print(...) sl_btmesh_LCD_write(__VA_ARGS__)
+#else
+#define lcd_print(...)
+#endif // SL_CATALOG_BTMESH_WSTK_LCD_PRESENT
+
+static my_model_t my_model = {
+  .elem_index = PRIMARY_ELEMENT,
+  .vendor_id = VENDOR_ID,
+  .model_id = MY_VENDOR_SERVER_ID,
+  .publish = 1,
+  .opcodes_len = NUMBER_OF_OPCODES,
+  .opcodes_data[0] = sensor_status,
+  .opcodes_data[1] = telemetry_status,
+  .opcodes_data[2] = relay_advert,
+  .opcodes_data[3] = mssv_list,
+  .opcodes_data[4] = led_state,
+  .opcodes_data[5] = led_snapshot_get,
+  .opcodes_data[6] = uptime_status,
+  .opcodes_data[7] = multi_record,
+  .opcodes_data[8] = ctrl_ack,
+  .opcodes_data[9] = bulk_chunk,
+  .opcodes_data[10] = blob_status
+};
+
+// Most payload bytes one send or set_publication command takes
+#define LED_SNAPSHOT_PART_LEN                       255
+
+// Node that owns the module instance @p ptr, a member @p member of it
+#define NODE_OF(ptr, member) \
+  ((server_node_t *)((uint8_t *)(ptr) - offsetof(server_node_t, member)))
+
+// Configuration pushed to all clients by a very long press of button 0, in
+// APP_BLOB_ENTRY_LEN byte entries: a 10 s period in the step-resolution
+// format and a send-on-delta threshold of 0.5
+static const uint8_t config_blob[] = {
+  APP_CTRL_SET_PERIOD, 0x4A, 0x00,
+  APP_CTRL_SET_DELTA,  0x05, 0x00,
+};
+
+static void initialize_server_settings(server_node_t *node);
+static void advertise_groups(server_node_t *node);
+static void refresh_led_lcd(server_node_t *node);
+static void dispatch(server_node_t *node, const app_rx_msg_t *msg, const uint8_t *data, uint8_t len);
+static void handle_sensor(const uint8_t *data, uint8_t len);
+static void handle_led(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len);
+static bool store_sensor(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len);
+static void handle_uptime(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len);
+static void handle_multi_record(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len);
+static void send_led_snapshot(server_node_t *node, uint16_t destination, uint16_t appkey_index);
+static sl_status_t send_control(app_fanout_t *fanout,
+                                uint16_t destination,
+                                const uint8_t *data,
+                                uint8_t len);
+static sl_status_t send_bulk_ack(app_bulk_rx_t *bulk,
+                                 uint16_t destination,
+                                 const uint8_t *data,
+                                 uint8_t len);
+static sl_status_t send_blob(app_blob_tx_t *blob,
+                             uint16_t destination,
+                             const uint8_t *data,
+                             uint8_t len);
+static void send_time_beacon(server_node_t *node);
+static void on_bulk_done(app_bulk_rx_t *bulk,
+                         uint16_t source,
+                         const uint8_t *records,
+                         uint16_t len,
+                         uint32_t elapsed_ms);
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg);
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd);
+
+void server_node_init(server_node_t *node)
+{
+  app_capture_init(&node->capture);
+  app_telemetry_init(&node->telemetry);
+  app_telemetry_table_init(&node->telemetry_table);
+  app_reasm_init(&node->reasm);
+  app_tasks_init(&node->tasks, &node->telemetry, worker_on_rx, worker_on_cmd);
+  app_led_init(&node->led);
+}
+
+/***************************************************************************//**
+ * Set device name in the GATT database. A unique name is generated using
+ * the two last bytes from the Bluetooth address of this device. Name is also
+ * displayed on the LCD.
+ *
+ * @param[in] addr  Pointer to Bluetooth address.
+ ******************************************************************************/
+static void set_device_name(bd_addr *addr)
+{
+  char name[NAME_BUF_LEN];
+  sl_status_t result;
+
+  // Create unique device name using the last two bytes of the Bluetooth address
+  snprintf(name, NAME_BUF_LEN, "Server %02x:%02x",
+           addr->addr[1], addr->addr[0]);
+
+  APP_STACK_LOG("Device name: '%s'\r\n", name);
+
+  result = sl_bt_gatt_server_write_attribute_value(gattdb_device_name,
+                                                   0,
+                                                   strlen(name),
+                                                   (uint8_t *)name);
+  if(result) {
+    APP_STACK_LOG("sl_bt_gatt_server_write_attribute_value() failed, code %lx\r\n", result);
+  }
+
+  // Show device name on the LCD
+  APP_STACK_LCD(name, SL_BTMESH_WSTK_LCD_ROW_NAME_CFG_VAL);
+}
+
+void server_node_on_mesh_event(server_node_t *node, sl_btmesh_msg_t *evt)
+{
+  sl_status_t sc;
+  switch (SL_BT_MSG_ID(evt->header)) {
+    case sl_btmesh_evt_node_initialized_id:
+      APP_STACK_LOG("Node initialized ...\r\n");
+      sc = sl_btmesh_vendor_model_init(my_model.elem_index,
+                                       my_model.vendor_id,
+                                       my_model.model_id,
+                                       my_model.publish,
+                                       my_model.opcodes_len,
+                                       my_model.opcodes_data);
+      app_assert_status_f(sc, "Failed to initialize vendor model\r\n");
+      bd_addr address;
+      uint8_t address_type;
+      sc = sl_bt_system_get_identity_address(&address, &address_type);
+      app_assert_status_f(sc, "Failed to get Bluetooth address\r\n");
+      set_device_name(&address);
+
+      if(evt->data.evt_node_initialized.provisioned) {
+        APP_STACK_LOG("Node already provisioned.\r\n");
+        initialize_server_settings(node);
+        APP_STACK_LCD("Node ready", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      } else {
+        APP_STACK_LOG("Node unprovisioned\r\n");
+        // Start unprovisioned Beaconing using PB-ADV and PB-GATT Bearers
+        APP_STACK_LOG("Send unprovisioned beacons.\r\n");
+        APP_STACK_LCD("Node unprovisioned", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+//        sc = sl_btmesh_node_start_unprov_beaconing(PB_ADV | PB_GATT);
+//        app_assert_status_f(sc, "Failed to start unprovisioned beaconing\r\n");
+      }
+      break;
+
+    // -------------------------------
+    // Provisioning Events
+    case sl_btmesh_evt_node_provisioned_id:
+      APP_STACK_LOG("Provisioning done. Address: 0x%04x, IV Index: 0x%lx\r\n",
+                    evt->data.evt_node_provisioned.address,
+                    evt->data.evt_node_provisioned.iv_index);
+      initialize_server_settings(node);
+      APP_STACK_LCD("Provisioning done", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_provisioning_failed_id:
+      APP_STACK_LOG("Provisioning failed. Result = 0x%04x\r\n",
+                    evt->data.evt_node_provisioning_failed.result);
+      APP_STACK_LCD("Provisioning failed", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_provisioning_started_id:
+      APP_STACK_LOG("Provisioning started.\r\n");
+      APP_STACK_LCD("Provisioning...", SL_BTMESH_WSTK_LCD_ROW_STATUS_CFG_VAL);
+      break;
+
+    case sl_btmesh_evt_node_key_added_id:
+      APP_STACK_LOG("Got new %s key with index %x\r\n",
+                    evt->data.evt_node_key_added.type == 0 ? "network " : "application ",
+                    evt->data.evt_node_key_added.index);
+      break;
+
+    case sl_btmesh_evt_node_config_set_id:
+      APP_STACK_LOG("evt_node_config_set_id\r\n\t");
+      break;
+
+    case sl_btmesh_evt_node_model_config_changed_id:
+      APP_STACK_LOG("Model config changed, type: %d, elem_addr: %x, model_id: %x, vendor_id: %x\r\n",
+                    evt->data.evt_node_model_config_changed.node_config_state,
+                    evt->data.evt_node_model_config_changed.element_address,
+                    evt->data.evt_node_model_config_changed.model_id,
+                    evt->data.evt_node_model_config_changed.vendor_id);
+      // Subscriptions or publication of our model changed: tell the relays
+      if (node->address != 0
+          && evt->data.evt_node_model_config_changed.model_id == my_model.model_id) {
+        sl_bt_external_signal(EX_ADVERT);
+      }
+      break;
+
+    // -------------------------------
+    // Handle vendor model messages
+    case sl_btmesh_evt_vendor_model_receive_id:
+      app_telemetry_count_rx(&node->telemetry);
+      app_capture_rx(&node->capture, (sl_btmesh_evt_vendor_model_receive_t *)&evt->data);
+      app_tasks_post_rx(&node->tasks, (sl_btmesh_evt_vendor_model_receive_t *)&evt->data);
+      break;
+
+    // -------------------------------
+    // Default event handler.
+    default:
+      break;
+  }
+}
+
+/**************************************************************************//**
+ * Process a received vendor message. Runs in the worker task with a kernel,
+ * inline from server_node_on_mesh_event() otherwise.
+ *****************************************************************************/
+static void worker_on_rx(app_tasks_t *tasks, const app_rx_msg_t *msg)
+{
+  server_node_t *node = NODE_OF(tasks, tasks);
+  const uint8_t *data;
+  uint8_t len;
+
+  // Parts of a longer message are collected first
+  if (!app_reasm_feed(&node->reasm, msg, &data, &len)) {
+    return;
+  }
+  if (data != msg->data) {
+    APP_TASK_LOG("Reassembled %u bytes from 0x%04X\r\n", len, msg->source_address);
+  }
+  dispatch(node, msg, data, len);
+  app_reasm_release(&node->reasm, data);
+}
+
+/**************************************************************************//**
+ * Handle a complete message for @p node. @p data points into @p msg or into
+ * the reassembly buffer; @p msg carries the header fields.
+ *****************************************************************************/
+static void dispatch(server_node_t *node, const app_rx_msg_t *msg, const uint8_t *data, uint8_t len)
+{
+  // Feed the loss measurement with everything that came in; telemetry
+  // reports carry the sender's count
+  if (msg->opcode == telemetry_status
+      && len >= sizeof(app_telemetry_status_t)
+      && data[offsetof(app_telemetry_status_t, version)] == APP_TELEMETRY_VERSION) {
+    uint32_t tx_count;
+    memcpy(&tx_count, &data[offsetof(app_telemetry_status_t, tx_count)], sizeof(tx_count));
+    app_nettx_on_telemetry(&node->nettx, msg->source_address, tx_count);
+  } else {
+    app_nettx_on_rx(&node->nettx, msg->source_address, msg->destination_address);
+  }
+
+  // Other servers' subscription adverts are only of interest to relays
+  if (msg->opcode == relay_advert) {
+    return;
+  }
+  // Acks only feed the control fan-out; they carry no data
+  if (msg->opcode == ctrl_ack) {
+    app_fanout_on_ack(&node->fanout, msg->source_address, data, len);
+    return;
+  }
+  // Chunks of a log upload go to their session, not to the sensor path
+  if (msg->opcode == bulk_chunk) {
+    app_bulk_rx_on_chunk(&node->bulk, msg->source_address, data, len);
+    return;
+  }
+  if (msg->opcode == blob_status) {
+    app_blob_tx_on_status(&node->blob, msg->source_address, data, len);
+    return;
+  }
+  // Snapshot requests carry no data either; answer them straight away
+  if (msg->opcode == led_snapshot_get) {
+    send_led_snapshot(node, msg->source_address, msg->appkey_index);
+    return;
+  }
+
+  // Only sensor readings repeat unchanged; every other message is handled
+  if (msg->opcode == sensor_status
+      && !store_sensor(node, msg->source_address, data, len)) {
+    APP_TASK_LOG("Duplicate payload detected, skipping processing.\r\n");
+    app_telemetry_count_drop(&node->telemetry);
+    app_nettx_on_duplicate(&node->nettx);
+    return;
+  }
+
+  app_tasks_log_rx(msg);
+
+  switch (msg->opcode) {
+    case sensor_status:
+      // Nodes that report are the ones the control plane addresses
+      app_fanout_note_node(&node->fanout, msg->source_address);
+      app_blob_tx_note_node(&node->blob, msg->source_address);
+      handle_sensor(data, len);
+      break;
+
+    case telemetry_status:
+      app_telemetry_on_status(&node->telemetry_table, msg->source_address, data, len);
+      break;
+
+    case led_state:
+      handle_led(node, msg->source_address, data, len);
+      break;
+
+    case uptime_status:
+      handle_uptime(node, msg->source_address, data, len);
+      break;
+
+    case multi_record:
+      handle_multi_record(node, msg->source_address, data, len);
+      break;
+
+    case mssv_list: {
+      uint32_t ids[APP_MSSV_MAX_IDS];
+      uint8_t count = app_mssv_unpack(data, len, ids, APP_MSSV_MAX_IDS);
+      if (count == 0) {
+        APP_TASK_LOG("Malformed MSSV list, length %u\r\n", len);
+        break;
+      }
+      APP_TASK_LOG("MSSV list from 0x%04X, %u IDs:\r\n", msg->source_address, count);
+      for (uint8_t i = 0; i < count; i++) {
+        APP_TASK_LOG("  %08lu\r\n", (unsigned long)ids[i]);
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+}
+
+/**************************************************************************//**
+ * Store a sensor_status payload of @p source unless it repeats the last one
+ * from the same sender.
+ *
+ * @return false if the payload is a duplicate
+ *****************************************************************************/
+static bool store_sensor(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  int slot = -1;
+  bool is_duplicate;
+
+  if (len != APP_SENSOR_PACKED_LEN) {
+    // Malformed; let the handler report it
+    return true;
+  }
+  for (int i = 0; i < SENSOR_SOURCES; i++) {
+    if (node->sensor_sources[i].address == source) {
+      slot = i;
+      break;
+    }
+  }
+  is_duplicate = slot >= 0
+                 && memcmp(node->sensor_sources[slot].data, data, APP_SENSOR_PACKED_LEN) == 0;
+  app_telemetry_count_dup_lookup(&node->telemetry, is_duplicate);
+  if (is_duplicate) {
+    return false;
+  }
+  if (slot < 0) {
+    // Take over the oldest slot
+    slot = node->sensor_next_slot;
+    node->sensor_next_slot = (node->sensor_next_slot + 1) % SENSOR_SOURCES;
+    node->sensor_sources[slot].address = source;
+  }
+  memcpy(node->sensor_sources[slot].data, data, APP_SENSOR_PACKED_LEN);
+
+  uint64_t data_value = 0;
+  for (int i = 0; i < APP_SENSOR_PACKED_LEN; i++) {
+    data_value = (data_value << 8) | data[i];
+  }
+  node->store_data[node->store_state] = data_value;
+  if (node->store_state < 7) node->store_state++;
+  else node->store_state = 0;
+  APP_TASK_LOG("New data stored.\r\n");
+  return true;
+}
+
+/**************************************************************************//**
+ * Log a sensor_status payload.
+ *****************************************************************************/
+static void handle_sensor(const uint8_t *data, uint8_t len)
+{
+  app_sensor_sample_t sample;
+  if (!app_sensor_unpack(data, len, &sample)) {
+    APP_TASK_LOG("Malformed sensor payload, length %u\r\n", len);
+    return;
+  }
+  int32_t temperature = sample.temperature;
+  int32_t humidity = sample.humidity;
+  APP_TASK_LOG("Temperature = %ld.%1ld Celsius\r\n",
+               temperature / 1000,
+               temperature % 1000);
+
+  float temp = (float) (temperature / 1000);
+  temp = temp * 1.8 + 32;
+  temperature = (int32_t) (temp * 1000);
+  APP_TASK_LOG("Temperature = %ld.%1ld Fahrenheit\r\n",
+               temperature / 1000,
+               temperature % 1000);
+
+  APP_TASK_LOG("Humidity = %ld %%\r\n",
+               humidity / 1000);
+}
+
+/**************************************************************************//**
+ * Store the LED bits of @p source and redraw the LCD if they changed.
+ *****************************************************************************/
+static void handle_led(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  if (len >= 1 && app_led_update(&node->led, source, data[0])) {
+    APP_TASK_LOG("LED state of 0x%04X changed to %u%u\r\n",
+                 source,
+                 (data[0] >> 1) & 1,
+                 data[0] & 1);
+    refresh_led_lcd(node);
+  }
+}
+
+/**************************************************************************//**
+ * Decode an uptime message with the state @p node keeps for @p source.
+ *****************************************************************************/
+static void handle_uptime(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint32_t uptime_s;
+  int slot = -1;
+
+  for (int i = 0; i < UPTIME_SOURCES; i++) {
+    if (node->uptime_sources[i].address == source) {
+      slot = i;
+      break;
+    }
+  }
+  if (slot < 0) {
+    // Take over the oldest slot; the new sender starts without a base
+    slot = node->uptime_next_slot;
+    node->uptime_next_slot = (node->uptime_next_slot + 1) % UPTIME_SOURCES;
+    memset(&node->uptime_sources[slot], 0, sizeof(node->uptime_sources[slot]));
+    node->uptime_sources[slot].address = source;
+  }
+  if (!app_time_decode_uptime(&node->uptime_sources[slot].dec, data, len, &uptime_s)) {
+    APP_TASK_LOG("Uptime of 0x%04X not decodable yet\r\n", source);
+    return;
+  }
+  APP_TASK_LOG("Uptime of 0x%04X: %lu s\r\n", source, (unsigned long)uptime_s);
+}
+
+/**************************************************************************//**
+ * Dispatch every record of a multi_record message to its handler.
+ *****************************************************************************/
+static void handle_multi_record(server_node_t *node, uint16_t source, const uint8_t *data, uint8_t len)
+{
+  uint8_t pos = 0;
+  uint8_t type;
+  const uint8_t *value;
+  uint8_t value_len;
+
+  while (app_tlv_next(data, len, &pos, &type, &value, &value_len)) {
+    switch (type) {
+      case APP_TLV_UPTIME:
+        handle_uptime(node, source, value, value_len);
+        break;
+      case APP_TLV_LED:
+        handle_led(node, source, value, value_len);
+        break;
+      case APP_TLV_SENSOR:
+        handle_sensor(value, value_len);
+        break;
+      default:
+        // Unknown records are skipped; their length is known
+        break;
+    }
+  }
+  if (pos != len) {
+    APP_TASK_LOG("Truncated multi_record from 0x%04X\r\n", source);
+  }
+}
+
+/**************************************************************************//**
+ * Process the external signals forwarded by sl_bt_on_event().
+ *****************************************************************************/
+static void worker_on_cmd(app_tasks_t *tasks, uint32_t cmd)
+{
+  server_node_t *node = NODE_OF(tasks, tasks);
+
+  if (cmd & EX_B0_LONG_PRESS) {
+    app_profile_report();
+    app_reasm_report(&node->reasm);
+    app_capture_dump(&node->capture, node->address, EX_CAPTURE_DUMP);
+  }
+  if (cmd & EX_B0_PRESS) {
+    send_led_snapshot(node, 0, 0);
+  }
+  if (cmd & EX_B1_PRESS) {
+    app_telemetry_print_table(&node->telemetry, &node->telemetry_table);
+  }
+  if (cmd & EX_B1_LONG_PRESS) {
+    if (!app_fanout_start(&node->fanout, APP_CTRL_SAMPLE_NOW, 0)) {
+      APP_TASK_LOG("Control busy or no nodes known\r\n");
+    }
+  }
+  if (cmd & EX_FANOUT_TICK) {
+    app_fanout_process(&node->fanout);
+  }
+  if (cmd & EX_B0_VERYLONG_PRESS) {
+    if (!app_blob_tx_start(&node->blob, config_blob, sizeof(config_blob))) {
+      APP_TASK_LOG("Blob busy or no nodes known\r\n");
+    }
+  }
+  if (cmd & EX_BLOB_TICK) {
+    app_blob_tx_process(&node->blob);
+  }
+  if (cmd & EX_SYNC_BEACON) {
+    send_time_beacon(node);
+  }
+  if (cmd & EX_ADVERT) {
+    advertise_groups(node);
+  }
+  // the log queue may take the next lines of the capture dump
+  if (cmd & EX_CAPTURE_DUMP) {
+    app_capture_dump_process(&node->capture);
+  }
+  if (cmd & EX_B1_VERYLONG_PRESS) {
+    if (!app_fanout_start(&node->fanout, APP_CTRL_UPLOAD_LOG, 0)) {
+      APP_TASK_LOG("Control busy or no nodes known\r\n");
+    }
+  }
+  // The loss is on the paths from the sources, so a new level goes to them;
+  // while control is busy it is tried again after the next window
+  if (cmd & EX_NETTX_EVAL) {
+    if (app_nettx_evaluate(&node->nettx)) {
+      node->nettx_announce = true;
+    }
+    if (node->nettx_announce
+        && app_fanout_start(&node->fanout, APP_CTRL_SET_NETTX,
+                            app_nettx_level(&node->nettx))) {
+      node->nettx_announce = false;
+    }
+  }
+}
+
+/**************************************************************************//**
+ * Rewrite the LCD rows of the LED table whose nodes changed.
+ *****************************************************************************/
+static void refresh_led_lcd(server_node_t *node)
+{
+  char text[NAME_BUF_LEN];
+  uint8_t row;
+
+  while (app_led_next_dirty_row(&node->led, &row, text, sizeof(text))) {
+    APP_TASK_LCD(text, row);
+  }
+}
+
+/**************************************************************************//**
+ * Send the LED bitmap of all nodes in one message, to @p destination or to
+ * the publication group if it is 0.
+ *****************************************************************************/
+static void send_led_snapshot(server_node_t *node, uint16_t destination, uint16_t appkey_index)
+{
+  uint8_t *snapshot = node->snapshot_buf;
+  sl_status_t sc = SL_STATUS_OK;
+  uint16_t len = app_led_snapshot(&node->led, snapshot, sizeof(node->snapshot_buf));
+
+  // A command carries at most LED_SNAPSHOT_PART_LEN bytes; the stack
+  // collects the parts and sends the message with the final one
+  for (uint16_t at = 0; at < len && sc == SL_STATUS_OK; at += LED_SNAPSHOT_PART_LEN) {
+    uint16_t part = len - at > LED_SNAPSHOT_PART_LEN ? LED_SNAPSHOT_PART_LEN : len - at;
+    uint8_t final = at + part == len;
+
+    if (destination != 0) {
+      sc = sl_btmesh_vendor_model_send(destination,
+                                       -1,
+                                       appkey_index,
+                                       my_model.elem_index,
+                                       my_model.vendor_id,
+                                       my_model.model_id,
+                                       0,
+                                       led_snapshot,
+                                       final,
+                                       part,
+                                       &snapshot[at]);
+    } else {
+      sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
+                                                  my_model.vendor_id,
+                                                  my_model.model_id,
+                                                  led_snapshot,
+                                                  final,
+                                                  part,
+                                                  &snapshot[at]);
+    }
+  }
+  if (destination == 0) {
+    if (sc == SL_STATUS_OK) {
+      sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
+                                          my_model.vendor_id,
+                                          my_model.model_id);
+    }
+  }
+  app_capture_tx(&node->capture, led_snapshot, destination, appkey_index, snapshot, len, sc);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("LED snapshot error: 0x%04lX\r\n", sc);
+  } else {
+    APP_TASK_LOG("LED snapshot sent, %u bytes\r\n", len);
+  }
+}
+
+/**************************************************************************//**
+ * Send a ctrl_command for the control fan-out.
+ *****************************************************************************/
+static sl_status_t send_control(app_fanout_t *fanout,
+                                uint16_t destination,
+                                const uint8_t *data,
+                                uint8_t len)
+{
+  server_node_t *node = NODE_OF(fanout, fanout);
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination,
+                                   -1,
+                                   node->ctrl_appkey_index,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   ctrl_command,
+                                   1,
+                                   len,
+                                   data);
+  app_capture_tx(&node->capture, ctrl_command, destination, node->ctrl_appkey_index, data, len, sc);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  return sc;
+}
+
+/**************************************************************************//**
+ * Send a bulk_ack for a log upload.
+ *****************************************************************************/
+static sl_status_t send_bulk_ack(app_bulk_rx_t *bulk,
+                                 uint16_t destination,
+                                 const uint8_t *data,
+                                 uint8_t len)
+{
+  server_node_t *node = NODE_OF(bulk, bulk);
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination,
+                                   -1,
+                                   node->ctrl_appkey_index,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   bulk_ack,
+                                   1,
+                                   len,
+                                   data);
+  app_capture_tx(&node->capture, bulk_ack, destination, node->ctrl_appkey_index, data, len, sc);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  return sc;
+}
+
+/**************************************************************************//**
+ * Send a blob_transfer for the blob distribution.
+ *****************************************************************************/
+static sl_status_t send_blob(app_blob_tx_t *blob,
+                             uint16_t destination,
+                             const uint8_t *data,
+                             uint8_t len)
+{
+  server_node_t *node = NODE_OF(blob, blob);
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination,
+                                   -1,
+                                   node->ctrl_appkey_index,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   blob_transfer,
+                                   1,
+                                   len,
+                                   data);
+  app_capture_tx(&node->capture, blob_transfer, destination, node->ctrl_appkey_index, data, len, sc);
+  app_telemetry_count_send(&node->telemetry, destination, sc);
+  return sc;
+}
+
+/**************************************************************************//**
+ * Send a time beacon to the control group, stamped just before the send.
+ *****************************************************************************/
+static void send_time_beacon(server_node_t *node)
+{
+  uint8_t beacon[APP_SYNC_BEACON_LEN];
+  sl_status_t sc;
+
+  app_sync_encode_beacon(&node->sync, beacon);
+  sc = sl_btmesh_vendor_model_send(APP_CTRL_GROUP_ADDR,
+                                   -1,
+                                   node->ctrl_appkey_index,
+                                   my_model.elem_index,
+                                   my_model.vendor_id,
+                                   my_model.model_id,
+                                   0,
+                                   time_beacon,
+                                   1,
+                                   sizeof(beacon),
+                                   beacon);
+  app_capture_tx(&node->capture, time_beacon, APP_CTRL_GROUP_ADDR,
+                 node->ctrl_appkey_index, beacon, sizeof(beacon), sc);
+  app_telemetry_count_send(&node->telemetry, APP_CTRL_GROUP_ADDR, sc);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Time beacon error: 0x%04lX\r\n", sc);
+  }
+}
+
+/**************************************************************************//**
+ * A client's sample log is in. Print the newest record and the transfer rate.
+ *****************************************************************************/
+static void on_bulk_done(app_bulk_rx_t *bulk,
+                         uint16_t source,
+                         const uint8_t *records,
+                         uint16_t len,
+                         uint32_t elapsed_ms)
+{
+  uint16_t count = len / APP_BULK_RECORD_LEN;
+  const uint8_t *last;
+  app_sensor_sample_t sample;
+  uint32_t uptime_s;
+
+  (void)bulk;
+  APP_TASK_LOG("Log of 0x%04X: %u records, %u bytes in %lu ms, %lu B/s\r\n",
+               source,
+               count,
+               len,
+               (unsigned long)elapsed_ms,
+               (unsigned long)(elapsed_ms != 0 ? (uint32_t)len * 1000u / elapsed_ms : 0));
+  if (count == 0) {
+    return;
+  }
+  last = &records[(count - 1) * APP_BULK_RECORD_LEN];
+  if (!app_sensor_unpack(last, APP_SENSOR_PACKED_LEN, &sample)) {
+    return;
+  }
+  uptime_s = (uint32_t)last[APP_SENSOR_PACKED_LEN]
+             | ((uint32_t)last[APP_SENSOR_PACKED_LEN + 1] << 8)
+             | ((uint32_t)last[APP_SENSOR_PACKED_LEN + 2] << 16)
+             | ((uint32_t)last[APP_SENSOR_PACKED_LEN + 3] << 24);
+  APP_TASK_LOG("  newest at %lu s: humidity %ld, temperature %ld (milli-units)\r\n",
+               (unsigned long)uptime_s,
+               (long)sample.humidity,
+               (long)sample.temperature);
+}
+
+/**************************************************************************//**
+ * Publish the groups this node subscribes to as a relay_advert message, so
+ * relays on the way only forward traffic that has a listener here. Worker
+ * only; other contexts raise EX_ADVERT.
+ *****************************************************************************/
+static void advertise_groups(server_node_t *node)
+{
+  sl_status_t sc;
+  uint8_t groups[RELAY_ADVERT_MAX_GROUPS * 2];
+  size_t len = 0;
+
+  sc = sl_btmesh_test_get_local_model_sub(my_model.elem_index,
+                                          my_model.vendor_id,
+                                          my_model.model_id,
+                                          sizeof(groups),
+                                          &len,
+                                          groups);
+  if (sc != SL_STATUS_OK || len == 0) {
+    return;
+  }
+  sc = sl_btmesh_vendor_model_set_publication(my_model.elem_index,
+                                              my_model.vendor_id,
+                                              my_model.model_id,
+                                              relay_advert,
+                                              1,
+                                              len,
+                                              groups);
+  if (sc == SL_STATUS_OK) {
+    sc = sl_btmesh_vendor_model_publish(my_model.elem_index,
+                                        my_model.vendor_id,
+                                        my_model.model_id);
+  }
+  app_capture_tx(&node->capture, relay_advert, 0, 0, groups, len, sc);
+  app_telemetry_count_publish(&node->telemetry, sc);
+  if (sc != SL_STATUS_OK) {
+    APP_TASK_LOG("Relay advert error: 0x%04lX\r\n", sc);
+  }
+}
+
+static void advert_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  sl_bt_external_signal(EX_ADVERT);
+}
+
+static void sync_timer_cb(app_timer_t *handle, void *data)
+{
+  (void)handle;
+  (void)data;
+  sl_bt_external_signal(EX_SYNC_BEACON);
+}
+
+/**************************************************************************//**
+ * Initialize server settings for the node.
+ * This function is called both for newly provisioned nodes and already provisioned nodes.
+ *****************************************************************************/
+static void initialize_server_settings(server_node_t *node)
+{
+  sl_status_t sc;
+  uint16_t pub_address;
+  uint8_t ttl, period, retrans, credentials;
+  
+  APP_STACK_LOG("Setting up server functionality...\r\n");
+  
+  // Enable relay functionality and set the network transmission state;
+  // both are retuned from the measured loss later on, here and at the
+  // sources
+  app_nettx_init(&node->nettx, true, EX_NETTX_EVAL);
+  
+  // If our address is not set yet (for already provisioned nodes), get it
+  if (node->address == 0) {
+    uint16_t node_address;
+    sc = sl_btmesh_node_get_element_address(my_model.elem_index, &node_address);
+    if (sc == SL_STATUS_OK) {
+      node->address = node_address;
+      APP_STACK_LOG("Got node address: 0x%04x\r\n", node->address);
+    } else {
+      APP_STACK_LOG("Failed to get node address, error: 0x%lx\r\n", sc);
+    }
+  }
+
+  // Let senders measure their distance to us
+  app_hops_publish();
+
+  // Control commands use the application key of our publication
+  sc = sl_btmesh_test_get_local_model_pub(my_model.elem_index,
+                                          my_model.vendor_id,
+                                          my_model.model_id,
+                                          &node->ctrl_appkey_index,
+                                          &pub_address,
+                                          &ttl,
+                                          &period,
+                                          &retrans,
+                                          &credentials);
+  if (sc != SL_STATUS_OK) {
+    node->ctrl_appkey_index = 0;
+  }
+  app_fanout_init(&node->fanout, send_control, EX_FANOUT_TICK);
+  app_bulk_rx_init(&node->bulk, send_bulk_ack, on_bulk_done);
+  app_blob_tx_init(&node->blob, send_blob, EX_BLOB_TICK);
+
+  sl_bt_external_signal(EX_ADVERT);
+  app_timer_stop(&node->advert_timer);
+  app_timer_start(&node->advert_timer,
+                  RELAY_ADVERT_PERIOD_MS,
+                  advert_timer_cb,
+                  NULL,
+                  true);
+
+  // We are the time source of the network
+  app_sync_init(&node->sync, true);
+  app_timer_stop(&node->sync_timer);
+  app_timer_start(&node->sync_timer,
+                  APP_SYNC_BEACON_PERIOD_MS,
+                  sync_timer_cb,
+                  NULL,
+                  true);
+
+  APP_STACK_LOG("Server initialization complete\r\n");
+}
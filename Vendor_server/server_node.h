@@ -0,0 +1,108 @@
+/***************************************************************************//**
+ * @file server_node.h
+ * @brief Mesh side of the vendor server node: event dispatch, the data
+ *        handlers and the control plane.
+ *
+ * Everything the server does with the mesh runs on a server_node_t, which
+ * holds the instances of the shared modules. app.c keeps what belongs to the
+ * chip: the boot, the buttons and the one node it runs, and hands the
+ * node the mesh events and the external signals.
+ *
+ * The node lives in a server_node_t owned by the caller, so a host
+ * simulation can run many servers in one process, each with its own host
+ * node entered.
+ ******************************************************************************/
+
+#ifndef SERVER_NODE_H
+#define SERVER_NODE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_btmesh_api.h"
+#include "app_timer.h"
+#include "app_sensor_codec.h"
+#include "app_telemetry.h"
+#include "app_time.h"
+#include "app_nettx.h"
+#include "app_reasm.h"
+#include "app_fanout.h"
+#include "app_bulk_rx.h"
+#include "app_blob_tx.h"
+#include "app_sync.h"
+#include "app_led.h"
+#include "app_tasks.h"
+#include "app_capture.h"
+
+// External signals of the node, handed to app_tasks_post_cmd()
+#define EX_B0_PRESS                                 ((1) << 5)
+#define EX_B1_PRESS                                 ((1) << 6)
+#define EX_B0_LONG_PRESS                            ((1) << 7)
+#define EX_B1_LONG_PRESS                            ((1) << 8)
+#define EX_FANOUT_TICK                              ((1) << 9)
+#define EX_B1_VERYLONG_PRESS                        ((1) << 10)
+#define EX_B0_VERYLONG_PRESS                        ((1) << 11)
+#define EX_BLOB_TICK                                ((1) << 12)
+#define EX_SYNC_BEACON                              ((1) << 13)
+#define EX_ADVERT                                   ((1) << 14)
+#define EX_CAPTURE_DUMP                             ((1) << 15)
+#define EX_NETTX_EVAL                               ((1) << 16)
+
+// Uptime decoder state is kept for this many of the most recent senders
+#define UPTIME_SOURCES                              8
+// Last sensor payload is kept for this many of the most recent senders
+#define SENSOR_SOURCES                              8
+
+// State of this node, with the instances of the shared modules. Everything
+// below the stack callbacks takes it as a context instead of reaching for
+// file statics, so it does not care how many nodes there are.
+typedef struct {
+  uint16_t address;
+  // Application key of our publication, also used for control commands
+  uint16_t ctrl_appkey_index;
+  // Last sensor payload of each sender, for duplicate detection
+  struct {
+    uint16_t address;
+    uint8_t data[APP_SENSOR_PACKED_LEN];
+  } sensor_sources[SENSOR_SOURCES];
+  uint8_t sensor_next_slot;
+  // The last eight payloads received
+  uint64_t store_data[8];
+  uint8_t store_state;
+  struct {
+    uint16_t address;
+    app_time_uptime_dec_t dec;
+  } uptime_sources[UPTIME_SOURCES];
+  uint8_t uptime_next_slot;
+  app_telemetry_t telemetry;
+  app_telemetry_table_t telemetry_table;
+  app_nettx_t nettx;
+  // The sources have not acked the current network transmit level yet
+  bool nettx_announce;
+  app_reasm_t reasm;
+  app_fanout_t fanout;
+  app_bulk_rx_t bulk;
+  app_blob_tx_t blob;
+  app_sync_t sync;
+  app_led_t led;
+  // The LED snapshot being sent, too large for the worker stack
+  uint8_t snapshot_buf[APP_LED_SNAPSHOT_MAX_LEN];
+  app_tasks_t tasks;
+#if APP_CAPTURE_ENABLE
+  app_capture_t capture;
+#endif
+  app_timer_t advert_timer;
+  app_timer_t sync_timer;
+} server_node_t;
+
+/***************************************************************************//**
+ * Set up the modules of @p node and its worker. Call from app_init(), after
+ * app_time_init().
+ ******************************************************************************/
+void server_node_init(server_node_t *node);
+
+/***************************************************************************//**
+ * Handle an event of the Bluetooth Mesh stack.
+ ******************************************************************************/
+void server_node_on_mesh_event(server_node_t *node, sl_btmesh_msg_t *evt);
+
+#endif // SERVER_NODE_H
@@ -1,9 +1,15 @@
 #include "sl_btmesh_api.h"
 #include "sl_simple_button_instances.h"
 #include "sl_sleeptimer.h"
+#include "app_timer.h"
 #include "my_model_def.h"
 #include "app.h"
 #include "app_log.h"
+#include "app_profile.h"
+#include "app_mssv.h"
+#include "app_time.h"
+#include "app_tlv.h"
+#include "app_action.h"
 
 // Vendor model info
 static uint16_t elem_index = 0;
@@ -14,12 +20,69 @@ static uint16_t model_id  = MY_CLIENT_MODEL_ID;
 static uint8_t led0 = 0;
 static uint8_t led1 = 0;
 
+// LED tự đảo mỗi 5 s; chỉ gửi khi trạng thái đổi hoặc tới hạn keep-alive
+#define LED_TOGGLE_PERIOD_MS    5000
+#define LED_KEEPALIVE_MS        60000
+// Uptime yêu cầu trong khoảng này trước lần đảo LED kế tiếp sẽ gửi cùng lúc
+#define COALESCE_WINDOW_MS      500
+
+static app_timer_t led_timer;
+static uint64_t led_deadline;           // tick tuyệt đối của lần đảo kế tiếp
+static uint64_t led_last_sent;          // tick của lần gửi LED gần nhất
+static int16_t led_sent_state = -1;     // -1: chưa gửi lần nào
+static bool uptime_pending = false;
+static app_time_uptime_enc_t uptime_enc;
+
+// Các bản ghi phát ra trong cùng một sự kiện được gom thành một bản tin
+static app_tlv_builder_t batch;
+static bool batch_open = false;
+static uint8_t batch_first_opcode;
+static uint32_t publications_saved = 0;
+
+// Nút nhấn chỉ đăng ký hành động; hành động chạy trong app_process_action()
+// và không chạy lại trước khoảng tối thiểu, nên bấm liên tục không làm ngập mạng
+enum {
+    ACTION_SEND_MSSV,
+    ACTION_REQUEST_UPTIME,
+    ACTION_COUNT
+};
+
+static void run_send_mssv(app_action_t *action)
+{
+    (void)action;
+    client_send_mssv();
+}
+
+static void run_request_uptime(app_action_t *action)
+{
+    (void)action;
+    client_request_uptime();
+}
+
+static const app_action_def_t action_table[ACTION_COUNT] = {
+    [ACTION_SEND_MSSV]      = { run_send_mssv,      2000 },
+    [ACTION_REQUEST_UPTIME] = { run_request_uptime, 1000 },
+};
+
+static app_action_t actions;
+
+static void led_schedule_next(void);
+static void send_record(uint8_t opcode, uint8_t type, const uint8_t *data, uint8_t len);
+
 // =====================================================
 // KHỞI TẠO CLIENT
 // =====================================================
 void app_init(void)
 {
     elem_index = 0;  // Element mặc định
+    app_time_init();
+    app_profile_init();
+    app_action_init(&actions, action_table, ACTION_COUNT, NULL);
+
+    // Mốc thời gian tuyệt đối cho bộ tạo LED
+    led_deadline = app_time_ticks();
+    led_schedule_next();
+
     app_log("Client initialized OK\r\n");
 }
 
@@ -28,25 +91,33 @@ void app_init(void)
 // =====================================================
 void client_send_mssv(void)
 {
-    // MSSV 4 bạn → tổng 16 bytes ASCII
-    uint8_t mssv[16] = {
-        '2','2','2','0','0','1','1','4',
-        '2','2','2','0','0','1','3','1',
-        '2','2','2','0','0','1','4','4',
-        '2','2','2','0','0','1','6','6'
+    // MSSV 4 bạn, gửi dạng nén (tối đa 27 bit/MSSV) trong 1 PDU không phân đoạn
+    static const uint32_t mssv[] = {
+        22200114,
+        22200131,
+        22200144,
+        22200166
     };
+    uint8_t payload[APP_MSSV_PACKED_LEN(sizeof(mssv) / sizeof(mssv[0]))];
+    uint8_t len = app_mssv_pack(mssv, sizeof(mssv) / sizeof(mssv[0]),
+                                payload, sizeof(payload));
+    if (len == 0) {
+        app_log("MSSV pack failed\r\n");
+        return;
+    }
 
     sl_btmesh_vendor_model_set_publication(elem_index,
                                            vendor_id,
                                            model_id,
-                                           OPCODE_MSSV,
-                                           0,
-                                           sizeof(mssv),
-                                           mssv);
+                                           OPCODE_MSSV_LIST,
+                                           1,
+                                           len,
+                                           payload);
 
     sl_btmesh_vendor_model_publish(elem_index, vendor_id, model_id);
 
-    app_log("Sent MSSV group payload (16 bytes)\r\n");
+    app_log("Sent MSSV list: %u IDs in %u bytes\r\n",
+            (unsigned)(sizeof(mssv) / sizeof(mssv[0])), len);
 }
 
 // =====================================================
@@ -54,49 +125,161 @@ void client_send_mssv(void)
 // =====================================================
 void client_send_uptime(void)
 {
-    uint32_t uptime_s = sl_sleeptimer_get_tick_count64() / 32768;
+    uint32_t uptime_s = app_time_s();
 
-    uint8_t data[4];
-    data[0] = uptime_s >> 24;
-    data[1] = uptime_s >> 16;
-    data[2] = uptime_s >> 8;
-    data[3] = uptime_s;
+    // Gửi uptime tuyệt đối hoặc độ lệch so với lần tuyệt đối trước (varint)
+    uint8_t data[APP_TIME_UPTIME_MAX_LEN];
+    uint8_t len = app_time_encode_uptime(&uptime_enc, uptime_s, data);
 
-    sl_btmesh_vendor_model_set_publication(elem_index,
-                                           vendor_id,
-                                           model_id,
-                                           OPCODE_UPTIME,
-                                           0,
-                                           4,
-                                           data);
+    send_record(OPCODE_UPTIME, APP_TLV_UPTIME, data, len);
 
-    sl_btmesh_vendor_model_publish(elem_index, vendor_id, model_id);
-
-    app_log("Sent uptime: %lu s\r\n", uptime_s);
+    app_log("Sent uptime: %lu s (%u bytes)\r\n", (unsigned long)uptime_s, len);
 }
 
 // =====================================================
-// HÀM GỬI LED STATE (BTN1)
+// HÀM GỬI LED STATE (khi đổi hoặc keep-alive)
 // =====================================================
 void client_send_led_state(void)
 {
-    // Toggle 2 bit LED mỗi lần nhấn
-    led0 ^= 1;
-    led1 ^= 1;
-
     uint8_t led_state = (led0 << 1) | (led1);
+    uint64_t now = app_time_ticks();
+    uint64_t keepalive = app_time_ms_to_ticks(LED_KEEPALIVE_MS);
+
+    if (led_state == led_sent_state && now - led_last_sent < keepalive) {
+        return;
+    }
+    led_sent_state = led_state;
+    led_last_sent = now;
 
+    send_record(OPCODE_LED, APP_TLV_LED, &led_state, 1);
+
+    app_log("Sent LED state: %d%d\r\n", led0, led1);
+}
+
+// =====================================================
+// GOM BẢN TIN THEO SỰ KIỆN
+// =====================================================
+static void publish_message(uint8_t opcode, const uint8_t *data, uint8_t len)
+{
     sl_btmesh_vendor_model_set_publication(elem_index,
                                            vendor_id,
                                            model_id,
-                                           OPCODE_LED,
-                                           0,
+                                           opcode,
                                            1,
-                                           &led_state);
+                                           len,
+                                           data);
 
     sl_btmesh_vendor_model_publish(elem_index, vendor_id, model_id);
+}
 
-    app_log("Sent LED state: %d%d\r\n", led0, led1);
+void batch_begin(void)
+{
+    app_tlv_begin(&batch);
+    batch_open = true;
+}
+
+void batch_flush(void)
+{
+    batch_open = false;
+    if (batch.records == 0) {
+        return;
+    }
+    if (batch.records == 1) {
+        // Chỉ một bản ghi: gửi bản tin gốc, không tốn byte header
+        publish_message(batch_first_opcode, &batch.buf[1], batch.len - 1);
+        return;
+    }
+    publish_message(OPCODE_MULTI_RECORD, batch.buf, batch.len);
+    publications_saved += batch.records - 1;
+    app_log("Sent %u records in one message, %lu publications saved so far\r\n",
+            batch.records, (unsigned long)publications_saved);
+}
+
+static void send_record(uint8_t opcode, uint8_t type, const uint8_t *data, uint8_t len)
+{
+    if (batch_open) {
+        if (batch.records == 0) {
+            batch_first_opcode = opcode;
+        }
+        if (app_tlv_add(&batch, type, data, len)) {
+            return;
+        }
+        // Hết chỗ: gửi phần đã gom rồi mở lô mới cho bản ghi này
+        batch_flush();
+        batch_begin();
+        batch_first_opcode = opcode;
+        if (app_tlv_add(&batch, type, data, len)) {
+            return;
+        }
+    }
+    publish_message(opcode, data, len);
+}
+
+// =====================================================
+// CHẠY CÁC HÀNH ĐỘNG ĐANG CHỜ (gọi từ app_process_action())
+// =====================================================
+void client_process_actions(void)
+{
+    app_action_process(&actions);
+}
+
+// =====================================================
+// UPTIME THEO YÊU CẦU (BTN1)
+// =====================================================
+void client_request_uptime(void)
+{
+    uint64_t now = app_time_ticks();
+    uint64_t window = app_time_ms_to_ticks(COALESCE_WINDOW_MS);
+
+    // Lần đảo LED sắp tới: gửi uptime cùng lúc để radio chỉ thức dậy một lần
+    if (led_deadline - now <= window) {
+        uptime_pending = true;
+        return;
+    }
+    batch_begin();
+    client_send_uptime();
+    client_send_led_state();
+    batch_flush();
+}
+
+// =====================================================
+// BỘ TẠO LED TUẦN HOÀN (deadline tuyệt đối, không trôi)
+// =====================================================
+static void led_timer_cb(app_timer_t *handle, void *data)
+{
+    (void)handle;
+    (void)data;
+
+    led0 ^= 1;
+    led1 ^= 1;
+    batch_begin();
+    if (uptime_pending) {
+        uptime_pending = false;
+        client_send_uptime();
+    }
+    client_send_led_state();
+    batch_flush();
+    led_schedule_next();
+}
+
+static void led_schedule_next(void)
+{
+    uint64_t period = app_time_ms_to_ticks(LED_TOGGLE_PERIOD_MS);
+    uint64_t now = app_time_ticks();
+    uint32_t delay_ms;
+
+    // Deadline kế tiếp tính từ deadline trước, không từ lúc callback chạy,
+    // nên độ trễ xử lý không cộng dồn. Bỏ qua các chu kỳ đã lỡ.
+    led_deadline += period;
+    if (led_deadline <= now) {
+        led_deadline += ((now - led_deadline) / period + 1) * period;
+    }
+    delay_ms = (uint32_t)app_time_ticks_to_ms(led_deadline - now);
+    app_timer_start(&led_timer,
+                    delay_ms ? delay_ms : 1,
+                    led_timer_cb,
+                    NULL,
+                    false);
 }
 
 // =====================================================
@@ -111,12 +294,11 @@ void app_button_press_on_change(uint8_t button, uint8_t pressed)
     switch(button)
     {
         case 0:     // BTN0
-            client_send_mssv();
+            app_action_post(&actions, ACTION_SEND_MSSV);
             break;
 
         case 1:     // BTN1
-            client_send_uptime();
-            client_send_led_state();
+            app_action_post(&actions, ACTION_REQUEST_UPTIME);
             break;
     }
 }
@@ -34,6 +34,10 @@
 void client_send_mssv(void);
 void client_send_uptime(void);
 void client_send_led_state(void);
+void client_request_uptime(void);
+void client_process_actions(void);
+void batch_begin(void);
+void batch_flush(void);
 
 #endif
 
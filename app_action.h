@@ -0,0 +1,83 @@
+/***************************************************************************//**
+ * @file app_action.h
+ * @brief Debounced, rate-limited queue of application actions.
+ *
+ * Button callbacks only post an action number; the action itself runs later
+ * from app_action_process(), called from app_process_action() (or from the
+ * worker task with a kernel). Pending actions are kept as one bit each, so
+ * repeated posts of an action that has not run yet collapse into one run.
+ * A post that follows the previous one of the same action within
+ * APP_ACTION_DEBOUNCE_MS is dropped, and an action does not run again before
+ * its min_interval_ms has passed: it stays pending and runs once when the
+ * interval is over. Mashing a button therefore cannot flood the mesh.
+ *
+ * The queue lives in an app_action_t owned by the caller, so a host
+ * simulation can run many nodes in one process. The actions are handed
+ * their queue and find their node from it.
+ ******************************************************************************/
+
+#ifndef APP_ACTION_H
+#define APP_ACTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "app_timer.h"
+
+// Largest number of actions
+#define APP_ACTION_MAX                  16
+
+// Posts of the same action closer than this are treated as bounces
+#define APP_ACTION_DEBOUNCE_MS          50
+
+typedef struct app_action app_action_t;
+
+typedef struct {
+  void (*run)(app_action_t *action);
+  uint16_t min_interval_ms;             // 0 = no rate limit
+} app_action_def_t;
+
+struct app_action {
+  const app_action_def_t *table;
+  uint8_t count;
+  void (*wake_fn)(app_action_t *action);
+  atomic_uint_fast32_t pending;
+  uint64_t last_post[APP_ACTION_MAX];   // written by app_action_post()
+  uint64_t last_run[APP_ACTION_MAX];    // written by app_action_process()
+  bool has_run[APP_ACTION_MAX];
+  app_timer_t defer_timer;
+  atomic_bool defer_running;            // cleared on expiry
+  uint64_t defer_due;                   // deadline of the running timer
+
+  uint32_t posted;
+  uint32_t debounced;
+  uint32_t collapsed;
+  uint32_t run_count;
+};
+
+/***************************************************************************//**
+ * Use @p table, indexed by action number. @p wake, if not NULL, is called
+ * from app_action_post() and when a deferred action becomes runnable, to get
+ * app_action_process() called; without a kernel the super loop runs anyway.
+ ******************************************************************************/
+void app_action_init(app_action_t *action,
+                     const app_action_def_t *table,
+                     uint8_t count,
+                     void (*wake)(app_action_t *action));
+
+/***************************************************************************//**
+ * Post action @p number. Safe to call from interrupt context.
+ ******************************************************************************/
+void app_action_post(app_action_t *action, uint8_t number);
+
+/***************************************************************************//**
+ * Run the pending actions whose rate limit allows it.
+ ******************************************************************************/
+void app_action_process(app_action_t *action);
+
+/***************************************************************************//**
+ * Print posted, debounced, collapsed and run counters.
+ ******************************************************************************/
+void app_action_report(const app_action_t *action);
+
+#endif // APP_ACTION_H
@@ -0,0 +1,116 @@
+/***************************************************************************//**
+ * @file app_mssv.c
+ * @brief Packed student-ID (MSSV) list message.
+ ******************************************************************************/
+#include <string.h>
+#include "app_mssv.h"
+
+typedef struct {
+  uint8_t *buf;
+  const uint8_t *data;
+  uint16_t pos;                         // in bits
+  uint16_t limit;                       // in bits
+} bit_cursor_t;
+
+static void put_bits(bit_cursor_t *c, uint32_t value, uint8_t bits)
+{
+  for (uint8_t i = 0; i < bits; i++, c->pos++) {
+    if (value & (1u << i)) {
+      c->buf[c->pos / 8] |= 1u << (c->pos % 8);
+    }
+  }
+}
+
+static uint32_t get_bits(bit_cursor_t *c, uint8_t bits)
+{
+  uint32_t value = 0;
+  for (uint8_t i = 0; i < bits; i++, c->pos++) {
+    if (c->data[c->pos / 8] & (1u << (c->pos % 8))) {
+      value |= 1u << i;
+    }
+  }
+  return value;
+}
+
+static uint8_t width_of(uint32_t value)
+{
+  uint8_t bits = 0;
+  while (value != 0) {
+    bits++;
+    value >>= 1;
+  }
+  return bits;
+}
+
+uint8_t app_mssv_pack(const uint32_t *ids, uint8_t count, uint8_t *out, uint8_t out_size)
+{
+  uint32_t sorted[APP_MSSV_MAX_IDS];
+  uint32_t max_delta = 0;
+  uint8_t width;
+  uint8_t len;
+  bit_cursor_t c = { .buf = out };
+
+  if (count == 0 || count > APP_MSSV_MAX_IDS) {
+    return 0;
+  }
+  // Insertion sort; the list is tiny
+  for (uint8_t i = 0; i < count; i++) {
+    uint32_t id = ids[i];
+    uint8_t j = i;
+    if (id > APP_MSSV_ID_MAX) {
+      return 0;
+    }
+    while (j > 0 && sorted[j - 1] > id) {
+      sorted[j] = sorted[j - 1];
+      j--;
+    }
+    sorted[j] = id;
+  }
+  for (uint8_t i = 1; i < count; i++) {
+    if (sorted[i] - sorted[i - 1] > max_delta) {
+      max_delta = sorted[i] - sorted[i - 1];
+    }
+  }
+  width = width_of(max_delta);
+
+  len = (4 + 5 + APP_MSSV_ID_BITS + width * (count - 1) + 7) / 8;
+  if (len > out_size) {
+    return 0;
+  }
+  memset(out, 0, len);
+  put_bits(&c, count, 4);
+  put_bits(&c, width, 5);
+  put_bits(&c, sorted[0], APP_MSSV_ID_BITS);
+  for (uint8_t i = 1; i < count; i++) {
+    put_bits(&c, sorted[i] - sorted[i - 1], width);
+  }
+  return len;
+}
+
+uint8_t app_mssv_unpack(const uint8_t *data, uint8_t len, uint32_t *ids, uint8_t max_ids)
+{
+  bit_cursor_t c = { .data = data, .limit = len * 8 };
+  uint8_t count;
+  uint8_t width;
+
+  if (c.limit < 4 + 5 + APP_MSSV_ID_BITS) {
+    return 0;
+  }
+  count = (uint8_t)get_bits(&c, 4);
+  width = (uint8_t)get_bits(&c, 5);
+  if (count == 0 || count > max_ids || width > APP_MSSV_ID_BITS
+      || c.pos + APP_MSSV_ID_BITS + width * (count - 1) > c.limit) {
+    return 0;
+  }
+  ids[0] = get_bits(&c, APP_MSSV_ID_BITS);
+  if (ids[0] > APP_MSSV_ID_MAX) {
+    return 0;
+  }
+  for (uint8_t i = 1; i < count; i++) {
+    ids[i] = ids[i - 1] + get_bits(&c, width);
+    if (ids[i] > APP_MSSV_ID_MAX) {
+      return 0;
+    }
+  }
+  return count;
+}
@@ -0,0 +1,42 @@
+/***************************************************************************//**
+ * @file app_mssv.h
+ * @brief Packed student-ID (MSSV) list message.
+ *
+ * An 8-digit ID is below 2^27, so it never needs more than 27 bits. The IDs
+ * of one group are usually close to each other, so the list is sorted and
+ * sent as the smallest ID followed by the differences between neighbours,
+ * all of the same width. Bit stream, LSB first:
+ *
+ *   count (4) | delta width (5) | first ID (27) | (count - 1) x delta
+ *
+ * Unrelated IDs cost 27 bits each plus the 9-bit header, while the four IDs
+ * of a lab group fit in 7 bytes, well within a single unsegmented PDU. The
+ * order of the IDs is not preserved.
+ ******************************************************************************/
+
+#ifndef APP_MSSV_H
+#define APP_MSSV_H
+
+#include <stdint.h>
+
+#define APP_MSSV_ID_BITS                27
+#define APP_MSSV_ID_MAX                 99999999u
+#define APP_MSSV_MAX_IDS                15
+
+// Payload length of a list of @p n unrelated IDs, the worst case
+#define APP_MSSV_PACKED_LEN(n)          ((4 + 5 + APP_MSSV_ID_BITS * (n) + 7) / 8)
+
+/***************************************************************************//**
+ * Pack @p count IDs into @p out. Returns the payload length, or 0 if an ID is
+ * out of range, @p count is 0 or above APP_MSSV_MAX_IDS, or @p out_size is
+ * too small.
+ ******************************************************************************/
+uint8_t app_mssv_pack(const uint32_t *ids, uint8_t count, uint8_t *out, uint8_t out_size);
+
+/***************************************************************************//**
+ * Unpack a list into @p ids in ascending order. Returns the number of IDs,
+ * or 0 if the payload is malformed or holds more than @p max_ids.
+ ******************************************************************************/
+uint8_t app_mssv_unpack(const uint8_t *data, uint8_t len, uint32_t *ids, uint8_t max_ids);
+
+#endif // APP_MSSV_H
@@ -10,5 +10,6 @@
 
 void app_process_action(void)
 {
-    // không cần xử lý gì ở client
+    // Chạy các hành động do nút nhấn đăng ký
+    client_process_actions();
 }
@@ -0,0 +1,155 @@
+/***************************************************************************//**
+ * @file app_time.c
+ * @brief Monotonic time service on the 64-bit sleeptimer tick count.
+ ******************************************************************************/
+#include "sl_sleeptimer.h"
+
+#include "app_time.h"
+
+static uint32_t freq;
+static uint8_t shift;                   // log2(freq), if it is a power of two
+static bool pow2;
+static uint64_t ms_per_tick;            // 1000 / freq in 0.64, rounded up
+static uint64_t s_per_tick;             // 1 / freq in 0.64, rounded up
+static uint64_t per_thousand;           // 1 / 1000 in 0.64, rounded up
+
+// (a * b) >> 64 from 32-bit partial products
+static uint64_t mulhi64(uint64_t a, uint64_t b)
+{
+  uint64_t a0 = a & 0xFFFFFFFFu, a1 = a >> 32;
+  uint64_t b0 = b & 0xFFFFFFFFu, b1 = b >> 32;
+  uint64_t p01 = a0 * b1;
+  uint64_t p10 = a1 * b0;
+  uint64_t mid = ((a0 * b0) >> 32) + (p01 & 0xFFFFFFFFu) + (p10 & 0xFFFFFFFFu);
+  return a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+}
+
+// ceil(num * 2^64 / den) for num < den, by two 64/32 long-division steps
+static uint64_t reciprocal(uint32_t num, uint32_t den)
+{
+  uint64_t rem = (uint64_t)num << 32;
+  uint64_t hi = rem / den;
+  rem = (rem % den) << 32;
+  return ((hi << 32) | (rem / den)) + 1;
+}
+
+void app_time_init(void)
+{
+  freq = sl_sleeptimer_get_timer_frequency();
+  pow2 = freq != 0 && (freq & (freq - 1)) == 0;
+  shift = 0;
+  while (pow2 && (1u << shift) < freq) {
+    shift++;
+  }
+  // The only divisions, done once. The sleeptimer runs well above 1 kHz.
+  ms_per_tick = reciprocal(1000, freq);
+  s_per_tick = reciprocal(1, freq);
+  per_thousand = reciprocal(1, 1000);
+}
+
+uint64_t app_time_ticks(void)
+{
+  return sl_sleeptimer_get_tick_count64();
+}
+
+uint64_t app_time_ticks_to_ms(uint64_t ticks)
+{
+  if (pow2) {
+    // Whole seconds and the remainder separately, so nothing overflows
+    return (ticks >> shift) * 1000 + (((ticks & (freq - 1)) * 1000) >> shift);
+  }
+  return mulhi64(ticks, ms_per_tick);
+}
+
+uint64_t app_time_ms_to_ticks(uint32_t ms)
+{
+  return mulhi64((uint64_t)ms * freq, per_thousand);
+}
+
+uint64_t app_time_ms(void)
+{
+  return app_time_ticks_to_ms(app_time_ticks());
+}
+
+uint32_t app_time_s(void)
+{
+  uint64_t ticks = app_time_ticks();
+
+  if (pow2) {
+    return (uint32_t)(ticks >> shift);
+  }
+  return (uint32_t)mulhi64(ticks, s_per_tick);
+}
+
+static uint8_t put_varint(uint64_t value, uint8_t *out)
+{
+  uint8_t len = 0;
+  do {
+    out[len] = value & 0x7F;
+    value >>= 7;
+    if (value != 0) {
+      out[len] |= 0x80;
+    }
+    len++;
+  } while (value != 0);
+  return len;
+}
+
+static uint8_t varint_len(uint64_t value)
+{
+  uint8_t len = 1;
+  while (value >>= 7) {
+    len++;
+  }
+  return len;
+}
+
+uint8_t app_time_encode_uptime(app_time_uptime_enc_t *enc, uint32_t uptime_s, uint8_t *out)
+{
+  uint32_t delta = uptime_s - enc->base_s;        // modular, safe over a wrap
+
+  if (!enc->valid
+      || enc->since_abs + 1 >= APP_TIME_ABS_EVERY
+      || varint_len((uint64_t)delta << 3) >= varint_len((uint64_t)uptime_s << 3)) {
+    enc->epoch = (enc->epoch + 1) & 0x3;
+    enc->base_s = uptime_s;
+    enc->since_abs = 0;
+    enc->valid = true;
+    return put_varint(((uint64_t)uptime_s << 3) | (enc->epoch << 1) | 1, out);
+  }
+  enc->since_abs++;
+  return put_varint(((uint64_t)delta << 3) | (enc->epoch << 1), out);
+}
+
+bool app_time_decode_uptime(app_time_uptime_dec_t *dec,
+                            const uint8_t *data, uint8_t len,
+                            uint32_t *uptime_s)
+{
+  uint64_t value = 0;
+  uint8_t i;
+
+  for (i = 0; i < len && i < APP_TIME_UPTIME_MAX_LEN; i++) {
+    value |= (uint64_t)(data[i] & 0x7F) << (7 * i);
+    if (!(data[i] & 0x80)) {
+      break;
+    }
+  }
+  if (i == len || i == APP_TIME_UPTIME_MAX_LEN || value >> 35) {
+    // Truncated or longer than any valid encoding
+    return false;
+  }
+
+  uint8_t epoch = (value >> 1) & 0x3;
+  if (value & 1) {
+    dec->base_s = (uint32_t)(value >> 3);
+    dec->epoch = epoch;
+    dec->valid = true;
+    *uptime_s = dec->base_s;
+    return true;
+  }
+  if (!dec->valid || dec->epoch != epoch) {
+    return false;
+  }
+  *uptime_s = dec->base_s + (uint32_t)(value >> 3);
+  return true;
+}
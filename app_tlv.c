@@ -0,0 +1,40 @@
+/***************************************************************************//**
+ * @file app_tlv.c
+ * @brief Multi-record vendor message: several logical records in one PDU.
+ ******************************************************************************/
+#include <string.h>
+#include "app_tlv.h"
+
+void app_tlv_begin(app_tlv_builder_t *b)
+{
+  b->len = 0;
+  b->records = 0;
+}
+
+bool app_tlv_add(app_tlv_builder_t *b, uint8_t type, const uint8_t *value, uint8_t len)
+{
+  if (type > 0xF || len > APP_TLV_VALUE_MAX || b->len + 1 + len > APP_TLV_MAX_LEN) {
+    return false;
+  }
+  b->buf[b->len++] = (uint8_t)((type << 4) | len);
+  memcpy(&b->buf[b->len], value, len);
+  b->len += len;
+  b->records++;
+  return true;
+}
+
+bool app_tlv_next(const uint8_t *data, uint8_t len, uint8_t *pos,
+                  uint8_t *type, const uint8_t **value, uint8_t *value_len)
+{
+  if (*pos >= len) {
+    return false;
+  }
+  *type = data[*pos] >> 4;
+  *value_len = data[*pos] & 0xF;
+  if (*pos + 1 + *value_len > len) {
+    return false;
+  }
+  *value = &data[*pos + 1];
+  *pos += 1 + *value_len;
+  return true;
+}
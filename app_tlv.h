@@ -0,0 +1,53 @@
+/***************************************************************************//**
+ * @file app_tlv.h
+ * @brief Multi-record vendor message: several logical records in one PDU.
+ *
+ * Every record starts with one header byte, type in the upper nibble and
+ * value length in the lower one, followed by the value in the same format
+ * as the standalone message of that type. Records that are issued while one
+ * event is handled are collected in a builder and published together as a
+ * single multi_record message, so a button action costs one publication
+ * instead of one per record.
+ ******************************************************************************/
+
+#ifndef APP_TLV_H
+#define APP_TLV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Record types
+#define APP_TLV_UPTIME                  0x1   // app_time uptime encoding
+#define APP_TLV_LED                     0x2   // 2 LED bits
+#define APP_TLV_SENSOR                  0x3   // app_sensor_codec payload
+
+// Largest value of one record
+#define APP_TLV_VALUE_MAX               15
+
+// A multi_record message is kept within one unsegmented PDU
+#define APP_TLV_MAX_LEN                 8
+
+typedef struct {
+  uint8_t buf[APP_TLV_MAX_LEN];
+  uint8_t len;
+  uint8_t records;
+} app_tlv_builder_t;
+
+/***************************************************************************//**
+ * Start an empty message.
+ ******************************************************************************/
+void app_tlv_begin(app_tlv_builder_t *b);
+
+/***************************************************************************//**
+ * Append a record. Returns false if it does not fit.
+ ******************************************************************************/
+bool app_tlv_add(app_tlv_builder_t *b, uint8_t type, const uint8_t *value, uint8_t len);
+
+/***************************************************************************//**
+ * Read the record at @p *pos and advance it. Returns false at the end of
+ * the message or if the record is truncated.
+ ******************************************************************************/
+bool app_tlv_next(const uint8_t *data, uint8_t len, uint8_t *pos,
+                  uint8_t *type, const uint8_t **value, uint8_t *value_len);
+
+#endif // APP_TLV_H
@@ -40,6 +40,7 @@
 #include <string.h>
 
 #include "app_log.h"
+#include "app_profile.h"
 
 /* This will be the model agregator: config and load model */
 #include "config.h"
@@ -58,6 +59,7 @@ void DCD_decode(void)
   tsDCD_Header *pHeader;
   tsDCD_Elem *pElem;
   uint8_t byte_offset;
+  APP_PROFILE_BEGIN(DCD_DECODE);
 
   pHeader = (tsDCD_Header *)&_dcd_raw;
 
@@ -79,6 +81,7 @@ void DCD_decode(void)
     app_log("Decoding 2nd element (just informative, not used for anything)\r\n");
     DCD_decode_element(pElem, &_sDCD_2nd);
   }
+  APP_PROFILE_END(DCD_DECODE);
 }
 
 /* function for decoding one element inside the DCD. Parameters:
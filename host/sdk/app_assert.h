@@ -0,0 +1,25 @@
+/***************************************************************************//**
+ * @file app_assert.h
+ * @brief Host stand-in for the SDK assert component: failures abort.
+ ******************************************************************************/
+
+#ifndef APP_ASSERT_H
+#define APP_ASSERT_H
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#define app_assert(expr, ...)                                           \
+  do {                                                                  \
+    if (!(expr)) {                                                      \
+      fprintf(stderr, "%s:%d: assertion '%s' failed: ",                 \
+              __FILE__, __LINE__, #expr);                               \
+      fprintf(stderr, __VA_ARGS__);                                     \
+      abort();                                                          \
+    }                                                                   \
+  } while (0)
+
+#define app_assert_status_f(sc, ...)                                    \
+  app_assert((sc) == SL_STATUS_OK, __VA_ARGS__)
+
+#endif // APP_ASSERT_H
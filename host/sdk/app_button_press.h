@@ -0,0 +1,23 @@
+/***************************************************************************//**
+ * @file app_button_press.h
+ * @brief Host stand-in for the button press component. The press callback,
+ *        app_button_press_cb(), is called by the host program directly.
+ ******************************************************************************/
+
+#ifndef APP_BUTTON_PRESS_H
+#define APP_BUTTON_PRESS_H
+
+#include <stdint.h>
+
+enum {
+  APP_BUTTON_PRESS_NONE = 0,
+  APP_BUTTON_PRESS_DURATION_SHORT,
+  APP_BUTTON_PRESS_DURATION_MEDIUM,
+  APP_BUTTON_PRESS_DURATION_LONG,
+  APP_BUTTON_PRESS_DURATION_VERYLONG,
+};
+
+void app_button_press_enable(void);
+void app_button_press_cb(uint8_t button, uint8_t duration);
+
+#endif // APP_BUTTON_PRESS_H
@@ -0,0 +1,13 @@
+/***************************************************************************//**
+ * @file app_log.h
+ * @brief Host stand-in for the SDK log component; see host_log().
+ ******************************************************************************/
+
+#ifndef APP_LOG_H
+#define APP_LOG_H
+
+#include "host_sdk.h"
+
+#define app_log(...)                    host_log(__VA_ARGS__)
+
+#endif // APP_LOG_H
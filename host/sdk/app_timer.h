@@ -0,0 +1,34 @@
+/***************************************************************************//**
+ * @file app_timer.h
+ * @brief Host stand-in for the SDK application timer on the simulated clock.
+ *
+ * Timers belong to the node that started them and fire from
+ * host_node_run_until().
+ ******************************************************************************/
+
+#ifndef APP_TIMER_H
+#define APP_TIMER_H
+
+#include "sl_status.h"
+
+typedef struct app_timer app_timer_t;
+typedef void (*app_timer_callback_t)(app_timer_t *timer, void *data);
+
+struct app_timer {
+  app_timer_t *next;                    // in the list of running timers
+  struct host_node *node;
+  app_timer_callback_t callback;
+  void *data;
+  uint64_t deadline_ms;
+  uint32_t period_ms;                   // 0 for a one-shot timer
+  bool running;
+};
+
+sl_status_t app_timer_start(app_timer_t *timer,
+                            uint32_t timeout_ms,
+                            app_timer_callback_t callback,
+                            void *callback_data,
+                            bool is_periodic);
+sl_status_t app_timer_stop(app_timer_t *timer);
+
+#endif // APP_TIMER_H
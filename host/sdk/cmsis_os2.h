@@ -0,0 +1,46 @@
+/***************************************************************************//**
+ * @file cmsis_os2.h
+ * @brief Host stand-in for the CMSIS-RTOS2 subset used by app_tasks.c, on
+ *        POSIX threads.
+ *
+ * Thread flags behave like the kernel's. Priorities are not modelled: every
+ * thread may run at any time, which is what stresses the queues.
+ ******************************************************************************/
+
+#ifndef CMSIS_OS2_H
+#define CMSIS_OS2_H
+
+#include <stdint.h>
+
+typedef void *osThreadId_t;
+typedef void (*osThreadFunc_t)(void *argument);
+
+typedef enum {
+  osPriorityLow = 8,
+  osPriorityBelowNormal = 16,
+  osPriorityNormal = 24,
+  osPriorityAboveNormal = 32,
+  osPriorityHigh = 40,
+} osPriority_t;
+
+typedef struct {
+  const char *name;
+  uint32_t attr_bits;
+  void *cb_mem;
+  uint32_t cb_size;
+  void *stack_mem;
+  uint32_t stack_size;
+  osPriority_t priority;
+} osThreadAttr_t;
+
+#define osFlagsWaitAny                  0x00000000u
+#define osFlagsWaitAll                  0x00000001u
+#define osFlagsNoClear                  0x00000002u
+#define osWaitForever                   0xFFFFFFFFu
+#define osFlagsError                    0x80000000u
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr);
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags);
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout);
+
+#endif // CMSIS_OS2_H
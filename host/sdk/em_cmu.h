@@ -0,0 +1,9 @@
+/***************************************************************************//**
+ * @file em_cmu.h
+ * @brief Host stand-in for the emlib CMU header; the apps use nothing from it.
+ ******************************************************************************/
+
+#ifndef EM_CMU_H
+#define EM_CMU_H
+
+#endif // EM_CMU_H
@@ -0,0 +1,11 @@
+/***************************************************************************//**
+ * @file em_common.h
+ * @brief Host stand-in for the SDK common macros.
+ ******************************************************************************/
+
+#ifndef EM_COMMON_H
+#define EM_COMMON_H
+
+#define SL_WEAK                         __attribute__((weak))
+
+#endif // EM_COMMON_H
@@ -0,0 +1,9 @@
+/***************************************************************************//**
+ * @file em_gpio.h
+ * @brief Host stand-in for the emlib GPIO header; the apps use nothing from it.
+ ******************************************************************************/
+
+#ifndef EM_GPIO_H
+#define EM_GPIO_H
+
+#endif // EM_GPIO_H
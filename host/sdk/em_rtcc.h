@@ -0,0 +1,9 @@
+/***************************************************************************//**
+ * @file em_rtcc.h
+ * @brief Host stand-in for the emlib RTCC header; the apps use nothing from it.
+ ******************************************************************************/
+
+#ifndef EM_RTCC_H
+#define EM_RTCC_H
+
+#endif // EM_RTCC_H
@@ -0,0 +1,11 @@
+/***************************************************************************//**
+ * @file gatt_db.h
+ * @brief Host stand-in for the generated GATT database handles.
+ ******************************************************************************/
+
+#ifndef GATT_DB_H
+#define GATT_DB_H
+
+#define gattdb_device_name              11
+
+#endif // GATT_DB_H
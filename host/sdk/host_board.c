@@ -0,0 +1,31 @@
+/***************************************************************************//**
+ * @file host_board.c
+ * @brief Buttons of the host stand-in board, for host builds of a whole
+ *        app.c.
+ ******************************************************************************/
+#include "app_button_press.h"
+#include "sl_simple_button_instances.h"
+
+const sl_button_t sl_button_btn0 = { 0 };
+const sl_button_t sl_button_btn1 = { 1 };
+
+static __thread uint8_t pressed;        // bit n: button n held down
+
+uint8_t sl_simple_button_get_state(const sl_button_t *button)
+{
+  return (pressed >> button->index) & 1 ? SL_SIMPLE_BUTTON_PRESSED
+         : SL_SIMPLE_BUTTON_RELEASED;
+}
+
+void host_button_set(uint8_t index, bool pressed_now)
+{
+  if (pressed_now) {
+    pressed |= (uint8_t)(1u << index);
+  } else {
+    pressed &= (uint8_t)~(1u << index);
+  }
+}
+
+void app_button_press_enable(void)
+{
+}
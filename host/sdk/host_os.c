@@ -0,0 +1,90 @@
+/***************************************************************************//**
+ * @file host_os.c
+ * @brief CMSIS-RTOS2 thread and thread flag calls on POSIX threads.
+ ******************************************************************************/
+#include <pthread.h>
+#include <stdlib.h>
+
+#include "cmsis_os2.h"
+
+typedef struct {
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t cond;
+  uint32_t flags;
+  osThreadFunc_t func;
+  void *argument;
+} host_thread_t;
+
+static __thread host_thread_t *self;
+
+static void *trampoline(void *arg)
+{
+  host_thread_t *t = arg;
+
+  self = t;
+  t->func(t->argument);
+  return NULL;
+}
+
+osThreadId_t osThreadNew(osThreadFunc_t func, void *argument, const osThreadAttr_t *attr)
+{
+  host_thread_t *t = calloc(1, sizeof(*t));
+
+  (void)attr;
+  if (t == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&t->lock, NULL);
+  pthread_cond_init(&t->cond, NULL);
+  t->func = func;
+  t->argument = argument;
+  if (pthread_create(&t->thread, NULL, trampoline, t) != 0) {
+    free(t);
+    return NULL;
+  }
+  pthread_detach(t->thread);
+  return t;
+}
+
+uint32_t osThreadFlagsSet(osThreadId_t thread_id, uint32_t flags)
+{
+  host_thread_t *t = thread_id;
+  uint32_t result;
+
+  if (t == NULL) {
+    return osFlagsError;
+  }
+  pthread_mutex_lock(&t->lock);
+  t->flags |= flags;
+  result = t->flags;
+  pthread_cond_broadcast(&t->cond);
+  pthread_mutex_unlock(&t->lock);
+  return result;
+}
+
+uint32_t osThreadFlagsWait(uint32_t flags, uint32_t options, uint32_t timeout)
+{
+  host_thread_t *t = self;
+  uint32_t result;
+
+  // Only the forever wait the tasks use is needed here
+  (void)timeout;
+  if (t == NULL) {
+    return osFlagsError;
+  }
+  pthread_mutex_lock(&t->lock);
+  for (;;) {
+    uint32_t set = t->flags & flags;
+    if ((options & osFlagsWaitAll) ? set == flags : set != 0) {
+      break;
+    }
+    pthread_cond_wait(&t->cond, &t->lock);
+  }
+  result = t->flags;
+  if (!(options & osFlagsNoClear)) {
+    t->flags &= ~flags;
+  }
+  pthread_mutex_unlock(&t->lock);
+  return result;
+}
@@ -0,0 +1,589 @@
+/***************************************************************************//**
+ * @file host_sdk.c
+ * @brief Simulated SDK for the host build: clock, app timers, external
+ *        signals, vendor model traffic and the log.
+ ******************************************************************************/
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "app_timer.h"
+#include "sl_bt_api.h"
+#include "sl_btmesh_api.h"
+#include "sl_sleeptimer.h"
+#include "host_sdk.h"
+
+#define DEFAULT_FREQUENCY               32768
+
+typedef struct {
+  uint32_t hz;
+  uint64_t ticks;
+} host_clock_t;
+
+static __thread host_clock_t clock_state = { DEFAULT_FREQUENCY, 0 };
+static __thread host_node_t *current;
+static __thread host_node_t default_node;
+static __thread bool default_ready;
+
+static pthread_mutex_t log_lock = PTHREAD_MUTEX_INITIALIZER;
+static host_log_fn log_sink;
+static volatile bool log_muted;
+
+// -----------------------------------------------------------------------------
+// Nodes
+
+void host_node_init(host_node_t *node, uint16_t address)
+{
+  memset(node, 0, sizeof(*node));
+  node->address = address;
+  node->rng = 0x9E3779B9u ^ ((uint32_t)address * 2654435761u);
+  if (node->rng == 0) {
+    node->rng = 1;
+  }
+}
+
+host_node_t *host_node_current(void)
+{
+  if (current == NULL) {
+    if (!default_ready) {
+      host_node_init(&default_node, 0x0001);
+      default_ready = true;
+    }
+    current = &default_node;
+  }
+  return current;
+}
+
+host_node_t *host_node_enter(host_node_t *node)
+{
+  host_node_t *previous = current;
+  current = node;
+  return previous;
+}
+
+uint32_t host_node_take_signals(host_node_t *node)
+{
+  return __atomic_exchange_n(&node->signals, 0, __ATOMIC_ACQ_REL);
+}
+
+// -----------------------------------------------------------------------------
+// Clock
+
+void host_clock_set_frequency(uint32_t hz)
+{
+  clock_state.hz = hz;
+}
+
+void host_clock_set_ticks(uint64_t ticks)
+{
+  clock_state.ticks = ticks;
+}
+
+void host_clock_set_ms(uint64_t ms)
+{
+  // Rounded up, so host_clock_ms() reads back exactly ms
+  clock_state.ticks = (ms * clock_state.hz + 999) / 1000;
+}
+
+uint64_t host_clock_ticks(void)
+{
+  return clock_state.ticks;
+}
+
+uint64_t host_clock_ms(void)
+{
+  return clock_state.ticks * 1000 / clock_state.hz;
+}
+
+uint64_t sl_sleeptimer_get_tick_count64(void)
+{
+  return clock_state.ticks;
+}
+
+uint32_t sl_sleeptimer_get_tick_count(void)
+{
+  return (uint32_t)clock_state.ticks;
+}
+
+uint32_t sl_sleeptimer_get_timer_frequency(void)
+{
+  return clock_state.hz;
+}
+
+// -----------------------------------------------------------------------------
+// App timers
+
+static void unlink_timer(app_timer_t *timer)
+{
+  app_timer_t **link = &timer->node->timers;
+
+  while (*link != NULL) {
+    if (*link == timer) {
+      *link = timer->next;
+      break;
+    }
+    link = &(*link)->next;
+  }
+  timer->running = false;
+  timer->next = NULL;
+}
+
+sl_status_t app_timer_start(app_timer_t *timer,
+                            uint32_t timeout_ms,
+                            app_timer_callback_t callback,
+                            void *callback_data,
+                            bool is_periodic)
+{
+  host_node_t *node = host_node_current();
+
+  if (timer->running) {
+    unlink_timer(timer);
+  }
+  timer->node = node;
+  timer->callback = callback;
+  timer->data = callback_data;
+  timer->deadline_ms = host_clock_ms() + timeout_ms;
+  timer->period_ms = is_periodic ? timeout_ms : 0;
+  timer->running = true;
+  timer->next = node->timers;
+  node->timers = timer;
+  return SL_STATUS_OK;
+}
+
+sl_status_t app_timer_stop(app_timer_t *timer)
+{
+  if (timer->running) {
+    unlink_timer(timer);
+  }
+  return SL_STATUS_OK;
+}
+
+uint64_t host_node_next_deadline(const host_node_t *node)
+{
+  uint64_t next = UINT64_MAX;
+
+  for (const app_timer_t *t = node->timers; t != NULL; t = t->next) {
+    if (t->deadline_ms < next) {
+      next = t->deadline_ms;
+    }
+  }
+  return next;
+}
+
+bool host_node_fire_next(host_node_t *node, uint64_t until_ms)
+{
+  app_timer_t *due = NULL;
+  host_node_t *previous;
+
+  for (app_timer_t *t = node->timers; t != NULL; t = t->next) {
+    if (t->deadline_ms <= until_ms && (due == NULL || t->deadline_ms < due->deadline_ms)) {
+      due = t;
+    }
+  }
+  if (due == NULL) {
+    return false;
+  }
+  if (due->deadline_ms > host_clock_ms()) {
+    host_clock_set_ms(due->deadline_ms);
+  }
+  if (due->period_ms != 0) {
+    // Periodic timers keep their phase like the sleeptimer does
+    due->deadline_ms += due->period_ms;
+  } else {
+    unlink_timer(due);
+  }
+  previous = host_node_enter(node);
+  due->callback(due, due->data);
+  host_node_enter(previous);
+  return true;
+}
+
+void host_run_until(uint64_t until_ms)
+{
+  host_node_t *node = host_node_current();
+
+  while (host_node_fire_next(node, until_ms)) {
+  }
+  if (until_ms > host_clock_ms()) {
+    host_clock_set_ms(until_ms);
+  }
+}
+
+// -----------------------------------------------------------------------------
+// Log
+
+void host_log(const char *fmt, ...)
+{
+  char text[512];
+  va_list args;
+
+  if (log_muted) {
+    return;
+  }
+  va_start(args, fmt);
+  vsnprintf(text, sizeof(text), fmt, args);
+  va_end(args);
+
+  pthread_mutex_lock(&log_lock);
+  if (log_sink != NULL) {
+    log_sink(text);
+  } else {
+    fputs(text, stdout);
+  }
+  pthread_mutex_unlock(&log_lock);
+}
+
+void host_log_set_sink(host_log_fn sink)
+{
+  pthread_mutex_lock(&log_lock);
+  log_sink = sink;
+  pthread_mutex_unlock(&log_lock);
+}
+
+void host_log_mute(bool mute)
+{
+  log_muted = mute;
+}
+
+// -----------------------------------------------------------------------------
+// Bluetooth API
+
+sl_status_t sl_bt_external_signal(uint32_t signals)
+{
+  __atomic_or_fetch(&host_node_current()->signals, signals, __ATOMIC_ACQ_REL);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_system_get_random_data(uint8_t length,
+                                         size_t max_data_size,
+                                         size_t *data_len,
+                                         uint8_t *data)
+{
+  host_node_t *node = host_node_current();
+
+  if (length > max_data_size) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+  for (uint8_t i = 0; i < length; i++) {
+    // xorshift32, so every node draws its own reproducible sequence
+    node->rng ^= node->rng << 13;
+    node->rng ^= node->rng >> 17;
+    node->rng ^= node->rng << 5;
+    data[i] = (uint8_t)node->rng;
+  }
+  *data_len = length;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_system_get_identity_address(bd_addr *address, uint8_t *type)
+{
+  uint16_t a = host_node_current()->address;
+
+  memset(address, 0, sizeof(*address));
+  address->addr[0] = a & 0xFF;
+  address->addr[1] = a >> 8;
+  *type = 0;
+  return SL_STATUS_OK;
+}
+
+void sl_bt_system_reboot(void)
+{
+}
+
+sl_status_t sl_bt_gatt_server_write_attribute_value(uint16_t attribute,
+                                                    uint16_t offset,
+                                                    size_t value_len,
+                                                    const uint8_t *value)
+{
+  return SL_STATUS_OK;
+}
+
+// -----------------------------------------------------------------------------
+// Bluetooth Mesh API
+
+sl_status_t sl_btmesh_node_init(void)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_node_reset(void)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_node_get_element_address(uint16_t elem_index, uint16_t *address)
+{
+  *address = host_node_current()->address;
+  return *address != 0 ? SL_STATUS_OK : SL_STATUS_INVALID_STATE;
+}
+
+sl_status_t sl_btmesh_vendor_model_init(uint16_t elem_index,
+                                        uint16_t vendor_id,
+                                        uint16_t model_id,
+                                        uint8_t publish,
+                                        size_t opcodes_len,
+                                        const uint8_t *opcodes)
+{
+  host_node_t *node = host_node_current();
+
+  if (opcodes_len > HOST_OPCODE_MAX) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  memcpy(node->opcodes, opcodes, opcodes_len);
+  node->opcode_count = (uint8_t)opcodes_len;
+  return SL_STATUS_OK;
+}
+
+// Append a part to @p msg; false if it does not fit
+static bool append_part(host_tx_t *msg, size_t len, const uint8_t *data)
+{
+  if (msg->len + len > HOST_TX_MAX) {
+    return false;
+  }
+  memcpy(&msg->data[msg->len], data, len);
+  msg->len += (uint16_t)len;
+  return true;
+}
+
+sl_status_t sl_btmesh_vendor_model_send(uint16_t destination_address,
+                                        int8_t va_index,
+                                        uint16_t appkey_index,
+                                        uint16_t elem_index,
+                                        uint16_t vendor_id,
+                                        uint16_t model_id,
+                                        uint8_t nonrelayed,
+                                        uint8_t opcode,
+                                        uint8_t final,
+                                        size_t payload_len,
+                                        const uint8_t *payload)
+{
+  host_node_t *node = host_node_current();
+  host_tx_t *msg = &node->send_msg;
+
+  if (node->tx_status != SL_STATUS_OK) {
+    node->send_open = false;
+    return node->tx_status;
+  }
+  if (!node->send_open) {
+    msg->source = node->address;
+    msg->destination = destination_address;
+    msg->publish = false;
+    msg->appkey_index = appkey_index;
+    msg->ttl = node->pub_ttl;
+    msg->opcode = opcode;
+    msg->len = 0;
+    node->send_open = true;
+  }
+  if (!append_part(msg, payload_len, payload)) {
+    node->send_open = false;
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+  if (final) {
+    node->send_open = false;
+    node->sends++;
+    if (node->on_tx != NULL) {
+      node->on_tx(node, msg);
+    }
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_vendor_model_set_publication(uint16_t elem_index,
+                                                   uint16_t vendor_id,
+                                                   uint16_t model_id,
+                                                   uint8_t opcode,
+                                                   uint8_t final,
+                                                   size_t payload_len,
+                                                   const uint8_t *payload)
+{
+  host_node_t *node = host_node_current();
+  host_tx_t *msg = &node->pub_msg;
+
+  if (node->pub_ready || msg->len == 0) {
+    // First part of a new message
+    node->pub_ready = false;
+    msg->opcode = opcode;
+    msg->len = 0;
+  }
+  if (!append_part(msg, payload_len, payload)) {
+    msg->len = 0;
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+  node->pub_ready = final != 0;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_vendor_model_publish(uint16_t elem_index,
+                                           uint16_t vendor_id,
+                                           uint16_t model_id)
+{
+  host_node_t *node = host_node_current();
+  host_tx_t *msg = &node->pub_msg;
+
+  if (node->tx_status != SL_STATUS_OK) {
+    return node->tx_status;
+  }
+  if (!node->pub_ready) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  msg->source = node->address;
+  msg->destination = node->pub_address;
+  msg->publish = true;
+  msg->appkey_index = node->pub_appkey_index;
+  msg->ttl = node->pub_ttl;
+  node->publishes++;
+  if (node->on_tx != NULL) {
+    node->on_tx(node, msg);
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_set_nettx(uint8_t count, uint8_t interval)
+{
+  host_node_t *node = host_node_current();
+
+  node->nettx_count = count;
+  node->nettx_interval = interval;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_set_relay(uint8_t enabled, uint8_t count, uint8_t interval)
+{
+  host_node_t *node = host_node_current();
+
+  node->relay_enabled = enabled;
+  node->relay_count = count;
+  node->relay_interval = interval;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_get_local_model_pub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t *appkey_index,
+                                               uint16_t *pub_address,
+                                               uint8_t *ttl,
+                                               uint8_t *period,
+                                               uint8_t *retrans,
+                                               uint8_t *credentials)
+{
+  host_node_t *node = host_node_current();
+
+  if (!node->pub_set) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  *appkey_index = node->pub_appkey_index;
+  *pub_address = node->pub_address;
+  *ttl = node->pub_ttl;
+  *period = node->pub_period;
+  *retrans = node->pub_retrans;
+  *credentials = 0;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_set_local_model_pub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t appkey_index,
+                                               uint16_t pub_address,
+                                               uint8_t ttl,
+                                               uint8_t period,
+                                               uint8_t retrans,
+                                               uint8_t credentials)
+{
+  host_node_t *node = host_node_current();
+
+  node->pub_set = true;
+  node->pub_appkey_index = appkey_index;
+  node->pub_address = pub_address;
+  node->pub_ttl = ttl;
+  node->pub_period = period;
+  node->pub_retrans = retrans;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_get_local_model_sub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               size_t max_addresses_size,
+                                               size_t *addresses_len,
+                                               uint8_t *addresses)
+{
+  host_node_t *node = host_node_current();
+  size_t len = 0;
+
+  for (uint8_t i = 0; i < node->sub_count && len + 2 <= max_addresses_size; i++) {
+    addresses[len++] = node->subs[i] & 0xFF;
+    addresses[len++] = node->subs[i] >> 8;
+  }
+  *addresses_len = len;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_add_local_model_sub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t sub_address)
+{
+  host_node_t *node = host_node_current();
+
+  for (uint8_t i = 0; i < node->sub_count; i++) {
+    if (node->subs[i] == sub_address) {
+      return SL_STATUS_ALREADY_EXISTS;
+    }
+  }
+  if (node->sub_count == HOST_SUB_MAX) {
+    return SL_STATUS_NO_MORE_RESOURCE;
+  }
+  node->subs[node->sub_count++] = sub_address;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_set_local_heartbeat_publication(uint16_t publication_address,
+                                                           uint16_t netkey_index,
+                                                           uint8_t count_log,
+                                                           uint8_t period_log,
+                                                           uint8_t ttl,
+                                                           uint16_t features)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_test_set_local_heartbeat_subscription(uint16_t subscription_source,
+                                                            uint16_t subscription_destination,
+                                                            uint8_t period_log)
+{
+  host_node_t *node = host_node_current();
+
+  if (node->heartbeat_sub_status != SL_STATUS_OK) {
+    return node->heartbeat_sub_status;
+  }
+  node->heartbeat_sub_source = subscription_source;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_lpn_init(void)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_lpn_config(uint8_t setting_id, uint32_t value)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_lpn_establish_friendship(uint16_t netkey_index)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_lpn_poll(uint16_t netkey_index)
+{
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_btmesh_friend_init(void)
+{
+  return SL_STATUS_OK;
+}
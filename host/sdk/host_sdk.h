@@ -0,0 +1,145 @@
+/***************************************************************************//**
+ * @file host_sdk.h
+ * @brief Simulated SDK for the host build: clock, app timers, external
+ *        signals, vendor model traffic and the log.
+ *
+ * Every SDK call acts on the current node of the calling thread, set with
+ * host_node_enter(); a thread that never enters one uses a default node of
+ * its own. The clock is per thread too, so scenarios on different threads
+ * do not see each other.
+ *
+ * Nothing runs by itself. Timers fire from host_node_fire_next() or
+ * host_run_until(), external signals collect in the node until taken with
+ * host_node_take_signals(), and messages the node sends or publishes are
+ * handed to its on_tx hook once their final part is given.
+ ******************************************************************************/
+
+#ifndef HOST_SDK_H
+#define HOST_SDK_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sl_status.h"
+
+// Longest vendor message assembled from parts
+#define HOST_TX_MAX                     512
+
+// Subscriptions kept per node
+#define HOST_SUB_MAX                    8
+
+// Opcodes of the vendor model kept per node
+#define HOST_OPCODE_MAX                 16
+
+struct app_timer;
+struct host_node;
+
+// A vendor message leaving a node
+typedef struct {
+  uint16_t source;
+  uint16_t destination;                 // publication address on a publish
+  bool publish;
+  uint16_t appkey_index;
+  uint8_t ttl;
+  uint8_t opcode;
+  uint16_t len;
+  uint8_t data[HOST_TX_MAX];
+} host_tx_t;
+
+typedef void (*host_tx_fn)(struct host_node *node, const host_tx_t *tx);
+
+typedef struct host_node {
+  uint16_t address;
+  void *user;                           // free for the owner of the node
+  host_tx_fn on_tx;                     // NULL drops the traffic
+  sl_status_t tx_status;                // send/publish fail with it if set
+
+  // Vendor model publication and subscriptions
+  bool pub_set;
+  uint16_t pub_address;
+  uint16_t pub_appkey_index;
+  uint8_t pub_ttl;
+  uint8_t pub_period;
+  uint8_t pub_retrans;
+  uint16_t subs[HOST_SUB_MAX];
+  uint8_t sub_count;
+  uint8_t opcodes[HOST_OPCODE_MAX];     // given to sl_btmesh_vendor_model_init()
+  uint8_t opcode_count;
+
+  // Messages being assembled from parts
+  host_tx_t pub_msg;
+  bool pub_ready;                       // final part of pub_msg given
+  host_tx_t send_msg;
+  bool send_open;
+
+  // Network settings last applied
+  uint8_t nettx_count;
+  uint8_t nettx_interval;
+  uint8_t relay_enabled;
+  uint8_t relay_count;
+  uint8_t relay_interval;
+  uint16_t heartbeat_sub_source;
+  sl_status_t heartbeat_sub_status;     // returned by the subscription call
+
+  struct app_timer *timers;             // running timers
+  uint32_t signals;                     // raised, not taken yet
+  uint32_t rng;
+
+  uint32_t sends;                       // messages handed to on_tx
+  uint32_t publishes;
+} host_node_t;
+
+/***************************************************************************//**
+ * Clear @p node and give it @p address.
+ ******************************************************************************/
+void host_node_init(host_node_t *node, uint16_t address);
+
+/***************************************************************************//**
+ * Make @p node the target of the SDK calls of this thread. Returns the node
+ * that was current before.
+ ******************************************************************************/
+host_node_t *host_node_enter(host_node_t *node);
+host_node_t *host_node_current(void);
+
+/***************************************************************************//**
+ * Return and clear the external signals raised on @p node.
+ ******************************************************************************/
+uint32_t host_node_take_signals(host_node_t *node);
+
+/***************************************************************************//**
+ * Deadline of the earliest running timer of @p node, UINT64_MAX if none.
+ ******************************************************************************/
+uint64_t host_node_next_deadline(const host_node_t *node);
+
+/***************************************************************************//**
+ * Fire the earliest timer of @p node due at or before @p until_ms, with the
+ * clock set to its deadline and @p node current. Returns false if none was
+ * due.
+ ******************************************************************************/
+bool host_node_fire_next(host_node_t *node, uint64_t until_ms);
+
+/***************************************************************************//**
+ * Fire the timers of the current node up to @p until_ms in deadline order,
+ * then leave the clock at @p until_ms.
+ ******************************************************************************/
+void host_run_until(uint64_t until_ms);
+
+/***************************************************************************//**
+ * Simulated clock of this thread. The frequency defaults to 32768 Hz.
+ ******************************************************************************/
+void host_clock_set_frequency(uint32_t hz);
+void host_clock_set_ticks(uint64_t ticks);
+void host_clock_set_ms(uint64_t ms);
+uint64_t host_clock_ticks(void);
+uint64_t host_clock_ms(void);
+
+/***************************************************************************//**
+ * Log output. Lines go to stdout unless a sink is set; a NULL sink restores
+ * stdout and host_log_mute() drops everything.
+ ******************************************************************************/
+typedef void (*host_log_fn)(const char *text);
+
+void host_log(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+void host_log_set_sink(host_log_fn sink);
+void host_log_mute(bool mute);
+
+#endif // HOST_SDK_H
@@ -0,0 +1,116 @@
+/***************************************************************************//**
+ * @file host_sensor.c
+ * @brief Stand-in Si70xx humidity and temperature sensor on the simulated
+ *        clock.
+ ******************************************************************************/
+#include <stdbool.h>
+#include <string.h>
+
+#include "sl_sensor_rht.h"
+#include "sl_sleeptimer.h"
+#include "sl_si70xx.h"
+#include "host_sdk.h"
+#include "host_sensor.h"
+
+// Address and command, then address and two bytes per measurement read
+#define START_BYTES                     2
+#define ADDRESS_BYTES                   1
+#define READ_BYTES                      8
+
+typedef struct {
+  uint32_t latency_us;
+  uint32_t humidity;
+  int32_t temperature;
+  bool converting;
+  uint64_t done_ticks;
+  host_sensor_stats_t stats;
+} host_sensor_t;
+
+static __thread host_sensor_t sensor = { .latency_us = 23000, .humidity = 45000, .temperature = 21500 };
+
+sl_i2cspm_t *sl_i2cspm_sensor;
+
+static uint64_t us_to_ticks(uint64_t us)
+{
+  return (us * sl_sleeptimer_get_timer_frequency() + 999999) / 1000000;
+}
+
+/// Hold the caller for @p us of simulated time
+static void hold(uint64_t us)
+{
+  host_clock_set_ticks(host_clock_ticks() + us_to_ticks(us));
+  sensor.stats.held_us += us;
+  sensor.stats.calls++;
+  if (us > sensor.stats.longest_us) {
+    sensor.stats.longest_us = us;
+  }
+}
+
+void host_sensor_set_latency_us(uint32_t latency_us)
+{
+  sensor.latency_us = latency_us;
+}
+
+void host_sensor_set_reading(uint32_t humidity, int32_t temperature)
+{
+  sensor.humidity = humidity;
+  sensor.temperature = temperature;
+}
+
+host_sensor_stats_t host_sensor_take_stats(void)
+{
+  host_sensor_stats_t stats = sensor.stats;
+
+  memset(&sensor.stats, 0, sizeof(sensor.stats));
+  return stats;
+}
+
+sl_status_t sl_si70xx_measure_rh_and_temp(sl_i2cspm_t *i2cspm,
+                                          uint8_t addr,
+                                          uint32_t *rh_data,
+                                          int32_t *t_data)
+{
+  (void)i2cspm;
+  (void)addr;
+  // Hold master mode: the bus and the caller wait out the conversion
+  hold((uint64_t)(START_BYTES + READ_BYTES) * HOST_SENSOR_I2C_BYTE_US + sensor.latency_us);
+  sensor.converting = false;
+  *rh_data = sensor.humidity;
+  *t_data = sensor.temperature;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_si70xx_start_no_hold_measure_rh(sl_i2cspm_t *i2cspm, uint8_t addr)
+{
+  (void)i2cspm;
+  (void)addr;
+  hold(START_BYTES * HOST_SENSOR_I2C_BYTE_US);
+  sensor.converting = true;
+  sensor.done_ticks = host_clock_ticks() + us_to_ticks(sensor.latency_us);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_si70xx_read_rh_and_temp(sl_i2cspm_t *i2cspm,
+                                       uint8_t addr,
+                                       uint32_t *rh_data,
+                                       int32_t *t_data)
+{
+  (void)i2cspm;
+  (void)addr;
+  if (sensor.converting && host_clock_ticks() < sensor.done_ticks) {
+    // Still converting: the address byte is NACKed, the driver's I2C error
+    hold(ADDRESS_BYTES * HOST_SENSOR_I2C_BYTE_US);
+    sensor.stats.nacks++;
+    return SL_STATUS_FAIL;
+  }
+  hold(READ_BYTES * HOST_SENSOR_I2C_BYTE_US);
+  sensor.converting = false;
+  *rh_data = sensor.humidity;
+  *t_data = sensor.temperature;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_sensor_rht_get(uint32_t *rh, int32_t *t)
+{
+  return sl_si70xx_measure_rh_and_temp(sl_i2cspm_sensor, SI7021_ADDR, rh, t);
+}
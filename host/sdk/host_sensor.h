@@ -0,0 +1,41 @@
+/***************************************************************************//**
+ * @file host_sensor.h
+ * @brief Stand-in Si70xx humidity and temperature sensor on the simulated
+ *        clock.
+ *
+ * Every driver call moves the clock of the calling thread on by the time it
+ * would hold the caller: the I2C transfer at HOST_SENSOR_I2C_BYTE_US per
+ * byte, and for the blocking calls the whole conversion as well. A no-hold
+ * conversion finishes the set latency after it was started; a read before
+ * that is NACKed after the address byte, as the sensor does. The time the
+ * calls held the caller is summed, so the blocking of the two ways to read
+ * the sensor can be compared.
+ ******************************************************************************/
+
+#ifndef HOST_SENSOR_H
+#define HOST_SENSOR_H
+
+#include <stdint.h>
+
+// One byte with its ack bit at 100 kHz
+#define HOST_SENSOR_I2C_BYTE_US         90
+
+typedef struct {
+  uint64_t held_us;                     // time the driver calls held the caller
+  uint64_t longest_us;                  // longest single call
+  uint32_t calls;
+  uint32_t nacks;                       // reads before the conversion was done
+} host_sensor_stats_t;
+
+/***************************************************************************//**
+ * Conversion time of the sensor, and the reading it returns.
+ ******************************************************************************/
+void host_sensor_set_latency_us(uint32_t latency_us);
+void host_sensor_set_reading(uint32_t humidity, int32_t temperature);
+
+/***************************************************************************//**
+ * Return the statistics of this thread's sensor and clear them.
+ ******************************************************************************/
+host_sensor_stats_t host_sensor_take_stats(void);
+
+#endif // HOST_SENSOR_H
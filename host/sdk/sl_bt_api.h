@@ -0,0 +1,49 @@
+/***************************************************************************//**
+ * @file sl_bt_api.h
+ * @brief Host stand-in for the subset of the Bluetooth API the apps use.
+ ******************************************************************************/
+
+#ifndef SL_BT_API_H
+#define SL_BT_API_H
+
+#include "sl_status.h"
+
+#define SL_BT_MSG_ID(header)            (header)
+
+enum {
+  sl_bt_evt_system_boot_id = 0x000000a0,
+  sl_bt_evt_system_external_signal_id = 0x030000a0,
+};
+
+typedef struct {
+  uint8_t addr[6];
+} bd_addr;
+
+typedef struct {
+  uint32_t extsignals;
+} sl_bt_evt_system_external_signal_t;
+
+struct sl_bt_msg {
+  uint32_t header;
+  union {
+    sl_bt_evt_system_external_signal_t evt_system_external_signal;
+    uint8_t payload[64];
+  } data;
+};
+
+// Event handler of the app
+void sl_bt_on_event(struct sl_bt_msg *evt);
+
+sl_status_t sl_bt_external_signal(uint32_t signals);
+sl_status_t sl_bt_system_get_random_data(uint8_t length,
+                                         size_t max_data_size,
+                                         size_t *data_len,
+                                         uint8_t *data);
+sl_status_t sl_bt_system_get_identity_address(bd_addr *address, uint8_t *type);
+void sl_bt_system_reboot(void);
+sl_status_t sl_bt_gatt_server_write_attribute_value(uint16_t attribute,
+                                                    uint16_t offset,
+                                                    size_t value_len,
+                                                    const uint8_t *value);
+
+#endif // SL_BT_API_H
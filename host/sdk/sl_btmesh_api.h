@@ -0,0 +1,212 @@
+/***************************************************************************//**
+ * @file sl_btmesh_api.h
+ * @brief Host stand-in for the subset of the Bluetooth Mesh API the apps use.
+ *
+ * Calls act on the current simulated node, see host_sdk.h.
+ ******************************************************************************/
+
+#ifndef SL_BTMESH_API_H
+#define SL_BTMESH_API_H
+
+#include "sl_bt_api.h"
+
+typedef struct {
+  uint8_t len;
+  uint8_t data[];
+} uint8array;
+
+enum {
+  sl_btmesh_evt_node_initialized_id = 0x001400a8,
+  sl_btmesh_evt_node_provisioned_id = 0x011400a8,
+  sl_btmesh_evt_node_config_set_id = 0x031400a8,
+  sl_btmesh_evt_node_provisioning_started_id = 0x061400a8,
+  sl_btmesh_evt_node_provisioning_failed_id = 0x071400a8,
+  sl_btmesh_evt_node_key_added_id = 0x081400a8,
+  sl_btmesh_evt_node_model_config_changed_id = 0x091400a8,
+  sl_btmesh_evt_node_heartbeat_id = 0x1a1400a8,
+  sl_btmesh_evt_vendor_model_receive_id = 0x001900a8,
+  sl_btmesh_evt_lpn_friendship_established_id = 0x001e00a8,
+  sl_btmesh_evt_lpn_friendship_failed_id = 0x011e00a8,
+  sl_btmesh_evt_lpn_friendship_terminated_id = 0x021e00a8,
+  sl_btmesh_evt_friend_friendship_established_id = 0x001f00a8,
+  sl_btmesh_evt_friend_friendship_terminated_id = 0x011f00a8,
+};
+
+enum {
+  sl_btmesh_lpn_queue_length = 0,
+  sl_btmesh_lpn_poll_timeout = 1,
+  sl_btmesh_lpn_receive_delay = 2,
+  sl_btmesh_lpn_request_retries = 3,
+  sl_btmesh_lpn_retry_interval = 4,
+};
+
+typedef struct {
+  uint8_t provisioned;
+  uint16_t address;
+  uint32_t iv_index;
+} sl_btmesh_evt_node_initialized_t;
+
+typedef struct {
+  uint32_t iv_index;
+  uint16_t address;
+} sl_btmesh_evt_node_provisioned_t;
+
+typedef struct {
+  uint16_t result;
+} sl_btmesh_evt_node_provisioning_failed_t;
+
+typedef struct {
+  uint8_t type;
+  uint16_t index;
+} sl_btmesh_evt_node_key_added_t;
+
+typedef struct {
+  uint8_t node_config_state;
+  uint16_t element_address;
+  uint16_t vendor_id;
+  uint16_t model_id;
+} sl_btmesh_evt_node_model_config_changed_t;
+
+typedef struct {
+  uint16_t src_addr;
+  uint16_t dst_addr;
+  uint8_t hops;
+  uint8_t min_hops;
+  uint8_t max_hops;
+} sl_btmesh_evt_node_heartbeat_t;
+
+typedef struct {
+  uint16_t destination_address;
+  uint16_t elem_index;
+  uint16_t vendor_id;
+  uint16_t model_id;
+  uint16_t source_address;
+  int8_t va_index;
+  uint16_t appkey_index;
+  uint8_t nonrelayed;
+  uint8_t opcode;
+  uint8_t final;
+  uint8array payload;
+} sl_btmesh_evt_vendor_model_receive_t;
+
+typedef struct {
+  uint16_t netkey_index;
+  uint16_t friend_address;
+} sl_btmesh_evt_lpn_friendship_established_t;
+
+typedef struct {
+  uint16_t netkey_index;
+  uint16_t reason;
+} sl_btmesh_evt_lpn_friendship_terminated_t;
+
+typedef struct {
+  uint16_t netkey_index;
+  uint16_t lpn_address;
+} sl_btmesh_evt_friend_friendship_established_t;
+
+typedef struct {
+  uint16_t netkey_index;
+  uint16_t lpn_address;
+  uint16_t reason;
+} sl_btmesh_evt_friend_friendship_terminated_t;
+
+typedef struct {
+  uint32_t header;
+  union {
+    sl_btmesh_evt_node_initialized_t evt_node_initialized;
+    sl_btmesh_evt_node_provisioned_t evt_node_provisioned;
+    sl_btmesh_evt_node_provisioning_failed_t evt_node_provisioning_failed;
+    sl_btmesh_evt_node_key_added_t evt_node_key_added;
+    sl_btmesh_evt_node_model_config_changed_t evt_node_model_config_changed;
+    sl_btmesh_evt_node_heartbeat_t evt_node_heartbeat;
+    sl_btmesh_evt_vendor_model_receive_t evt_vendor_model_receive;
+    sl_btmesh_evt_lpn_friendship_established_t evt_lpn_friendship_established;
+    sl_btmesh_evt_lpn_friendship_terminated_t evt_lpn_friendship_terminated;
+    sl_btmesh_evt_friend_friendship_established_t evt_friend_friendship_established;
+    sl_btmesh_evt_friend_friendship_terminated_t evt_friend_friendship_terminated;
+    uint8_t payload[300];
+  } data;
+} sl_btmesh_msg_t;
+
+// Event handler of the app
+void sl_btmesh_on_event(sl_btmesh_msg_t *evt);
+
+sl_status_t sl_btmesh_node_init(void);
+sl_status_t sl_btmesh_node_reset(void);
+sl_status_t sl_btmesh_node_get_element_address(uint16_t elem_index, uint16_t *address);
+
+sl_status_t sl_btmesh_vendor_model_init(uint16_t elem_index,
+                                        uint16_t vendor_id,
+                                        uint16_t model_id,
+                                        uint8_t publish,
+                                        size_t opcodes_len,
+                                        const uint8_t *opcodes);
+sl_status_t sl_btmesh_vendor_model_send(uint16_t destination_address,
+                                        int8_t va_index,
+                                        uint16_t appkey_index,
+                                        uint16_t elem_index,
+                                        uint16_t vendor_id,
+                                        uint16_t model_id,
+                                        uint8_t nonrelayed,
+                                        uint8_t opcode,
+                                        uint8_t final,
+                                        size_t payload_len,
+                                        const uint8_t *payload);
+sl_status_t sl_btmesh_vendor_model_set_publication(uint16_t elem_index,
+                                                   uint16_t vendor_id,
+                                                   uint16_t model_id,
+                                                   uint8_t opcode,
+                                                   uint8_t final,
+                                                   size_t payload_len,
+                                                   const uint8_t *payload);
+sl_status_t sl_btmesh_vendor_model_publish(uint16_t elem_index,
+                                           uint16_t vendor_id,
+                                           uint16_t model_id);
+
+sl_status_t sl_btmesh_test_set_nettx(uint8_t count, uint8_t interval);
+sl_status_t sl_btmesh_test_set_relay(uint8_t enabled, uint8_t count, uint8_t interval);
+sl_status_t sl_btmesh_test_get_local_model_pub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t *appkey_index,
+                                               uint16_t *pub_address,
+                                               uint8_t *ttl,
+                                               uint8_t *period,
+                                               uint8_t *retrans,
+                                               uint8_t *credentials);
+sl_status_t sl_btmesh_test_set_local_model_pub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t appkey_index,
+                                               uint16_t pub_address,
+                                               uint8_t ttl,
+                                               uint8_t period,
+                                               uint8_t retrans,
+                                               uint8_t credentials);
+sl_status_t sl_btmesh_test_get_local_model_sub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               size_t max_addresses_size,
+                                               size_t *addresses_len,
+                                               uint8_t *addresses);
+sl_status_t sl_btmesh_test_add_local_model_sub(uint16_t elem_index,
+                                               uint16_t vendor_id,
+                                               uint16_t model_id,
+                                               uint16_t sub_address);
+sl_status_t sl_btmesh_test_set_local_heartbeat_publication(uint16_t publication_address,
+                                                           uint16_t netkey_index,
+                                                           uint8_t count_log,
+                                                           uint8_t period_log,
+                                                           uint8_t ttl,
+                                                           uint16_t features);
+sl_status_t sl_btmesh_test_set_local_heartbeat_subscription(uint16_t subscription_source,
+                                                            uint16_t subscription_destination,
+                                                            uint8_t period_log);
+
+sl_status_t sl_btmesh_lpn_init(void);
+sl_status_t sl_btmesh_lpn_config(uint8_t setting_id, uint32_t value);
+sl_status_t sl_btmesh_lpn_establish_friendship(uint16_t netkey_index);
+sl_status_t sl_btmesh_lpn_poll(uint16_t netkey_index);
+sl_status_t sl_btmesh_friend_init(void);
+
+#endif // SL_BTMESH_API_H
@@ -0,0 +1,12 @@
+/***************************************************************************//**
+ * @file sl_component_catalog.h
+ * @brief Host stand-in for the generated component catalog.
+ *
+ * No component is present; the host Makefile defines
+ * SL_CATALOG_KERNEL_PRESENT for the task build.
+ ******************************************************************************/
+
+#ifndef SL_COMPONENT_CATALOG_H
+#define SL_COMPONENT_CATALOG_H
+
+#endif // SL_COMPONENT_CATALOG_H
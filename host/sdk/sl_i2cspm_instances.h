@@ -0,0 +1,13 @@
+/***************************************************************************//**
+ * @file sl_i2cspm_instances.h
+ * @brief Host stand-in for the I2C instance the sensor sits on.
+ ******************************************************************************/
+
+#ifndef SL_I2CSPM_INSTANCES_H
+#define SL_I2CSPM_INSTANCES_H
+
+typedef struct host_i2c sl_i2cspm_t;
+
+extern sl_i2cspm_t *sl_i2cspm_sensor;
+
+#endif // SL_I2CSPM_INSTANCES_H
@@ -0,0 +1,14 @@
+/***************************************************************************//**
+ * @file sl_sensor_rht.h
+ * @brief Host stand-in for the blocking RHT sensor service, see host_sensor.h.
+ ******************************************************************************/
+
+#ifndef SL_SENSOR_RHT_H
+#define SL_SENSOR_RHT_H
+
+#include <stdint.h>
+#include "sl_status.h"
+
+sl_status_t sl_sensor_rht_get(uint32_t *rh, int32_t *t);
+
+#endif // SL_SENSOR_RHT_H
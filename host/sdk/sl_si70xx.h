@@ -0,0 +1,25 @@
+/***************************************************************************//**
+ * @file sl_si70xx.h
+ * @brief Host stand-in for the Si70xx driver, see host_sensor.h.
+ ******************************************************************************/
+
+#ifndef SL_SI70XX_H
+#define SL_SI70XX_H
+
+#include <stdint.h>
+#include "sl_status.h"
+#include "sl_i2cspm_instances.h"
+
+#define SI7021_ADDR                     0x40
+
+sl_status_t sl_si70xx_measure_rh_and_temp(sl_i2cspm_t *i2cspm,
+                                          uint8_t addr,
+                                          uint32_t *rh_data,
+                                          int32_t *t_data);
+sl_status_t sl_si70xx_start_no_hold_measure_rh(sl_i2cspm_t *i2cspm, uint8_t addr);
+sl_status_t sl_si70xx_read_rh_and_temp(sl_i2cspm_t *i2cspm,
+                                       uint8_t addr,
+                                       uint32_t *rh_data,
+                                       int32_t *t_data);
+
+#endif // SL_SI70XX_H
@@ -0,0 +1,25 @@
+/***************************************************************************//**
+ * @file sl_simple_button.h
+ * @brief Host stand-in for the simple button driver: buttons are released
+ *        unless host_button_set() holds them down.
+ ******************************************************************************/
+
+#ifndef SL_SIMPLE_BUTTON_H
+#define SL_SIMPLE_BUTTON_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#define SL_SIMPLE_BUTTON_RELEASED       0
+#define SL_SIMPLE_BUTTON_PRESSED        1
+
+typedef struct {
+  uint8_t index;
+} sl_button_t;
+
+uint8_t sl_simple_button_get_state(const sl_button_t *button);
+
+/// Hold button @p index down or release it
+void host_button_set(uint8_t index, bool pressed);
+
+#endif // SL_SIMPLE_BUTTON_H
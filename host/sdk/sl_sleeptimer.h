@@ -0,0 +1,15 @@
+/***************************************************************************//**
+ * @file sl_sleeptimer.h
+ * @brief Host stand-in for the SDK sleeptimer: the simulated clock.
+ ******************************************************************************/
+
+#ifndef SL_SLEEPTIMER_H
+#define SL_SLEEPTIMER_H
+
+#include "sl_status.h"
+
+uint64_t sl_sleeptimer_get_tick_count64(void);
+uint32_t sl_sleeptimer_get_tick_count(void);
+uint32_t sl_sleeptimer_get_timer_frequency(void);
+
+#endif // SL_SLEEPTIMER_H
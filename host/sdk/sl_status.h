@@ -0,0 +1,30 @@
+/***************************************************************************//**
+ * @file sl_status.h
+ * @brief Host stand-in for the SDK status codes.
+ ******************************************************************************/
+
+#ifndef SL_STATUS_H
+#define SL_STATUS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef uint32_t sl_status_t;
+
+#define SL_STATUS_OK                    0x0000
+#define SL_STATUS_FAIL                  0x0001
+#define SL_STATUS_INVALID_STATE         0x0002
+#define SL_STATUS_NOT_READY             0x0003
+#define SL_STATUS_BUSY                  0x0004
+#define SL_STATUS_IN_PROGRESS           0x0005
+#define SL_STATUS_TIMEOUT               0x0007
+#define SL_STATUS_NOT_FOUND             0x000E
+#define SL_STATUS_ALREADY_EXISTS        0x0010
+#define SL_STATUS_NO_MORE_RESOURCE      0x0019
+#define SL_STATUS_INVALID_PARAMETER     0x0021
+#define SL_STATUS_WOULD_OVERFLOW        0x002A
+#define SL_STATUS_FULL                  0x002B
+#define SL_STATUS_EMPTY                 0x002C
+
+#endif // SL_STATUS_H
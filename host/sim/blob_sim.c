@@ -0,0 +1,424 @@
+/***************************************************************************//**
+ * @file blob_sim.c
+ * @brief Transmissions needed to push a configuration blob to 10 to 500
+ *        clients with the multicast distribution of app_blob_tx.c.
+ *
+ * The server runs the real app_blob_tx.c; the clients do what app_blob_rx.c
+ * does: keep a bitmap of the chunks they hold and answer a query with the
+ * missing ones after a random delay within the spread it carries, a group
+ * query only once when complete.
+ *
+ * Each client sits 1 to MAX_HOPS hops from the server, every hop adding a
+ * relay delay. Every copy of a message is lost end to end with the given
+ * loss, for each client on its own. A status answer goes out NETTX_COUNT
+ * times NETTX_INTERVAL_MS apart, and copies that reach the server in the
+ * same millisecond collide and are all lost.
+ *
+ * The table gives, per group size and averaged over the seeds, the time
+ * until the transfer ended, the clients complete in the worst seed, the
+ * query rounds, the chunks and queries the server sent and the status
+ * answers that reached it. The last column is what unicasting the blob
+ * would take: every chunk to every client, resent until it gets through.
+ *
+ * Usage: blob_sim [loss_pct [seeds [blob_len]]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_blob_tx.h"
+#include "app_ctrl.h"
+#include "app_time.h"
+
+#define MAX_NODES                       500
+#define MAX_HOPS                        4
+#define HOP_DELAY_MIN_MS                10
+#define HOP_DELAY_SPREAD_MS             20
+#define NETTX_COUNT                     3
+#define NETTX_INTERVAL_MS               20
+#define SERVER_ADDRESS                  0x0001
+#define FIRST_CLIENT                    0x0002
+#define HORIZON_MS                      600000
+
+#define EX_BLOB_TICK                    (1u << 4)
+
+typedef enum {
+  EV_MESSAGE,                           // a blob_transfer reaches a client
+  EV_REPLY,                             // the answer delay of a client is over
+  EV_STATUS,                            // a status copy has reached the server
+} sim_kind_t;
+
+typedef struct {
+  uint64_t at_ms;
+  sim_kind_t kind;
+  uint16_t client;
+  uint32_t instance;                    // reply: answer of this query
+  uint8_t len;
+  uint8_t data[APP_BLOB_CHUNK_MAX_LEN];
+} sim_event_t;
+
+typedef struct {
+  sim_event_t *items;
+  size_t count;
+  size_t size;
+} sim_heap_t;
+
+// What app_blob_rx.c keeps
+typedef struct {
+  uint8_t hops;
+  bool have_blob;
+  uint8_t blob_id;
+  uint8_t total;
+  uint32_t received;
+  bool reported;
+  uint32_t queries;                     // also the instance of the next answer
+  uint32_t status_sent;                 // instance + 1 of the last one through
+} sim_client_t;
+
+typedef struct {
+  uint64_t done_ms;
+  uint32_t complete;
+  uint32_t rounds;
+  uint32_t chunk_sends;
+  uint32_t queries;
+  uint32_t answers;
+} sim_result_t;
+
+static sim_client_t clients[MAX_NODES];
+static uint32_t client_count;
+static host_node_t server;
+static app_blob_tx_t blob_tx;
+static sim_heap_t heap;
+static uint8_t arrivals[HORIZON_MS];
+static uint32_t rng;
+static uint32_t loss_pct;
+static sim_result_t result;
+static bool done;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void heap_push(const sim_event_t *ev)
+{
+  size_t i;
+
+  if (heap.count == heap.size) {
+    heap.size = heap.size ? heap.size * 2 : 1024;
+    heap.items = realloc(heap.items, heap.size * sizeof(*heap.items));
+  }
+  i = heap.count++;
+  while (i > 0 && heap.items[(i - 1) / 2].at_ms > ev->at_ms) {
+    heap.items[i] = heap.items[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap.items[i] = *ev;
+}
+
+static void heap_pop(sim_event_t *ev)
+{
+  sim_event_t last = heap.items[--heap.count];
+  size_t i = 0;
+
+  *ev = heap.items[0];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.count) {
+      break;
+    }
+    if (child + 1 < heap.count && heap.items[child + 1].at_ms < heap.items[child].at_ms) {
+      child++;
+    }
+    if (heap.items[child].at_ms >= last.at_ms) {
+      break;
+    }
+    heap.items[i] = heap.items[child];
+    i = child;
+  }
+  if (heap.count > 0) {
+    heap.items[i] = last;
+  }
+}
+
+static uint32_t path_delay(uint16_t client)
+{
+  uint32_t ms = 0;
+
+  for (uint8_t h = 0; h < clients[client].hops; h++) {
+    ms += HOP_DELAY_MIN_MS + next_random() % HOP_DELAY_SPREAD_MS;
+  }
+  return ms;
+}
+
+static uint32_t all_chunks(const sim_client_t *cl)
+{
+  return cl->total >= 32 ? UINT32_MAX : (1u << cl->total) - 1;
+}
+
+static void deliver_message(uint16_t client, const uint8_t *data, uint8_t len)
+{
+  sim_event_t ev = { .kind = EV_MESSAGE, .client = client, .len = len };
+
+  if (next_random() % 100 < loss_pct) {
+    return;
+  }
+  ev.at_ms = host_clock_ms() + path_delay(client);
+  memcpy(ev.data, data, len);
+  heap_push(&ev);
+}
+
+static sl_status_t server_send(app_blob_tx_t *b,
+                               uint16_t destination,
+                               const uint8_t *data,
+                               uint8_t len)
+{
+  (void)b;
+  if (data[0] == APP_BLOB_TYPE_CHUNK) {
+    result.chunk_sends++;
+  } else {
+    result.queries++;
+  }
+  if (destination == APP_CTRL_GROUP_ADDR) {
+    for (uint16_t c = 0; c < client_count; c++) {
+      deliver_message(c, data, len);
+    }
+  } else if (destination >= FIRST_CLIENT && destination < FIRST_CLIENT + client_count) {
+    deliver_message(destination - FIRST_CLIENT, data, len);
+  }
+  return SL_STATUS_OK;
+}
+
+/// What follow() in app_blob_rx.c does
+static bool client_follow(sim_client_t *cl, uint8_t id, uint8_t total)
+{
+  if (total == 0 || total > APP_BLOB_MAX_CHUNKS) {
+    return false;
+  }
+  if (cl->have_blob && id == cl->blob_id) {
+    return total == cl->total;
+  }
+  cl->have_blob = true;
+  cl->blob_id = id;
+  cl->total = total;
+  cl->received = 0;
+  cl->reported = false;
+  // A pending answer belongs to the old blob
+  cl->queries++;
+  return true;
+}
+
+static void client_answer(uint16_t c)
+{
+  sim_client_t *cl = &clients[c];
+  uint32_t missing = all_chunks(cl) & ~cl->received;
+  sim_event_t ev = { .kind = EV_STATUS, .client = c, .len = APP_BLOB_STATUS_LEN };
+
+  ev.instance = cl->queries;
+  ev.data[0] = cl->blob_id;
+  ev.data[1] = missing & 0xFF;
+  ev.data[2] = (missing >> 8) & 0xFF;
+  ev.data[3] = (missing >> 16) & 0xFF;
+  ev.data[4] = missing >> 24;
+  if (missing == 0) {
+    cl->reported = true;
+  }
+  for (int k = 0; k < NETTX_COUNT; k++) {
+    uint64_t at = host_clock_ms() + (uint64_t)k * NETTX_INTERVAL_MS + path_delay(c);
+    if (next_random() % 100 < loss_pct) {
+      continue;
+    }
+    if (at < HORIZON_MS) {
+      arrivals[at]++;
+    }
+    // Judged once the millisecond is over and every copy in it is known
+    ev.at_ms = at + 1;
+    heap_push(&ev);
+  }
+}
+
+static void client_on_message(const sim_event_t *msg)
+{
+  sim_client_t *cl = &clients[msg->client];
+  const uint8_t *data = msg->data;
+
+  if (data[0] == APP_BLOB_TYPE_CHUNK) {
+    if (client_follow(cl, data[1], data[3]) && data[2] < cl->total) {
+      cl->received |= 1u << data[2];
+    }
+    return;
+  }
+  if (!client_follow(cl, data[1], data[2])) {
+    return;
+  }
+  if (cl->received == all_chunks(cl) && cl->reported && !(data[4] & APP_BLOB_QUERY_ALWAYS)) {
+    return;
+  }
+  // A new query replaces an answer still waiting
+  cl->queries++;
+  if (data[3] == 0) {
+    client_answer(msg->client);
+  } else {
+    sim_event_t ev = { .kind = EV_REPLY, .client = msg->client, .instance = cl->queries };
+    ev.at_ms = host_clock_ms() + 1 + next_random() % ((uint32_t)data[3] * APP_BLOB_SPREAD_UNIT_MS);
+    heap_push(&ev);
+  }
+}
+
+static void server_on_status(const sim_event_t *ev)
+{
+  sim_client_t *cl = &clients[ev->client];
+  uint64_t at = ev->at_ms - 1;
+
+  if (at < HORIZON_MS && arrivals[at] > 1) {
+    return;
+  }
+  if (cl->status_sent > ev->instance) {
+    // Another copy of the same answer got through; the network cache drops it
+    return;
+  }
+  cl->status_sent = ev->instance + 1;
+  result.answers++;
+  app_blob_tx_on_status(&blob_tx, FIRST_CLIENT + ev->client, ev->data, ev->len);
+}
+
+static void on_log(const char *text)
+{
+  const char *at = strstr(text, "nodes complete in");
+  unsigned complete, targets, rounds;
+  unsigned long ms;
+
+  if (strstr(text, "status answers") != NULL) {
+    done = true;
+  }
+  if (at == NULL) {
+    return;
+  }
+  // Back over the space to the start of the counts before it
+  at--;
+  while (at > text && at[-1] != ' ') {
+    at--;
+  }
+  if (sscanf(at, "%u/%u nodes complete in %lu ms, %u rounds",
+             &complete, &targets, &ms, &rounds) == 4) {
+    result.done_ms = ms;
+    result.complete = complete;
+    result.rounds = rounds;
+  }
+}
+
+static void run(uint32_t seed, uint16_t blob_len)
+{
+  uint8_t blob[APP_BLOB_MAX_LEN];
+
+  memset(&result, 0, sizeof(result));
+  memset(arrivals, 0, sizeof(arrivals));
+  heap.count = 0;
+  done = false;
+  rng = seed * 2654435761u + 17;
+
+  for (uint16_t c = 0; c < client_count; c++) {
+    memset(&clients[c], 0, sizeof(clients[c]));
+    clients[c].hops = (uint8_t)(1 + next_random() % MAX_HOPS);
+  }
+  for (uint16_t i = 0; i < blob_len; i++) {
+    blob[i] = (uint8_t)next_random();
+  }
+  host_node_init(&server, SERVER_ADDRESS);
+  server.rng ^= seed;
+  host_node_enter(&server);
+  host_clock_set_ms(0);
+  app_blob_tx_init(&blob_tx, server_send, EX_BLOB_TICK);
+  for (uint16_t c = 0; c < client_count; c++) {
+    app_blob_tx_note_node(&blob_tx, FIRST_CLIENT + c);
+  }
+  app_blob_tx_start(&blob_tx, blob, blob_len);
+
+  while (!done) {
+    uint64_t timer_at = host_node_next_deadline(&server);
+    uint64_t event_at = heap.count ? heap.items[0].at_ms : UINT64_MAX;
+
+    if (timer_at == UINT64_MAX && event_at == UINT64_MAX) {
+      break;
+    }
+    if (timer_at <= event_at) {
+      host_node_fire_next(&server, timer_at);
+      if (host_node_take_signals(&server) & EX_BLOB_TICK) {
+        app_blob_tx_process(&blob_tx);
+      }
+    } else {
+      sim_event_t ev;
+      heap_pop(&ev);
+      host_clock_set_ms(ev.at_ms);
+      if (ev.kind == EV_MESSAGE) {
+        client_on_message(&ev);
+      } else if (ev.kind == EV_REPLY) {
+        if (ev.instance == clients[ev.client].queries) {
+          client_answer(ev.client);
+        }
+      } else {
+        server_on_status(&ev);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const uint32_t sizes[] = { 10, 20, 50, 100, 200, 500 };
+  uint32_t seeds = 10;
+  uint32_t blob_len = 512;
+  uint32_t chunks;
+
+  loss_pct = argc > 1 ? (uint32_t)atoi(argv[1]) : 10;
+  if (argc > 2) {
+    seeds = (uint32_t)atoi(argv[2]);
+  }
+  if (argc > 3) {
+    blob_len = (uint32_t)atoi(argv[3]);
+  }
+  if (loss_pct >= 100 || seeds == 0 || blob_len == 0 || blob_len > APP_BLOB_MAX_LEN) {
+    fprintf(stderr, "usage: %s [loss_pct [seeds [blob_len]]]\n", argv[0]);
+    return 2;
+  }
+  chunks = (blob_len + APP_BLOB_CHUNK_DATA - 1) / APP_BLOB_CHUNK_DATA;
+
+  host_log_set_sink(on_log);
+  app_time_init();
+  printf("%u byte blob in %u chunks, %u%% loss, 1-%u hops, %u seeds\n",
+         blob_len, chunks, loss_pct, MAX_HOPS, seeds);
+  printf("nodes  done mean  complete min  rounds  chunk sends  queries  answers  sent  unicast\n");
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+    uint64_t done_sum = 0, rounds = 0, chunk_sends = 0, queries = 0, answers = 0;
+    uint32_t complete_min = UINT32_MAX;
+
+    client_count = sizes[s];
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+      run(seed, (uint16_t)blob_len);
+      done_sum += result.done_ms;
+      if (result.complete < complete_min) {
+        complete_min = result.complete;
+      }
+      rounds += result.rounds;
+      chunk_sends += result.chunk_sends;
+      queries += result.queries;
+      answers += result.answers;
+    }
+    printf("%5u  %7.2f s  %12u  %6.2f  %11.1f  %7.1f  %7.1f  %4.0f  %7.0f\n",
+           client_count,
+           done_sum / 1000.0 / seeds,
+           complete_min,
+           (double)rounds / seeds,
+           (double)chunk_sends / seeds,
+           (double)queries / seeds,
+           (double)answers / seeds,
+           (double)(chunk_sends + queries) / seeds,
+           client_count * chunks * 100.0 / (100 - loss_pct));
+  }
+  free(heap.items);
+  return 0;
+}
@@ -0,0 +1,434 @@
+/***************************************************************************//**
+ * @file bulk_sim.c
+ * @brief Goodput of a log upload with the bulk transfer of app_bulk_tx.c and
+ *        app_bulk_rx.c, against publishing the same samples one by one.
+ *
+ * A client HOPS hops from the server holds a full log of
+ * APP_BULK_TX_LOG_RECORDS records and moves it to the server:
+ *
+ *   publish      every record is published once in its own message, as
+ *                fast as the path takes them; nothing is acked
+ *   publish x3   the same with two publication retransmits per record
+ *   bulk         the real app_bulk_tx.c and app_bulk_rx.c, one session
+ *
+ * A message of up to 11 payload bytes fits one network PDU; a longer one is
+ * segmented into 12-byte segments, and to a unicast address the lower
+ * transport acks the segments and resends the missing ones, SAR_ROUNDS
+ * times at most. A record published alone fits one PDU with its time stamp.
+ *
+ * Every PDU is sent NETTX_COUNT times NETTX_INTERVAL_MS apart and relayed
+ * the same way at every hop; a copy is lost with the given loss, a PDU at a
+ * hop only if all of its copies are. The hops share the air: a relay can
+ * send only while the nodes two hops either side are quiet, so a chain
+ * carries one PDU per three hops at a time. Both directions use the same
+ * chain.
+ *
+ * The table gives, per loss rate and averaged over the seeds, the records
+ * the server got, the time until the last of them, the goodput in record
+ * bytes per second and the PDU transmissions on air, relays included.
+ *
+ * Usage: bulk_sim [hops [seeds]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_bulk_rx.h"
+#include "app_bulk_tx.h"
+#include "app_time.h"
+
+#define MAX_HOPS                        8
+#define NETTX_COUNT                     3
+#define NETTX_INTERVAL_MS               20
+#define SAR_ROUNDS                      3
+#define SERVER_ADDRESS                  0x0001
+#define CLIENT_ADDRESS                  0x0002
+#define RECORDS                         APP_BULK_TX_LOG_RECORDS
+
+// Payload bytes of an unsegmented access message, and per segment
+#define UNSEGMENTED_MAX                 11
+#define SEGMENT_LEN                     12
+// Vendor opcode and transport MIC
+#define ACCESS_OVERHEAD                 (3 + 4)
+
+#define EX_BULK_TICK                    (1u << 0)
+
+typedef enum {
+  MODE_PUBLISH,
+  MODE_PUBLISH_X3,
+  MODE_BULK,
+  MODE_COUNT
+} sim_mode_t;
+
+static const char *const mode_names[MODE_COUNT] = {
+  "publish", "publish x3", "bulk",
+};
+
+typedef enum {
+  EV_CHUNK,                             // a bulk_chunk reaches the server
+  EV_ACK,                               // a bulk_ack reaches the client
+} sim_kind_t;
+
+typedef struct {
+  uint64_t at_ms;
+  sim_kind_t kind;
+  uint8_t len;
+  uint8_t data[APP_BULK_CHUNK_MAX_LEN];
+} sim_event_t;
+
+typedef struct {
+  sim_event_t *items;
+  size_t count;
+  size_t size;
+} sim_heap_t;
+
+typedef struct {
+  uint32_t records;
+  uint64_t done_ms;
+  uint64_t pdus;
+} sim_result_t;
+
+static host_node_t client;
+static host_node_t server;
+static app_bulk_tx_t bulk_tx;
+static app_bulk_rx_t bulk_rx;
+static sim_heap_t heap;
+static uint8_t records[RECORDS][APP_BULK_RECORD_LEN];
+static uint32_t hops;
+static uint32_t loss_pct;
+static uint32_t rng;
+static uint64_t air_free_ms;            // the chain is busy until then
+static uint64_t start_ms;
+static sim_result_t result;
+static bool finished;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void heap_push(const sim_event_t *ev)
+{
+  size_t i;
+
+  if (heap.count == heap.size) {
+    heap.size = heap.size ? heap.size * 2 : 1024;
+    heap.items = realloc(heap.items, heap.size * sizeof(*heap.items));
+  }
+  i = heap.count++;
+  while (i > 0 && heap.items[(i - 1) / 2].at_ms > ev->at_ms) {
+    heap.items[i] = heap.items[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap.items[i] = *ev;
+}
+
+static void heap_pop(sim_event_t *ev)
+{
+  sim_event_t last = heap.items[--heap.count];
+  size_t i = 0;
+
+  *ev = heap.items[0];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.count) {
+      break;
+    }
+    if (child + 1 < heap.count && heap.items[child + 1].at_ms < heap.items[child].at_ms) {
+      child++;
+    }
+    if (heap.items[child].at_ms >= last.at_ms) {
+      break;
+    }
+    heap.items[i] = heap.items[child];
+    i = child;
+  }
+  if (heap.count > 0) {
+    heap.items[i] = last;
+  }
+}
+
+static uint32_t pdus_of(uint8_t len)
+{
+  if (len <= UNSEGMENTED_MAX) {
+    return 1;
+  }
+  return (len + ACCESS_OVERHEAD + SEGMENT_LEN - 1) / SEGMENT_LEN;
+}
+
+/// Whether one PDU makes it over the whole chain
+static bool pdu_through(void)
+{
+  for (uint32_t h = 0; h < hops; h++) {
+    bool through = false;
+    for (int k = 0; k < NETTX_COUNT; k++) {
+      if (next_random() % 100 >= loss_pct) {
+        through = true;
+      }
+    }
+    if (!through) {
+      return false;
+    }
+  }
+  return true;
+}
+
+/***************************************************************************//**
+ * Put @p pdus PDUs on the chain at the current time or once it is free.
+ * Returns when the last of them reaches the far end.
+ ******************************************************************************/
+static uint64_t transmit(uint32_t pdus)
+{
+  uint32_t slot = NETTX_COUNT * NETTX_INTERVAL_MS;
+  uint32_t stages = hops < 3 ? hops : 3;
+  uint64_t begin = host_clock_ms() > air_free_ms ? host_clock_ms() : air_free_ms;
+
+  air_free_ms = begin + (uint64_t)pdus * slot * stages;
+  result.pdus += (uint64_t)pdus * NETTX_COUNT * hops;
+  return air_free_ms + (uint64_t)(hops - stages) * slot;
+}
+
+/***************************************************************************//**
+ * Send a message of @p len payload bytes over the chain. Returns true and
+ * the arrival time in @p at_ms if it got through.
+ ******************************************************************************/
+static bool deliver(uint8_t len, bool unicast, uint64_t *at_ms)
+{
+  uint32_t pdus = pdus_of(len);
+  uint32_t missing = pdus;
+  uint64_t at = host_clock_ms();
+
+  if (pdus == 1 || !unicast) {
+    bool through = true;
+    for (uint32_t p = 0; p < pdus; p++) {
+      through &= pdu_through();
+    }
+    *at_ms = transmit(pdus);
+    return through;
+  }
+  // Segments to a unicast address: the segment ack names the missing ones
+  for (int round = 0; round < SAR_ROUNDS && missing != 0; round++) {
+    uint32_t lost = 0;
+    for (uint32_t p = 0; p < missing; p++) {
+      if (!pdu_through()) {
+        lost++;
+      }
+    }
+    at = transmit(missing);
+    missing = lost;
+    // The segment ack comes back on the same chain
+    host_clock_set_ms(at);
+    at = transmit(1);
+  }
+  *at_ms = at;
+  return missing == 0;
+}
+
+static sl_status_t send_chunk(app_bulk_tx_t *bulk,
+                              uint16_t destination,
+                              const uint8_t *data,
+                              uint8_t len)
+{
+  uint64_t now = host_clock_ms();
+  sim_event_t ev = { .kind = EV_CHUNK, .len = len };
+
+  (void)bulk;
+  (void)destination;
+  if (deliver(len, true, &ev.at_ms)) {
+    memcpy(ev.data, data, len);
+    heap_push(&ev);
+  }
+  host_clock_set_ms(now);
+  return SL_STATUS_OK;
+}
+
+static sl_status_t send_ack(app_bulk_rx_t *bulk,
+                            uint16_t destination,
+                            const uint8_t *data,
+                            uint8_t len)
+{
+  uint64_t now = host_clock_ms();
+  sim_event_t ev = { .kind = EV_ACK, .len = len };
+
+  (void)bulk;
+  (void)destination;
+  if (deliver(len, true, &ev.at_ms)) {
+    memcpy(ev.data, data, len);
+    heap_push(&ev);
+  }
+  host_clock_set_ms(now);
+  return SL_STATUS_OK;
+}
+
+static void on_done(app_bulk_rx_t *bulk,
+                    uint16_t source,
+                    const uint8_t *data,
+                    uint16_t len,
+                    uint32_t elapsed_ms)
+{
+  (void)bulk;
+  (void)source;
+  (void)elapsed_ms;
+  if (len == sizeof(records) && memcmp(data, records, len) == 0) {
+    result.records = RECORDS;
+  }
+  result.done_ms = host_clock_ms() - start_ms;
+}
+
+static void on_log(const char *text)
+{
+  if (strstr(text, "Bulk upload") != NULL) {
+    finished = true;
+  }
+}
+
+static void client_process(void)
+{
+  if (host_node_take_signals(&client) & EX_BULK_TICK) {
+    app_bulk_tx_process(&bulk_tx);
+  }
+}
+
+static void run_bulk(void)
+{
+  host_node_init(&client, CLIENT_ADDRESS);
+  host_node_init(&server, SERVER_ADDRESS);
+  client.rng ^= rng;
+  host_node_enter(&server);
+  app_bulk_rx_init(&bulk_rx, send_ack, on_done);
+  host_node_enter(&client);
+  app_bulk_tx_init(&bulk_tx, send_chunk, EX_BULK_TICK);
+  for (uint32_t r = 0; r < RECORDS; r++) {
+    app_bulk_tx_log(&bulk_tx,
+                    records[r],
+                    (uint32_t)records[r][APP_SENSOR_PACKED_LEN]
+                    | (uint32_t)records[r][APP_SENSOR_PACKED_LEN + 1] << 8
+                    | (uint32_t)records[r][APP_SENSOR_PACKED_LEN + 2] << 16
+                    | (uint32_t)records[r][APP_SENSOR_PACKED_LEN + 3] << 24);
+  }
+  heap.count = 0;
+  finished = false;
+  app_bulk_tx_start(&bulk_tx, SERVER_ADDRESS);
+
+  while (!finished) {
+    uint64_t timer_at = host_node_next_deadline(&client);
+    uint64_t event_at = heap.count ? heap.items[0].at_ms : UINT64_MAX;
+
+    if (timer_at == UINT64_MAX && event_at == UINT64_MAX) {
+      break;
+    }
+    if (timer_at <= event_at) {
+      host_node_fire_next(&client, timer_at);
+      client_process();
+    } else {
+      sim_event_t ev;
+      heap_pop(&ev);
+      host_clock_set_ms(ev.at_ms);
+      if (ev.kind == EV_CHUNK) {
+        host_node_enter(&server);
+        app_bulk_rx_on_chunk(&bulk_rx, CLIENT_ADDRESS, ev.data, ev.len);
+      } else {
+        host_node_enter(&client);
+        app_bulk_tx_on_ack(&bulk_tx, SERVER_ADDRESS, ev.data, ev.len);
+        client_process();
+      }
+    }
+  }
+}
+
+static void run_publish(int copies)
+{
+  for (uint32_t r = 0; r < RECORDS; r++) {
+    bool through = false;
+    uint64_t at = 0;
+
+    for (int c = 0; c < copies; c++) {
+      through |= deliver(APP_BULK_RECORD_LEN, false, &at);
+    }
+    if (through) {
+      result.records++;
+      result.done_ms = at - start_ms;
+    }
+    // The next record goes out once the chain takes it
+    host_clock_set_ms(air_free_ms);
+  }
+}
+
+static void run(sim_mode_t mode, uint32_t seed)
+{
+  memset(&result, 0, sizeof(result));
+  rng = seed * 2654435761u + 17;
+  // Samples ten seconds apart, a few degrees and percent apart
+  for (uint32_t r = 0; r < RECORDS; r++) {
+    uint32_t t = 100000 + 10 * r;
+    for (int i = 0; i < APP_SENSOR_PACKED_LEN; i++) {
+      records[r][i] = (uint8_t)(next_random() >> 8);
+    }
+    records[r][APP_SENSOR_PACKED_LEN] = t & 0xFF;
+    records[r][APP_SENSOR_PACKED_LEN + 1] = (t >> 8) & 0xFF;
+    records[r][APP_SENSOR_PACKED_LEN + 2] = (t >> 16) & 0xFF;
+    records[r][APP_SENSOR_PACKED_LEN + 3] = t >> 24;
+  }
+  start_ms = 1000;
+  host_clock_set_ms(start_ms);
+  air_free_ms = start_ms;
+
+  switch (mode) {
+    case MODE_PUBLISH:
+      run_publish(1);
+      break;
+    case MODE_PUBLISH_X3:
+      run_publish(3);
+      break;
+    default:
+      run_bulk();
+      break;
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const uint32_t losses[] = { 0, 10, 20, 30 };
+  uint32_t seeds = 20;
+
+  hops = argc > 1 ? (uint32_t)atoi(argv[1]) : 3;
+  if (argc > 2) {
+    seeds = (uint32_t)atoi(argv[2]);
+  }
+  if (hops == 0 || hops > MAX_HOPS || seeds == 0) {
+    fprintf(stderr, "usage: %s [hops [seeds]]\n", argv[0]);
+    return 2;
+  }
+
+  host_log_set_sink(on_log);
+  app_time_init();
+  printf("%u records of %u bytes, %u hops, %u copies %u ms apart, %u seeds\n",
+         RECORDS, APP_BULK_RECORD_LEN, hops, NETTX_COUNT, NETTX_INTERVAL_MS, seeds);
+  printf("loss  mode         records    time s   goodput B/s  PDUs on air\n");
+  for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+    loss_pct = losses[l];
+    for (int m = 0; m < MODE_COUNT; m++) {
+      uint64_t got = 0, ms = 0, pdus = 0;
+
+      for (uint32_t seed = 1; seed <= seeds; seed++) {
+        run((sim_mode_t)m, seed);
+        got += result.records;
+        ms += result.done_ms;
+        pdus += result.pdus;
+      }
+      printf("%3u%%  %-11s  %7.1f  %8.2f  %12.1f  %11.0f\n",
+             loss_pct,
+             mode_names[m],
+             (double)got / seeds,
+             ms / 1000.0 / seeds,
+             ms != 0 ? (double)got * APP_BULK_RECORD_LEN * 1000.0 / ms : 0.0,
+             (double)pdus / seeds);
+    }
+  }
+  free(heap.items);
+  return 0;
+}
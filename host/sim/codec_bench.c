@@ -0,0 +1,141 @@
+/***************************************************************************//**
+ * @file codec_bench.c
+ * @brief Packed size, accuracy and speed of the sensor_status codec of
+ *        app_sensor_codec.c.
+ *
+ * The samples are the temperature and humidity traces of tests/rht_trace.h.
+ * Each one is packed and unpacked by the codec, and for comparison copied
+ * as the raw app_sensor_sample_t the payload used to be. The table gives
+ * per format the payload size, the largest round-trip error per field, and
+ * the time per encode and per decode on this host, the best of a few timed
+ * passes over all samples.
+ *
+ * Usage: codec_bench [samples]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_sensor_codec.h"
+#include "rht_trace.h"
+
+#define DEFAULT_SAMPLES                 100000
+#define PASSES                          10
+
+typedef struct {
+  const char *name;
+  uint8_t len;
+  void (*encode)(const app_sensor_sample_t *sample, uint8_t *out);
+  bool (*decode)(const uint8_t *data, uint8_t len, app_sensor_sample_t *sample);
+} codec_t;
+
+static void raw_encode(const app_sensor_sample_t *sample, uint8_t *out)
+{
+  memcpy(out, sample, sizeof(*sample));
+}
+
+static bool raw_decode(const uint8_t *data, uint8_t len, app_sensor_sample_t *sample)
+{
+  if (len != sizeof(*sample)) {
+    return false;
+  }
+  memcpy(sample, data, sizeof(*sample));
+  return true;
+}
+
+static const codec_t codecs[] = {
+  { "raw struct", sizeof(app_sensor_sample_t), raw_encode, raw_decode },
+  { "packed", APP_SENSOR_PACKED_LEN, app_sensor_pack, app_sensor_unpack },
+};
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+  static const rht_trace_config_t trace_config[2] = {
+    RHT_TRACE_TEMPERATURE,
+    RHT_TRACE_HUMIDITY,
+  };
+  uint32_t count = argc > 1 ? (uint32_t)atoi(argv[1]) : DEFAULT_SAMPLES;
+  app_sensor_sample_t *samples;
+  uint8_t *payloads;
+  rht_trace_t trace[2];
+  double truth;
+
+  if (count == 0) {
+    fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+    return 2;
+  }
+  samples = malloc(count * sizeof(*samples));
+  payloads = malloc((size_t)count * sizeof(app_sensor_sample_t));
+  if (samples == NULL || payloads == NULL) {
+    return 1;
+  }
+  for (int c = 0; c < 2; c++) {
+    rht_trace_init(&trace[c], &trace_config[c], (uint64_t)c + 1);
+  }
+  for (uint32_t i = 0; i < count; i++) {
+    samples[i].temperature = rht_trace_next(&trace[0], &truth);
+    samples[i].humidity = rht_trace_next(&trace[1], &truth);
+  }
+
+  printf("%u samples from tests/rht_trace.h, %d passes, schema of %u bits\n\n",
+         count, PASSES, (unsigned)APP_SENSOR_PACKED_BITS);
+  printf("%-12s  bytes  max err temp  max err hum  ns/encode  ns/decode\n", "format");
+  for (size_t c = 0; c < sizeof(codecs) / sizeof(codecs[0]); c++) {
+    const codec_t *codec = &codecs[c];
+    int32_t max_temp = 0, max_hum = 0;
+    double best_encode = 1e30, best_decode = 1e30;
+    volatile int32_t sink = 0;
+
+    for (int pass = 0; pass < PASSES; pass++) {
+      double start = now_ns();
+      for (uint32_t i = 0; i < count; i++) {
+        codec->encode(&samples[i], &payloads[(size_t)i * codec->len]);
+      }
+      double mid = now_ns();
+      for (uint32_t i = 0; i < count; i++) {
+        app_sensor_sample_t out;
+        if (codec->decode(&payloads[(size_t)i * codec->len], codec->len, &out)) {
+          sink += out.temperature;
+        }
+      }
+      double end = now_ns();
+      if (mid - start < best_encode) {
+        best_encode = mid - start;
+      }
+      if (end - mid < best_decode) {
+        best_decode = end - mid;
+      }
+    }
+    (void)sink;
+
+    for (uint32_t i = 0; i < count; i++) {
+      app_sensor_sample_t out;
+      if (!codec->decode(&payloads[(size_t)i * codec->len], codec->len, &out)) {
+        fprintf(stderr, "%s: sample %u does not decode\n", codec->name, i);
+        return 1;
+      }
+      int32_t dt = abs(out.temperature - samples[i].temperature);
+      int32_t dh = abs(out.humidity - samples[i].humidity);
+      max_temp = dt > max_temp ? dt : max_temp;
+      max_hum = dh > max_hum ? dh : max_hum;
+    }
+    printf("%-12s  %5u  %12.3f  %11.3f  %9.1f  %9.1f\n",
+           codec->name,
+           codec->len,
+           max_temp / 1000.0,
+           max_hum / 1000.0,
+           best_encode / count,
+           best_decode / count);
+  }
+  free(samples);
+  free(payloads);
+  return 0;
+}
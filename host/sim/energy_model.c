@@ -0,0 +1,147 @@
+/***************************************************************************//**
+ * @file energy_model.c
+ * @brief Energy per sample of the client in normal and low-power mode.
+ *
+ * Runs the client's periodic sampling schedule for a simulated day through
+ * the energy model of app_power.c, once as the normal build does it and once
+ * as the low-power build does:
+ *
+ *   normal     a wake for the sample timer, one for each conversion, the
+ *              path log lines, and a wake of its own for every telemetry
+ *              publication (APP_TELEMETRY_PERIOD_MS)
+ *   low-power  the same sample wakes without the log lines; telemetry rides
+ *              in every APP_POWER_TELEMETRY_EVERY-th sample window
+ *
+ * Usage: energy_model [period_s [conversions [transmissions [hours]]]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_power.h"
+#include "app_sensor_codec.h"
+#include "app_telemetry.h"
+
+// Lines APP_PATH_LOG prints for a published sample in the normal build
+static const char *const path_log[] = {
+  "New data update\r\n",
+  "Set publication done. Publishing...\r\n",
+  "Publish done.\r\n",
+};
+
+typedef struct {
+  uint32_t period_ms;
+  uint32_t conversions;                 // per sample, 2^oversample_log2
+  uint8_t transmissions;                // network transmit count + 1
+  uint32_t hours;
+} scenario_t;
+
+static void charge_sample(const scenario_t *s, bool low_power)
+{
+  app_energy_charge_wake();
+  for (uint32_t i = 0; i < s->conversions; i++) {
+    // Each conversion is started in one wake and read in the next
+    app_energy_charge_sensor();
+    app_energy_charge_wake();
+  }
+  app_energy_charge_publish(APP_SENSOR_PACKED_LEN, s->transmissions);
+  app_energy_count_sample();
+  if (!low_power) {
+    for (size_t i = 0; i < sizeof(path_log) / sizeof(path_log[0]); i++) {
+      app_energy_charge_log((uint16_t)strlen(path_log[i]));
+    }
+  }
+}
+
+static void run(const scenario_t *s, bool low_power, app_energy_totals_t *t)
+{
+  uint64_t end_ms = (uint64_t)s->hours * 3600 * 1000;
+  uint64_t next_sample = s->period_ms;
+  uint64_t next_telemetry = APP_TELEMETRY_PERIOD_MS;
+  uint32_t windows = 0;
+
+  host_clock_set_ms(0);
+  app_power_init();
+  while (next_sample <= end_ms) {
+    if (!low_power && next_telemetry <= next_sample) {
+      host_clock_set_ms(next_telemetry);
+      app_energy_charge_wake();
+      app_energy_charge_publish(sizeof(app_telemetry_status_t), s->transmissions);
+      next_telemetry += APP_TELEMETRY_PERIOD_MS;
+      continue;
+    }
+    host_clock_set_ms(next_sample);
+    charge_sample(s, low_power);
+    if (low_power && ++windows % APP_POWER_TELEMETRY_EVERY == 0) {
+      app_energy_charge_publish(sizeof(app_telemetry_status_t), s->transmissions);
+    }
+    next_sample += s->period_ms;
+  }
+  host_clock_set_ms(end_ms);
+  app_energy_get(t);
+}
+
+static uint64_t total_nj(const app_energy_totals_t *t)
+{
+  return t->wake_nj + t->tx_nj + t->sensor_nj + t->log_nj + t->sleep_nj;
+}
+
+static void print_mode(const char *name, const app_energy_totals_t *t)
+{
+  printf("%-9s %7lu %7lu %8lu %8lu %8lu %8lu %8lu %9.1f\n",
+         name,
+         (unsigned long)t->wakes,
+         (unsigned long)t->tx_pdus,
+         (unsigned long)(t->wake_nj / 1000),
+         (unsigned long)(t->tx_nj / 1000),
+         (unsigned long)(t->sensor_nj / 1000),
+         (unsigned long)(t->log_nj / 1000),
+         (unsigned long)(t->sleep_nj / 1000),
+         t->samples ? (double)total_nj(t) / t->samples / 1000 : 0.0);
+}
+
+int main(int argc, char **argv)
+{
+  scenario_t s = {
+    .period_ms = 10000,
+    .conversions = 4,
+    .transmissions = 1,
+    .hours = 24,
+  };
+  app_energy_totals_t normal, low_power;
+
+  if (argc > 1) {
+    s.period_ms = (uint32_t)(atof(argv[1]) * 1000);
+  }
+  if (argc > 2) {
+    s.conversions = (uint32_t)atoi(argv[2]);
+  }
+  if (argc > 3) {
+    s.transmissions = (uint8_t)atoi(argv[3]);
+  }
+  if (argc > 4) {
+    s.hours = (uint32_t)atoi(argv[4]);
+  }
+  if (s.period_ms == 0 || s.transmissions == 0 || s.hours == 0) {
+    fprintf(stderr, "usage: %s [period_s [conversions [transmissions [hours]]]]\n",
+            argv[0]);
+    return 2;
+  }
+
+  run(&s, false, &normal);
+  run(&s, true, &low_power);
+
+  printf("period %.1f s, %lu conversions per sample, %u transmissions, %lu h\n",
+         s.period_ms / 1000.0, (unsigned long)s.conversions, s.transmissions,
+         (unsigned long)s.hours);
+  printf("costs nJ: wake %u, tx pdu %u, sensor %u, log byte %u; sleep %u nW\n",
+         APP_ENERGY_WAKE_NJ, APP_ENERGY_TX_PDU_NJ, APP_ENERGY_SENSOR_NJ,
+         APP_ENERGY_LOG_BYTE_NJ, APP_ENERGY_SLEEP_NW);
+  printf("mode        wakes    pdus  wake uJ    tx uJ  sens uJ   log uJ sleep uJ  uJ/sample\n");
+  print_mode("normal", &normal);
+  print_mode("low-power", &low_power);
+  printf("low-power saves %.1f %% per sample\n",
+         100.0 * (1.0 - (double)total_nj(&low_power) / (double)total_nj(&normal)));
+  return 0;
+}
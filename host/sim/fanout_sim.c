@@ -0,0 +1,351 @@
+/***************************************************************************//**
+ * @file fanout_sim.c
+ * @brief Time to reconfigure a large group of clients with the control
+ *        fan-out of app_fanout.c.
+ *
+ * The server runs the real app_fanout.c and app_ctrl.c; the clients do what
+ * handle_ctrl() in Vendor_client/app.c does: apply a sequence number once and
+ * ack every copy after a random delay within the spread the command carries.
+ *
+ * Each client sits 1 to MAX_HOPS hops from the server, every hop adding a
+ * relay delay. A command or ack copy is lost end to end with the given loss.
+ * An ack goes out NETTX_COUNT times NETTX_INTERVAL_MS apart, and copies that
+ * reach the server in the same millisecond collide and are all lost; the ack
+ * gets through if any of its copies does. The server sends the multicast
+ * once and the unicast retransmits the way app_fanout.c paces them.
+ *
+ * The table gives, per loss rate, the time until the last ack and the rounds
+ * used, averaged over the seeds, with the worst seed, and the messages sent
+ * on both sides.
+ *
+ * Usage: fanout_sim [nodes [seeds]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_ctrl.h"
+#include "app_fanout.h"
+#include "app_time.h"
+
+#define MAX_NODES                       1000
+#define MAX_HOPS                        4
+#define HOP_DELAY_MIN_MS                10
+#define HOP_DELAY_SPREAD_MS             20
+#define NETTX_COUNT                     3
+#define NETTX_INTERVAL_MS               20
+#define SERVER_ADDRESS                  0x0001
+#define FIRST_CLIENT                    0x0002
+// Long enough for four rounds of the largest group
+#define HORIZON_MS                      600000
+
+#define EX_FANOUT_TICK                  (1u << 4)
+
+typedef enum {
+  EV_COMMAND,                           // a command copy reaches a client
+  EV_ACK,                               // an ack copy has reached the server
+} sim_kind_t;
+
+typedef struct {
+  uint64_t at_ms;
+  sim_kind_t kind;
+  uint16_t client;
+  uint32_t instance;                    // ack: which ack of the client
+  uint8_t data[APP_CTRL_CMD_LEN];
+} sim_event_t;
+
+typedef struct {
+  sim_event_t *items;
+  size_t count;
+  size_t size;
+} sim_heap_t;
+
+typedef struct {
+  uint8_t hops;
+  bool applied;
+  uint8_t applied_seq;
+  uint32_t acks_sent;                   // also the instance of the next ack
+  uint32_t ack_delivered;               // instance + 1 of the last one through
+} sim_client_t;
+
+typedef struct {
+  uint64_t done_ms;
+  uint32_t acked;
+  uint32_t rounds;
+  uint32_t commands;
+  uint32_t ack_copies;
+  uint32_t collisions;
+} sim_result_t;
+
+static sim_client_t clients[MAX_NODES];
+static uint32_t client_count;
+static host_node_t server;
+static app_fanout_t fanout;
+static sim_heap_t heap;
+static uint8_t arrivals[HORIZON_MS];
+static uint32_t rng;
+static uint32_t loss_pct;
+static sim_result_t result;
+static bool done;
+
+static uint32_t next_random(void)
+{
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static void heap_push(const sim_event_t *ev)
+{
+  size_t i;
+
+  if (heap.count == heap.size) {
+    heap.size = heap.size ? heap.size * 2 : 1024;
+    heap.items = realloc(heap.items, heap.size * sizeof(*heap.items));
+  }
+  i = heap.count++;
+  while (i > 0 && heap.items[(i - 1) / 2].at_ms > ev->at_ms) {
+    heap.items[i] = heap.items[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap.items[i] = *ev;
+}
+
+static void heap_pop(sim_event_t *ev)
+{
+  sim_event_t last = heap.items[--heap.count];
+  size_t i = 0;
+
+  *ev = heap.items[0];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.count) {
+      break;
+    }
+    if (child + 1 < heap.count && heap.items[child + 1].at_ms < heap.items[child].at_ms) {
+      child++;
+    }
+    if (heap.items[child].at_ms >= last.at_ms) {
+      break;
+    }
+    heap.items[i] = heap.items[child];
+    i = child;
+  }
+  if (heap.count > 0) {
+    heap.items[i] = last;
+  }
+}
+
+static uint32_t path_delay(uint16_t client)
+{
+  uint32_t ms = 0;
+
+  for (uint8_t h = 0; h < clients[client].hops; h++) {
+    ms += HOP_DELAY_MIN_MS + next_random() % HOP_DELAY_SPREAD_MS;
+  }
+  return ms;
+}
+
+static void deliver_command(uint16_t client, const uint8_t *data)
+{
+  sim_event_t ev = { .kind = EV_COMMAND, .client = client };
+
+  if (next_random() % 100 < loss_pct) {
+    return;
+  }
+  ev.at_ms = host_clock_ms() + path_delay(client);
+  memcpy(ev.data, data, APP_CTRL_CMD_LEN);
+  heap_push(&ev);
+}
+
+static sl_status_t server_send(app_fanout_t *f,
+                               uint16_t destination,
+                               const uint8_t *data,
+                               uint8_t len)
+{
+  (void)f;
+  (void)len;
+  result.commands++;
+  if (destination == APP_CTRL_GROUP_ADDR) {
+    for (uint16_t c = 0; c < client_count; c++) {
+      deliver_command(c, data);
+    }
+  } else if (destination >= FIRST_CLIENT && destination < FIRST_CLIENT + client_count) {
+    deliver_command(destination - FIRST_CLIENT, data);
+  }
+  return SL_STATUS_OK;
+}
+
+/// What handle_ctrl() in Vendor_client/app.c does with a command
+static void client_on_command(uint16_t c, const uint8_t *data)
+{
+  sim_client_t *cl = &clients[c];
+  app_ctrl_cmd_t cmd;
+  uint64_t send_at;
+  sim_event_t ev = { .kind = EV_ACK, .client = c };
+
+  app_ctrl_decode(data, APP_CTRL_CMD_LEN, &cmd);
+  if (!cl->applied || cmd.seq != cl->applied_seq) {
+    cl->applied = true;
+    cl->applied_seq = cmd.seq;
+  }
+  send_at = host_clock_ms()
+            + next_random() % ((uint32_t)cmd.spread * APP_CTRL_SPREAD_UNIT_MS);
+  ev.instance = cl->acks_sent++;
+  ev.data[0] = cmd.seq;
+  ev.data[1] = APP_CTRL_STATUS_OK;
+  for (int k = 0; k < NETTX_COUNT; k++) {
+    uint64_t at = send_at + (uint64_t)k * NETTX_INTERVAL_MS + path_delay(c);
+    result.ack_copies++;
+    if (next_random() % 100 < loss_pct) {
+      continue;
+    }
+    if (at < HORIZON_MS) {
+      arrivals[at]++;
+    }
+    // Judged once the millisecond is over and every copy in it is known
+    ev.at_ms = at + 1;
+    heap_push(&ev);
+  }
+}
+
+static void server_on_ack(const sim_event_t *ev)
+{
+  sim_client_t *cl = &clients[ev->client];
+  uint64_t at = ev->at_ms - 1;
+
+  if (at < HORIZON_MS && arrivals[at] > 1) {
+    result.collisions++;
+    return;
+  }
+  if (cl->ack_delivered > ev->instance) {
+    // Another copy of the same ack got through; the network cache drops it
+    return;
+  }
+  cl->ack_delivered = ev->instance + 1;
+  app_fanout_on_ack(&fanout, FIRST_CLIENT + ev->client, ev->data, APP_CTRL_ACK_LEN);
+}
+
+static void on_log(const char *text)
+{
+  const char *at = strstr(text, "nodes acked in");
+  unsigned acked, targets, rounds;
+  unsigned long ms;
+
+  if (at == NULL) {
+    return;
+  }
+  while (at > text && at[-1] != ':') {
+    at--;
+  }
+  if (sscanf(at, " %u/%u nodes acked in %lu ms, %u rounds",
+             &acked, &targets, &ms, &rounds) == 4) {
+    result.done_ms = ms;
+    result.acked = acked;
+    result.rounds = rounds;
+    done = true;
+  }
+}
+
+static void run(uint32_t seed)
+{
+  memset(&result, 0, sizeof(result));
+  memset(arrivals, 0, sizeof(arrivals));
+  heap.count = 0;
+  done = false;
+  rng = seed * 2654435761u + 17;
+
+  for (uint16_t c = 0; c < client_count; c++) {
+    memset(&clients[c], 0, sizeof(clients[c]));
+    clients[c].hops = (uint8_t)(1 + next_random() % MAX_HOPS);
+  }
+  host_node_init(&server, SERVER_ADDRESS);
+  server.rng ^= seed;
+  host_node_enter(&server);
+  host_clock_set_ms(0);
+  app_fanout_init(&fanout, server_send, EX_FANOUT_TICK);
+  for (uint16_t c = 0; c < client_count; c++) {
+    app_fanout_note_node(&fanout, FIRST_CLIENT + c);
+  }
+  app_fanout_start(&fanout, APP_CTRL_SET_PERIOD, 0x4A);
+
+  while (!done) {
+    uint64_t timer_at = host_node_next_deadline(&server);
+    uint64_t event_at = heap.count ? heap.items[0].at_ms : UINT64_MAX;
+
+    if (timer_at == UINT64_MAX && event_at == UINT64_MAX) {
+      break;
+    }
+    if (timer_at <= event_at) {
+      host_node_fire_next(&server, timer_at);
+      if (host_node_take_signals(&server) & EX_FANOUT_TICK) {
+        app_fanout_process(&fanout);
+      }
+    } else {
+      sim_event_t ev;
+      heap_pop(&ev);
+      host_clock_set_ms(ev.at_ms);
+      if (ev.kind == EV_COMMAND) {
+        client_on_command(ev.client, ev.data);
+      } else {
+        server_on_ack(&ev);
+      }
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  static const uint32_t losses[] = { 0, 10, 20, 30 };
+  uint32_t seeds = 10;
+
+  client_count = argc > 1 ? (uint32_t)atoi(argv[1]) : 500;
+  if (argc > 2) {
+    seeds = (uint32_t)atoi(argv[2]);
+  }
+  if (client_count == 0 || client_count > MAX_NODES
+      || FIRST_CLIENT + client_count - 1 > APP_FANOUT_MAX_NODES || seeds == 0) {
+    fprintf(stderr, "usage: %s [nodes [seeds]]\n", argv[0]);
+    return 2;
+  }
+
+  host_log_set_sink(on_log);
+  app_time_init();
+  printf("%u clients, 1-%u hops, %u seeds, spread for %u acks/s, %u rounds at most\n",
+         client_count, MAX_HOPS, seeds, APP_FANOUT_ACK_RATE, APP_FANOUT_MAX_ROUNDS);
+  printf("loss  done mean  done max  acked min  rounds  commands  ack copies  collided\n");
+  for (size_t l = 0; l < sizeof(losses) / sizeof(losses[0]); l++) {
+    uint64_t done_sum = 0, done_max = 0;
+    uint32_t acked_min = UINT32_MAX;
+    uint64_t rounds = 0, commands = 0, copies = 0, collided = 0;
+
+    loss_pct = losses[l];
+    for (uint32_t seed = 1; seed <= seeds; seed++) {
+      run(seed);
+      done_sum += result.done_ms;
+      if (result.done_ms > done_max) {
+        done_max = result.done_ms;
+      }
+      if (result.acked < acked_min) {
+        acked_min = result.acked;
+      }
+      rounds += result.rounds;
+      commands += result.commands;
+      copies += result.ack_copies;
+      collided += result.collisions;
+    }
+    printf("%3u%%  %7.2f s  %6.2f s  %9u  %6.2f  %8.1f  %10.1f  %8.1f\n",
+           loss_pct,
+           done_sum / 1000.0 / seeds,
+           done_max / 1000.0,
+           acked_min,
+           (double)rounds / seeds,
+           (double)commands / seeds,
+           (double)copies / seeds,
+           (double)collided / seeds);
+  }
+  free(heap.items);
+  return 0;
+}
@@ -0,0 +1,192 @@
+/***************************************************************************//**
+ * @file filter_bench.c
+ * @brief Accuracy, report rate and cost of the sensor filter pipeline of
+ *        app_filter.c in several configurations.
+ *
+ * Each configuration filters a temperature and a humidity trace (see
+ * tests/rht_trace.h), or the readings of a recorded trace file. Per channel
+ * the table gives the conversions per value, the RMS and largest error of
+ * the filtered values against the true value, and the reports a send-on-delta
+ * threshold of 0.5 lets through per 1000 values; the last column is the time
+ * per reading on this host. Recorded traces have no true value, so only the
+ * report rate and the cost are given for them.
+ *
+ * A trace file holds one "humidity,temperature" line per reading, both in
+ * milli-units as the sensor driver returns them.
+ *
+ * Usage: filter_bench [trace_file]
+ ******************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "app_filter.h"
+#include "rht_trace.h"
+
+#define VALUES                          20000
+#define MAX_READINGS                    (VALUES << 2)
+#define DELTA_THRESHOLD                 500
+
+typedef struct {
+  const char *name;
+  app_filter_config_t config;
+} bench_config_t;
+
+typedef struct {
+  double rms;
+  double max;
+  double reports;                       // per 1000 values
+  double ns;                            // per reading
+} bench_result_t;
+
+static const bench_config_t configs[] = {
+  { "raw", { 0, 1, 0 } },
+  { "oversample 4", { 2, 1, 0 } },
+  { "median 3", { 0, 3, 0 } },
+  { "ema 1/4", { 0, 1, 2 } },
+  { "median 3 + ema 1/2", { 0, 3, 1 } },
+  { "median 3 + ema 1/4", { 0, 3, 2 } },
+  { "default", APP_FILTER_CONFIG_DEFAULT },
+  { "low-power", APP_FILTER_CONFIG_LOW_POWER },
+};
+
+static int32_t readings[2][MAX_READINGS];
+static double truths[2][MAX_READINGS];
+static uint32_t reading_count;
+static bool have_truth;
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static bench_result_t run(const app_filter_config_t *config, int channel)
+{
+  bench_result_t r = { 0 };
+  app_filter_t f;
+  uint32_t group = 1u << config->oversample_log2;
+  uint32_t values = 0, reports = 0;
+  int32_t reported = 0, out;
+  double truth_sum = 0, err_sum = 0;
+  double start;
+  volatile int32_t sink = 0;
+
+  app_filter_init(&f, config);
+  for (uint32_t i = 0; i < reading_count; i++) {
+    truth_sum += truths[channel][i];
+    if (!app_filter_feed(&f, readings[channel][i], &out)) {
+      continue;
+    }
+    if (have_truth) {
+      double err = fabs(out - truth_sum / group);
+      err_sum += err * err;
+      if (err > r.max) {
+        r.max = err;
+      }
+    }
+    truth_sum = 0;
+    if (values == 0 || abs(out - reported) >= DELTA_THRESHOLD) {
+      reported = out;
+      reports++;
+    }
+    values++;
+  }
+  r.rms = values ? sqrt(err_sum / values) : 0;
+  r.reports = values ? 1000.0 * reports / values : 0;
+
+  // Cost: the same readings again, timed, a few times over
+  app_filter_init(&f, config);
+  start = now_ns();
+  for (int pass = 0; pass < 20; pass++) {
+    for (uint32_t i = 0; i < reading_count; i++) {
+      if (app_filter_feed(&f, readings[channel][i], &out)) {
+        sink += out;
+      }
+    }
+  }
+  r.ns = (now_ns() - start) / (20.0 * reading_count);
+  (void)sink;
+  return r;
+}
+
+static bool load(const char *path)
+{
+  FILE *file = fopen(path, "r");
+  long humidity, temperature;
+
+  if (file == NULL) {
+    return false;
+  }
+  reading_count = 0;
+  while (reading_count < MAX_READINGS
+         && fscanf(file, " %ld , %ld", &humidity, &temperature) == 2) {
+    readings[0][reading_count] = (int32_t)temperature;
+    readings[1][reading_count] = (int32_t)humidity;
+    reading_count++;
+  }
+  fclose(file);
+  return reading_count > 0;
+}
+
+static void generate(void)
+{
+  static const rht_trace_config_t trace_config[2] = {
+    RHT_TRACE_TEMPERATURE,
+    RHT_TRACE_HUMIDITY,
+  };
+
+  for (int c = 0; c < 2; c++) {
+    rht_trace_t t;
+    rht_trace_init(&t, &trace_config[c], (uint64_t)c + 1);
+    for (uint32_t i = 0; i < MAX_READINGS; i++) {
+      readings[c][i] = rht_trace_next(&t, &truths[c][i]);
+    }
+  }
+  reading_count = MAX_READINGS;
+  have_truth = true;
+}
+
+int main(int argc, char **argv)
+{
+  static const char *const channels[] = { "temperature", "humidity" };
+
+  if (argc > 1) {
+    if (!load(argv[1])) {
+      fprintf(stderr, "usage: %s [trace_file]\n", argv[0]);
+      return 2;
+    }
+    printf("%u recorded readings from %s\n", reading_count, argv[1]);
+  } else {
+    generate();
+    printf("%u generated readings per channel, see tests/rht_trace.h\n", reading_count);
+  }
+  printf("send-on-delta threshold %.1f, errors in units of 0.001\n", DELTA_THRESHOLD / 1000.0);
+
+  for (int c = 0; c < 2; c++) {
+    printf("\n%-20s  conv/value  rms err  max err  reports/1000  ns/reading\n", channels[c]);
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+      bench_result_t r = run(&configs[i].config, c);
+      if (have_truth) {
+        printf("%-20s  %10u  %7.1f  %7.0f  %12.1f  %10.1f\n",
+               configs[i].name,
+               1u << configs[i].config.oversample_log2,
+               r.rms,
+               r.max,
+               r.reports,
+               r.ns);
+      } else {
+        printf("%-20s  %10u  %7s  %7s  %12.1f  %10.1f\n",
+               configs[i].name,
+               1u << configs[i].config.oversample_log2,
+               "-",
+               "-",
+               r.reports,
+               r.ns);
+      }
+    }
+  }
+  return 0;
+}
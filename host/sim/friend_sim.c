@@ -0,0 +1,268 @@
+/***************************************************************************//**
+ * @file friend_sim.c
+ * @brief Delivery latency to a Low Power Node against its poll interval,
+ *        with and without merging in the Friend queue.
+ *
+ * A low-power client (app_lpn.c) receives what is sent to the groups it
+ * subscribes to, all of it from the server:
+ *
+ *   time_beacon    every APP_SYNC_BEACON_PERIOD_MS; a newer one supersedes
+ *   ctrl_command   at random, CTRL_MEAN_S apart on average, each one a
+ *                  command that has to arrive
+ *   blob_transfer  a configuration blob every BLOB_EVERY_S, BLOB_CHUNKS
+ *                  chunks sent APP_BLOB_TX_BURST per APP_BLOB_TX_TICK_MS,
+ *                  each one a chunk that has to arrive
+ *
+ * Sensor updates go from the clients to the server and never reach an LPN.
+ *
+ * The Friend holds them in a queue of queue_len messages until the LPN
+ * polls. A poll returns one message, and while more are queued the LPN polls
+ * again after POLL_EXCHANGE_MS. The queue is kept in one of three ways:
+ *
+ *   fifo     the stack's Friend queue: the oldest message is dropped when
+ *            the queue is full
+ *   merge    a newer message of the same opcode from the same origin takes
+ *            the place of the queued one, as the per-LPN queue of app_friend
+ *            did before it was removed
+ *   beacon   only a newer time beacon replaces a queued one
+ *
+ * Per poll interval and queue the table gives, averaged over the seeds, the
+ * mean and 95th percentile latency of the commands and chunks, how many of
+ * them were lost, how many superseded beacons were delivered, and the polls
+ * per hour. The poll interval is swept up to APP_LPN_POLL_TIMEOUT_MS, past
+ * which the Friend ends the friendship.
+ *
+ * Usage: friend_sim [queue_len [hours [seeds]]]
+ ******************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_blob_tx.h"
+#include "app_lpn.h"
+#include "app_sync.h"
+
+#define CTRL_MEAN_S                     600
+#define BLOB_EVERY_S                    3600
+#define BLOB_CHUNKS                     8
+
+// One poll, the receive delay and the Friend's answer
+#define POLL_EXCHANGE_MS                (APP_LPN_RECEIVE_DELAY_MS + 50)
+
+#define QUEUE_MAX                       32
+#define HIST_BUCKET_MS                  100
+#define HIST_BUCKETS                    (2 * APP_LPN_POLL_TIMEOUT_MS / HIST_BUCKET_MS)
+
+typedef enum {
+  MSG_BEACON,
+  MSG_CTRL,
+  MSG_BLOB,
+} msg_kind_t;
+
+typedef enum {
+  QUEUE_FIFO,
+  QUEUE_MERGE,
+  QUEUE_BEACON,
+} queue_mode_t;
+
+typedef struct {
+  uint64_t at_ms;
+  msg_kind_t kind;
+  uint32_t beacon;                      // sequence of a time beacon
+} arrival_t;
+
+typedef struct {
+  double mean_s;
+  double p95_s;
+  double lost;
+  double stale;
+  double polls_per_hour;
+} sim_result_t;
+
+static const char *const mode_name[] = { "fifo", "merge", "beacon" };
+static const uint32_t poll_ms[] = { 500, 1000, 2000, 5000, APP_LPN_POLL_TIMEOUT_MS };
+
+static uint64_t rng;
+static arrival_t *arrivals;
+static size_t n_arrivals;
+
+static double next_unit(void)
+{
+  // xorshift64, 53 bits in (0, 1)
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return ((rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+static void add_arrival(uint64_t at_ms, msg_kind_t kind, uint32_t beacon)
+{
+  arrivals[n_arrivals].at_ms = at_ms;
+  arrivals[n_arrivals].kind = kind;
+  arrivals[n_arrivals].beacon = beacon;
+  n_arrivals++;
+}
+
+static int by_time(const void *a, const void *b)
+{
+  const arrival_t *x = a;
+  const arrival_t *y = b;
+  return (x->at_ms > y->at_ms) - (x->at_ms < y->at_ms);
+}
+
+static void make_traffic(uint64_t duration_ms, uint32_t seed)
+{
+  rng = 0x9e3779b97f4a7c15ull * (seed + 1);
+  n_arrivals = 0;
+
+  uint64_t t = (uint64_t)(next_unit() * APP_SYNC_BEACON_PERIOD_MS);
+  for (uint32_t seq = 0; t < duration_ms; t += APP_SYNC_BEACON_PERIOD_MS) {
+    add_arrival(t, MSG_BEACON, seq++);
+  }
+  for (double c = 0;;) {
+    c -= CTRL_MEAN_S * 1000.0 * log(next_unit());
+    if (c >= duration_ms) {
+      break;
+    }
+    add_arrival((uint64_t)c, MSG_CTRL, 0);
+  }
+  t = (uint64_t)(next_unit() * BLOB_EVERY_S * 1000);
+  for (; t < duration_ms; t += BLOB_EVERY_S * 1000ull) {
+    for (uint32_t i = 0; i < BLOB_CHUNKS; i++) {
+      add_arrival(t + (i / APP_BLOB_TX_BURST) * APP_BLOB_TX_TICK_MS, MSG_BLOB, 0);
+    }
+  }
+  qsort(arrivals, n_arrivals, sizeof(arrivals[0]), by_time);
+}
+
+static void enqueue(arrival_t *queue, uint32_t *count, uint32_t queue_len,
+                    queue_mode_t mode, const arrival_t *a, uint32_t *lost)
+{
+  for (uint32_t i = 0; i < *count; i++) {
+    bool same = queue[i].kind == a->kind;
+    if (mode == QUEUE_MERGE ? same : mode == QUEUE_BEACON && same && a->kind == MSG_BEACON) {
+      // Keeps its place; a command or chunk replaced here is lost
+      if (a->kind != MSG_BEACON) {
+        (*lost)++;
+      }
+      queue[i] = *a;
+      return;
+    }
+  }
+  if (*count == queue_len) {
+    if (queue[0].kind != MSG_BEACON) {
+      (*lost)++;
+    }
+    memmove(&queue[0], &queue[1], (queue_len - 1) * sizeof(queue[0]));
+    (*count)--;
+  }
+  queue[(*count)++] = *a;
+}
+
+static sim_result_t run(uint32_t period_ms, uint32_t queue_len, queue_mode_t mode,
+                        uint64_t duration_ms)
+{
+  static uint32_t hist[HIST_BUCKETS + 1];
+  arrival_t queue[QUEUE_MAX];
+  uint32_t count = 0;
+  uint32_t lost = 0;
+  uint32_t stale = 0;
+  uint32_t delivered = 0;
+  uint32_t polls = 0;
+  uint32_t last_beacon = 0;
+  double latency_sum = 0;
+  size_t next = 0;
+  sim_result_t r = { 0 };
+
+  memset(hist, 0, sizeof(hist));
+  uint64_t poll = (uint64_t)(next_unit() * period_ms);
+  while (poll < duration_ms) {
+    while (next < n_arrivals && arrivals[next].at_ms <= poll) {
+      if (arrivals[next].kind == MSG_BEACON) {
+        last_beacon = arrivals[next].beacon;
+      }
+      enqueue(queue, &count, queue_len, mode, &arrivals[next++], &lost);
+    }
+    polls++;
+    if (count == 0) {
+      poll += period_ms;
+      continue;
+    }
+
+    arrival_t m = queue[0];
+    memmove(&queue[0], &queue[1], (count - 1) * sizeof(queue[0]));
+    count--;
+    uint64_t at = poll + APP_LPN_RECEIVE_DELAY_MS;
+    if (m.kind == MSG_BEACON) {
+      stale += m.beacon != last_beacon;
+    } else {
+      uint32_t latency = (uint32_t)(at - m.at_ms);
+      uint32_t bucket = latency / HIST_BUCKET_MS;
+      hist[bucket < HIST_BUCKETS ? bucket : HIST_BUCKETS]++;
+      latency_sum += latency;
+      delivered++;
+    }
+    // More data: poll again straight away
+    poll += count ? POLL_EXCHANGE_MS : period_ms;
+  }
+
+  if (delivered) {
+    uint32_t seen = 0;
+    uint32_t b = 0;
+    for (; b < HIST_BUCKETS && seen < delivered * 0.95; b++) {
+      seen += hist[b];
+    }
+    r.mean_s = latency_sum / delivered / 1000.0;
+    r.p95_s = b * HIST_BUCKET_MS / 1000.0;
+  }
+  r.lost = lost;
+  r.stale = stale;
+  r.polls_per_hour = polls * 3600000.0 / duration_ms;
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t queue_len = argc > 1 ? (uint32_t)atoi(argv[1]) : 8;
+  uint32_t hours = argc > 2 ? (uint32_t)atoi(argv[2]) : 24;
+  uint32_t seeds = argc > 3 ? (uint32_t)atoi(argv[3]) : 10;
+  uint64_t duration_ms = hours * 3600000ull;
+
+  if (queue_len < APP_LPN_MIN_QUEUE_LEN || queue_len > QUEUE_MAX || hours == 0 || seeds == 0) {
+    fprintf(stderr, "usage: friend_sim [queue_len %d..%d [hours [seeds]]]\n",
+            APP_LPN_MIN_QUEUE_LEN, QUEUE_MAX);
+    return 1;
+  }
+  size_t cap = duration_ms / APP_SYNC_BEACON_PERIOD_MS + 1
+               + (duration_ms / (BLOB_EVERY_S * 1000ull) + 1) * BLOB_CHUNKS
+               + duration_ms / (CTRL_MEAN_S * 100ull) + 64;
+  arrivals = malloc(cap * sizeof(arrivals[0]));
+  if (arrivals == NULL) {
+    return 1;
+  }
+
+  printf("queue %u, %u h, %u seeds; latency of commands and blob chunks\n\n",
+         queue_len, hours, seeds);
+  printf("poll_ms  queue   mean_s  p95_s   lost/day  stale/day  polls/h\n");
+  for (size_t p = 0; p < sizeof(poll_ms) / sizeof(poll_ms[0]); p++) {
+    for (queue_mode_t mode = QUEUE_FIFO; mode <= QUEUE_BEACON; mode++) {
+      sim_result_t sum = { 0 };
+      for (uint32_t s = 0; s < seeds; s++) {
+        make_traffic(duration_ms, s);
+        sim_result_t r = run(poll_ms[p], queue_len, mode, duration_ms);
+        sum.mean_s += r.mean_s;
+        sum.p95_s += r.p95_s;
+        sum.lost += r.lost;
+        sum.stale += r.stale;
+        sum.polls_per_hour += r.polls_per_hour;
+      }
+      double per_day = 24.0 / hours / seeds;
+      printf("%7u  %-6s  %6.2f  %5.2f  %8.1f  %9.1f  %7.0f\n",
+             poll_ms[p], mode_name[mode], sum.mean_s / seeds, sum.p95_s / seeds,
+             sum.lost * per_day, sum.stale * per_day, sum.polls_per_hour / seeds);
+    }
+  }
+  free(arrivals);
+  return 0;
+}
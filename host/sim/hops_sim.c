@@ -0,0 +1,158 @@
+/***************************************************************************//**
+ * @file hops_sim.c
+ * @brief Airtime of client publications with the default TTL and with the
+ *        TTL app_hops.c derives from the heartbeat distance.
+ *
+ * The nodes sit on a square grid with the server in the middle; every node
+ * reaches its eight neighbours and relays at the network layer. Each node
+ * but the server publishes one report. Its TTL is either the configured
+ * default or what app_hops.c sets after a heartbeat of the server arrived
+ * with the node's hop distance. The report is flooded the way the network
+ * layer does it: a node relays the first copy it gets if its TTL is at
+ * least 2, with the TTL lowered by one.
+ *
+ * Airtime is counted per network PDU on the three advertising channels at
+ * 1 Mbit/s, with a full 29-byte network PDU in the advertising packet.
+ *
+ * Usage: hops_sim [grid_side [default_ttl]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "sl_btmesh_api.h"
+#include "app_hops.h"
+
+#define MAX_SIDE                        64
+#define MAX_NODES                       (MAX_SIDE * MAX_SIDE)
+
+// Preamble, access address, header, AdvA, AD length and type, network PDU,
+// CRC: 47 bytes at 1 us per bit, on three channels
+#define PDU_AIRTIME_US                  (47 * 8 * 3)
+
+static uint32_t side;
+static uint32_t node_count;
+static uint8_t hops_to_server[MAX_NODES];
+
+static void neighbours_of(uint32_t n, uint32_t out[8], uint32_t *count)
+{
+  int x = (int)(n % side), y = (int)(n / side);
+
+  *count = 0;
+  for (int dy = -1; dy <= 1; dy++) {
+    for (int dx = -1; dx <= 1; dx++) {
+      int nx = x + dx, ny = y + dy;
+      if ((dx || dy) && nx >= 0 && ny >= 0 && nx < (int)side && ny < (int)side) {
+        out[(*count)++] = (uint32_t)(ny * (int)side + nx);
+      }
+    }
+  }
+}
+
+/// Hop distance from @p origin to every node
+static void distances(uint32_t origin, uint8_t *hops)
+{
+  uint32_t queue[MAX_NODES];
+  uint32_t head = 0, tail = 0;
+
+  memset(hops, 0xFF, node_count);
+  hops[origin] = 0;
+  queue[tail++] = origin;
+  while (head < tail) {
+    uint32_t n = queue[head++], nb[8], count;
+    neighbours_of(n, nb, &count);
+    for (uint32_t i = 0; i < count; i++) {
+      if (hops[nb[i]] == 0xFF) {
+        hops[nb[i]] = hops[n] + 1;
+        queue[tail++] = nb[i];
+      }
+    }
+  }
+}
+
+/// Network PDUs sent to flood one message of @p origin with @p ttl, and
+/// whether it reached @p server
+static uint32_t flood(uint32_t origin, uint8_t ttl, uint32_t server, bool *reached)
+{
+  static uint8_t hops[MAX_NODES];
+  uint32_t sent = 0;
+
+  distances(origin, hops);
+  *reached = hops[server] <= ttl;
+  for (uint32_t n = 0; n < node_count; n++) {
+    // A node h hops away receives TTL ttl - h + 1 and relays at 2 or more
+    if (hops[n] < ttl) {
+      sent++;
+    }
+  }
+  return sent;
+}
+
+/// TTL that app_hops.c sets once a heartbeat from @p hops away arrived
+static uint8_t hop_limited_ttl(uint32_t n, uint8_t default_ttl, uint8_t hops)
+{
+  host_node_t node;
+  app_hops_t node_hops = { 0 };
+
+  host_node_init(&node, (uint16_t)(n + 1));
+  host_node_enter(&node);
+  sl_btmesh_test_set_local_model_pub(0, 0, 0, 0, 0xC001, default_ttl, 0, 0, 0);
+  app_hops_init(&node_hops, 0, 0, 0);
+  app_hops_on_heartbeat(&node_hops, 1, hops);
+  return node.pub_ttl;
+}
+
+int main(int argc, char **argv)
+{
+  uint8_t default_ttl = 7;
+  uint32_t server;
+  uint64_t sent_default = 0, sent_limited = 0;
+  uint32_t lost_default = 0, lost_limited = 0;
+  uint32_t hop_sum = 0;
+
+  side = argc > 1 ? (uint32_t)atoi(argv[1]) : 15;
+  if (argc > 2) {
+    default_ttl = (uint8_t)atoi(argv[2]);
+  }
+  if (side < 2 || side > MAX_SIDE || default_ttl < 2 || default_ttl > 0x7F) {
+    fprintf(stderr, "usage: %s [grid_side [default_ttl]]\n", argv[0]);
+    return 2;
+  }
+  host_log_mute(true);
+  node_count = side * side;
+  server = (side / 2) * side + side / 2;
+  distances(server, hops_to_server);
+
+  for (uint32_t n = 0; n < node_count; n++) {
+    bool reached;
+    uint8_t ttl;
+
+    if (n == server) {
+      continue;
+    }
+    hop_sum += hops_to_server[n];
+    sent_default += flood(n, default_ttl, server, &reached);
+    lost_default += !reached;
+    ttl = hop_limited_ttl(n, default_ttl, hops_to_server[n]);
+    sent_limited += flood(n, ttl, server, &reached);
+    lost_limited += !reached;
+  }
+
+  printf("%ux%u grid, server in the middle, default TTL %u, TTL margin %u\n",
+         side, side, default_ttl, APP_HOPS_TTL_MARGIN);
+  printf("mean distance to the server %.2f hops\n",
+         (double)hop_sum / (node_count - 1));
+  printf("TTL          PDUs/report  airtime/report  unreached\n");
+  printf("default      %11.1f  %11.2f ms  %9u\n",
+         (double)sent_default / (node_count - 1),
+         (double)sent_default * PDU_AIRTIME_US / 1000 / (node_count - 1),
+         lost_default);
+  printf("hop-limited  %11.1f  %11.2f ms  %9u\n",
+         (double)sent_limited / (node_count - 1),
+         (double)sent_limited * PDU_AIRTIME_US / 1000 / (node_count - 1),
+         lost_limited);
+  printf("airtime saved %.1f %%\n",
+         100.0 * (1.0 - (double)sent_limited / (double)sent_default));
+  return 0;
+}
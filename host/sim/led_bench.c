@@ -0,0 +1,112 @@
+/***************************************************************************//**
+ * @file led_bench.c
+ * @brief Update cost and snapshot size of the LED table of app_led.c for a
+ *        network of 1024 nodes.
+ *
+ * Every node of addresses 1 to nodes reports its LED state once per round,
+ * in a random order, with the given percentage of them changing it. The
+ * server's LCD refresh drains the dirty rows after each round. The table
+ * gives the time per app_led_update() on this host, the best of the rounds,
+ * the share of updates that changed the state, and the LCD rows rewritten
+ * per round. Then the size of a snapshot of all nodes against one byte per
+ * node, and the time to take it.
+ *
+ * Usage: led_bench [nodes [change_pct [rounds]]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "app_led.h"
+
+#define SNAPSHOT_RUNS                   1000
+
+static uint32_t rng = 0x2545F491u;
+
+static uint32_t next_random(void)
+{
+  // xorshift32
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+int main(int argc, char **argv)
+{
+  static uint16_t order[APP_LED_MAX_NODES];
+  static uint8_t states[APP_LED_MAX_NODES];
+  static uint8_t snapshot[APP_LED_SNAPSHOT_MAX_LEN];
+  static app_led_t led;
+  uint32_t nodes = argc > 1 ? (uint32_t)atoi(argv[1]) : APP_LED_MAX_NODES;
+  uint32_t change_pct = argc > 2 ? (uint32_t)atoi(argv[2]) : 10;
+  uint32_t rounds = argc > 3 ? (uint32_t)atoi(argv[3]) : 200;
+  uint32_t changed = 0, rows = 0;
+  double best = 1e30;
+  char text[32];
+  uint8_t row;
+
+  if (nodes == 0 || nodes > APP_LED_MAX_NODES || change_pct > 100 || rounds == 0) {
+    fprintf(stderr, "usage: %s [nodes 1..%d [change_pct [rounds]]]\n",
+            argv[0], APP_LED_MAX_NODES);
+    return 2;
+  }
+
+  app_led_init(&led);
+  for (uint32_t i = 0; i < nodes; i++) {
+    order[i] = (uint16_t)(i + 1);
+  }
+  for (uint32_t r = 0; r < rounds; r++) {
+    // Shuffle the report order and pick this round's states up front, so
+    // only the updates are timed
+    for (uint32_t i = nodes - 1; i > 0; i--) {
+      uint32_t j = next_random() % (i + 1);
+      uint16_t t = order[i];
+      order[i] = order[j];
+      order[j] = t;
+    }
+    for (uint32_t i = 0; i < nodes; i++) {
+      if (next_random() % 100 < change_pct) {
+        states[i] = (uint8_t)((states[i] + 1 + next_random() % 3) & 0x3);
+      }
+    }
+
+    uint32_t round_changed = 0;
+    double start = now_ns();
+    for (uint32_t i = 0; i < nodes; i++) {
+      round_changed += app_led_update(&led, order[i], states[order[i] - 1]);
+    }
+    double elapsed = now_ns() - start;
+    if (elapsed < best) {
+      best = elapsed;
+    }
+    changed += round_changed;
+    while (app_led_next_dirty_row(&led, &row, text, sizeof(text))) {
+      rows++;
+    }
+  }
+
+  uint16_t len = 0;
+  double start = now_ns();
+  for (int i = 0; i < SNAPSHOT_RUNS; i++) {
+    len = app_led_snapshot(&led, snapshot, sizeof(snapshot));
+  }
+  double snapshot_ns = (now_ns() - start) / SNAPSHOT_RUNS;
+
+  printf("%u nodes, %u%% change per round, %u rounds\n\n", nodes, change_pct, rounds);
+  printf("ns/update  changed  lcd rows/round\n");
+  printf("%9.1f  %6.1f%%  %14.2f\n\n",
+         best / nodes,
+         100.0 * changed / ((double)nodes * rounds),
+         (double)rows / rounds);
+  printf("snapshot bytes  byte per node  ns/snapshot\n");
+  printf("%14u  %13u  %11.1f\n", len, APP_LED_SNAPSHOT_HEADER_LEN + nodes, snapshot_ns);
+  return 0;
+}
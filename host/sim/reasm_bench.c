@@ -0,0 +1,220 @@
+/***************************************************************************//**
+ * @file reasm_bench.c
+ * @brief Throughput and pool pressure of app_reasm.c with the parts of many
+ *        sources interleaved.
+ *
+ * Each of the sources sends messages of the given number of parts, each
+ * part APP_RX_PAYLOAD_MAX bytes long, one after the other. The next part
+ * to arrive comes from a source picked at random, so the messages of all
+ * sources interleave. A part arrives PART_GAP_MS after the one before and
+ * is lost with the given loss, and the rest of its message with it, as
+ * app_tasks_post_rx() drops them when the worker queue is full. Every
+ * completed payload is checked and released at once, as relay_on_rx() and
+ * the server do.
+ *
+ * Per source count the table gives the time per part fed on this host,
+ * the best of a few timed passes over the same stream, and then per 1000
+ * messages sent those completed and those lost for want of a buffer
+ * (no_buffer), cut short by the next message of the same source, or timed
+ * out, and the parts dropped as the rest of a message whose start was lost
+ * (orphaned). Then the mean and the peak number of pool buffers filling;
+ * above APP_REASM_POOL_SIZE sources the pool is the limit. A completed
+ * payload of the wrong length or mixing two messages counts as corrupt.
+ *
+ * Usage: reasm_bench [parts [loss_pct [messages]]]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_sdk.h"
+#include "app_reasm.h"
+#include "app_time.h"
+
+#define OPCODE                          0x21
+#define PART_GAP_MS                     5
+#define PASSES                          5
+#define MAX_SOURCES                     64
+
+typedef struct {
+  app_rx_msg_t msg;
+  uint64_t at_ms;
+} stream_part_t;
+
+static const uint32_t source_counts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+static host_node_t node;
+static app_reasm_t reasm;
+static stream_part_t *stream;
+static size_t stream_len;
+static uint32_t rng;
+
+static uint32_t next_random(void)
+{
+  // xorshift32
+  rng ^= rng << 13;
+  rng ^= rng >> 17;
+  rng ^= rng << 5;
+  return rng;
+}
+
+static double now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+/// The parts of @p messages messages spread over @p sources, interleaved
+static void make_stream(uint32_t sources, uint32_t parts, uint32_t loss_pct, uint32_t messages)
+{
+  uint32_t next_part[MAX_SOURCES] = { 0 };
+  uint32_t seq[MAX_SOURCES] = { 0 };
+  bool dropping[MAX_SOURCES] = { false };
+  uint32_t sent = 0;
+  uint64_t t = 0;
+
+  rng = 0x2545F491u ^ sources;
+  stream_len = 0;
+  for (;;) {
+    uint32_t s = next_random() % sources;
+    // A source only starts a new message while some are left to send
+    if (next_part[s] == 0) {
+      if (sent == messages) {
+        continue;
+      }
+      sent++;
+      seq[s]++;
+      dropping[s] = false;
+    }
+    t += PART_GAP_MS;
+    dropping[s] = dropping[s] || next_random() % 100 < loss_pct;
+    if (!dropping[s]) {
+      stream_part_t *p = &stream[stream_len++];
+      memset(&p->msg, 0, sizeof(p->msg));
+      p->msg.source_address = (uint16_t)(s + 1);
+      p->msg.opcode = OPCODE;
+      p->msg.first = next_part[s] == 0;
+      p->msg.final = next_part[s] == parts - 1;
+      p->msg.len = APP_RX_PAYLOAD_MAX;
+      memset(p->msg.data, (uint8_t)seq[s], APP_RX_PAYLOAD_MAX);
+      p->at_ms = t;
+    }
+    next_part[s] = (next_part[s] + 1) % parts;
+    // Stop once every source finished its last message
+    if (sent == messages) {
+      bool done = true;
+      for (uint32_t i = 0; i < sources; i++) {
+        done = done && next_part[i] == 0;
+      }
+      if (done) {
+        break;
+      }
+    }
+  }
+}
+
+static uint32_t pool_filling(void)
+{
+  uint32_t n = 0;
+
+  for (int i = 0; i < APP_REASM_POOL_SIZE; i++) {
+    n += reasm.pool[i].state == APP_REASM_FILLING;
+  }
+  return n;
+}
+
+/// Feed the stream once; with @p filling_peak the pool occupancy is sampled
+/// and with @p corrupt the payloads are checked
+static uint32_t feed_stream(uint32_t parts, double *filling_mean, uint32_t *filling_peak,
+                            uint32_t *corrupt)
+{
+  uint64_t base = host_clock_ms() + 10 * APP_REASM_TIMEOUT_MS;
+  uint64_t filling_sum = 0;
+  uint32_t completed = 0;
+  uint8_t expected_len = (uint8_t)(parts * APP_RX_PAYLOAD_MAX);
+
+  app_reasm_init(&reasm);
+  for (size_t i = 0; i < stream_len; i++) {
+    const uint8_t *data;
+    uint8_t len;
+
+    host_clock_set_ms(base + stream[i].at_ms);
+    if (app_reasm_feed(&reasm, &stream[i].msg, &data, &len)) {
+      completed++;
+      if (corrupt != NULL && (len != expected_len || data[0] != data[len - 1])) {
+        (*corrupt)++;
+      }
+      app_reasm_release(&reasm, data);
+    }
+    if (filling_peak != NULL) {
+      uint32_t f = pool_filling();
+      filling_sum += f;
+      if (f > *filling_peak) {
+        *filling_peak = f;
+      }
+    }
+  }
+  if (filling_mean != NULL) {
+    *filling_mean = stream_len ? (double)filling_sum / stream_len : 0;
+  }
+  return completed;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t parts = argc > 1 ? (uint32_t)atoi(argv[1]) : 3;
+  uint32_t loss_pct = argc > 2 ? (uint32_t)atoi(argv[2]) : 0;
+  uint32_t messages = argc > 3 ? (uint32_t)atoi(argv[3]) : 100000;
+
+  if (parts < 2 || parts * APP_RX_PAYLOAD_MAX > APP_REASM_MAX_LEN || loss_pct >= 100
+      || messages == 0) {
+    fprintf(stderr, "usage: %s [parts 2..%d [loss_pct [messages]]]\n",
+            argv[0], APP_REASM_MAX_LEN / APP_RX_PAYLOAD_MAX);
+    return 2;
+  }
+  stream = malloc(((size_t)messages * parts + MAX_SOURCES * parts) * sizeof(*stream));
+  if (stream == NULL) {
+    return 1;
+  }
+  host_node_init(&node, 0x0001);
+  host_node_enter(&node);
+  host_log_mute(true);
+  app_time_init();
+
+  printf("%u messages of %u parts of %u bytes, %u%% part loss, pool of %d\n\n",
+         messages, parts, APP_RX_PAYLOAD_MAX, loss_pct, APP_REASM_POOL_SIZE);
+  printf("sources  ns/part  completed  no_buffer  cut_short  timed_out  orphaned  "
+         "filling mean  peak  corrupt\n");
+  for (size_t c = 0; c < sizeof(source_counts) / sizeof(source_counts[0]); c++) {
+    uint32_t sources = source_counts[c];
+    double best = 1e30, filling_mean = 0;
+    uint32_t filling_peak = 0, corrupt = 0;
+
+    make_stream(sources, parts, loss_pct, messages);
+    for (int pass = 0; pass < PASSES; pass++) {
+      double start = now_ns();
+      feed_stream(parts, NULL, NULL, NULL);
+      double elapsed = now_ns() - start;
+      if (elapsed < best) {
+        best = elapsed;
+      }
+    }
+    uint32_t completed = feed_stream(parts, &filling_mean, &filling_peak, &corrupt);
+    double per_1000 = 1000.0 / messages;
+    printf("%7u  %7.1f  %9.1f  %9.1f  %9.1f  %9.1f  %8.1f  %12.2f  %4u  %7u\n",
+           sources,
+           best / stream_len,
+           completed * per_1000,
+           reasm.no_buffer * per_1000,
+           reasm.cut_short * per_1000,
+           reasm.timed_out * per_1000,
+           reasm.orphaned * per_1000,
+           filling_mean,
+           filling_peak,
+           corrupt);
+  }
+  free(stream);
+  return 0;
+}
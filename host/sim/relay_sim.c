@@ -0,0 +1,527 @@
+/***************************************************************************//**
+ * @file relay_sim.c
+ * @brief Transmissions of the application-level relay with and without the
+ *        decision layer of app_relay.c.
+ *
+ * Nodes are dropped at random into a square sized for an average of about
+ * ten neighbours within radio range, and the placement is redrawn until the
+ * network is connected. The first CLIENTS nodes are clients: each publishes
+ * a sensor report every CLIENT_PERIOD_MS from a phase of its own, a share of
+ * them to a group nobody subscribes to, and relays nothing. A few nodes
+ * subscribe to the other group and advertise it with relay_advert before
+ * the traffic starts. Every other node relays. Each copy reaches every
+ * neighbour with the configured loss.
+ *
+ * A relay does with a copy what relay_on_rx() in Relay_node/app.c does. It
+ * drops a payload the duplicate check of app_relay.c has seen, and
+ * republishes as a new origin: the copy carries the relay's address, not
+ * the client's. Only the subscribers tell reports apart by their number,
+ * to count what reached them.
+ *
+ *   flood   every node republishes each new message once after a random
+ *           assessment delay, like the relay did before the decision layer
+ *   layer   every node runs the real app_relay.c: the group filter learned
+ *           from the adverts, the suppression counter and the merging of
+ *           superseded reports straight from a client
+ *
+ * Both modes see the same placements, loss draws and traffic. The table
+ * gives the transmissions of all nodes and the share of the reports to the
+ * subscribed group that reached each subscriber.
+ *
+ * Usage: relay_sim [nodes [seeds [loss_pct [unsubscribed_pct]]]]
+ ******************************************************************************/
+#include <math.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_relay.h"
+#include "app_time.h"
+
+#define MAX_NODES                       500
+#define MAX_NEIGHBOURS                  64
+#define CLIENTS                         10
+#define SUBSCRIBERS                     5
+#define REPORTS                         200
+#define CLIENT_PERIOD_MS                2000
+#define TRAFFIC_START_MS                5000
+// Copies still in the air this long after the last report are dropped
+#define DRAIN_MS                        60000
+#define RANGE                           1.0
+#define TARGET_DEGREE                   10.0
+#define LINK_DELAY_MS                   2
+
+#define GROUP_SUBSCRIBED                0xC001
+#define GROUP_UNSUBSCRIBED              0xC005
+
+#define OPCODE_SENSOR                   0x01
+#define OPCODE_ADVERT                   0x03
+
+#define EX_RELAY_DUE                    (1u << 8)
+#define EX_RELAY_AGE                    (1u << 9)
+
+// Message identities: the reports, then one advert per subscriber
+#define MAX_IDS                         (REPORTS + SUBSCRIBERS)
+
+typedef enum {
+  MODE_FLOOD,
+  MODE_LAYER,
+} sim_mode_t;
+
+typedef struct {
+  host_node_t hn;
+  app_relay_t relay;
+  double x, y;
+  uint16_t neighbours[MAX_NEIGHBOURS];
+  uint8_t neighbour_count;
+  bool subscriber;
+  uint8_t delivered[MAX_IDS];           // subscribers only
+} sim_node_t;
+
+typedef struct {
+  uint64_t at_ms;
+  uint16_t node;                        // receiver, or sender of a flood tx
+  bool transmit;                        // flood mode: our delayed republish
+  app_rx_msg_t msg;
+} sim_event_t;
+
+typedef struct {
+  sim_event_t *items;
+  size_t count;
+  size_t size;
+} sim_heap_t;
+
+typedef struct {
+  uint32_t nodes;
+  uint32_t loss_pct;
+  uint32_t unsubscribed_pct;
+} sim_params_t;
+
+typedef struct {
+  uint64_t transmissions;
+  uint64_t deliveries;
+  uint64_t expected;
+  uint64_t suppressed;
+  uint64_t merged;
+  uint64_t filtered;
+} sim_result_t;
+
+static sim_node_t nodes[MAX_NODES];
+static uint32_t node_count;
+static sim_heap_t heap;
+static uint32_t link_rng;
+static uint32_t loss_pct;
+static sim_mode_t mode;
+static sim_result_t result;
+
+static uint32_t next_random(uint32_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static double random_unit(uint32_t *state)
+{
+  return (next_random(state) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static void heap_push(const sim_event_t *ev)
+{
+  size_t i;
+
+  if (heap.count == heap.size) {
+    heap.size = heap.size ? heap.size * 2 : 1024;
+    heap.items = realloc(heap.items, heap.size * sizeof(*heap.items));
+  }
+  i = heap.count++;
+  while (i > 0 && heap.items[(i - 1) / 2].at_ms > ev->at_ms) {
+    heap.items[i] = heap.items[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap.items[i] = *ev;
+}
+
+static void heap_pop(sim_event_t *ev)
+{
+  sim_event_t last = heap.items[--heap.count];
+  size_t i = 0;
+
+  *ev = heap.items[0];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap.count) {
+      break;
+    }
+    if (child + 1 < heap.count && heap.items[child + 1].at_ms < heap.items[child].at_ms) {
+      child++;
+    }
+    if (heap.items[child].at_ms >= last.at_ms) {
+      break;
+    }
+    heap.items[i] = heap.items[child];
+    i = child;
+  }
+  if (heap.count > 0) {
+    heap.items[i] = last;
+  }
+}
+
+static bool connected(void)
+{
+  uint16_t queue[MAX_NODES];
+  bool reached[MAX_NODES] = { false };
+  uint32_t head = 0, tail = 0;
+
+  queue[tail++] = 0;
+  reached[0] = true;
+  while (head < tail) {
+    sim_node_t *n = &nodes[queue[head++]];
+    for (int i = 0; i < n->neighbour_count; i++) {
+      if (!reached[n->neighbours[i]]) {
+        reached[n->neighbours[i]] = true;
+        queue[tail++] = n->neighbours[i];
+      }
+    }
+  }
+  return tail == node_count;
+}
+
+static void place(uint32_t *rng)
+{
+  double side = sqrt(node_count * M_PI * RANGE * RANGE / TARGET_DEGREE);
+
+  do {
+    for (uint32_t i = 0; i < node_count; i++) {
+      nodes[i].x = random_unit(rng) * side;
+      nodes[i].y = random_unit(rng) * side;
+      nodes[i].neighbour_count = 0;
+    }
+    for (uint32_t i = 0; i < node_count; i++) {
+      for (uint32_t j = i + 1; j < node_count; j++) {
+        double dx = nodes[i].x - nodes[j].x;
+        double dy = nodes[i].y - nodes[j].y;
+        if (dx * dx + dy * dy <= RANGE * RANGE
+            && nodes[i].neighbour_count < MAX_NEIGHBOURS
+            && nodes[j].neighbour_count < MAX_NEIGHBOURS) {
+          nodes[i].neighbours[nodes[i].neighbour_count++] = (uint16_t)j;
+          nodes[j].neighbours[nodes[j].neighbour_count++] = (uint16_t)i;
+        }
+      }
+    }
+  } while (!connected());
+}
+
+/// Put a copy of @p msg on the air from @p sender
+static void transmit(uint16_t sender, const app_rx_msg_t *msg)
+{
+  sim_node_t *n = &nodes[sender];
+  sim_event_t ev = { .at_ms = host_clock_ms() + LINK_DELAY_MS, .msg = *msg };
+
+  result.transmissions++;
+  for (int i = 0; i < n->neighbour_count; i++) {
+    if (next_random(&link_rng) % 100 < loss_pct) {
+      continue;
+    }
+    ev.node = n->neighbours[i];
+    heap_push(&ev);
+  }
+}
+
+/// Republish @p msg from @p sender as a new origin, as republish_data() does
+static void republish(uint16_t sender, const app_rx_msg_t *msg)
+{
+  app_rx_msg_t copy = *msg;
+
+  copy.source_address = nodes[sender].hn.address;
+  transmit(sender, &copy);
+}
+
+static void relay_publish(app_relay_t *relay, const app_rx_msg_t *msg)
+{
+  sim_node_t *n = (sim_node_t *)((uint8_t *)relay - offsetof(sim_node_t, relay));
+
+  republish((uint16_t)(n - nodes), msg);
+}
+
+static uint16_t message_id(const app_rx_msg_t *msg)
+{
+  return (uint16_t)(msg->data[0] | (msg->data[1] << 8));
+}
+
+/// What relay_on_rx() in Relay_node/app.c does with a received copy
+static void receive(uint16_t index, const app_rx_msg_t *msg)
+{
+  sim_node_t *n = &nodes[index];
+  uint16_t id = message_id(msg);
+
+  if (index < CLIENTS) {
+    return;
+  }
+  if (n->subscriber && msg->destination_address == GROUP_SUBSCRIBED
+      && msg->opcode == OPCODE_SENSOR && !n->delivered[id]) {
+    n->delivered[id] = 1;
+    result.deliveries++;
+  }
+  if (mode == MODE_LAYER && msg->opcode == OPCODE_ADVERT) {
+    app_relay_on_advert(&n->relay, msg->source_address, &msg->data[2], msg->len - 2);
+  }
+  // The flooding relay had the same duplicate check
+  if (app_relay_check_duplicate(&n->relay, msg->data, msg->len)) {
+    if (mode == MODE_LAYER) {
+      app_relay_on_duplicate(&n->relay, msg->data, msg->len);
+    }
+    return;
+  }
+
+  if (mode == MODE_FLOOD) {
+    sim_event_t ev = {
+      .at_ms = host_clock_ms()
+               + APP_RELAY_RAD_MIN_MS
+               + next_random(&n->hn.rng) % (APP_RELAY_RAD_MAX_MS - APP_RELAY_RAD_MIN_MS + 1),
+      .node = index,
+      .transmit = true,
+      .msg = *msg,
+    };
+    heap_push(&ev);
+    return;
+  }
+
+  if (msg->opcode != OPCODE_ADVERT
+      && !app_relay_filter_match(&n->relay, msg->destination_address)) {
+    app_relay_count_filtered(&n->relay);
+    return;
+  }
+  app_relay_schedule(&n->relay, msg,
+                     msg->opcode == OPCODE_ADVERT ? APP_RELAY_NO_SUPPRESS : APP_RELAY_LATEST_ONLY);
+}
+
+static void originate(uint16_t index, uint16_t id, uint8_t opcode, uint16_t destination,
+                      const uint8_t *body, uint8_t body_len)
+{
+  app_rx_msg_t msg = {
+    .source_address = nodes[index].hn.address,
+    .destination_address = destination,
+    .opcode = opcode,
+    .final = 1,
+    .len = (uint8_t)(2 + body_len),
+  };
+
+  msg.data[0] = id & 0xFF;
+  msg.data[1] = id >> 8;
+  memcpy(&msg.data[2], body, body_len);
+  transmit(index, &msg);
+}
+
+/// Earliest relay timer of any node, UINT64_MAX if none
+static uint64_t next_timer(uint16_t *owner)
+{
+  uint64_t first = UINT64_MAX;
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    uint64_t d = host_node_next_deadline(&nodes[i].hn);
+    if (d < first) {
+      first = d;
+      *owner = (uint16_t)i;
+    }
+  }
+  return first;
+}
+
+static void run_mode(const sim_params_t *p, uint32_t seed, sim_mode_t m)
+{
+  uint32_t traffic_rng = seed * 7919u + 1;
+  uint16_t subscribers[SUBSCRIBERS];
+  uint16_t report = 0;
+  uint64_t client_next[CLIENTS];
+  uint64_t end_ms = UINT64_MAX;
+  uint16_t client = 0;
+
+  mode = m;
+  link_rng = seed * 104729u + 3;
+  heap.count = 0;
+  host_clock_set_ms(0);
+
+  for (uint32_t i = 0; i < node_count; i++) {
+    sim_node_t *n = &nodes[i];
+    host_node_init(&n->hn, (uint16_t)(i + 1));
+    n->hn.rng ^= seed * 2654435761u;
+    n->subscriber = false;
+    memset(n->delivered, 0, sizeof(n->delivered));
+    host_node_enter(&n->hn);
+    // Relays publish to the subscribed group, which seeds their filter
+    app_relay_init(&n->relay, GROUP_SUBSCRIBED, relay_publish, EX_RELAY_DUE,
+                   EX_RELAY_AGE);
+  }
+
+  // Subscribers are drawn among the relays; the draws are the same in both
+  // modes
+  for (int s = 0; s < SUBSCRIBERS; s++) {
+    uint16_t pick;
+    do {
+      pick = (uint16_t)(CLIENTS + next_random(&traffic_rng) % (node_count - CLIENTS));
+    } while (nodes[pick].subscriber);
+    nodes[pick].subscriber = true;
+    subscribers[s] = pick;
+  }
+  // Subscribers advertise their group, as advertise_groups() in the
+  // server does
+  for (int s = 0; s < SUBSCRIBERS; s++) {
+    uint8_t groups[2] = { GROUP_SUBSCRIBED & 0xFF, GROUP_SUBSCRIBED >> 8 };
+    host_node_enter(&nodes[subscribers[s]].hn);
+    host_clock_set_ms((uint64_t)s * 100);
+    originate(subscribers[s], (uint16_t)(REPORTS + s), OPCODE_ADVERT, 0xFFFF,
+              groups, sizeof(groups));
+  }
+  for (int c = 0; c < CLIENTS; c++) {
+    client_next[c] = TRAFFIC_START_MS + next_random(&traffic_rng) % CLIENT_PERIOD_MS;
+  }
+
+  for (;;) {
+    uint16_t owner = 0;
+    uint64_t timer_at = next_timer(&owner);
+    uint64_t event_at = heap.count ? heap.items[0].at_ms : UINT64_MAX;
+    uint64_t report_at = UINT64_MAX;
+
+    for (int c = 0; report < REPORTS && c < CLIENTS; c++) {
+      if (client_next[c] < report_at) {
+        report_at = client_next[c];
+        client = (uint16_t)c;
+      }
+    }
+    // Filter aging runs every 15 minutes and is not part of the scenario;
+    // neither is what is still in the air long after the traffic
+    if (timer_at >= end_ms) {
+      timer_at = UINT64_MAX;
+    }
+    if (event_at >= end_ms) {
+      event_at = UINT64_MAX;
+    }
+    if (timer_at == UINT64_MAX && event_at == UINT64_MAX && report_at == UINT64_MAX) {
+      break;
+    }
+    if (timer_at <= event_at && timer_at <= report_at) {
+      sim_node_t *n = &nodes[owner];
+      host_node_fire_next(&n->hn, timer_at);
+      uint32_t signals = host_node_take_signals(&n->hn);
+      host_node_enter(&n->hn);
+      if (signals & EX_RELAY_DUE) {
+        app_relay_flush(&n->relay);
+      }
+      if (signals & EX_RELAY_AGE) {
+        app_relay_age(&n->relay);
+      }
+    } else if (event_at <= report_at && event_at != UINT64_MAX) {
+      sim_event_t ev;
+      heap_pop(&ev);
+      host_clock_set_ms(ev.at_ms);
+      host_node_enter(&nodes[ev.node].hn);
+      if (ev.transmit) {
+        republish(ev.node, &ev.msg);
+      } else {
+        receive(ev.node, &ev.msg);
+      }
+    } else if (report_at != UINT64_MAX) {
+      uint8_t body[6];
+      bool subscribed = next_random(&traffic_rng) % 100 >= p->unsubscribed_pct;
+      memset(body, report & 0xFF, sizeof(body));
+      host_clock_set_ms(report_at);
+      host_node_enter(&nodes[client].hn);
+      originate(client, report, OPCODE_SENSOR,
+                subscribed ? GROUP_SUBSCRIBED : GROUP_UNSUBSCRIBED,
+                body, sizeof(body));
+      if (subscribed) {
+        result.expected += SUBSCRIBERS;
+      }
+      report++;
+      client_next[client] += CLIENT_PERIOD_MS;
+      if (report == REPORTS) {
+        end_ms = report_at + DRAIN_MS;
+      }
+    } else {
+      break;
+    }
+  }
+
+  if (m == MODE_LAYER) {
+    for (uint32_t i = 0; i < node_count; i++) {
+      result.suppressed += nodes[i].relay.suppressed_count;
+      result.merged += nodes[i].relay.merged_count;
+      result.filtered += nodes[i].relay.filtered_count;
+    }
+  }
+}
+
+int main(int argc, char **argv)
+{
+  sim_params_t p = { .nodes = 100, .loss_pct = 10, .unsubscribed_pct = 25 };
+  uint32_t seeds = 10;
+  sim_result_t total[2];
+
+  if (argc > 1) {
+    p.nodes = (uint32_t)atoi(argv[1]);
+  }
+  if (argc > 2) {
+    seeds = (uint32_t)atoi(argv[2]);
+  }
+  if (argc > 3) {
+    p.loss_pct = (uint32_t)atoi(argv[3]);
+  }
+  if (argc > 4) {
+    p.unsubscribed_pct = (uint32_t)atoi(argv[4]);
+  }
+  if (p.nodes < CLIENTS + SUBSCRIBERS + 1 || p.nodes > MAX_NODES || seeds == 0
+      || p.loss_pct >= 100 || p.unsubscribed_pct > 100) {
+    fprintf(stderr, "usage: %s [nodes [seeds [loss_pct [unsubscribed_pct]]]]\n", argv[0]);
+    return 2;
+  }
+
+  host_log_mute(true);
+  app_time_init();
+  node_count = p.nodes;
+  loss_pct = p.loss_pct;
+  memset(total, 0, sizeof(total));
+  printf("%u nodes, %u clients, %u %% loss, %u %% of %u reports to an unsubscribed group, %u seeds\n",
+         p.nodes, CLIENTS, p.loss_pct, p.unsubscribed_pct, REPORTS, seeds);
+  printf("seed  flood tx  layer tx  saved  flood dlv  layer dlv\n");
+  for (uint32_t seed = 1; seed <= seeds; seed++) {
+    uint32_t place_rng = seed * 2246822519u + 5;
+    sim_result_t r[2];
+
+    place(&place_rng);
+    for (int m = MODE_FLOOD; m <= MODE_LAYER; m++) {
+      memset(&result, 0, sizeof(result));
+      run_mode(&p, seed, (sim_mode_t)m);
+      r[m] = result;
+      total[m].transmissions += result.transmissions;
+      total[m].deliveries += result.deliveries;
+      total[m].expected += result.expected;
+      total[m].suppressed += result.suppressed;
+      total[m].merged += result.merged;
+      total[m].filtered += result.filtered;
+    }
+    printf("%4u  %8lu  %8lu  %4.1f%%  %8.1f%%  %8.1f%%\n",
+           seed,
+           (unsigned long)r[MODE_FLOOD].transmissions,
+           (unsigned long)r[MODE_LAYER].transmissions,
+           100.0 * (1.0 - (double)r[MODE_LAYER].transmissions / r[MODE_FLOOD].transmissions),
+           100.0 * r[MODE_FLOOD].deliveries / r[MODE_FLOOD].expected,
+           100.0 * r[MODE_LAYER].deliveries / r[MODE_LAYER].expected);
+  }
+  printf("all   %8lu  %8lu  %4.1f%%  %8.1f%%  %8.1f%%\n",
+         (unsigned long)total[MODE_FLOOD].transmissions,
+         (unsigned long)total[MODE_LAYER].transmissions,
+         100.0 * (1.0 - (double)total[MODE_LAYER].transmissions
+                  / total[MODE_FLOOD].transmissions),
+         100.0 * total[MODE_FLOOD].deliveries / total[MODE_FLOOD].expected,
+         100.0 * total[MODE_LAYER].deliveries / total[MODE_LAYER].expected);
+  printf("layer: %lu copies suppressed, %lu merged, %lu filtered\n",
+         (unsigned long)total[MODE_LAYER].suppressed,
+         (unsigned long)total[MODE_LAYER].merged,
+         (unsigned long)total[MODE_LAYER].filtered);
+  free(heap.items);
+  return 0;
+}
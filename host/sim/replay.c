@@ -0,0 +1,531 @@
+/***************************************************************************//**
+ * @file replay.c
+ * @brief Replay of a traffic capture of app_capture.c through the real
+ *        app.c, at the original speed, faster, or as fast as it runs.
+ *
+ * The input is a log with a dump of app_capture.c in it, other lines
+ * ignored; with several dumps the last complete one is used. The program is
+ * built once per role against the whole app of that role, main.c aside, and
+ * the host SDK and board in sdk/. It boots the app with the clock at the
+ * first record, as a provisioned node with the address from the BEGIN line
+ * and the publication given with -p, and then hands every received record
+ * to sl_btmesh_on_event() at its original tick count. App timers fire in
+ * between at their deadlines, and external signals go to sl_bt_on_event()
+ * as the stack would deliver them.
+ *
+ * What the app sends and publishes is compared with the tx records of the
+ * capture: a record matches the first replayed message not matched yet of
+ * the same kind, opcode, destination and length, with the same stored
+ * payload unless its opcode was given with -i. The ring only holds the
+ * tail of the traffic, so tx records from before the first received record
+ * are left out on both sides, as are those the stack refused and replayed
+ * messages from after the last record that match nothing. Received payloads
+ * that were cut to APP_CAPTURE_PAYLOAD_MAX are replayed at their length with
+ * the missing bytes zero, and counted; only stored bytes are compared.
+ *
+ * The speed is a factor on the original timing: 1 waits as long as the
+ * capture did between events, 10 ten times less, and 0 does not wait. The
+ * clock of the app always follows the capture.
+ *
+ * Exits with 1 if a tx record did not match or the app sent something the
+ * capture does not have.
+ *
+ * Usage: replay_relay|replay_server [-x speed] [-p pub_address]
+ *                                   [-i opcode,...] [-v] [capture.log]
+ ******************************************************************************/
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "host_sdk.h"
+#include "sl_bt_api.h"
+#include "sl_btmesh_api.h"
+#include "app.h"
+#include "app_capture.h"
+
+// Time the app gets after the last record to act on it
+#define DRAIN_MS                        2000
+#define LINE_MAX                        512
+#define MAX_IGNORED                     16
+
+typedef struct {
+  uint64_t ticks;                       // unwrapped
+  uint8_t kind;
+  uint8_t opcode;
+  uint16_t source;
+  uint16_t destination;
+  uint16_t appkey_index;
+  uint8_t stored;
+  uint16_t len;
+  uint8_t data[APP_CAPTURE_PAYLOAD_MAX];
+  bool matched;
+} replay_record_t;
+
+typedef struct {
+  replay_record_t *items;
+  size_t count;
+  size_t size;
+} replay_list_t;
+
+static host_node_t node;
+static replay_list_t captured;
+static replay_list_t replayed;
+static uint16_t capture_node;
+static uint32_t capture_hz;
+static double speed;
+static bool verbose;
+static uint8_t ignored[MAX_IGNORED];
+static uint32_t ignored_count;
+
+// Wall clock pacing
+static struct timespec wall_start;
+static uint64_t sim_start_ms;
+
+static replay_record_t *list_add(replay_list_t *list)
+{
+  if (list->count == list->size) {
+    list->size = list->size ? 2 * list->size : 256;
+    list->items = realloc(list->items, list->size * sizeof(*list->items));
+    if (list->items == NULL) {
+      fprintf(stderr, "out of memory\n");
+      exit(2);
+    }
+  }
+  memset(&list->items[list->count], 0, sizeof(*list->items));
+  return &list->items[list->count++];
+}
+
+static int hex_value(char c)
+{
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+  return -1;
+}
+
+// Decode one "CAP <hex>" line into @p r; ticks are still 32 bits
+static bool parse_record(const char *hex, replay_record_t *r)
+{
+  uint8_t raw[APP_CAPTURE_HEADER_LEN + APP_CAPTURE_PAYLOAD_MAX];
+  size_t n = 0;
+
+  while (hex_value(hex[0]) >= 0 && hex_value(hex[1]) >= 0) {
+    if (n == sizeof(raw)) {
+      return false;
+    }
+    raw[n++] = (uint8_t)(hex_value(hex[0]) << 4 | hex_value(hex[1]));
+    hex += 2;
+  }
+  if (n < APP_CAPTURE_HEADER_LEN || raw[12] > APP_CAPTURE_PAYLOAD_MAX
+      || n != (size_t)APP_CAPTURE_HEADER_LEN + raw[12]) {
+    return false;
+  }
+  r->ticks = raw[0] | raw[1] << 8 | raw[2] << 16 | (uint32_t)raw[3] << 24;
+  r->kind = raw[4];
+  r->opcode = raw[5];
+  r->source = raw[6] | raw[7] << 8;
+  r->destination = raw[8] | raw[9] << 8;
+  r->appkey_index = raw[10] | raw[11] << 8;
+  r->stored = raw[12];
+  r->len = raw[13] | raw[14] << 8;
+  memcpy(r->data, &raw[APP_CAPTURE_HEADER_LEN], r->stored);
+  return true;
+}
+
+// Keep the last complete dump of @p in
+static bool read_capture(FILE *in)
+{
+  char line[LINE_MAX];
+  replay_list_t dump = { 0 };
+  bool inside = false, found = false;
+  unsigned format, node_address;
+  unsigned long hz;
+  uint16_t dump_node = 0;
+  uint32_t dump_hz = 0;
+
+  while (fgets(line, sizeof(line), in) != NULL) {
+    const char *begin = strstr(line, "CAPTURE BEGIN ");
+    const char *cap = strstr(line, "CAP ");
+
+    if (begin != NULL) {
+      if (sscanf(begin, "CAPTURE BEGIN %u node 0x%x hz %lu", &format, &node_address, &hz) != 3
+          || format != APP_CAPTURE_FORMAT || hz == 0) {
+        fprintf(stderr, "unknown capture: %s", begin);
+        inside = false;
+        continue;
+      }
+      inside = true;
+      dump.count = 0;
+      dump_node = (uint16_t)node_address;
+      dump_hz = (uint32_t)hz;
+    } else if (strstr(line, "CAPTURE END") != NULL) {
+      if (inside) {
+        free(captured.items);
+        captured = dump;
+        capture_node = dump_node;
+        capture_hz = dump_hz;
+        dump = (replay_list_t){ 0 };
+        found = true;
+      }
+      inside = false;
+    } else if (inside && cap != NULL) {
+      replay_record_t *r = list_add(&dump);
+      if (!parse_record(cap + 4, r)) {
+        fprintf(stderr, "bad record dropped: %s", cap);
+        dump.count--;
+      }
+    }
+  }
+  free(dump.items);
+  if (!found) {
+    return false;
+  }
+
+  // The ticks are the low 32 bits of the sleeptimer count
+  uint64_t base = 0;
+  for (size_t i = 1; i < captured.count; i++) {
+    if ((uint32_t)captured.items[i].ticks < (uint32_t)captured.items[i - 1].ticks) {
+      base += (uint64_t)1 << 32;
+    }
+    captured.items[i].ticks = (uint32_t)captured.items[i].ticks + base;
+  }
+  return true;
+}
+
+static uint64_t ticks_to_ms(uint64_t ticks)
+{
+  return ticks * 1000 / capture_hz;
+}
+
+static void pace(uint64_t sim_ms)
+{
+  struct timespec now, wait;
+  double due, elapsed;
+
+  if (speed <= 0) {
+    return;
+  }
+  due = (sim_ms - sim_start_ms) / 1000.0 / speed;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  elapsed = (now.tv_sec - wall_start.tv_sec) + (now.tv_nsec - wall_start.tv_nsec) / 1e9;
+  if (due > elapsed) {
+    wait.tv_sec = (time_t)(due - elapsed);
+    wait.tv_nsec = (long)((due - elapsed - wait.tv_sec) * 1e9);
+    nanosleep(&wait, NULL);
+  }
+}
+
+static void on_tx(host_node_t *from, const host_tx_t *tx)
+{
+  replay_record_t *r = list_add(&replayed);
+
+  r->ticks = host_clock_ticks();
+  r->kind = tx->publish ? APP_CAPTURE_PUBLISH : APP_CAPTURE_SEND;
+  r->opcode = tx->opcode;
+  // The capture does not know the publication address
+  r->destination = tx->publish ? 0 : tx->destination;
+  r->appkey_index = tx->publish ? 0 : tx->appkey_index;
+  r->len = tx->len;
+  r->stored = tx->len > APP_CAPTURE_PAYLOAD_MAX ? APP_CAPTURE_PAYLOAD_MAX : tx->len;
+  memcpy(r->data, tx->data, r->stored);
+}
+
+// Deliver the external signals raised so far, as the stack does
+static void deliver_signals(void)
+{
+  struct sl_bt_msg evt;
+  uint32_t signals;
+
+  while ((signals = host_node_take_signals(&node)) != 0) {
+    memset(&evt, 0, sizeof(evt));
+    evt.header = sl_bt_evt_system_external_signal_id;
+    evt.data.evt_system_external_signal.extsignals = signals;
+    sl_bt_on_event(&evt);
+  }
+}
+
+// Fire the app timers due up to @p ticks, then leave the clock there
+static void run_until(uint64_t ticks)
+{
+  uint64_t until_ms = ticks_to_ms(ticks);
+
+  while (host_node_next_deadline(&node) <= until_ms) {
+    pace(host_node_next_deadline(&node));
+    host_node_fire_next(&node, until_ms);
+    deliver_signals();
+  }
+  if (ticks > host_clock_ticks()) {
+    host_clock_set_ticks(ticks);
+  }
+}
+
+static void boot(uint64_t ticks, uint16_t pub_address)
+{
+  struct sl_bt_msg bt_evt;
+  sl_btmesh_msg_t mesh_evt;
+
+  host_clock_set_frequency(capture_hz);
+  host_clock_set_ticks(ticks);
+  host_node_init(&node, capture_node);
+  node.on_tx = on_tx;
+  if (pub_address != 0) {
+    // The publication comes from the configuration, not the capture
+    node.pub_set = true;
+    node.pub_address = pub_address;
+    node.pub_ttl = 5;
+  }
+  host_node_enter(&node);
+
+  app_init();
+  memset(&bt_evt, 0, sizeof(bt_evt));
+  bt_evt.header = sl_bt_evt_system_boot_id;
+  sl_bt_on_event(&bt_evt);
+  memset(&mesh_evt, 0, sizeof(mesh_evt));
+  mesh_evt.header = sl_btmesh_evt_node_initialized_id;
+  mesh_evt.data.evt_node_initialized.provisioned = 1;
+  mesh_evt.data.evt_node_initialized.address = capture_node;
+  sl_btmesh_on_event(&mesh_evt);
+  deliver_signals();
+}
+
+static void receive(const replay_record_t *r)
+{
+  sl_btmesh_msg_t evt;
+  sl_btmesh_evt_vendor_model_receive_t *rx = &evt.data.evt_vendor_model_receive;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_btmesh_evt_vendor_model_receive_id;
+  rx->destination_address = r->destination;
+  rx->source_address = r->source;
+  rx->va_index = -1;
+  rx->appkey_index = r->appkey_index;
+  rx->nonrelayed = (r->kind & APP_CAPTURE_FLAG_NONRELAYED) != 0;
+  rx->opcode = r->opcode;
+  rx->final = 1;
+  // A payload cut short gets its length back, the rest zero
+  rx->payload.len = (uint8_t)r->len;
+  memcpy(rx->payload.data, r->data, r->stored);
+  sl_btmesh_on_event(&evt);
+  deliver_signals();
+}
+
+static bool is_ignored(uint8_t opcode)
+{
+  for (uint32_t i = 0; i < ignored_count; i++) {
+    if (ignored[i] == opcode) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool same(const replay_record_t *a, const replay_record_t *b)
+{
+  return (a->kind & APP_CAPTURE_KIND_MASK) == (b->kind & APP_CAPTURE_KIND_MASK)
+         && a->opcode == b->opcode
+         && a->destination == b->destination
+         && a->len == b->len
+         && (is_ignored(a->opcode) || memcmp(a->data, b->data, a->stored) == 0);
+}
+
+static void print_record(const char *what, const replay_record_t *r)
+{
+  printf("%s %10.3f s %s op 0x%02X to 0x%04X len %u:",
+         what,
+         ticks_to_ms(r->ticks) / 1000.0,
+         (r->kind & APP_CAPTURE_KIND_MASK) == APP_CAPTURE_SEND ? "send   " : "publish",
+         r->opcode,
+         r->destination,
+         r->len);
+  for (uint8_t i = 0; i < r->stored && i < 16; i++) {
+    printf(" %02X", r->data[i]);
+  }
+  printf("%s\n", r->stored > 16 ? " ..." : "");
+}
+
+static uint32_t parse_opcodes(char *text)
+{
+  uint32_t n = 0;
+
+  for (char *item = strtok(text, ","); item != NULL && n < MAX_IGNORED;
+       item = strtok(NULL, ",")) {
+    ignored[n++] = (uint8_t)strtoul(item, NULL, 0);
+  }
+  return n;
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t tx_count[256] = { 0 }, rx_count = 0, truncated = 0, refused = 0, early = 0;
+  uint32_t matched_count[256] = { 0 }, replayed_count[256] = { 0 };
+  uint32_t unmatched = 0, extra = 0, after = 0;
+  uint16_t pub_address = 0;
+  uint64_t first_rx = UINT64_MAX, last, max_skew_ms = 0;
+  FILE *in = stdin;
+  struct timespec wall_end;
+  bool ok = true;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "x:p:i:v")) != -1) {
+    switch (opt) {
+      case 'x':
+        speed = atof(optarg);
+        break;
+      case 'p':
+        pub_address = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'i':
+        ignored_count = parse_opcodes(optarg);
+        break;
+      case 'v':
+        verbose = true;
+        break;
+      default:
+        ok = false;
+        break;
+    }
+  }
+  if (!ok || speed < 0 || argc - optind > 1) {
+    fprintf(stderr, "usage: %s [-x speed] [-p pub_address] [-i opcode,...] [-v] [capture.log]\n",
+            argv[0]);
+    return 2;
+  }
+  if (optind < argc && (in = fopen(argv[optind], "r")) == NULL) {
+    perror(argv[optind]);
+    return 2;
+  }
+  if (!read_capture(in) || captured.count == 0) {
+    fprintf(stderr, "no complete capture in the input\n");
+    return 2;
+  }
+
+  for (size_t i = 0; i < captured.count; i++) {
+    replay_record_t *r = &captured.items[i];
+    if ((r->kind & APP_CAPTURE_KIND_MASK) == APP_CAPTURE_RX) {
+      rx_count++;
+      truncated += (r->kind & APP_CAPTURE_FLAG_TRUNCATED) != 0;
+      if (first_rx == UINT64_MAX) {
+        first_rx = r->ticks;
+      }
+    }
+  }
+  last = captured.items[captured.count - 1].ticks;
+  if (first_rx == UINT64_MAX) {
+    fprintf(stderr, "the capture holds no received message\n");
+    return 2;
+  }
+
+  if (!verbose) {
+    host_log_mute(true);
+  }
+  boot(captured.items[0].ticks, pub_address);
+  sim_start_ms = ticks_to_ms(captured.items[0].ticks);
+  clock_gettime(CLOCK_MONOTONIC, &wall_start);
+  for (size_t i = 0; i < captured.count; i++) {
+    const replay_record_t *r = &captured.items[i];
+    if ((r->kind & APP_CAPTURE_KIND_MASK) != APP_CAPTURE_RX) {
+      continue;
+    }
+    run_until(r->ticks);
+    pace(ticks_to_ms(r->ticks));
+    receive(r);
+  }
+  run_until(last + (uint64_t)DRAIN_MS * capture_hz / 1000);
+  clock_gettime(CLOCK_MONOTONIC, &wall_end);
+  host_log_mute(false);
+
+  // Each tx record against the first equal replayed message
+  for (size_t i = 0; i < captured.count; i++) {
+    replay_record_t *c = &captured.items[i];
+    if ((c->kind & APP_CAPTURE_KIND_MASK) == APP_CAPTURE_RX) {
+      continue;
+    }
+    if (c->kind & APP_CAPTURE_FLAG_FAILED) {
+      refused++;
+      continue;
+    }
+    if (c->ticks < first_rx) {
+      early++;
+      continue;
+    }
+    tx_count[c->opcode]++;
+    for (size_t j = 0; j < replayed.count; j++) {
+      replay_record_t *p = &replayed.items[j];
+      if (!p->matched && same(c, p)) {
+        uint64_t skew = c->ticks > p->ticks ? c->ticks - p->ticks : p->ticks - c->ticks;
+        p->matched = true;
+        c->matched = true;
+        matched_count[c->opcode]++;
+        if (ticks_to_ms(skew) > max_skew_ms) {
+          max_skew_ms = ticks_to_ms(skew);
+        }
+        break;
+      }
+    }
+    if (!c->matched) {
+      unmatched++;
+      if (verbose) {
+        print_record("missing ", c);
+      }
+    }
+  }
+  for (size_t j = 0; j < replayed.count; j++) {
+    replay_record_t *p = &replayed.items[j];
+    if (p->matched) {
+      replayed_count[p->opcode]++;
+      continue;
+    }
+    if (p->ticks < first_rx) {
+      early++;
+      continue;
+    }
+    if (p->ticks > last) {
+      after++;
+      continue;
+    }
+    replayed_count[p->opcode]++;
+    extra++;
+    if (verbose) {
+      print_record("extra   ", p);
+    }
+  }
+
+  printf("capture of node 0x%04X at %lu Hz: %zu records over %.1f s\n",
+         capture_node,
+         (unsigned long)capture_hz,
+         captured.count,
+         (ticks_to_ms(last) - sim_start_ms) / 1000.0);
+  printf("replayed %lu received messages (%lu cut short) in %.2f s at speed %g\n",
+         (unsigned long)rx_count,
+         (unsigned long)truncated,
+         (wall_end.tv_sec - wall_start.tv_sec) + (wall_end.tv_nsec - wall_start.tv_nsec) / 1e9,
+         speed);
+  printf("tx left out: %lu before the first received message, %lu refused by the stack\n",
+         (unsigned long)early,
+         (unsigned long)refused);
+  printf("opcode  captured  replayed  matched\n");
+  for (uint32_t op = 0; op < 256; op++) {
+    if (tx_count[op] != 0 || replayed_count[op] != 0) {
+      printf("  0x%02X  %8lu  %8lu  %7lu%s\n",
+             op,
+             (unsigned long)tx_count[op],
+             (unsigned long)replayed_count[op],
+             (unsigned long)matched_count[op],
+             is_ignored((uint8_t)op) ? "  payload ignored" : "");
+    }
+  }
+  printf("%lu missing, %lu extra, %lu after the capture, largest time difference %lu ms\n",
+         (unsigned long)unmatched,
+         (unsigned long)extra,
+         (unsigned long)after,
+         (unsigned long)max_skew_ms);
+  return unmatched == 0 && extra == 0 ? 0 : 1;
+}
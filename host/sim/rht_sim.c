@@ -0,0 +1,131 @@
+/***************************************************************************//**
+ * @file rht_sim.c
+ * @brief Event loop blocking of the blocking sensor read against the
+ *        split-phase acquisition of app_rht.c.
+ *
+ * A stand-in Si70xx with a configurable conversion time (sdk/host_sensor.c)
+ * is read once a second, first through sl_sensor_rht_get() as the client did
+ * from its event handler, then through the real app_rht.c: app_rht_start(),
+ * the conversion timer, the external signal and app_rht_read(), with its
+ * retries of a read the sensor NACKs.
+ *
+ * The table gives, per conversion time, how long the driver calls held the
+ * event loop per sample and the longest single hold, and for the split-phase
+ * path the NACKed reads, the time from the start to the result and the
+ * samples that failed after the last retry.
+ *
+ * Usage: rht_sim [samples]
+ ******************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_sdk.h"
+#include "host_sensor.h"
+#include "sl_sensor_rht.h"
+#include "sl_sleeptimer.h"
+#include "app_rht.h"
+#include "app_time.h"
+
+#define SAMPLE_INTERVAL_MS              1000
+#define EX_SENSOR_READY                 (1u << 7)
+
+typedef struct {
+  host_sensor_stats_t stats;
+  uint64_t result_us;                   // start to result, summed
+  uint32_t failed;
+} sim_result_t;
+
+static host_node_t node;
+
+static sim_result_t run_blocking(uint32_t samples)
+{
+  sim_result_t r = { 0 };
+  uint32_t humidity;
+  int32_t temperature;
+
+  host_clock_set_ms(0);
+  host_sensor_take_stats();
+  for (uint32_t i = 0; i < samples; i++) {
+    uint64_t start;
+
+    host_run_until((uint64_t)i * SAMPLE_INTERVAL_MS);
+    start = host_clock_ticks();
+    if (sl_sensor_rht_get(&humidity, &temperature) != SL_STATUS_OK) {
+      r.failed++;
+    }
+    r.result_us += (host_clock_ticks() - start) * 1000000 / sl_sleeptimer_get_timer_frequency();
+  }
+  r.stats = host_sensor_take_stats();
+  return r;
+}
+
+static sim_result_t run_split(uint32_t samples)
+{
+  sim_result_t r = { 0 };
+  uint32_t humidity;
+  int32_t temperature;
+
+  host_clock_set_ms(0);
+  app_rht_init(EX_SENSOR_READY);
+  host_sensor_take_stats();
+  for (uint32_t i = 0; i < samples; i++) {
+    uint64_t until = (uint64_t)(i + 1) * SAMPLE_INTERVAL_MS - 1;
+    uint64_t start;
+    sl_status_t sc = SL_STATUS_NOT_READY;
+
+    host_run_until((uint64_t)i * SAMPLE_INTERVAL_MS);
+    start = host_clock_ticks();
+    if (app_rht_start() != SL_STATUS_OK) {
+      r.failed++;
+      continue;
+    }
+    // The worker reads when the conversion timer signals
+    while (sc == SL_STATUS_NOT_READY && host_node_fire_next(&node, until)) {
+      if (host_node_take_signals(&node) & EX_SENSOR_READY) {
+        sc = app_rht_read(&humidity, &temperature);
+      }
+    }
+    if (sc != SL_STATUS_OK) {
+      r.failed++;
+    }
+    r.result_us += (host_clock_ticks() - start) * 1000000 / sl_sleeptimer_get_timer_frequency();
+  }
+  r.stats = host_sensor_take_stats();
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  static const uint32_t latencies_us[] = { 3800, 7000, 12000, 23000, 30000, 40000, 45000 };
+  uint32_t samples = argc > 1 ? (uint32_t)atoi(argv[1]) : 1000;
+
+  if (samples == 0) {
+    fprintf(stderr, "usage: %s [samples]\n", argv[0]);
+    return 2;
+  }
+  host_log_mute(true);
+  host_node_init(&node, 0x0100);
+  host_node_enter(&node);
+  app_time_init();
+
+  printf("%u samples, one a second, I2C at %u us per byte\n", samples, HOST_SENSOR_I2C_BYTE_US);
+  printf("            blocking read          split-phase (app_rht.c)\n");
+  printf("conversion  held/sample  longest   held/sample  longest  nacks/sample  result after  failed\n");
+  for (size_t l = 0; l < sizeof(latencies_us) / sizeof(latencies_us[0]); l++) {
+    sim_result_t b, s;
+
+    host_sensor_set_latency_us(latencies_us[l]);
+    b = run_blocking(samples);
+    s = run_split(samples);
+    printf("%7.1f ms  %8.2f ms  %5.2f ms  %8.2f ms  %5.2f ms  %12.2f  %9.2f ms  %6u\n",
+           latencies_us[l] / 1000.0,
+           b.stats.held_us / 1000.0 / samples,
+           b.stats.longest_us / 1000.0,
+           s.stats.held_us / 1000.0 / samples,
+           s.stats.longest_us / 1000.0,
+           (double)s.stats.nacks / samples,
+           s.result_us / 1000.0 / samples,
+           s.failed);
+  }
+  return 0;
+}
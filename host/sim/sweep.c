@@ -0,0 +1,926 @@
+/***************************************************************************//**
+ * @file sweep.c
+ * @brief Parameter sweep of the relay mesh over node count, loss, report
+ *        period and duplicate cache size, on all cores, with CSV output.
+ *
+ * Nodes are placed at random and connected. Node 0 is the sensor source,
+ * SUBSCRIBERS nodes drawn at random run the server, and all others run the
+ * relay. The relays and servers are the firmware: each is a relay_node_t
+ * or server_node_t of its own, booted with the provisioned
+ * sl_btmesh_evt_node_initialized_id and handed every message its vendor
+ * model takes as sl_btmesh_evt_vendor_model_receive_id, so relay_on_rx()
+ * and the server dispatch run per node. The external signals a node raises
+ * go to its worker through app_tasks_post_cmd(), as app.c does. The swept
+ * cache size is the length of the relay's duplicate check, set with
+ * app_relay_set_dup_cache_len() after boot.
+ *
+ * The source stands in for the client: it publishes a sensor report every
+ * period, packed by app_sensor_pack() with the report number as the
+ * humidity, and its telemetry every TELEMETRY_MS, both to a group, and
+ * acks the APP_CTRL_SET_NETTX commands of the servers. UNSUBSCRIBED_PCT of
+ * the reports go to a group no server subscribes to.
+ *
+ * A model takes a message sent to its node, to the all-nodes address or to
+ * one of its subscriptions, with one of the opcodes it registered. Relays
+ * are subscribed to both groups of the source, and add the control group
+ * themselves; servers to the subscribed group. What no model takes is
+ * passed on by the network layer of a node with relaying enabled, with the
+ * TTL counted down. A node sends every message as often as the network
+ * transmit state set by its app_nettx.c says, each copy lost on each link
+ * with the given loss, and drops copies of a message it had already seen
+ * from a network cache of NET_CACHE messages. The air has no limit on the
+ * messages it carries at once, so a duplicate check too short for the
+ * traffic turns into a broadcast storm: once STORM_EVENTS copies are in
+ * flight the scenario stops there.
+ *
+ * The scenarios share nothing: the state of each is in a sweep_run_t, and
+ * the host SDK keeps the clock and the current node per thread. They run on
+ * a work-stealing pool. Each worker takes scenarios from the back of its own
+ * deque and steals from the front of the others once it is empty. The rows
+ * come out in scenario order whatever the number of threads, so two runs
+ * with the same parameters give the same file.
+ *
+ * Columns: the scenario, then all transmissions, the share of subscribed
+ * reports that reached the servers, the reports a server got more than
+ * once, the relay layer counters, the copies dropped by the network cache,
+ * the duplicate rate seen by the relays' app_telemetry.c, the mean
+ * transmissions per message app_nettx.c settled on at the relays, and 1 if
+ * the scenario was stopped as a storm.
+ *
+ * Usage: sweep [-j threads] [-s seeds] [-n nodes,...] [-l loss_pct,...]
+ *              [-p period_ms,...] [-c cache,...] [-o file.csv]
+ ******************************************************************************/
+#include <math.h>
+#include <pthread.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "host_sdk.h"
+#include "sl_btmesh_api.h"
+#include "relay_node.h"
+// Both roles number their signals on their own; the sweep only passes
+// them on, so the relay's names give way to the server's
+#undef EX_B0_LONG_PRESS
+#undef EX_CAPTURE_DUMP
+#include "server_node.h"
+#include "app_ctrl.h"
+#include "app_sensor_codec.h"
+#include "my_model_def.h"
+
+#define MAX_NODES                       500
+#define MAX_NEIGHBOURS                  64
+#define NET_CACHE                       128
+#define MAX_LIST                        16
+#define SUBSCRIBERS                     5
+#define UNSUBSCRIBED_PCT                25
+// Nodes boot one after the other over a telemetry period, so their
+// periodic timers are out of phase as in a deployed network
+#define BOOT_SPREAD_MS                  APP_TELEMETRY_PERIOD_MS
+#define TRAFFIC_START_MS                (BOOT_SPREAD_MS + 5000)
+#define TRAFFIC_MS                      180000
+#define TELEMETRY_MS                    10000
+#define DRAIN_MS                        10000
+#define MIN_PERIOD_MS                   100
+#define MAX_REPORTS                     (TRAFFIC_MS / MIN_PERIOD_MS)
+#define RANGE                           1.0
+#define TARGET_DEGREE                   10.0
+#define LINK_DELAY_MS                   2
+#define COPY_GAP_MS                     20
+#define NETWORK_TTL                     7
+#define SIM_PAYLOAD_MAX                 64
+// Messages in flight at which a scenario counts as a broadcast storm
+#define STORM_EVENTS                    1000000
+
+#define GROUP_SUBSCRIBED                0xC001
+#define GROUP_UNSUBSCRIBED              0xC005
+
+// Vendor model of the source, as the client registers it
+#define SOURCE_MODEL_ID                 0x2222
+// Temperature of every report, milli-degrees
+#define SOURCE_TEMPERATURE              21000
+// Humidity step of the report number in the sensor codec
+#define REPORT_HUMIDITY_STEP            50
+
+_Static_assert(sizeof(app_telemetry_status_t) <= SIM_PAYLOAD_MAX,
+               "a telemetry report must fit one event");
+_Static_assert(MAX_REPORTS * REPORT_HUMIDITY_STEP <= 102350,
+               "the report number must fit the humidity field");
+
+typedef enum {
+  SIM_SOURCE,
+  SIM_RELAY,
+  SIM_SERVER,
+} sim_role_t;
+
+typedef struct {
+  uint32_t nodes;
+  uint32_t loss_pct;
+  uint32_t period_ms;
+  uint32_t cache;
+  uint32_t seed;
+} sweep_scenario_t;
+
+typedef struct {
+  uint64_t transmissions;
+  uint64_t deliveries;
+  uint64_t expected;
+  uint64_t repeats;
+  uint64_t suppressed;
+  uint64_t filtered;
+  uint64_t merged;
+  uint64_t net_drops;
+  uint64_t dup_lookups;
+  uint64_t dup_hits;
+  double nettx_mean;
+  bool storm;
+} sweep_result_t;
+
+struct sweep_run;
+
+typedef struct {
+  host_node_t hn;
+  struct sweep_run *run;
+  sim_role_t role;
+  bool booted;
+  relay_node_t *relay;                  // SIM_RELAY
+  server_node_t *server;                // SIM_SERVER
+  double x, y;
+  uint16_t neighbours[MAX_NEIGHBOURS];
+  uint8_t neighbour_count;
+  // Network cache: sequence numbers of the last messages
+  uint32_t net_cache[NET_CACHE];
+  uint8_t net_next;
+  uint8_t delivered[(MAX_REPORTS + 7) / 8];
+} sim_node_t;
+
+typedef struct {
+  uint64_t at_ms;
+  uint32_t seq;                         // network message, shared by its copies
+  uint16_t node;                        // receiver
+  uint16_t source;
+  uint16_t destination;
+  uint16_t appkey_index;
+  uint8_t ttl;
+  uint8_t opcode;
+  uint8_t len;
+  uint8_t data[SIM_PAYLOAD_MAX];
+} sim_event_t;
+
+typedef struct {
+  sim_event_t *items;
+  size_t count;
+  size_t size;
+} sim_heap_t;
+
+typedef struct sweep_run {
+  const sweep_scenario_t *sc;
+  sweep_result_t *result;
+  sim_node_t *nodes;
+  sim_heap_t heap;
+  uint32_t link_rng;
+  uint32_t next_seq;
+  // The source's own modules
+  app_telemetry_t source_telemetry;
+  app_nettx_t source_nettx;
+} sweep_run_t;
+
+typedef struct {
+  pthread_mutex_t lock;
+  uint32_t *items;
+  uint32_t head;                        // thieves take from here
+  uint32_t tail;                        // the owner takes from here
+} sweep_deque_t;
+
+typedef struct {
+  sweep_deque_t *deques;
+  uint32_t workers;
+  const sweep_scenario_t *scenarios;
+  sweep_result_t *results;
+} sweep_pool_t;
+
+typedef struct {
+  sweep_pool_t *pool;
+  uint32_t index;
+  uint32_t done;
+  uint32_t stolen;
+} sweep_worker_t;
+
+static uint32_t next_random(uint32_t *state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static double random_unit(uint32_t *state)
+{
+  return (next_random(state) & 0xFFFFFF) / (double)0x1000000;
+}
+
+static void heap_push(sim_heap_t *heap, const sim_event_t *ev)
+{
+  size_t i;
+
+  if (heap->count == heap->size) {
+    heap->size = heap->size ? heap->size * 2 : 1024;
+    heap->items = realloc(heap->items, heap->size * sizeof(*heap->items));
+  }
+  i = heap->count++;
+  while (i > 0 && heap->items[(i - 1) / 2].at_ms > ev->at_ms) {
+    heap->items[i] = heap->items[(i - 1) / 2];
+    i = (i - 1) / 2;
+  }
+  heap->items[i] = *ev;
+}
+
+static void heap_pop(sim_heap_t *heap, sim_event_t *ev)
+{
+  sim_event_t last = heap->items[--heap->count];
+  size_t i = 0;
+
+  *ev = heap->items[0];
+  for (;;) {
+    size_t child = 2 * i + 1;
+    if (child >= heap->count) {
+      break;
+    }
+    if (child + 1 < heap->count && heap->items[child + 1].at_ms < heap->items[child].at_ms) {
+      child++;
+    }
+    if (heap->items[child].at_ms >= last.at_ms) {
+      break;
+    }
+    heap->items[i] = heap->items[child];
+    i = child;
+  }
+  if (heap->count > 0) {
+    heap->items[i] = last;
+  }
+}
+
+static bool connected(const sweep_run_t *run)
+{
+  uint16_t queue[MAX_NODES];
+  bool reached[MAX_NODES] = { false };
+  uint32_t head = 0, tail = 0;
+
+  queue[tail++] = 0;
+  reached[0] = true;
+  while (head < tail) {
+    const sim_node_t *n = &run->nodes[queue[head++]];
+    for (int i = 0; i < n->neighbour_count; i++) {
+      if (!reached[n->neighbours[i]]) {
+        reached[n->neighbours[i]] = true;
+        queue[tail++] = n->neighbours[i];
+      }
+    }
+  }
+  return tail == run->sc->nodes;
+}
+
+static void place(sweep_run_t *run, uint32_t *rng)
+{
+  uint32_t count = run->sc->nodes;
+  sim_node_t *nodes = run->nodes;
+  double side = sqrt(count * M_PI * RANGE * RANGE / TARGET_DEGREE);
+
+  do {
+    for (uint32_t i = 0; i < count; i++) {
+      nodes[i].x = random_unit(rng) * side;
+      nodes[i].y = random_unit(rng) * side;
+      nodes[i].neighbour_count = 0;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+      for (uint32_t j = i + 1; j < count; j++) {
+        double dx = nodes[i].x - nodes[j].x;
+        double dy = nodes[i].y - nodes[j].y;
+        if (dx * dx + dy * dy <= RANGE * RANGE
+            && nodes[i].neighbour_count < MAX_NEIGHBOURS
+            && nodes[j].neighbour_count < MAX_NEIGHBOURS) {
+          nodes[i].neighbours[nodes[i].neighbour_count++] = (uint16_t)j;
+          nodes[j].neighbours[nodes[j].neighbour_count++] = (uint16_t)i;
+        }
+      }
+    }
+  } while (!connected(run));
+}
+
+
+/// Put @p proto on the air from @p sender, @p copies times
+static void transmit(sweep_run_t *run, sim_node_t *sender, sim_event_t *proto, uint8_t copies)
+{
+  run->result->transmissions += copies;
+  for (uint8_t c = 0; c < copies; c++) {
+    proto->at_ms = host_clock_ms() + LINK_DELAY_MS + (uint64_t)c * COPY_GAP_MS;
+    for (int i = 0; i < sender->neighbour_count; i++) {
+      if (next_random(&run->link_rng) % 100 < run->sc->loss_pct) {
+        continue;
+      }
+      proto->node = sender->neighbours[i];
+      heap_push(&run->heap, proto);
+    }
+  }
+}
+
+/// The on_tx hook of every node: a message the node sends or publishes
+static void on_tx(host_node_t *hn, const host_tx_t *tx)
+{
+  sim_node_t *n = hn->user;
+  sim_event_t ev = {
+    .seq = n->run->next_seq++,
+    .source = tx->source,
+    .destination = tx->destination,
+    .appkey_index = tx->appkey_index,
+    .ttl = tx->ttl,
+    .opcode = tx->opcode,
+    .len = (uint8_t)tx->len,
+  };
+
+  if (tx->len > SIM_PAYLOAD_MAX) {
+    fprintf(stderr, "0x%04X sent %u bytes with opcode 0x%02X, more than the sweep carries\n",
+            tx->source, tx->len, tx->opcode);
+    abort();
+  }
+  memcpy(ev.data, tx->data, tx->len);
+  transmit(n->run, n, &ev, (uint8_t)(hn->nettx_count + 1));
+}
+
+/// Hand the signals raised on @p n to its worker, as app.c does
+static void post_signals(sim_node_t *n)
+{
+  uint32_t signals;
+
+  // Work done for one signal may raise the next
+  while ((signals = host_node_take_signals(&n->hn)) != 0) {
+    if (n->role == SIM_RELAY) {
+      app_tasks_post_cmd(&n->relay->tasks, signals);
+    } else if (n->role == SIM_SERVER) {
+      app_tasks_post_cmd(&n->server->tasks, signals);
+    }
+  }
+}
+
+/// Returns true if @p seq is in the network cache of @p n, adds it if not
+static bool net_cache_seen(sim_node_t *n, uint32_t seq)
+{
+  for (uint32_t i = 0; i < NET_CACHE; i++) {
+    if (n->net_cache[i] == seq) {
+      return true;
+    }
+  }
+  n->net_cache[n->net_next] = seq;
+  n->net_next = (uint8_t)((n->net_next + 1) % NET_CACHE);
+  return false;
+}
+
+/// Returns true if the vendor model of @p n takes @p ev
+static bool model_takes(const sim_node_t *n, const sim_event_t *ev)
+{
+  bool addressed = ev->destination == n->hn.address || ev->destination == 0xFFFF;
+
+  for (uint8_t i = 0; i < n->hn.sub_count && !addressed; i++) {
+    addressed = n->hn.subs[i] == ev->destination;
+  }
+  return addressed && memchr(n->hn.opcodes, ev->opcode, n->hn.opcode_count) != NULL;
+}
+
+/// Count a subscribed report reaching server @p n
+static void count_delivery(sweep_run_t *run, sim_node_t *n, const sim_event_t *ev)
+{
+  app_sensor_sample_t sample;
+  uint32_t id;
+
+  if (ev->opcode != sensor_status || ev->destination != GROUP_SUBSCRIBED
+      || !app_sensor_unpack(ev->data, ev->len, &sample)) {
+    return;
+  }
+  id = (uint32_t)sample.humidity / REPORT_HUMIDITY_STEP;
+  if (n->delivered[id / 8] & (1u << (id % 8))) {
+    run->result->repeats++;
+  } else {
+    n->delivered[id / 8] |= (uint8_t)(1u << (id % 8));
+    run->result->deliveries++;
+  }
+}
+
+/// What the client does with a control command: apply it and ack at once
+static void source_on_rx(sweep_run_t *run, const sim_event_t *ev)
+{
+  app_ctrl_cmd_t cmd;
+  uint8_t ack[APP_CTRL_ACK_LEN];
+  sl_status_t sc;
+
+  if (ev->opcode != ctrl_command || !app_ctrl_decode(ev->data, ev->len, &cmd)) {
+    return;
+  }
+  ack[0] = cmd.seq;
+  ack[1] = APP_CTRL_STATUS_OK;
+  if (cmd.command == APP_CTRL_SET_NETTX) {
+    app_nettx_set_level(&run->source_nettx, (uint8_t)cmd.argument);
+  } else {
+    ack[1] = APP_CTRL_STATUS_UNSUPPORTED;
+  }
+  sc = sl_btmesh_vendor_model_send(ev->source, -1, ev->appkey_index, PRIMARY_ELEMENT,
+                                   VENDOR_ID, SOURCE_MODEL_ID, 0, ctrl_ack, 1,
+                                   sizeof(ack), ack);
+  app_telemetry_count_send(&run->source_telemetry, ev->source, sc);
+}
+
+/// Hand @p ev to the vendor model of @p n as the stack would
+static void deliver(sweep_run_t *run, sim_node_t *n, const sim_event_t *ev)
+{
+  sl_btmesh_msg_t evt;
+  sl_btmesh_evt_vendor_model_receive_t *rx = &evt.data.evt_vendor_model_receive;
+
+  if (n->role == SIM_SOURCE) {
+    source_on_rx(run, ev);
+    return;
+  }
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_btmesh_evt_vendor_model_receive_id;
+  rx->destination_address = ev->destination;
+  rx->source_address = ev->source;
+  rx->va_index = -1;
+  rx->appkey_index = ev->appkey_index;
+  rx->opcode = ev->opcode;
+  rx->final = 1;
+  rx->payload.len = ev->len;
+  memcpy(rx->payload.data, ev->data, ev->len);
+  if (n->role == SIM_RELAY) {
+    relay_node_on_mesh_event(n->relay, &evt);
+  } else {
+    count_delivery(run, n, ev);
+    server_node_on_mesh_event(n->server, &evt);
+  }
+  post_signals(n);
+}
+
+/// A copy of a message arriving at its receiver, which is entered
+static void receive(sweep_run_t *run, sim_event_t *ev)
+{
+  sim_node_t *n = &run->nodes[ev->node];
+
+  if (!n->booted) {
+    return;
+  }
+  // Our own messages come back from the neighbours that pass them on
+  if (ev->source == n->hn.address) {
+    return;
+  }
+  if (net_cache_seen(n, ev->seq)) {
+    run->result->net_drops++;
+    return;
+  }
+  if (model_takes(n, ev)) {
+    deliver(run, n, ev);
+  }
+  // The network layer passes on whatever is not for this node alone
+  if (ev->destination != n->hn.address && n->hn.relay_enabled && ev->ttl >= 2) {
+    ev->ttl--;
+    transmit(run, n, ev, (uint8_t)(n->hn.relay_count + 1));
+  }
+}
+
+/// Send a message of the source, entered, and count it in its telemetry
+static void source_send(sweep_run_t *run, uint8_t opcode, uint16_t destination,
+                        const uint8_t *data, uint8_t len)
+{
+  sl_status_t sc;
+
+  sc = sl_btmesh_vendor_model_send(destination, -1, 0, PRIMARY_ELEMENT, VENDOR_ID,
+                                   SOURCE_MODEL_ID, 0, opcode, 1, len, data);
+  app_telemetry_count_send(&run->source_telemetry, destination, sc);
+}
+
+/// Provision node @p index as @p role and boot it
+static void boot(sweep_run_t *run, uint32_t index, sim_role_t role)
+{
+  sim_node_t *n = &run->nodes[index];
+  sl_btmesh_msg_t evt;
+  uint8_t source_opcode = ctrl_command;
+
+  host_node_init(&n->hn, (uint16_t)(index + 1));
+  n->hn.rng ^= run->sc->seed * 2654435761u;
+  n->hn.user = n;
+  n->hn.on_tx = on_tx;
+  n->hn.pub_set = true;
+  n->hn.pub_address = GROUP_SUBSCRIBED;
+  n->hn.pub_ttl = NETWORK_TTL;
+  n->run = run;
+  n->role = role;
+  n->booted = true;
+  host_node_enter(&n->hn);
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_btmesh_evt_node_initialized_id;
+  evt.data.evt_node_initialized.provisioned = 1;
+  evt.data.evt_node_initialized.address = n->hn.address;
+  switch (role) {
+    case SIM_RELAY:
+      n->hn.subs[n->hn.sub_count++] = GROUP_SUBSCRIBED;
+      n->hn.subs[n->hn.sub_count++] = GROUP_UNSUBSCRIBED;
+      n->relay = calloc(1, sizeof(*n->relay));
+      relay_node_init(n->relay);
+      relay_node_on_mesh_event(n->relay, &evt);
+      app_relay_set_dup_cache_len(&n->relay->relay, (uint8_t)run->sc->cache);
+      break;
+
+    case SIM_SERVER:
+      n->hn.subs[n->hn.sub_count++] = GROUP_SUBSCRIBED;
+      n->server = calloc(1, sizeof(*n->server));
+      server_node_init(n->server);
+      server_node_on_mesh_event(n->server, &evt);
+      break;
+
+    case SIM_SOURCE:
+      (void)sl_btmesh_vendor_model_init(PRIMARY_ELEMENT, VENDOR_ID, SOURCE_MODEL_ID, 1,
+                                        1, &source_opcode);
+      app_telemetry_init(&run->source_telemetry);
+      app_nettx_init(&run->source_nettx, false, 0);
+      break;
+  }
+  post_signals(n);
+}
+
+/// Earliest timer of any node, UINT64_MAX if none
+static uint64_t next_timer(const sweep_run_t *run, uint16_t *owner)
+{
+  uint64_t first = UINT64_MAX;
+
+  for (uint32_t i = 0; i < run->sc->nodes; i++) {
+    uint64_t d = host_node_next_deadline(&run->nodes[i].hn);
+    if (d < first) {
+      first = d;
+      *owner = (uint16_t)i;
+    }
+  }
+  return first;
+}
+
+static void run_scenario(const sweep_scenario_t *sc, sweep_result_t *result)
+{
+  sweep_run_t run = { .sc = sc, .result = result };
+  uint32_t place_rng = sc->seed * 2246822519u + 5;
+  uint32_t traffic_rng = sc->seed * 7919u + 1;
+  uint32_t reports = TRAFFIC_MS / sc->period_ms;
+  uint64_t traffic_end = TRAFFIC_START_MS + (uint64_t)reports * sc->period_ms;
+  uint64_t next_report = TRAFFIC_START_MS;
+  uint64_t next_telemetry = TRAFFIC_START_MS;
+  uint32_t relays = 0;
+  uint32_t booted = 0;
+  uint16_t report = 0;
+  bool server[MAX_NODES] = { false };
+
+  memset(result, 0, sizeof(*result));
+  run.nodes = calloc(sc->nodes, sizeof(*run.nodes));
+  run.next_seq = 1;                     // 0 marks a free network cache slot
+  run.link_rng = sc->seed * 104729u + 3;
+  place(&run, &place_rng);
+  host_clock_set_ms(0);
+
+  // The servers are drawn away from the source
+  for (int s = 0; s < SUBSCRIBERS; s++) {
+    uint32_t pick;
+    do {
+      pick = 1 + next_random(&traffic_rng) % (sc->nodes - 1);
+    } while (server[pick]);
+    server[pick] = true;
+  }
+
+  for (;;) {
+    uint64_t boot_at = booted < sc->nodes
+                       ? (uint64_t)booted * BOOT_SPREAD_MS / sc->nodes : UINT64_MAX;
+    uint16_t owner = 0;
+    uint64_t timer_at = next_timer(&run, &owner);
+    uint64_t event_at = run.heap.count ? run.heap.items[0].at_ms : UINT64_MAX;
+    uint64_t report_at = report < reports ? next_report : UINT64_MAX;
+    uint64_t telemetry_at = next_telemetry < traffic_end ? next_telemetry : UINT64_MAX;
+    uint64_t first = boot_at;
+
+    if (timer_at < first) {
+      first = timer_at;
+    }
+    if (event_at < first) {
+      first = event_at;
+    }
+    if (report_at < first) {
+      first = report_at;
+    }
+    if (telemetry_at < first) {
+      first = telemetry_at;
+    }
+    // The periodic timers of the nodes run for ever
+    if (first > traffic_end + DRAIN_MS) {
+      break;
+    }
+    if (run.heap.count > STORM_EVENTS) {
+      result->storm = true;
+      break;
+    }
+
+    if (boot_at == first) {
+      host_clock_set_ms(boot_at);
+      boot(&run, booted, booted == 0 ? SIM_SOURCE : server[booted] ? SIM_SERVER : SIM_RELAY);
+      booted++;
+    } else if (timer_at == first) {
+      sim_node_t *n = &run.nodes[owner];
+      host_node_fire_next(&n->hn, timer_at);
+      host_node_enter(&n->hn);
+      post_signals(n);
+    } else if (event_at == first) {
+      sim_event_t ev;
+      heap_pop(&run.heap, &ev);
+      host_clock_set_ms(ev.at_ms);
+      host_node_enter(&run.nodes[ev.node].hn);
+      receive(&run, &ev);
+    } else if (telemetry_at == first) {
+      app_telemetry_status_t status;
+      host_clock_set_ms(telemetry_at);
+      host_node_enter(&run.nodes[0].hn);
+      app_telemetry_snapshot(&run.source_telemetry, &status);
+      source_send(&run, telemetry_status, GROUP_SUBSCRIBED,
+                  (const uint8_t *)&status, sizeof(status));
+      next_telemetry += TELEMETRY_MS;
+    } else {
+      app_sensor_sample_t sample = {
+        .humidity = (int32_t)report * REPORT_HUMIDITY_STEP,
+        .temperature = SOURCE_TEMPERATURE,
+      };
+      uint8_t body[APP_SENSOR_PACKED_LEN];
+      bool subscribed = next_random(&traffic_rng) % 100 >= UNSUBSCRIBED_PCT;
+      app_sensor_pack(&sample, body);
+      host_clock_set_ms(report_at);
+      host_node_enter(&run.nodes[0].hn);
+      source_send(&run, sensor_status,
+                  subscribed ? GROUP_SUBSCRIBED : GROUP_UNSUBSCRIBED,
+                  body, sizeof(body));
+      if (subscribed) {
+        result->expected += SUBSCRIBERS;
+      }
+      report++;
+      next_report += sc->period_ms;
+    }
+  }
+
+  for (uint32_t i = 0; i < sc->nodes; i++) {
+    sim_node_t *n = &run.nodes[i];
+    if (n->role == SIM_RELAY) {
+      result->suppressed += n->relay->relay.suppressed_count;
+      result->filtered += n->relay->relay.filtered_count;
+      result->merged += n->relay->relay.merged_count;
+      result->dup_lookups += n->relay->telemetry.counters.dup_lookups;
+      result->dup_hits += n->relay->telemetry.counters.dup_hits;
+      result->nettx_mean += app_nettx_transmissions(&n->relay->nettx);
+      relays++;
+    }
+  }
+  result->nettx_mean = relays ? result->nettx_mean / relays : 0;
+  // The timers still running are linked within the nodes freed here
+  host_node_enter(NULL);
+  for (uint32_t i = 0; i < sc->nodes; i++) {
+    free(run.nodes[i].relay);
+    free(run.nodes[i].server);
+  }
+  free(run.heap.items);
+  free(run.nodes);
+}
+
+/// Next scenario for @p w: its own newest, else the oldest of another worker
+static bool take(sweep_worker_t *w, uint32_t *scenario)
+{
+  sweep_pool_t *pool = w->pool;
+
+  for (uint32_t k = 0; k < pool->workers; k++) {
+    sweep_deque_t *d = &pool->deques[(w->index + k) % pool->workers];
+    bool found = false;
+
+    pthread_mutex_lock(&d->lock);
+    if (d->head < d->tail) {
+      *scenario = k == 0 ? d->items[--d->tail] : d->items[d->head++];
+      found = true;
+    }
+    pthread_mutex_unlock(&d->lock);
+    if (found) {
+      if (k != 0) {
+        w->stolen++;
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+static void *worker_main(void *arg)
+{
+  sweep_worker_t *w = arg;
+  uint32_t scenario;
+
+  // Nothing adds work once the pool runs, so empty deques everywhere end it
+  while (take(w, &scenario)) {
+    run_scenario(&w->pool->scenarios[scenario], &w->pool->results[scenario]);
+    w->done++;
+  }
+  return NULL;
+}
+
+/// Parse a comma separated list of numbers into @p out, returns the count
+static uint32_t parse_list(const char *text, uint32_t *out)
+{
+  uint32_t count = 0;
+  char *end;
+
+  while (*text != '\0' && count < MAX_LIST) {
+    out[count++] = (uint32_t)strtoul(text, &end, 10);
+    if (end == text || (*end != ',' && *end != '\0')) {
+      return 0;
+    }
+    text = *end == ',' ? end + 1 : end;
+  }
+  return *text == '\0' ? count : 0;
+}
+
+static void usage(const char *name)
+{
+  fprintf(stderr,
+          "usage: %s [-j threads] [-s seeds] [-n nodes,...] [-l loss_pct,...]\n"
+          "          [-p period_ms,...] [-c cache,...] [-o file.csv]\n",
+          name);
+}
+
+int main(int argc, char **argv)
+{
+  uint32_t nodes[MAX_LIST] = { 25, 50, 100 };
+  uint32_t losses[MAX_LIST] = { 0, 10, 20, 30 };
+  uint32_t periods[MAX_LIST] = { 500, 1000, 2000 };
+  uint32_t caches[MAX_LIST] = { 1, 4, 16 };
+  uint32_t node_count = 3, loss_count = 4, period_count = 3, cache_count = 3;
+  long cores = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t threads = cores > 0 ? (uint32_t)cores : 1;
+  uint32_t seeds = 2;
+  const char *out_path = NULL;
+  sweep_scenario_t *scenarios;
+  sweep_result_t *results;
+  sweep_deque_t *deques;
+  sweep_worker_t *workers;
+  pthread_t *tids;
+  sweep_pool_t pool;
+  uint32_t total, stolen = 0;
+  struct timespec t0, t1;
+  FILE *out = stdout;
+  bool ok = true;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "j:s:n:l:p:c:o:")) != -1) {
+    switch (opt) {
+      case 'j':
+        threads = (uint32_t)atoi(optarg);
+        break;
+      case 's':
+        seeds = (uint32_t)atoi(optarg);
+        break;
+      case 'n':
+        node_count = parse_list(optarg, nodes);
+        break;
+      case 'l':
+        loss_count = parse_list(optarg, losses);
+        break;
+      case 'p':
+        period_count = parse_list(optarg, periods);
+        break;
+      case 'c':
+        cache_count = parse_list(optarg, caches);
+        break;
+      case 'o':
+        out_path = optarg;
+        break;
+      default:
+        ok = false;
+        break;
+    }
+  }
+  ok = ok && optind == argc && threads > 0 && seeds > 0
+       && node_count > 0 && loss_count > 0 && period_count > 0 && cache_count > 0;
+  for (uint32_t i = 0; ok && i < node_count; i++) {
+    ok = nodes[i] >= SUBSCRIBERS + 2 && nodes[i] <= MAX_NODES;
+  }
+  for (uint32_t i = 0; ok && i < loss_count; i++) {
+    ok = losses[i] < 100;
+  }
+  for (uint32_t i = 0; ok && i < period_count; i++) {
+    ok = periods[i] >= MIN_PERIOD_MS && periods[i] <= TRAFFIC_MS;
+  }
+  for (uint32_t i = 0; ok && i < cache_count; i++) {
+    ok = caches[i] >= 1 && caches[i] <= APP_RELAY_DUP_CACHE_LEN;
+  }
+  if (!ok) {
+    usage(argv[0]);
+    return 2;
+  }
+  if (out_path != NULL && (out = fopen(out_path, "w")) == NULL) {
+    perror(out_path);
+    return 1;
+  }
+
+  total = node_count * loss_count * period_count * cache_count * seeds;
+  scenarios = calloc(total, sizeof(*scenarios));
+  results = calloc(total, sizeof(*results));
+  total = 0;
+  for (uint32_t n = 0; n < node_count; n++) {
+    for (uint32_t l = 0; l < loss_count; l++) {
+      for (uint32_t p = 0; p < period_count; p++) {
+        for (uint32_t c = 0; c < cache_count; c++) {
+          for (uint32_t s = 1; s <= seeds; s++) {
+            scenarios[total++] = (sweep_scenario_t) {
+              .nodes = nodes[n],
+              .loss_pct = losses[l],
+              .period_ms = periods[p],
+              .cache = caches[c],
+              .seed = s,
+            };
+          }
+        }
+      }
+    }
+  }
+  if (threads > total) {
+    threads = total;
+  }
+
+  // Dealt out in turn, so every worker starts with small and large networks
+  deques = calloc(threads, sizeof(*deques));
+  for (uint32_t w = 0; w < threads; w++) {
+    pthread_mutex_init(&deques[w].lock, NULL);
+    deques[w].items = calloc(total / threads + 1, sizeof(uint32_t));
+  }
+  for (uint32_t i = 0; i < total; i++) {
+    sweep_deque_t *d = &deques[i % threads];
+    d->items[d->tail++] = i;
+  }
+  pool = (sweep_pool_t) {
+    .deques = deques,
+    .workers = threads,
+    .scenarios = scenarios,
+    .results = results,
+  };
+
+  host_log_mute(true);
+  app_time_init();
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+  workers = calloc(threads, sizeof(*workers));
+  tids = calloc(threads, sizeof(*tids));
+  for (uint32_t w = 0; w < threads; w++) {
+    workers[w] = (sweep_worker_t) { .pool = &pool, .index = w };
+    pthread_create(&tids[w], NULL, worker_main, &workers[w]);
+  }
+  for (uint32_t w = 0; w < threads; w++) {
+    pthread_join(tids[w], NULL);
+    stolen += workers[w].stolen;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  fprintf(out, "nodes,loss_pct,period_ms,cache,seed,transmissions,delivery_pct,repeats,"
+          "suppressed,filtered,merged,net_drops,dup_permille,nettx_mean,storm\n");
+  for (uint32_t i = 0; i < total; i++) {
+    const sweep_scenario_t *sc = &scenarios[i];
+    const sweep_result_t *r = &results[i];
+    fprintf(out, "%u,%u,%u,%u,%u,%lu,%.2f,%lu,%lu,%lu,%lu,%lu,%lu,%.3f,%d\n",
+            sc->nodes,
+            sc->loss_pct,
+            sc->period_ms,
+            sc->cache,
+            sc->seed,
+            (unsigned long)r->transmissions,
+            r->expected ? 100.0 * r->deliveries / r->expected : 0.0,
+            (unsigned long)r->repeats,
+            (unsigned long)r->suppressed,
+            (unsigned long)r->filtered,
+            (unsigned long)r->merged,
+            (unsigned long)r->net_drops,
+            (unsigned long)(r->dup_lookups ? r->dup_hits * 1000 / r->dup_lookups : 0),
+            r->nettx_mean,
+            r->storm);
+  }
+  if (out != stdout) {
+    fclose(out);
+  }
+  fprintf(stderr, "%u scenarios on %u threads in %.1f s, %u stolen\n",
+          total, threads,
+          (double)(t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9,
+          stolen);
+
+  for (uint32_t w = 0; w < threads; w++) {
+    pthread_mutex_destroy(&deques[w].lock);
+    free(deques[w].items);
+  }
+  free(deques);
+  free(workers);
+  free(tids);
+  free(scenarios);
+  free(results);
+  return 0;
+}
@@ -0,0 +1,150 @@
+/***************************************************************************//**
+ * @file sync_sim.c
+ * @brief Accuracy of the network time of app_sync.c over several hops, with
+ *        relay jitter and a drifting client clock.
+ *
+ * The client runs the real app_sync.c on its own clock, which drifts from
+ * the server's by the given ppm and starts at a random offset. The server
+ * sends a time beacon every APP_SYNC_BEACON_PERIOD_MS, in the format of
+ * app_sync.h, and each one is lost with the given loss. A beacon that gets
+ * through takes the shortest path delay app_sync.c assumes, plus at every
+ * hop a random queueing and relay delay, exponential with the given mean.
+ *
+ * After WARMUP_S the client's network time is compared with the server's
+ * every second. The table gives, per hop count and jitter, the RMS and
+ * largest error in milliseconds, averaged over the seeds, and the drift
+ * estimate at the end against the true drift.
+ *
+ * Usage: sync_sim [drift_ppm [loss_pct [seeds]]]
+ ******************************************************************************/
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "host_sdk.h"
+#include "app_sync.h"
+#include "app_time.h"
+
+#define DURATION_S                      7200
+#define WARMUP_S                        600
+
+typedef struct {
+  double rms;
+  double max;
+  int32_t drift_ppm;
+} sim_result_t;
+
+static uint64_t rng;
+static app_sync_t sync;
+static double drift_ppm;
+static uint32_t loss_pct;
+static double start_offset_ms;
+
+static double next_unit(void)
+{
+  // xorshift64, 53 bits in (0, 1)
+  rng ^= rng << 13;
+  rng ^= rng >> 7;
+  rng ^= rng << 17;
+  return ((rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/// Client clock at server time @p true_ms
+static uint64_t local_ms(double true_ms)
+{
+  return (uint64_t)(start_offset_ms + true_ms * (1.0 + drift_ppm / 1e6));
+}
+
+static sim_result_t run(uint8_t hops, double jitter_ms, uint32_t seed)
+{
+  sim_result_t r = { 0 };
+  uint8_t beacon[APP_SYNC_BEACON_LEN];
+  uint8_t epoch;
+  uint64_t next_beacon_ms = 0;
+  double err_sum = 0;
+  uint32_t samples = 0;
+
+  rng = seed * 0x9E3779B97F4A7C15u + hops;
+  epoch = (uint8_t)(next_unit() * 256);
+  start_offset_ms = 1000 + next_unit() * 3600000;
+  host_clock_set_ms(local_ms(0));
+  app_sync_init(&sync, false);
+
+  for (uint64_t true_ms = 0; true_ms <= (uint64_t)DURATION_S * 1000; true_ms += 1000) {
+    // Beacons sent before this second, in the order they arrive
+    while (next_beacon_ms <= true_ms) {
+      double delay = APP_SYNC_TX_DELAY_MS + (hops - 1) * APP_SYNC_HOP_DELAY_MS;
+
+      for (uint8_t h = 0; h < hops; h++) {
+        delay += -jitter_ms * log(next_unit());
+      }
+      beacon[0] = epoch;
+      for (uint8_t i = 0; i < APP_SYNC_BEACON_LEN - 1; i++) {
+        beacon[1 + i] = (next_beacon_ms >> (8 * i)) & 0xFF;
+      }
+      if (next_unit() * 100 >= loss_pct) {
+        uint64_t rx = local_ms(next_beacon_ms + delay);
+        host_clock_set_ms(rx);
+        app_sync_on_beacon(&sync, beacon, sizeof(beacon), rx, hops);
+      }
+      next_beacon_ms += APP_SYNC_BEACON_PERIOD_MS;
+    }
+
+    host_clock_set_ms(local_ms(true_ms));
+    if (true_ms >= (uint64_t)WARMUP_S * 1000) {
+      double err = (double)(int64_t)(app_sync_now_ms(&sync) - true_ms);
+      err_sum += err * err;
+      if (fabs(err) > r.max) {
+        r.max = fabs(err);
+      }
+      samples++;
+    }
+  }
+  r.rms = sqrt(err_sum / samples);
+  r.drift_ppm = app_sync_drift_ppm(&sync);
+  return r;
+}
+
+int main(int argc, char **argv)
+{
+  static const uint8_t hop_counts[] = { 1, 3, 5 };
+  static const double jitters[] = { 0, 10, 30 };
+  uint32_t seeds = 10;
+
+  drift_ppm = argc > 1 ? atof(argv[1]) : 40;
+  loss_pct = argc > 2 ? (uint32_t)atoi(argv[2]) : 10;
+  if (argc > 3) {
+    seeds = (uint32_t)atoi(argv[3]);
+  }
+  if (fabs(drift_ppm) > APP_SYNC_MAX_DRIFT_PPM || loss_pct >= 100 || seeds == 0) {
+    fprintf(stderr, "usage: %s [drift_ppm [loss_pct [seeds]]]\n", argv[0]);
+    return 2;
+  }
+
+  host_log_mute(true);
+  app_time_init();
+  printf("client drift %.0f ppm, %u%% beacon loss, beacon every %u s, %u s after %u s warm-up, %u seeds\n",
+         drift_ppm, loss_pct, APP_SYNC_BEACON_PERIOD_MS / 1000, DURATION_S - WARMUP_S,
+         WARMUP_S, seeds);
+  printf("hops  jitter/hop  rms err  max err  drift est\n");
+  for (size_t h = 0; h < sizeof(hop_counts) / sizeof(hop_counts[0]); h++) {
+    for (size_t j = 0; j < sizeof(jitters) / sizeof(jitters[0]); j++) {
+      double rms = 0, max = 0;
+      int64_t drift = 0;
+
+      for (uint32_t seed = 1; seed <= seeds; seed++) {
+        sim_result_t r = run(hop_counts[h], jitters[j], seed);
+        rms += r.rms;
+        max += r.max;
+        drift += r.drift_ppm;
+      }
+      printf("%4u  %7.0f ms  %5.1f ms  %5.0f ms  %5.1f ppm\n",
+             hop_counts[h],
+             jitters[j],
+             rms / seeds,
+             max / seeds,
+             (double)drift / seeds);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,50 @@
+/***************************************************************************//**
+ * @file host_test.h
+ * @brief Minimal checks for the host unit tests.
+ *
+ * A test program runs its test functions with RUN() and returns
+ * host_test_result() from main; a failed check prints its location and
+ * makes the program exit non-zero.
+ ******************************************************************************/
+
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+
+static int host_test_failures;
+
+#define CHECK(cond)                                                     \
+  do {                                                                  \
+    if (!(cond)) {                                                      \
+      fprintf(stderr, "%s:%d: CHECK(%s) failed\n",                      \
+              __FILE__, __LINE__, #cond);                               \
+      host_test_failures++;                                             \
+    }                                                                   \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                  \
+  do {                                                                  \
+    long long check_a = (long long)(a);                                 \
+    long long check_b = (long long)(b);                                 \
+    if (check_a != check_b) {                                           \
+      fprintf(stderr, "%s:%d: CHECK_EQ(%s, %s) failed: %lld != %lld\n", \
+              __FILE__, __LINE__, #a, #b, check_a, check_b);            \
+      host_test_failures++;                                             \
+    }                                                                   \
+  } while (0)
+
+#define RUN(test)                                                       \
+  do {                                                                  \
+    int failures_before = host_test_failures;                           \
+    test();                                                             \
+    printf("%-40s %s\n", #test,                                         \
+           host_test_failures == failures_before ? "ok" : "FAILED");    \
+  } while (0)
+
+static inline int host_test_result(void)
+{
+  return host_test_failures == 0 ? 0 : 1;
+}
+
+#endif // HOST_TEST_H
@@ -0,0 +1,76 @@
+/***************************************************************************//**
+ * @file rht_trace.h
+ * @brief Reproducible sensor traces for the filter tests and benchmark.
+ *
+ * A trace is a slowly varying true value plus Gaussian reading noise and
+ * rare single-reading spikes, as the Si70xx shows when a conversion overlaps
+ * a radio burst. The true value is kept next to each reading so the error of
+ * a filter can be measured. Recorded readings without a known true value
+ * can be given to the benchmark as a file instead.
+ ******************************************************************************/
+
+#ifndef RHT_TRACE_H
+#define RHT_TRACE_H
+
+#include <math.h>
+#include <stdint.h>
+
+typedef struct {
+  double base;                          // milli-units
+  double swing;                         // amplitude of the slow cycle
+  double cycle_readings;                // readings per slow cycle
+  double step_at;                       // reading of a step, < 0 for none
+  double step;                          // height of the step
+  double noise;                         // reading noise, standard deviation
+  uint32_t spike_every;                 // one spike in this many, 0 for none
+  double spike;                         // height of a spike
+} rht_trace_config_t;
+
+typedef struct {
+  const rht_trace_config_t *config;
+  uint64_t rng;
+  uint32_t n;
+} rht_trace_t;
+
+// Room temperature over a slow cycle, 0.1 C reading noise
+#define RHT_TRACE_TEMPERATURE           { 21500, 1500, 20000, -1, 0, 100, 500, 2000 }
+// Relative humidity with a door opening, 0.3 %RH reading noise
+#define RHT_TRACE_HUMIDITY              { 45000, 3000, 20000, 8000, 10000, 300, 500, 8000 }
+
+static inline void rht_trace_init(rht_trace_t *t, const rht_trace_config_t *config, uint64_t seed)
+{
+  t->config = config;
+  t->rng = seed * 0x9E3779B97F4A7C15u + 1;
+  t->n = 0;
+}
+
+static inline double rht_trace_unit(rht_trace_t *t)
+{
+  // xorshift64, 53 bits in (0, 1)
+  t->rng ^= t->rng << 13;
+  t->rng ^= t->rng >> 7;
+  t->rng ^= t->rng << 17;
+  return ((t->rng >> 11) + 0.5) / 9007199254740992.0;
+}
+
+/// Next raw reading in milli-units; @p truth receives the true value
+static inline int32_t rht_trace_next(rht_trace_t *t, double *truth)
+{
+  const rht_trace_config_t *c = t->config;
+  double value = c->base + c->swing * sin(2 * M_PI * t->n / c->cycle_readings);
+  double u1 = rht_trace_unit(t), u2 = rht_trace_unit(t);
+  double reading;
+
+  if (c->step_at >= 0 && t->n >= c->step_at) {
+    value += c->step;
+  }
+  *truth = value;
+  reading = value + c->noise * sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+  if (c->spike_every != 0 && t->rng % c->spike_every == 0) {
+    reading += t->rng & (1u << 20) ? c->spike : -c->spike;
+  }
+  t->n++;
+  return (int32_t)lround(reading);
+}
+
+#endif // RHT_TRACE_H
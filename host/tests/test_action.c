@@ -0,0 +1,230 @@
+/***************************************************************************//**
+ * @file test_action.c
+ * @brief Scripted button presses through the debounced, rate-limited action
+ *        queue.
+ *
+ * The script posts actions the way the client's button callback does, at
+ * given times, and runs the queue like the super loop (every millisecond) or
+ * like the worker (only when woken). The actions record when they ran.
+ ******************************************************************************/
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_action.h"
+#include "app_time.h"
+#include "host_test.h"
+
+#define MAX_RUNS                        64
+#define PUBLISH_INTERVAL_MS             1000
+
+enum {
+  ACTION_PUBLISH,
+  ACTION_NEXT,
+  ACTION_PREV,
+  ACTION_CONFIRM,
+  ACTION_COUNT
+};
+
+static host_node_t node;
+static app_action_t actions;
+static uint64_t run_ms[ACTION_COUNT][MAX_RUNS];
+static uint32_t runs[ACTION_COUNT];
+static uint32_t wakes;
+static int selected;
+static int confirmed;
+
+static void record(int action)
+{
+  if (runs[action] < MAX_RUNS) {
+    run_ms[action][runs[action]] = host_clock_ms();
+  }
+  runs[action]++;
+}
+
+static void run_publish(app_action_t *action)
+{
+  (void)action;
+  record(ACTION_PUBLISH);
+}
+
+static void run_next(app_action_t *action)
+{
+  (void)action;
+  record(ACTION_NEXT);
+  selected = (selected + 1) % 5;
+}
+
+static void run_prev(app_action_t *action)
+{
+  (void)action;
+  record(ACTION_PREV);
+  selected = (selected + 4) % 5;
+}
+
+static void run_confirm(app_action_t *action)
+{
+  (void)action;
+  record(ACTION_CONFIRM);
+  confirmed = selected;
+}
+
+static const app_action_def_t table[ACTION_COUNT] = {
+  [ACTION_PUBLISH] = { run_publish, PUBLISH_INTERVAL_MS },
+  [ACTION_NEXT]    = { run_next, 0 },
+  [ACTION_PREV]    = { run_prev, 0 },
+  [ACTION_CONFIRM] = { run_confirm, 0 },
+};
+
+static void wake(app_action_t *action)
+{
+  (void)action;
+  wakes++;
+}
+
+static void setup(bool with_wake)
+{
+  host_node_init(&node, 0x0100);
+  host_node_enter(&node);
+  host_clock_set_ms(1);
+  memset(runs, 0, sizeof(runs));
+  wakes = 0;
+  selected = 0;
+  confirmed = -1;
+  app_action_init(&actions, table, ACTION_COUNT, with_wake ? wake : NULL);
+}
+
+/// Super loop: fire the timers and run the queue every millisecond
+static void loop_until(uint64_t until_ms)
+{
+  for (uint64_t t = host_clock_ms(); t <= until_ms; t++) {
+    host_run_until(t);
+    app_action_process(&actions);
+  }
+}
+
+/// Worker: run the queue only when something woke it
+static void worker_until(uint64_t until_ms)
+{
+  if (wakes != 0) {
+    wakes = 0;
+    app_action_process(&actions);
+  }
+  while (host_node_fire_next(&node, until_ms)) {
+    if (wakes != 0) {
+      wakes = 0;
+      app_action_process(&actions);
+    }
+  }
+  host_run_until(until_ms);
+}
+
+static void test_mashing_is_rate_limited(void)
+{
+  setup(false);
+  // BTN0 every 20 ms for five seconds
+  for (uint64_t t = 1; t <= 5000; t += 20) {
+    loop_until(t);
+    app_action_post(&actions, ACTION_PUBLISH);
+  }
+  loop_until(7000);
+
+  // Once at the first press, then once per interval while presses came in
+  CHECK_EQ(runs[ACTION_PUBLISH], 6);
+  CHECK_EQ(run_ms[ACTION_PUBLISH][0], 1);
+  for (uint32_t i = 1; i < runs[ACTION_PUBLISH] && i < MAX_RUNS; i++) {
+    CHECK(run_ms[ACTION_PUBLISH][i] - run_ms[ACTION_PUBLISH][i - 1] >= PUBLISH_INTERVAL_MS);
+    CHECK(run_ms[ACTION_PUBLISH][i] - run_ms[ACTION_PUBLISH][i - 1] <= PUBLISH_INTERVAL_MS + 1);
+  }
+}
+
+static void test_bounces_and_repeats_collapse(void)
+{
+  setup(false);
+  // A bounce 10 ms after the press, then two presses before the loop runs
+  app_action_post(&actions, ACTION_PUBLISH);
+  host_clock_set_ms(11);
+  app_action_post(&actions, ACTION_PUBLISH);
+  host_clock_set_ms(80);
+  app_action_post(&actions, ACTION_PUBLISH);
+  loop_until(80);
+  CHECK_EQ(runs[ACTION_PUBLISH], 1);
+  CHECK_EQ(run_ms[ACTION_PUBLISH][0], 80);
+}
+
+static void test_deferred_run_wakes_worker(void)
+{
+  setup(true);
+  app_action_post(&actions, ACTION_PUBLISH);
+  CHECK_EQ(wakes, 1);
+  worker_until(100);
+  app_action_post(&actions, ACTION_PUBLISH);
+  worker_until(3000);
+
+  // The second press runs once the interval is over, from the timer alone
+  CHECK_EQ(runs[ACTION_PUBLISH], 2);
+  CHECK(run_ms[ACTION_PUBLISH][1] >= 1 + PUBLISH_INTERVAL_MS);
+  CHECK(run_ms[ACTION_PUBLISH][1] <= 2 + PUBLISH_INTERVAL_MS);
+}
+
+static void test_defer_timer_not_restarted(void)
+{
+  uint64_t deadline;
+
+  setup(false);
+  app_action_post(&actions, ACTION_PUBLISH);
+  app_action_process(&actions);
+  host_clock_set_ms(100);
+  app_action_post(&actions, ACTION_PUBLISH);
+  app_action_process(&actions);
+  deadline = host_node_next_deadline(&node);
+  CHECK(deadline != UINT64_MAX);
+
+  // Later passes of the loop leave the running timer alone
+  for (uint64_t t = 101; t < 900; t++) {
+    host_clock_set_ms(t);
+    app_action_process(&actions);
+    CHECK_EQ(host_node_next_deadline(&node), deadline);
+  }
+  loop_until(1100);
+  CHECK_EQ(runs[ACTION_PUBLISH], 2);
+}
+
+static void test_period_selection_script(void)
+{
+  static const struct {
+    uint64_t at_ms;
+    uint8_t action;
+  } script[] = {
+    // Three times forward, once back, then confirm
+    { 100, ACTION_NEXT }, { 400, ACTION_NEXT }, { 700, ACTION_NEXT },
+    { 1000, ACTION_PREV }, { 1300, ACTION_CONFIRM },
+  };
+
+  setup(true);
+  for (size_t i = 0; i < sizeof(script) / sizeof(script[0]); i++) {
+    uint32_t before;
+
+    worker_until(script[i].at_ms);
+    before = runs[script[i].action];
+    app_action_post(&actions, script[i].action);
+    // Nothing runs in the button callback itself
+    CHECK_EQ(runs[script[i].action], before);
+  }
+  CHECK_EQ(confirmed, -1);
+  worker_until(1400);
+  CHECK_EQ(runs[ACTION_NEXT], 3);
+  CHECK_EQ(runs[ACTION_PREV], 1);
+  CHECK_EQ(confirmed, 2);
+}
+
+int main(void)
+{
+  host_log_mute(true);
+  app_time_init();
+  RUN(test_mashing_is_rate_limited);
+  RUN(test_bounces_and_repeats_collapse);
+  RUN(test_deferred_run_wakes_worker);
+  RUN(test_defer_timer_not_restarted);
+  RUN(test_period_selection_script);
+  return host_test_result();
+}
@@ -0,0 +1,158 @@
+/***************************************************************************//**
+ * @file test_config.c
+ * @brief The client follows the publication period set by the provisioner.
+ *
+ * Built against the whole client app, main.c aside. The node boots once,
+ * provisioned with a publication whose period comes from the host stub of
+ * sl_btmesh_test_get_local_model_pub(), and the tests run one after the
+ * other on it. A test changes that period and injects
+ * sl_btmesh_evt_node_model_config_changed_id as the stack would. The app
+ * timers then run, and the sample period is measured between the
+ * EX_PERIODIC_UPDATE signals of the periodic timer.
+ ******************************************************************************/
+#include <string.h>
+
+#include "host_sdk.h"
+#include "sl_bt_api.h"
+#include "sl_btmesh_api.h"
+#include "app.h"
+#include "my_model_def.h"
+#include "host_test.h"
+
+#define NODE_ADDRESS                    0x0010
+#define PUB_ADDRESS                     0xC001
+
+// Signal of the periodic timer in Vendor_client/app.c
+#define EX_PERIODIC_UPDATE              (1u << 9)
+
+// Publication periods, mesh step-resolution format
+#define PERIOD_7_S                      0x47
+#define PERIOD_13_S                     0x4D
+
+static host_node_t node;
+static uint64_t last_update;
+
+// Hand the raised signals to the app and return them
+static uint32_t deliver_signals(void)
+{
+  struct sl_bt_msg evt;
+  uint32_t all = 0;
+  uint32_t signals;
+
+  while ((signals = host_node_take_signals(&node)) != 0) {
+    all |= signals;
+    memset(&evt, 0, sizeof(evt));
+    evt.header = sl_bt_evt_system_external_signal_id;
+    evt.data.evt_system_external_signal.extsignals = signals;
+    sl_bt_on_event(&evt);
+  }
+  return all;
+}
+
+static void boot(uint8_t period)
+{
+  struct sl_bt_msg bt_evt;
+  sl_btmesh_msg_t mesh_evt;
+
+  host_clock_set_ms(0);
+  host_node_init(&node, NODE_ADDRESS);
+  node.pub_set = true;
+  node.pub_address = PUB_ADDRESS;
+  node.pub_ttl = 5;
+  node.pub_period = period;
+  host_node_enter(&node);
+
+  app_init();
+  memset(&bt_evt, 0, sizeof(bt_evt));
+  bt_evt.header = sl_bt_evt_system_boot_id;
+  sl_bt_on_event(&bt_evt);
+  memset(&mesh_evt, 0, sizeof(mesh_evt));
+  mesh_evt.header = sl_btmesh_evt_node_initialized_id;
+  mesh_evt.data.evt_node_initialized.provisioned = 1;
+  mesh_evt.data.evt_node_initialized.address = NODE_ADDRESS;
+  sl_btmesh_on_event(&mesh_evt);
+  deliver_signals();
+}
+
+static void config_changed(uint16_t vendor_id, uint16_t model_id)
+{
+  sl_btmesh_msg_t evt;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_btmesh_evt_node_model_config_changed_id;
+  evt.data.evt_node_model_config_changed.node_config_state = 0;
+  evt.data.evt_node_model_config_changed.element_address = NODE_ADDRESS;
+  evt.data.evt_node_model_config_changed.vendor_id = vendor_id;
+  evt.data.evt_node_model_config_changed.model_id = model_id;
+  sl_btmesh_on_event(&evt);
+  deliver_signals();
+}
+
+// Run the app for @p ms and return the time between the last two periodic
+// updates, 0 if there were fewer than two
+static uint64_t sample_period(uint64_t ms)
+{
+  uint64_t until = host_clock_ms() + ms;
+  uint64_t previous = 0;
+  uint32_t updates = 0;
+
+  while (host_node_next_deadline(&node) <= until) {
+    host_node_fire_next(&node, until);
+    if (deliver_signals() & EX_PERIODIC_UPDATE) {
+      previous = last_update;
+      last_update = host_clock_ms();
+      updates++;
+    }
+  }
+  host_clock_set_ms(until);
+  return updates >= 2 ? last_update - previous : 0;
+}
+
+static void test_boot_follows_config(void)
+{
+  CHECK_EQ(sample_period(60000), 7000);
+}
+
+static void test_config_change_retunes(void)
+{
+  node.pub_period = PERIOD_13_S;
+  config_changed(VENDOR_ID, MY_VENDOR_CLIENT_ID);
+  CHECK_EQ(sample_period(60000), 13000);
+
+  node.pub_period = PERIOD_7_S;
+  config_changed(VENDOR_ID, MY_VENDOR_CLIENT_ID);
+  CHECK_EQ(sample_period(60000), 7000);
+}
+
+static void test_other_model_ignored(void)
+{
+  // Another model's configuration is none of the sampling's business
+  node.pub_period = PERIOD_13_S;
+  config_changed(VENDOR_ID, MY_VENDOR_CLIENT_ID + 1);
+  CHECK_EQ(sample_period(60000), 7000);
+  node.pub_period = PERIOD_7_S;
+}
+
+static void test_same_period_keeps_phase(void)
+{
+  uint64_t phase;
+
+  sample_period(30000);
+  phase = last_update;
+
+  // A change of other settings must not restart the period
+  config_changed(VENDOR_ID, MY_VENDOR_CLIENT_ID);
+  CHECK_EQ(sample_period(60000), 7000);
+  CHECK_EQ((last_update - phase) % 7000, 0);
+}
+
+int main(void)
+{
+  host_log_mute(true);
+  boot(PERIOD_7_S);
+  RUN(test_boot_follows_config);
+  RUN(test_config_change_retunes);
+  RUN(test_other_model_ignored);
+  RUN(test_same_period_keeps_phase);
+  return host_test_result();
+}
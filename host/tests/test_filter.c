@@ -0,0 +1,195 @@
+/***************************************************************************//**
+ * @file test_filter.c
+ * @brief Exactness of the fixed-point filter stages, and accuracy of the
+ *        shipped configurations on reproducible sensor traces.
+ ******************************************************************************/
+#include <math.h>
+#include <stdlib.h>
+
+#include "app_filter.h"
+#include "host_test.h"
+#include "rht_trace.h"
+
+static const app_filter_config_t config_default = APP_FILTER_CONFIG_DEFAULT;
+static const app_filter_config_t config_low_power = APP_FILTER_CONFIG_LOW_POWER;
+static const app_filter_config_t config_raw = { 0, 1, 0 };
+
+/// Feed @p raw until a value comes out
+static int32_t feed_value(app_filter_t *f, int32_t raw)
+{
+  int32_t out = 0;
+  while (!app_filter_feed(f, raw, &out)) {
+  }
+  return out;
+}
+
+static void test_constant_is_exact(void)
+{
+  static const app_filter_config_t configs[] = {
+    APP_FILTER_CONFIG_DEFAULT, APP_FILTER_CONFIG_LOW_POWER,
+    { 0, 1, 0 }, { 3, 5, 4 }, { 1, 1, 7 },
+  };
+  static const int32_t values[] = { 0, 1, -1, 21500, -40000, 125000, 100000 };
+
+  for (size_t c = 0; c < sizeof(configs) / sizeof(configs[0]); c++) {
+    for (size_t v = 0; v < sizeof(values) / sizeof(values[0]); v++) {
+      app_filter_t f;
+      app_filter_init(&f, &configs[c]);
+      for (int i = 0; i < 50; i++) {
+        CHECK_EQ(feed_value(&f, values[v]), values[v]);
+      }
+    }
+  }
+}
+
+static void test_oversampling_groups(void)
+{
+  static const app_filter_config_t config = { 2, 1, 0 };
+  app_filter_t f;
+  int32_t out;
+
+  app_filter_init(&f, &config);
+  CHECK(!app_filter_feed(&f, 1000, &out));
+  CHECK(!app_filter_feed(&f, 1001, &out));
+  CHECK(!app_filter_feed(&f, 1001, &out));
+  CHECK(app_filter_feed(&f, 1001, &out));
+  // 4003 / 4 rounds to 1001
+  CHECK_EQ(out, 1001);
+  // Negative readings round the same way
+  CHECK_EQ(feed_value(&f, -1002) , -1002);
+  app_filter_feed(&f, -1000, &out);
+  app_filter_feed(&f, -1000, &out);
+  app_filter_feed(&f, -1001, &out);
+  app_filter_feed(&f, -1001, &out);
+  CHECK_EQ(out, -1000);
+
+  // A failed reading drops the partial group
+  app_filter_feed(&f, 50000, &out);
+  app_filter_abort(&f);
+  CHECK_EQ(feed_value(&f, 7), 7);
+}
+
+static void test_median_removes_spikes(void)
+{
+  static const app_filter_config_t config = { 0, 3, 0 };
+  static const int32_t in[] = { 10, 10, 9000, 10, 11, -9000, 11, 12 };
+  // The window lags by one value and never lets a spike through
+  static const int32_t expected[] = { 10, 10, 10, 10, 11, 10, 11, 11 };
+  app_filter_t f;
+
+  app_filter_init(&f, &config);
+  for (size_t i = 0; i < sizeof(in) / sizeof(in[0]); i++) {
+    CHECK_EQ(feed_value(&f, in[i]), expected[i]);
+  }
+}
+
+static void test_ema_fixed_point(void)
+{
+  static const app_filter_config_t config = { 0, 1, 1 };
+  app_filter_t f;
+  double exact = 0;
+
+  // Within one milli-unit of the exact recurrence all the way up
+  app_filter_init(&f, &config);
+  CHECK_EQ(feed_value(&f, 0), 0);
+  for (int i = 0; i < 30; i++) {
+    exact += (1000 - exact) / 2;
+    CHECK(fabs(feed_value(&f, 1000) - exact) <= 1);
+  }
+  CHECK_EQ(feed_value(&f, 1000), 1000);
+}
+
+/// Values until a clean step of @p height settles within 1 %
+static int settle_values(const app_filter_config_t *config, int32_t height)
+{
+  app_filter_t f;
+  int n;
+
+  app_filter_init(&f, config);
+  for (int i = 0; i < 10; i++) {
+    feed_value(&f, 0);
+  }
+  for (n = 1; n < 100; n++) {
+    if (abs(feed_value(&f, height) - height) <= height / 100) {
+      break;
+    }
+  }
+  return n;
+}
+
+static void test_step_response(void)
+{
+  CHECK_EQ(settle_values(&config_raw, 10000), 1);
+  CHECK(settle_values(&config_default, 10000) <= 10);
+  CHECK(settle_values(&config_low_power, 10000) <= 20);
+}
+
+typedef struct {
+  double rms;
+  uint32_t reports;
+} trace_result_t;
+
+static trace_result_t run_trace(const app_filter_config_t *config,
+                                const rht_trace_config_t *trace_config)
+{
+  trace_result_t r = { 0 };
+  rht_trace_t t;
+  app_filter_t f;
+  uint32_t group = 1u << config->oversample_log2;
+  uint32_t values = 0;
+  int32_t reported = 0, out;
+  double truth, truth_sum = 0, err_sum = 0;
+
+  rht_trace_init(&t, trace_config, 7);
+  app_filter_init(&f, config);
+  for (uint32_t i = 0; i < 40000; i++) {
+    int32_t raw = rht_trace_next(&t, &truth);
+    truth_sum += truth;
+    if (!app_filter_feed(&f, raw, &out)) {
+      continue;
+    }
+    err_sum += (out - truth_sum / group) * (out - truth_sum / group);
+    truth_sum = 0;
+    if (values == 0 || abs(out - reported) >= 500) {
+      reported = out;
+      r.reports++;
+    }
+    values++;
+  }
+  r.rms = sqrt(err_sum / values);
+  // Per 1000 values, so configurations with fewer values compare fairly
+  r.reports = r.reports * 1000 / values;
+  return r;
+}
+
+static void test_trace_accuracy(void)
+{
+  static const rht_trace_config_t traces[] = {
+    RHT_TRACE_TEMPERATURE,
+    RHT_TRACE_HUMIDITY,
+  };
+
+  for (size_t i = 0; i < sizeof(traces) / sizeof(traces[0]); i++) {
+    trace_result_t raw = run_trace(&config_raw, &traces[i]);
+    trace_result_t def = run_trace(&config_default, &traces[i]);
+    trace_result_t low = run_trace(&config_low_power, &traces[i]);
+
+    // A third of the raw error or less, the humidity step included
+    CHECK(def.rms < raw.rms / 3);
+    CHECK(low.rms < raw.rms / 3);
+    // Noise and spikes no longer trigger most send-on-delta reports
+    CHECK(def.reports * 2 <= raw.reports);
+    CHECK(low.reports * 2 <= raw.reports);
+  }
+}
+
+int main(void)
+{
+  RUN(test_constant_is_exact);
+  RUN(test_oversampling_groups);
+  RUN(test_median_removes_spikes);
+  RUN(test_ema_fixed_point);
+  RUN(test_step_response);
+  RUN(test_trace_accuracy);
+  return host_test_result();
+}
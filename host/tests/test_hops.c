@@ -0,0 +1,96 @@
+/***************************************************************************//**
+ * @file test_hops.c
+ * @brief Publication TTL from the heartbeat hop distance, and the renewal of
+ *        the heartbeat subscription.
+ ******************************************************************************/
+#include <string.h>
+
+#include "host_sdk.h"
+#include "sl_btmesh_api.h"
+#include "app_hops.h"
+#include "host_test.h"
+
+#define DEFAULT_TTL                     7
+#define SINK                            0x0010
+
+static host_node_t node;
+static app_hops_t hops;
+static uint32_t renew_failures;
+
+static void count_renew_failures(const char *text)
+{
+  if (strstr(text, "not renewed") != NULL) {
+    renew_failures++;
+  }
+}
+
+static void setup(void)
+{
+  host_node_init(&node, 0x0100);
+  host_node_enter(&node);
+  host_clock_set_ms(0);
+  sl_btmesh_test_set_local_model_pub(0, 0, 0, 0, 0xC001, DEFAULT_TTL, 0, 0, 0);
+  app_hops_init(&hops, 0, 0, 0);
+}
+
+static void test_ttl_follows_distance(void)
+{
+  setup();
+  app_hops_on_heartbeat(&hops, SINK, 3);
+  CHECK_EQ(node.pub_ttl, 3 + APP_HOPS_TTL_MARGIN);
+  CHECK_EQ(app_hops_distance(&hops), 3);
+  // A shorter route wins at once
+  app_hops_on_heartbeat(&hops, SINK, 1);
+  CHECK_EQ(node.pub_ttl, 2);
+  // Never above the TTL the provisioner configured
+  setup();
+  app_hops_on_heartbeat(&hops, SINK, 30);
+  CHECK_EQ(node.pub_ttl, DEFAULT_TTL);
+}
+
+static void test_ttl_restored_when_silent(void)
+{
+  setup();
+  app_hops_on_heartbeat(&hops, SINK, 2);
+  CHECK_EQ(node.pub_ttl, 2 + APP_HOPS_TTL_MARGIN);
+  // The distance holds for the next window, then expires
+  host_run_until(APP_HOPS_WINDOW_MS);
+  CHECK_EQ(node.pub_ttl, 2 + APP_HOPS_TTL_MARGIN);
+  host_run_until(2 * APP_HOPS_WINDOW_MS);
+  CHECK_EQ(node.pub_ttl, DEFAULT_TTL);
+  CHECK_EQ(app_hops_distance(&hops), 0);
+}
+
+static void test_subscription_renewal_retried(void)
+{
+  setup();
+  app_hops_subscribe(&hops, SINK);
+  CHECK_EQ(node.heartbeat_sub_source, SINK);
+
+  // The stack refuses the renewal at the end of the window
+  node.heartbeat_sub_source = 0;
+  node.heartbeat_sub_status = SL_STATUS_NO_MORE_RESOURCE;
+  renew_failures = 0;
+  host_log_set_sink(count_renew_failures);
+  host_log_mute(false);
+  host_run_until(APP_HOPS_WINDOW_MS);
+  CHECK_EQ(renew_failures, 1);
+  CHECK_EQ(node.heartbeat_sub_source, 0);
+
+  // and accepts it one window later
+  node.heartbeat_sub_status = SL_STATUS_OK;
+  host_run_until(2 * APP_HOPS_WINDOW_MS);
+  host_log_mute(true);
+  host_log_set_sink(NULL);
+  CHECK_EQ(renew_failures, 1);
+  CHECK_EQ(node.heartbeat_sub_source, SINK);
+}
+
+int main(void)
+{
+  host_log_mute(true);
+  RUN(test_ttl_follows_distance);
+  RUN(test_ttl_restored_when_silent);
+  RUN(test_subscription_renewal_retried);
+  return host_test_result();
+}
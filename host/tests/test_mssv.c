@@ -0,0 +1,169 @@
+/***************************************************************************//**
+ * @file test_mssv.c
+ * @brief Round trips of the packed student-ID list over the whole ID range.
+ *
+ * Lists of every length are packed and unpacked again; the result must be
+ * the input in ascending order, in no more than the worst-case length.
+ * Random lists are drawn from the full 8-digit range and from narrow groups
+ * of close IDs, in random order and with repeats. Set HOST_MSSV_LISTS to
+ * change the number of random lists per length.
+ ******************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+
+#include "app_mssv.h"
+#include "host_test.h"
+
+static uint32_t rng_state = 0x2545F491u;
+
+static uint32_t rng_next(void)
+{
+  // xorshift32
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 17;
+  rng_state ^= rng_state << 5;
+  return rng_state;
+}
+
+static int compare_ids(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+/// Pack and unpack @p ids and check the result; returns the payload length
+static uint8_t round_trip(const uint32_t *ids, uint8_t count)
+{
+  uint8_t buf[APP_MSSV_PACKED_LEN(APP_MSSV_MAX_IDS)];
+  uint32_t expected[APP_MSSV_MAX_IDS];
+  uint32_t out[APP_MSSV_MAX_IDS];
+  uint8_t len, got;
+
+  len = app_mssv_pack(ids, count, buf, sizeof(buf));
+  CHECK(len != 0);
+  CHECK(len <= APP_MSSV_PACKED_LEN(count));
+  got = app_mssv_unpack(buf, len, out, APP_MSSV_MAX_IDS);
+  CHECK_EQ(got, count);
+
+  memcpy(expected, ids, count * sizeof(ids[0]));
+  qsort(expected, count, sizeof(expected[0]), compare_ids);
+  CHECK(got == count && memcmp(out, expected, count * sizeof(out[0])) == 0);
+  return len;
+}
+
+static void test_single_ids(void)
+{
+  static const uint32_t edges[] = {
+    0, 1, 2, 10000000, 12345678, (1u << 26) - 1, 1u << 26,
+    APP_MSSV_ID_MAX - 1, APP_MSSV_ID_MAX,
+  };
+
+  for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+    CHECK_EQ(round_trip(&edges[i], 1), APP_MSSV_PACKED_LEN(1));
+  }
+  // Every ID width, and a stride over the whole range
+  for (uint32_t id = 1; id <= APP_MSSV_ID_MAX; id <<= 1) {
+    round_trip(&id, 1);
+  }
+  for (uint32_t id = 0; id <= APP_MSSV_ID_MAX; id += 9973) {
+    round_trip(&id, 1);
+  }
+}
+
+static void test_worst_case(void)
+{
+  uint32_t ids[APP_MSSV_MAX_IDS];
+
+  // Both ends of the range force 27-bit deltas on every entry
+  ids[0] = 0;
+  ids[1] = APP_MSSV_ID_MAX;
+  for (uint8_t i = 2; i < APP_MSSV_MAX_IDS; i++) {
+    ids[i] = i % 2 ? APP_MSSV_ID_MAX - i : i;
+  }
+  CHECK_EQ(round_trip(ids, APP_MSSV_MAX_IDS), APP_MSSV_PACKED_LEN(APP_MSSV_MAX_IDS));
+
+  // Evenly spread over the range, the largest gap still needs 23 bits
+  for (uint8_t i = 0; i < APP_MSSV_MAX_IDS; i++) {
+    ids[i] = APP_MSSV_ID_MAX / (APP_MSSV_MAX_IDS - 1) * i;
+  }
+  round_trip(ids, APP_MSSV_MAX_IDS);
+
+  // All the same: zero-width deltas, the header and first ID only
+  for (uint8_t i = 0; i < APP_MSSV_MAX_IDS; i++) {
+    ids[i] = APP_MSSV_ID_MAX;
+  }
+  CHECK_EQ(round_trip(ids, APP_MSSV_MAX_IDS), APP_MSSV_PACKED_LEN(1));
+}
+
+static void test_unsorted(void)
+{
+  uint32_t group[] = { 22520004, 22520001, 22520003, 22520002 };
+  uint32_t reversed[APP_MSSV_MAX_IDS];
+
+  // A lab group of four fits in 7 bytes in any order
+  CHECK(round_trip(group, 4) <= 7);
+  for (uint8_t i = 0; i < APP_MSSV_MAX_IDS; i++) {
+    reversed[i] = APP_MSSV_ID_MAX - 1000000u * i;
+  }
+  round_trip(reversed, APP_MSSV_MAX_IDS);
+}
+
+static void test_random_lists(void)
+{
+  const char *env = getenv("HOST_MSSV_LISTS");
+  uint32_t lists = env ? (uint32_t)strtoul(env, NULL, 0) : 20000;
+  uint32_t ids[APP_MSSV_MAX_IDS];
+
+  for (uint8_t count = 1; count <= APP_MSSV_MAX_IDS; count++) {
+    for (uint32_t n = 0; n < lists; n++) {
+      // Half from the whole range, half from a group of close IDs
+      uint32_t spread = n % 2 ? APP_MSSV_ID_MAX + 1 : 1u << (rng_next() % 20);
+      uint32_t base = rng_next() % (APP_MSSV_ID_MAX + 2 - spread);
+
+      for (uint8_t i = 0; i < count; i++) {
+        ids[i] = i > 0 && rng_next() % 8 == 0 ? ids[i - 1] : base + rng_next() % spread;
+      }
+      round_trip(ids, count);
+    }
+  }
+}
+
+static void test_rejected(void)
+{
+  uint8_t buf[APP_MSSV_PACKED_LEN(APP_MSSV_MAX_IDS)];
+  uint32_t ids[APP_MSSV_MAX_IDS + 1] = { 0 };
+  uint32_t out[APP_MSSV_MAX_IDS];
+  uint32_t too_big = APP_MSSV_ID_MAX + 1;
+  uint8_t len;
+
+  CHECK_EQ(app_mssv_pack(ids, 0, buf, sizeof(buf)), 0);
+  CHECK_EQ(app_mssv_pack(ids, APP_MSSV_MAX_IDS + 1, buf, sizeof(buf)), 0);
+  CHECK_EQ(app_mssv_pack(&too_big, 1, buf, sizeof(buf)), 0);
+  CHECK_EQ(app_mssv_pack(ids, 1, buf, APP_MSSV_PACKED_LEN(1) - 1), 0);
+
+  ids[0] = 10000000;
+  ids[1] = 10000010;
+  ids[2] = 10000020;
+  len = app_mssv_pack(ids, 3, buf, sizeof(buf));
+  CHECK(len != 0);
+  // Truncated, or more IDs than the caller has room for
+  CHECK_EQ(app_mssv_unpack(buf, len - 1, out, APP_MSSV_MAX_IDS), 0);
+  CHECK_EQ(app_mssv_unpack(buf, len, out, 2), 0);
+  // An ID beyond eight digits
+  len = app_mssv_pack(&ids[0], 1, buf, sizeof(buf));
+  buf[1] |= 0xFE;
+  buf[2] = 0xFF;
+  buf[3] = 0xFF;
+  buf[4] |= 0x0F;
+  CHECK_EQ(app_mssv_unpack(buf, len, out, APP_MSSV_MAX_IDS), 0);
+}
+
+int main(void)
+{
+  RUN(test_single_ids);
+  RUN(test_worst_case);
+  RUN(test_unsorted);
+  RUN(test_random_lists);
+  RUN(test_rejected);
+  return host_test_result();
+}
@@ -0,0 +1,206 @@
+/***************************************************************************//**
+ * @file test_queue.c
+ * @brief Stress test of the lock-free SPSC queue with a real producer and
+ *        consumer thread.
+ *
+ * The producer alternates between push and claim/commit, the consumer
+ * between pop and peek/release, and every item carries its sequence number
+ * and a pattern derived from it. The consumer checks that nothing is lost,
+ * duplicated, reordered or torn. Set HOST_STRESS_ITEMS to change the number
+ * of items per queue size.
+ ******************************************************************************/
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+
+#include "app_queue.h"
+#include "host_test.h"
+
+typedef struct {
+  uint32_t seq;
+  uint32_t pattern[7];
+} item_t;
+
+APP_QUEUE_DEFINE(queue_1, item_t, 1);
+APP_QUEUE_DEFINE(queue_2, item_t, 2);
+APP_QUEUE_DEFINE(queue_8, item_t, 8);
+APP_QUEUE_DEFINE(queue_64, item_t, 64);
+
+typedef struct {
+  app_queue_t *q;
+  uint32_t items;
+  uint32_t capacity;
+  uint32_t errors;
+  uint32_t max_level;
+} run_t;
+
+static void fill(item_t *item, uint32_t seq)
+{
+  item->seq = seq;
+  for (int i = 0; i < 7; i++) {
+    item->pattern[i] = seq * 2654435761u + (uint32_t)i;
+  }
+}
+
+static bool intact(const item_t *item, uint32_t seq)
+{
+  if (item->seq != seq) {
+    return false;
+  }
+  for (int i = 0; i < 7; i++) {
+    if (item->pattern[i] != seq * 2654435761u + (uint32_t)i) {
+      return false;
+    }
+  }
+  return true;
+}
+
+static void *producer(void *arg)
+{
+  run_t *run = arg;
+  item_t item;
+
+  for (uint32_t seq = 0; seq < run->items; seq++) {
+    if (seq & 1) {
+      fill(&item, seq);
+      while (!app_queue_push(run->q, &item)) {
+        sched_yield();
+      }
+    } else {
+      item_t *slot;
+      while ((slot = app_queue_claim(run->q)) == NULL) {
+        sched_yield();
+      }
+      fill(slot, seq);
+      app_queue_commit(run->q);
+    }
+  }
+  return NULL;
+}
+
+static void *consumer(void *arg)
+{
+  run_t *run = arg;
+  item_t item;
+
+  for (uint32_t seq = 0; seq < run->items; seq++) {
+    uint32_t level = app_queue_level(run->q);
+    if (level > run->max_level) {
+      run->max_level = level;
+    }
+    if (seq & 2) {
+      while (!app_queue_pop(run->q, &item)) {
+        sched_yield();
+      }
+      if (!intact(&item, seq)) {
+        run->errors++;
+      }
+    } else {
+      item_t *slot;
+      while ((slot = app_queue_peek(run->q)) == NULL) {
+        sched_yield();
+      }
+      if (!intact(slot, seq)) {
+        run->errors++;
+      }
+      app_queue_release(run->q);
+    }
+  }
+  return NULL;
+}
+
+static uint32_t stress_items(void)
+{
+  const char *env = getenv("HOST_STRESS_ITEMS");
+  return env != NULL ? (uint32_t)strtoul(env, NULL, 0) : 1000000;
+}
+
+static void stress(app_queue_t *q, uint32_t capacity)
+{
+  run_t run = { .q = q, .items = stress_items(), .capacity = capacity };
+  pthread_t p, c;
+
+  pthread_create(&c, NULL, consumer, &run);
+  pthread_create(&p, NULL, producer, &run);
+  pthread_join(p, NULL);
+  pthread_join(c, NULL);
+
+  CHECK_EQ(run.errors, 0);
+  CHECK(run.max_level <= capacity);
+  CHECK_EQ(app_queue_level(q), 0);
+  CHECK(app_queue_peek(q) == NULL);
+}
+
+static void test_stress_1(void)
+{
+  stress(&queue_1, 1);
+}
+
+static void test_stress_2(void)
+{
+  stress(&queue_2, 2);
+}
+
+static void test_stress_8(void)
+{
+  stress(&queue_8, 8);
+}
+
+static void test_stress_64(void)
+{
+  stress(&queue_64, 64);
+}
+
+static void test_full_and_empty(void)
+{
+  item_t item;
+
+  fill(&item, 0);
+  CHECK(!app_queue_pop(&queue_8, &item));
+  for (uint32_t i = 0; i < 8; i++) {
+    fill(&item, i);
+    CHECK(app_queue_push(&queue_8, &item));
+  }
+  CHECK(!app_queue_push(&queue_8, &item));
+  CHECK(app_queue_claim(&queue_8) == NULL);
+  CHECK_EQ(app_queue_level(&queue_8), 8);
+  for (uint32_t i = 0; i < 8; i++) {
+    CHECK(app_queue_pop(&queue_8, &item));
+    CHECK(intact(&item, i));
+  }
+  CHECK_EQ(app_queue_level(&queue_8), 0);
+}
+
+static void test_counter_wrap(void)
+{
+  item_t item;
+
+  // Past the 16-bit wrap of head and tail with the queue half full
+  for (uint32_t i = 0; i < 4; i++) {
+    fill(&item, i);
+    CHECK(app_queue_push(&queue_8, &item));
+  }
+  for (uint32_t i = 4; i < 70000 + 4; i++) {
+    fill(&item, i);
+    CHECK(app_queue_push(&queue_8, &item));
+    CHECK(app_queue_pop(&queue_8, &item));
+    if (!intact(&item, i - 4)) {
+      CHECK(intact(&item, i - 4));
+      break;
+    }
+    CHECK_EQ(app_queue_level(&queue_8), 4);
+  }
+  while (app_queue_pop(&queue_8, &item)) {
+  }
+}
+
+int main(void)
+{
+  RUN(test_full_and_empty);
+  RUN(test_counter_wrap);
+  RUN(test_stress_1);
+  RUN(test_stress_2);
+  RUN(test_stress_8);
+  RUN(test_stress_64);
+  return host_test_result();
+}
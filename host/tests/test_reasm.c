@@ -0,0 +1,203 @@
+/***************************************************************************//**
+ * @file test_reasm.c
+ * @brief Reassembly of vendor messages in parts: interleaved sources, lost
+ *        final parts, discarded rests and their expiry, and two pools side
+ *        by side.
+ ******************************************************************************/
+#include <string.h>
+
+#include "host_sdk.h"
+#include "app_reasm.h"
+#include "app_time.h"
+#include "host_test.h"
+
+#define OPCODE                          0x21
+
+static host_node_t node;
+static app_reasm_t reasm;
+
+static void setup(void)
+{
+  host_node_init(&node, 0x0001);
+  host_node_enter(&node);
+  host_clock_set_ms(host_clock_ms() + 10 * APP_REASM_TIMEOUT_MS);
+  app_reasm_init(&reasm);
+}
+
+/// A part of @p len bytes, all of them @p fill
+static app_rx_msg_t part(uint16_t source, bool first, bool final, uint8_t len, uint8_t fill)
+{
+  app_rx_msg_t msg = {
+    .source_address = source,
+    .opcode = OPCODE,
+    .first = first,
+    .final = final,
+    .len = len,
+  };
+
+  memset(msg.data, fill, len);
+  return msg;
+}
+
+/// Feed @p msg to @p r; returns the length of a completed message, -1 if none
+static int feed_to(app_reasm_t *r, app_rx_msg_t msg, uint8_t *fill)
+{
+  const uint8_t *data;
+  uint8_t len;
+
+  if (!app_reasm_feed(r, &msg, &data, &len)) {
+    return -1;
+  }
+  if (fill != NULL) {
+    *fill = len ? data[len - 1] : 0;
+  }
+  if (len != 0 && data[0] != data[len - 1]) {
+    // Parts of two messages ran together
+    len = 0;
+  }
+  app_reasm_release(r, data);
+  return len;
+}
+
+static int feed(app_rx_msg_t msg, uint8_t *fill)
+{
+  return feed_to(&reasm, msg, fill);
+}
+
+static void test_single_part(void)
+{
+  setup();
+  CHECK_EQ(feed(part(2, true, true, 12, 0xAA), NULL), 12);
+}
+
+static void test_interleaved_sources(void)
+{
+  uint8_t fill;
+
+  setup();
+  CHECK_EQ(feed(part(2, true, false, 40, 2), NULL), -1);
+  CHECK_EQ(feed(part(3, true, false, 40, 3), NULL), -1);
+  CHECK_EQ(feed(part(2, false, false, 40, 2), NULL), -1);
+  CHECK_EQ(feed(part(3, false, true, 10, 3), &fill), 50);
+  CHECK_EQ(fill, 3);
+  CHECK_EQ(feed(part(2, false, true, 5, 2), &fill), 85);
+  CHECK_EQ(fill, 2);
+}
+
+static void test_lost_final_part(void)
+{
+  uint8_t fill;
+
+  setup();
+  // The final part of the first message never comes; the next message of
+  // the same source must not be appended to it
+  CHECK_EQ(feed(part(2, true, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, false, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, true, false, 40, 9), NULL), -1);
+  CHECK_EQ(feed(part(2, false, true, 20, 9), &fill), 60);
+  CHECK_EQ(fill, 9);
+  // And a single-part message right after a cut one comes through whole
+  CHECK_EQ(feed(part(2, true, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, true, true, 7, 4), NULL), 7);
+}
+
+static void test_pool_exhausted(void)
+{
+  setup();
+  for (uint16_t s = 0; s < APP_REASM_POOL_SIZE; s++) {
+    CHECK_EQ(feed(part(10 + s, true, false, 40, 1), NULL), -1);
+  }
+  // No buffer: the rest of this message is discarded up to its final part
+  CHECK_EQ(feed(part(2, true, false, 40, 2), NULL), -1);
+  CHECK_EQ(feed(part(2, false, false, 40, 2), NULL), -1);
+  CHECK_EQ(feed(part(2, false, true, 40, 2), NULL), -1);
+  // Without its final part the next message of the source ends the discard
+  CHECK_EQ(feed(part(2, true, false, 40, 3), NULL), -1);
+  CHECK_EQ(feed(part(2, false, false, 40, 3), NULL), -1);
+  CHECK_EQ(feed(part(2, true, true, 6, 3), NULL), 6);
+}
+
+static void test_skip_expires(void)
+{
+  setup();
+  for (uint16_t s = 0; s < APP_REASM_POOL_SIZE; s++) {
+    CHECK_EQ(feed(part(10 + s, true, false, 40, 1), NULL), -1);
+  }
+  // Discarded rests that never end, more than there are entries
+  for (uint16_t s = 0; s < 2 * APP_REASM_POOL_SIZE; s++) {
+    CHECK_EQ(feed(part(20 + s, true, false, 40, 2), NULL), -1);
+  }
+  // After the timeout buffers and entries are free again; the rest of a
+  // discarded message that outlived its entry is still not handed out
+  host_clock_set_ms(host_clock_ms() + APP_REASM_TIMEOUT_MS + 1);
+  CHECK_EQ(feed(part(20, false, false, 40, 5), NULL), -1);
+  CHECK_EQ(feed(part(20, false, true, 1, 5), NULL), -1);
+  CHECK_EQ(reasm.orphaned, 1);
+  for (uint16_t s = 0; s < APP_REASM_POOL_SIZE; s++) {
+    CHECK_EQ(feed(part(30 + s, true, false, 40, 6), NULL), -1);
+  }
+  for (uint16_t s = 0; s < APP_REASM_POOL_SIZE; s++) {
+    CHECK_EQ(feed(part(30 + s, false, true, 1, 6), NULL), 41);
+  }
+}
+
+static void test_lost_first_part(void)
+{
+  uint8_t fill;
+
+  setup();
+  // The first part never comes: the rest is not a message of its own
+  CHECK_EQ(feed(part(2, false, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, false, true, 20, 1), NULL), -1);
+  CHECK_EQ(reasm.orphaned, 1);
+  CHECK_EQ(reasm.completed, 0);
+  // The next message of the source comes through whole
+  CHECK_EQ(feed(part(2, true, false, 40, 3), NULL), -1);
+  CHECK_EQ(feed(part(2, false, true, 20, 3), &fill), 60);
+  CHECK_EQ(fill, 3);
+}
+
+static void test_too_long(void)
+{
+  setup();
+  for (int i = 0; i < APP_REASM_MAX_LEN / 40; i++) {
+    CHECK_EQ(feed(part(2, i == 0, false, 40, 1), NULL), -1);
+  }
+  CHECK_EQ(feed(part(2, false, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, false, true, 40, 1), NULL), -1);
+  CHECK_EQ(feed(part(2, true, true, 3, 1), NULL), 3);
+  CHECK_EQ(reasm.too_long, 1);
+}
+
+static void test_pools_apart(void)
+{
+  app_reasm_t other;
+  uint8_t fill;
+
+  setup();
+  app_reasm_init(&other);
+  // The same source and opcode in two nodes: neither sees the other's parts
+  CHECK_EQ(feed(part(2, true, false, 40, 1), NULL), -1);
+  CHECK_EQ(feed_to(&other, part(2, true, false, 40, 7), NULL), -1);
+  CHECK_EQ(feed_to(&other, part(2, false, true, 2, 7), &fill), 42);
+  CHECK_EQ(fill, 7);
+  CHECK_EQ(feed(part(2, false, true, 3, 1), &fill), 43);
+  CHECK_EQ(fill, 1);
+  CHECK_EQ(reasm.completed, 1);
+  CHECK_EQ(other.completed, 1);
+}
+
+int main(void)
+{
+  host_log_mute(true);
+  app_time_init();
+  RUN(test_single_part);
+  RUN(test_interleaved_sources);
+  RUN(test_lost_final_part);
+  RUN(test_pool_exhausted);
+  RUN(test_skip_expires);
+  RUN(test_lost_first_part);
+  RUN(test_too_long);
+  RUN(test_pools_apart);
+  return host_test_result();
+}
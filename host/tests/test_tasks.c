@@ -0,0 +1,185 @@
+/***************************************************************************//**
+ * @file test_tasks.c
+ * @brief The kernel task graph of app_tasks.c on POSIX threads.
+ *
+ * The main thread plays the stack task: it posts vendor messages of up to
+ * three worker parts and commands, retrying whatever the full queues refuse,
+ * and logs with APP_STACK_LOG. The real worker and log tasks run on their own
+ * threads. The worker callbacks below check that every message arrives whole
+ * and in order and log with APP_TASK_LOG; the log sink checks that lines of
+ * the two producers are never torn and stay in order.
+ ******************************************************************************/
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "app_tasks.h"
+#include "app_telemetry.h"
+#include "app_time.h"
+#include "host_sdk.h"
+#include "host_test.h"
+
+#define MESSAGES                        20000
+#define LONGEST                         (3 * APP_RX_PAYLOAD_MAX)
+
+static atomic_uint rx_done;
+static atomic_uint rx_errors;
+static atomic_uint cmd_done;
+static atomic_uint cmd_errors;
+
+// Worker-side reassembly of the message being received
+static uint8_t assembled[LONGEST];
+static uint16_t assembled_len;
+static uint32_t next_message;
+static uint32_t next_cmd = 1;
+
+// Log sink state, under the host log lock
+static uint32_t lines;
+static uint32_t torn_lines;
+static app_telemetry_t telemetry;
+static app_tasks_t tasks;
+static long last_worker_line = -1;
+static long last_stack_line = -1;
+static uint32_t unordered_lines;
+
+static uint16_t message_len(uint32_t id)
+{
+  return (uint16_t)(id * 7 % (LONGEST + 1));
+}
+
+static uint8_t message_byte(uint32_t id, uint16_t offset)
+{
+  return (uint8_t)(id * 31 + offset);
+}
+
+static void worker_on_rx(app_tasks_t *t, const app_rx_msg_t *msg)
+{
+  (void)t;
+  uint32_t id = msg->source_address | (uint32_t)msg->destination_address << 16;
+
+  if (id != next_message || assembled_len + msg->len > LONGEST
+      || (assembled_len == 0) != (msg->first != 0)) {
+    atomic_fetch_add(&rx_errors, 1);
+    return;
+  }
+  memcpy(&assembled[assembled_len], msg->data, msg->len);
+  assembled_len += msg->len;
+  if (!msg->final) {
+    return;
+  }
+  if (assembled_len != message_len(id)) {
+    atomic_fetch_add(&rx_errors, 1);
+  }
+  for (uint16_t i = 0; i < assembled_len; i++) {
+    if (assembled[i] != message_byte(id, i)) {
+      atomic_fetch_add(&rx_errors, 1);
+      break;
+    }
+  }
+  APP_TASK_LOG("worker %lu\r\n", (unsigned long)id);
+  assembled_len = 0;
+  next_message++;
+  atomic_fetch_add(&rx_done, 1);
+}
+
+static void worker_on_cmd(app_tasks_t *t, uint32_t cmd)
+{
+  (void)t;
+  if (cmd != next_cmd) {
+    atomic_fetch_add(&cmd_errors, 1);
+  }
+  next_cmd = cmd + 1;
+  atomic_fetch_add(&cmd_done, 1);
+}
+
+static void check_line(const char *text)
+{
+  char who[8];
+  long n;
+  char end[4];
+
+  lines++;
+  if (sscanf(text, "%7s %ld%3s", who, &n, end) != 2 || strcmp(&text[strlen(text) - 2], "\r\n") != 0) {
+    torn_lines++;
+    return;
+  }
+  if (strcmp(who, "worker") == 0) {
+    if (n <= last_worker_line) {
+      unordered_lines++;
+    }
+    last_worker_line = n;
+  } else if (strcmp(who, "stack") == 0) {
+    if (n <= last_stack_line) {
+      unordered_lines++;
+    }
+    last_stack_line = n;
+  } else {
+    torn_lines++;
+  }
+}
+
+static void wait_for(atomic_uint *counter, unsigned target)
+{
+  struct timespec pause = { 0, 1000000 };
+
+  for (int i = 0; i < 10000 && atomic_load(counter) < target; i++) {
+    nanosleep(&pause, NULL);
+  }
+}
+
+static void test_task_graph(void)
+{
+  static uint8_t evt_buf[sizeof(sl_btmesh_evt_vendor_model_receive_t) + 255]
+  __attribute__((aligned(8)));
+  sl_btmesh_evt_vendor_model_receive_t *evt = (void *)evt_buf;
+  uint32_t refused = 0;
+  struct timespec pause = { 0, 20000000 };
+
+  host_log_set_sink(check_line);
+  app_time_init();
+  app_telemetry_init(&telemetry);
+  app_tasks_init(&tasks, &telemetry, worker_on_rx, worker_on_cmd);
+
+  for (uint32_t id = 0; id < MESSAGES; id++) {
+    memset(evt, 0, sizeof(*evt));
+    evt->source_address = id & 0xFFFF;
+    evt->destination_address = id >> 16;
+    evt->opcode = 1;
+    evt->final = 1;
+    evt->payload.len = (uint8_t)message_len(id);
+    for (uint16_t i = 0; i < evt->payload.len; i++) {
+      evt->payload.data[i] = message_byte(id, i);
+    }
+    while (!app_tasks_post_rx(&tasks, evt)) {
+      refused++;
+      sched_yield();
+    }
+    while (!app_tasks_post_cmd(&tasks, id + 1)) {
+      sched_yield();
+    }
+    APP_STACK_LOG("stack %lu\r\n", (unsigned long)id);
+  }
+  wait_for(&rx_done, MESSAGES);
+  wait_for(&cmd_done, MESSAGES);
+  // Let the log task write out what is still queued
+  nanosleep(&pause, NULL);
+  host_log_set_sink(NULL);
+
+  CHECK_EQ(atomic_load(&rx_done), MESSAGES);
+  CHECK_EQ(atomic_load(&rx_errors), 0);
+  CHECK_EQ(atomic_load(&cmd_done), MESSAGES);
+  CHECK_EQ(atomic_load(&cmd_errors), 0);
+  CHECK(lines > 0);
+  CHECK_EQ(torn_lines, 0);
+  CHECK_EQ(unordered_lines, 0);
+  printf("  %u messages, %u refused while full, %u of %u log lines written\n",
+         MESSAGES, refused, lines, 2 * MESSAGES);
+}
+
+int main(void)
+{
+  RUN(test_task_graph);
+  return host_test_result();
+}
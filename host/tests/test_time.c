@@ -0,0 +1,187 @@
+/***************************************************************************//**
+ * @file test_time.c
+ * @brief Exactness of the division-free tick conversions at the usual
+ *        sleeptimer frequencies, and the wraps of the 32-bit counters.
+ *
+ * The conversions are compared with a 128-bit division over the whole tick
+ * range the header promises, below 2^64 / frequency, for power-of-two and
+ * other frequencies. Set HOST_TIME_SAMPLES to change the number of random
+ * tick counts per frequency.
+ ******************************************************************************/
+#include <stdlib.h>
+
+#include "host_sdk.h"
+#include "app_time.h"
+#include "host_test.h"
+
+static const uint32_t frequencies[] = { 32768, 32000, 38400, 1024, 39062 };
+
+static uint64_t rng_state = 0x9E3779B97F4A7C15u;
+
+static uint64_t rng_next(void)
+{
+  // xorshift64
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return rng_state;
+}
+
+static uint64_t exact_ms(uint64_t ticks, uint32_t hz)
+{
+  return (uint64_t)((unsigned __int128)ticks * 1000 / hz);
+}
+
+/// Check every conversion at @p ticks against the exact value
+static void check_ticks(uint64_t ticks, uint32_t hz)
+{
+  uint64_t ms = exact_ms(ticks, hz);
+
+  CHECK_EQ(app_time_ticks_to_ms(ticks), ms);
+  host_clock_set_ticks(ticks);
+  CHECK_EQ(app_time_ms(), ms);
+  CHECK_EQ(app_time_s(), (uint32_t)(ticks / hz));
+}
+
+static void test_exact_at_frequencies(void)
+{
+  const char *env = getenv("HOST_TIME_SAMPLES");
+  uint32_t samples = env ? (uint32_t)strtoul(env, NULL, 0) : 200000;
+
+  for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+    uint32_t hz = frequencies[f];
+    uint64_t limit = UINT64_MAX / hz;
+
+    host_clock_set_frequency(hz);
+    app_time_init();
+
+    // Around zero, one second, one tick count wrap and the top of the range
+    for (uint64_t t = 0; t < 4 * (uint64_t)hz; t++) {
+      check_ticks(t, hz);
+    }
+    for (uint64_t t = (1ull << 32) - hz; t < (1ull << 32) + hz; t++) {
+      check_ticks(t, hz);
+    }
+    for (uint64_t t = limit - 2 * (uint64_t)hz; t < limit; t++) {
+      check_ticks(t, hz);
+    }
+    // Random counts spread over every magnitude
+    for (uint32_t n = 0; n < samples; n++) {
+      uint64_t t = rng_next() >> (rng_next() % 64);
+      check_ticks(t % limit, hz);
+    }
+  }
+  host_clock_set_frequency(32768);
+  app_time_init();
+}
+
+static void test_ms_to_ticks(void)
+{
+  for (size_t f = 0; f < sizeof(frequencies) / sizeof(frequencies[0]); f++) {
+    uint32_t hz = frequencies[f];
+
+    host_clock_set_frequency(hz);
+    app_time_init();
+    for (uint32_t ms = 0; ms < 100000; ms++) {
+      CHECK_EQ(app_time_ms_to_ticks(ms), (uint64_t)ms * hz / 1000);
+    }
+    for (uint32_t ms = UINT32_MAX - 100000; ms != 0; ms++) {
+      CHECK_EQ(app_time_ms_to_ticks(ms), (uint64_t)ms * hz / 1000);
+    }
+  }
+  host_clock_set_frequency(32768);
+  app_time_init();
+}
+
+static void test_tick_count_wrap(void)
+{
+  uint64_t last = 0;
+
+  // The 32-bit hardware count wraps every 36 h at 32768 Hz; the 64-bit
+  // base keeps the millisecond clock monotonic across it
+  for (uint64_t t = (1ull << 32) - 100000; t < (1ull << 32) + 100000; t += 7) {
+    host_clock_set_ticks(t);
+    CHECK(app_time_ms() >= last);
+    last = app_time_ms();
+  }
+  CHECK_EQ(last, exact_ms((1ull << 32) + 99995, 32768));
+}
+
+static void test_seconds_wrap(void)
+{
+  uint64_t wrap_ticks = (1ull << 32) * 32768;
+
+  host_clock_set_ticks(wrap_ticks - 32768);
+  CHECK_EQ(app_time_s(), UINT32_MAX);
+  host_clock_set_ticks(wrap_ticks);
+  CHECK_EQ(app_time_s(), 0);
+  host_clock_set_ticks(wrap_ticks + 5 * 32768);
+  CHECK_EQ(app_time_s(), 5);
+  // Milliseconds keep counting where seconds wrap
+  CHECK_EQ(app_time_ms(), (uint64_t)1000 * ((1ull << 32) + 5));
+}
+
+static void test_uptime_across_wrap(void)
+{
+  app_time_uptime_enc_t enc = { 0 };
+  app_time_uptime_dec_t dec = { 0 };
+  uint8_t buf[APP_TIME_UPTIME_MAX_LEN];
+  uint32_t uptime, got;
+  uint8_t len;
+
+  // Base just before the wrap, deltas after it
+  for (int i = 0; i < 3 * APP_TIME_ABS_EVERY; i++) {
+    uptime = UINT32_MAX - 20 + 10u * (uint32_t)i;
+    len = app_time_encode_uptime(&enc, uptime, buf);
+    CHECK(len <= APP_TIME_UPTIME_MAX_LEN);
+    CHECK(app_time_decode_uptime(&dec, buf, len, &got));
+    CHECK_EQ(got, uptime);
+    if (i % APP_TIME_ABS_EVERY != 0) {
+      // Deltas of a few seconds stay short over the wrap
+      CHECK(len <= 2);
+    }
+  }
+}
+
+static void test_uptime_lost_messages(void)
+{
+  app_time_uptime_enc_t enc = { 0 };
+  app_time_uptime_dec_t dec = { 0 };
+  uint8_t buf[APP_TIME_UPTIME_MAX_LEN];
+  uint32_t got;
+  uint8_t len;
+
+  // A receiver that starts on a delta waits for the next absolute
+  app_time_encode_uptime(&enc, 1000000, buf);
+  len = app_time_encode_uptime(&enc, 1000060, buf);
+  CHECK(!app_time_decode_uptime(&dec, buf, len, &got));
+
+  // A lost delta costs nothing; a lost absolute rejects the old epoch
+  for (int i = 2; i <= APP_TIME_ABS_EVERY; i++) {
+    len = app_time_encode_uptime(&enc, 1000000 + 60u * (uint32_t)i, buf);
+  }
+  CHECK(app_time_decode_uptime(&dec, buf, len, &got));
+  CHECK_EQ(got, 1000000 + 60u * APP_TIME_ABS_EVERY);
+  for (int i = 1; i <= APP_TIME_ABS_EVERY; i++) {
+    len = app_time_encode_uptime(&enc, 2000000 + 60u * (uint32_t)i, buf);
+  }
+  CHECK(!app_time_decode_uptime(&dec, buf, len, &got));
+
+  // Truncated and overlong payloads
+  len = app_time_encode_uptime(&enc, UINT32_MAX, buf);
+  CHECK(!app_time_decode_uptime(&dec, buf, len - 1, &got));
+  buf[4] = 0x80;
+  CHECK(!app_time_decode_uptime(&dec, buf, 5, &got));
+}
+
+int main(void)
+{
+  app_time_init();
+  RUN(test_exact_at_frequencies);
+  RUN(test_ms_to_ticks);
+  RUN(test_tick_count_wrap);
+  RUN(test_seconds_wrap);
+  RUN(test_uptime_across_wrap);
+  RUN(test_uptime_lost_messages);
+  return host_test_result();
+}
@@ -47,6 +47,8 @@
 #define OPCODE_MSSV            0x02
 #define OPCODE_UPTIME          0x03
 #define OPCODE_LED             0x04
+#define OPCODE_MSSV_LIST       0x07   // danh sách MSSV nén, xem app_mssv.h
+#define OPCODE_MULTI_RECORD    0x0A   // nhiều bản ghi trong một bản tin, xem app_tlv.h
 
 // Group Address (client publish → server subscribe)
 #define GROUP_ADDR_STATUS      0xC001